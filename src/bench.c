@@ -0,0 +1,146 @@
+/*
+ ============================================================================
+ Name        : bench.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Collects the latency of client operations and reports the
+             : percentiles at the end of a benchmark run.
+ ============================================================================
+ */
+
+#ifndef BENCH_H
+#include "bench.h"
+#endif
+
+int bench_compare(const void * a, const void * b);
+
+
+/*******************************************************************************
+ * CONSTRUCTS A NEW BENCH THAT CAN HOLD CAPACITY SAMPLES.  RETURNS NULL IF THE *
+ * MEMORY ALLOCATION FAILS.                                                    *
+ ******************************************************************************/
+bench * bench_new(int capacity)
+{
+	bench * the_bench = (bench *) malloc(sizeof(bench));
+
+	if (the_bench == NULL)
+		return NULL;
+
+	the_bench->samples = (double *) malloc(sizeof(double) * capacity);
+
+	if (the_bench->samples == NULL)
+	{
+		free(the_bench);
+		return NULL;
+	}
+
+	the_bench->count    = 0;
+	the_bench->capacity = capacity;
+	the_bench->failures = 0;
+	the_bench->sorted   = 0;
+	the_bench->started  = bench_now_ms();
+	the_bench->finished = the_bench->started;
+
+	return the_bench;
+}
+
+
+/*******************************************************************************
+ * RECORDS THE LATENCY (MS) OF ONE OPERATION.  A FAILED OPERATION IS COUNTED   *
+ * AS A FAILURE BUT ITS LATENCY IS STILL RECORDED.  SAMPLES PAST THE CAPACITY  *
+ * ARE DROPPED.                                                                *
+ ******************************************************************************/
+void bench_record(bench * the_bench, double latency, int failed)
+{
+	if (failed)
+		the_bench->failures++;
+
+	if (the_bench->count < the_bench->capacity)
+		the_bench->samples[the_bench->count++] = latency;
+
+	the_bench->finished = bench_now_ms();
+	the_bench->sorted = 0;
+}
+
+
+/*******************************************************************************
+ * RETURNS THE LATENCY AT THE PERCENTILE PROVIDED (0 - 100).  SORTS THE        *
+ * SAMPLES THE FIRST TIME IT IS CALLED AFTER A RECORD.                         *
+ ******************************************************************************/
+double bench_percentile(bench * the_bench, double percentile)
+{
+	if (the_bench->count == 0)
+		return 0.0;
+
+	if (!the_bench->sorted)
+	{
+		qsort(the_bench->samples, the_bench->count, sizeof(double), bench_compare);
+		the_bench->sorted = 1;
+	}
+
+	// NEAREST RANK
+	int rank = (int) ((percentile / 100.0) * the_bench->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > the_bench->count)
+		rank = the_bench->count;
+
+	return the_bench->samples[rank - 1];
+}
+
+
+/*******************************************************************************
+ * PRINTS THE NUMBER OF OPERATIONS, FAILURES, THROUGHPUT AND THE P50, P90, P99 *
+ * AND MAX LATENCY OF THE RUN TO THE FILE PROVIDED.                            *
+ ******************************************************************************/
+void bench_report(bench * the_bench, char * label, FILE * out)
+{
+	double elapsed = (the_bench->finished - the_bench->started) / 1000.0;
+	double throughput = 0.0;
+	if (elapsed > 0)
+		throughput = the_bench->count / elapsed;
+
+	fprintf(out, "%s: ops=%d failures=%d elapsed=%.2fs throughput=%.1f ops/s\n",
+			label, the_bench->count, the_bench->failures, elapsed, throughput);
+	fprintf(out, "%s: p50=%.2fms p90=%.2fms p99=%.2fms max=%.2fms\n", label,
+			bench_percentile(the_bench, 50),
+			bench_percentile(the_bench, 90),
+			bench_percentile(the_bench, 99),
+			bench_percentile(the_bench, 100));
+}
+
+
+/*******************************************************************************
+ * FREES THE BENCH AND ITS SAMPLES                                             *
+ ******************************************************************************/
+void bench_free(bench * the_bench)
+{
+	free(the_bench->samples);
+	free(the_bench);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN MILLISECONDS.                                   *
+ ******************************************************************************/
+double bench_now_ms()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return((tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0));
+}
+
+
+// QSORT COMPARATOR FOR THE SAMPLES
+int bench_compare(const void * a, const void * b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
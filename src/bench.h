@@ -0,0 +1,69 @@
+/*
+ ============================================================================
+ Name        : bench.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Collects the latency of client operations and reports the
+             : percentiles at the end of a benchmark run.
+ ============================================================================
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#define BENCH_DEFAULT_OPS 1000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+// HOLDS THE LATENCY OF EVERY OPERATION OF A RUN
+typedef struct bench {
+	double * samples;   // latencies in milliseconds
+	int count;
+	int capacity;
+	int failures;
+	int sorted;         // 1 if the samples are sorted
+	double started;     // time the run started in ms
+	double finished;    // time the run finished in ms
+} bench;
+
+
+/*******************************************************************************
+ * CONSTRUCTS A NEW BENCH THAT CAN HOLD CAPACITY SAMPLES.  RETURNS NULL IF THE *
+ * MEMORY ALLOCATION FAILS.                                                    *
+ ******************************************************************************/
+bench * bench_new(int capacity);
+
+/*******************************************************************************
+ * RECORDS THE LATENCY (MS) OF ONE OPERATION.  A FAILED OPERATION IS COUNTED   *
+ * AS A FAILURE BUT ITS LATENCY IS STILL RECORDED.  SAMPLES PAST THE CAPACITY  *
+ * ARE DROPPED.                                                                *
+ ******************************************************************************/
+void bench_record(bench * the_bench, double latency, int failed);
+
+/*******************************************************************************
+ * RETURNS THE LATENCY AT THE PERCENTILE PROVIDED (0 - 100).  SORTS THE        *
+ * SAMPLES THE FIRST TIME IT IS CALLED AFTER A RECORD.                         *
+ ******************************************************************************/
+double bench_percentile(bench * the_bench, double percentile);
+
+/*******************************************************************************
+ * PRINTS THE NUMBER OF OPERATIONS, FAILURES, THROUGHPUT AND THE P50, P90, P99 *
+ * AND MAX LATENCY OF THE RUN TO THE FILE PROVIDED.                            *
+ ******************************************************************************/
+void bench_report(bench * the_bench, char * label, FILE * out);
+
+/*******************************************************************************
+ * FREES THE BENCH AND ITS SAMPLES                                             *
+ ******************************************************************************/
+void bench_free(bench * the_bench);
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN MILLISECONDS.                                   *
+ ******************************************************************************/
+double bench_now_ms();
+
+#endif /* BENCH_H */
@@ -0,0 +1,234 @@
+/*
+ ============================================================================
+ Name        : cache.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.02
+ Description : Client read cache.  See cache.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef CACHE_H
+#include "cache.h"
+#endif
+
+#include <time.h>
+
+int cache_find(kv_cache * cache, int key);
+int cache_hash(kv_cache * cache, int key);
+void cache_unlink(kv_cache * cache, int entry);
+void cache_unchain(kv_cache * cache, int entry);
+void cache_push(kv_cache * cache, int entry);
+
+
+/*******************************************************************************
+ * RETURNS A CACHE OF AT MOST ENTRIES KEYS, OR NULL IF THERE IS NO MEMORY.     *
+ ******************************************************************************/
+kv_cache * cache_new(int entries)
+{
+	if (entries < 1)
+		return(NULL);
+
+	kv_cache * cache = (kv_cache *) calloc(1, sizeof(kv_cache));
+	if (cache == NULL)
+		return(NULL);
+
+	// AT LEAST TWO BUCKETS PER ENTRY KEEPS THE CHAINS SHORT
+	cache->buckets = 1;
+	while (cache->buckets < 2 * entries)
+		cache->buckets <<= 1;
+
+	cache->capacity = entries;
+	cache->index    = (int *) malloc(cache->buckets * sizeof(int));
+	cache->entries  = (cache_entry *) calloc(entries, sizeof(cache_entry));
+	if (cache->index == NULL || cache->entries == NULL)
+	{
+		cache_free(cache);
+		return(NULL);
+	}
+
+	for (int i = 0; i < cache->buckets; i++)
+		cache->index[i] = CACHE_NONE;
+	cache->newest = CACHE_NONE;
+	cache->oldest = CACHE_NONE;
+	pthread_mutex_init(&cache->lock, NULL);
+	return(cache);
+}
+
+
+/*******************************************************************************
+ * FREES THE CACHE.                                                            *
+ ******************************************************************************/
+void cache_free(kv_cache * cache)
+{
+	if (cache == NULL)
+		return;
+	free(cache->index);
+	free(cache->entries);
+	free(cache);
+}
+
+
+/*******************************************************************************
+ * STORES THE VALUE OF THE KEY IN VALUE AND RETURNS 0 IF IT IS CACHED AND ITS  *
+ * LEASE HAS NOT RUN OUT AT NOW, OTHERWISE RETURNS -1.                         *
+ ******************************************************************************/
+int cache_get(kv_cache * cache, int key, int * value, double now)
+{
+	pthread_mutex_lock(&cache->lock);
+	int entry = cache_find(cache, key);
+	if (entry == CACHE_NONE)
+	{
+		cache->misses++;
+		pthread_mutex_unlock(&cache->lock);
+		return(-1);
+	}
+
+	if (cache->entries[entry].expires <= now)
+	{
+		// THE LEASE RAN OUT, THE NEXT GET ASKS THE SERVERS AGAIN
+		cache->misses++;
+		cache->expired++;
+		pthread_mutex_unlock(&cache->lock);
+		return(-1);
+	}
+
+	*value = cache->entries[entry].value;
+	cache_unlink(cache, entry);
+	cache_push(cache, entry);
+	cache->hits++;
+	pthread_mutex_unlock(&cache->lock);
+	return(0);
+}
+
+
+/*******************************************************************************
+ * CACHES THE VALUE OF THE KEY UNTIL EXPIRES, EVICTING THE LEAST RECENTLY      *
+ * USED KEY IF THE CACHE IS FULL.                                              *
+ ******************************************************************************/
+void cache_put(kv_cache * cache, int key, int value, double expires)
+{
+	pthread_mutex_lock(&cache->lock);
+	int entry = cache_find(cache, key);
+	if (entry != CACHE_NONE)
+	{
+		cache_unlink(cache, entry);
+	} else {
+		if (cache->count < cache->capacity)
+		{
+			entry = cache->count++;
+		} else {
+			entry = cache->oldest;
+			cache_unlink(cache, entry);
+			cache_unchain(cache, entry);
+			cache->evictions++;
+		}
+		int bucket = cache_hash(cache, key);
+		cache->entries[entry].key   = key;
+		cache->entries[entry].chain = cache->index[bucket];
+		cache->index[bucket] = entry;
+	}
+
+	cache->entries[entry].value   = value;
+	cache->entries[entry].expires = expires;
+	cache_push(cache, entry);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+
+/*******************************************************************************
+ * FORGETS THE KEY, A WRITE OF THIS CLIENT CHANGED IT.                         *
+ ******************************************************************************/
+void cache_invalidate(kv_cache * cache, int key)
+{
+	pthread_mutex_lock(&cache->lock);
+	int entry = cache_find(cache, key);
+	if (entry != CACHE_NONE)
+		cache->entries[entry].expires = 0;  // STAYS IN ITS PLACE UNTIL IT IS EVICTED OR CACHED AGAIN
+	pthread_mutex_unlock(&cache->lock);
+}
+
+
+/*******************************************************************************
+ * PRINTS THE HITS, MISSES AND EVICTIONS OF THE CACHE ON ONE LINE.             *
+ ******************************************************************************/
+void cache_print(kv_cache * cache, FILE * out)
+{
+	pthread_mutex_lock(&cache->lock);
+	uint64_t lookups = cache->hits + cache->misses;
+	fprintf(out, "cache: entries=%d/%d hits=%llu misses=%llu expired=%llu evictions=%llu hit_rate=%.1f%%\n",
+			cache->count, cache->capacity, (unsigned long long) cache->hits, (unsigned long long) cache->misses,
+			(unsigned long long) cache->expired, (unsigned long long) cache->evictions,
+			lookups > 0 ? 100.0 * cache->hits / lookups : 0.0);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE TIME IN MS OF THE MONOTONIC CLOCK, THE ONE LEASES ARE COUNTED   *
+ * ON.                                                                         *
+ ******************************************************************************/
+double cache_now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0));
+}
+
+
+// RETURNS THE ENTRY OF THE KEY, OR CACHE_NONE
+int cache_find(kv_cache * cache, int key)
+{
+	int entry = cache->index[cache_hash(cache, key)];
+	while (entry != CACHE_NONE && cache->entries[entry].key != key)
+		entry = cache->entries[entry].chain;
+	return(entry);
+}
+
+
+// THE BUCKET OF THE KEY IN THE HASH INDEX
+int cache_hash(kv_cache * cache, int key)
+{
+	return((int) (((uint32_t) key * 0x9E3779B1U) & (uint32_t) (cache->buckets - 1)));
+}
+
+
+// TAKES THE ENTRY OUT OF THE LRU LIST
+void cache_unlink(kv_cache * cache, int entry)
+{
+	cache_entry * e = &cache->entries[entry];
+	if (e->newer != CACHE_NONE)
+		cache->entries[e->newer].older = e->older;
+	else
+		cache->newest = e->older;
+
+	if (e->older != CACHE_NONE)
+		cache->entries[e->older].newer = e->newer;
+	else
+		cache->oldest = e->newer;
+}
+
+
+// TAKES THE ENTRY OUT OF ITS HASH CHAIN, BEFORE IT IS REUSED FOR ANOTHER KEY
+void cache_unchain(kv_cache * cache, int entry)
+{
+	int * link = &cache->index[cache_hash(cache, cache->entries[entry].key)];
+	while (*link != entry)
+		link = &cache->entries[*link].chain;
+	*link = cache->entries[entry].chain;
+}
+
+
+// MAKES THE ENTRY THE MOST RECENTLY USED
+void cache_push(kv_cache * cache, int entry)
+{
+	cache_entry * e = &cache->entries[entry];
+	e->newer = CACHE_NONE;
+	e->older = cache->newest;
+	if (cache->newest != CACHE_NONE)
+		cache->entries[cache->newest].newer = entry;
+	cache->newest = entry;
+	if (cache->oldest == CACHE_NONE)
+		cache->oldest = entry;
+}
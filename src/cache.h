@@ -0,0 +1,98 @@
+/*
+ ============================================================================
+ Name        : cache.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.02
+ Description : The read cache of a client.  A GET sent with the cache on asks
+             : the servers for a lease (see lease.h) and the value is kept
+             : until the lease runs out, so a read of the key is answered
+             : without a round trip until then.  The lease is counted from
+             : when the GET was sent, before any server granted it, so the
+             : client stops using a value before the servers let a write
+             : through.
+             :
+             : The cache holds at most the number of entries it was made with,
+             : the least recently used one is evicted to make room.  Entries
+             : are found through a hash of their key.  One lock guards it, so
+             : the threads of a client can share one cache.
+ ============================================================================
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#define CACHE_DEFAULT_ENTRIES  4096
+#define CACHE_LEASE_MS         200     // lease a cached GET asks for
+#define CACHE_NONE             -1      // end of a chain or of the lru list
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// ONE CACHED KEY, LINKED IN ITS HASH CHAIN AND IN THE LRU LIST
+typedef struct cache_entry {
+	int key;
+	int value;
+	double expires;   // cache_now_ms when the lease runs out
+	int chain;        // next entry of the same hash bucket
+	int newer;        // lru neighbours
+	int older;
+} cache_entry;
+
+typedef struct kv_cache {
+	pthread_mutex_t lock;
+	int capacity;
+	int count;
+	int buckets;      // size of the hash index, a power of two
+	int * index;      // first entry of every bucket
+	cache_entry * entries;
+	int newest;       // head of the lru list
+	int oldest;       // tail, evicted first
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t expired; // misses on a key whose lease had run out
+	uint64_t evictions;
+} kv_cache;
+
+
+/*******************************************************************************
+ * RETURNS A CACHE OF AT MOST ENTRIES KEYS, OR NULL IF THERE IS NO MEMORY.     *
+ ******************************************************************************/
+kv_cache * cache_new(int entries);
+
+/*******************************************************************************
+ * FREES THE CACHE.                                                            *
+ ******************************************************************************/
+void cache_free(kv_cache * cache);
+
+/*******************************************************************************
+ * STORES THE VALUE OF THE KEY IN VALUE AND RETURNS 0 IF IT IS CACHED AND ITS  *
+ * LEASE HAS NOT RUN OUT AT NOW, OTHERWISE RETURNS -1.                         *
+ ******************************************************************************/
+int cache_get(kv_cache * cache, int key, int * value, double now);
+
+/*******************************************************************************
+ * CACHES THE VALUE OF THE KEY UNTIL EXPIRES, EVICTING THE LEAST RECENTLY      *
+ * USED KEY IF THE CACHE IS FULL.                                              *
+ ******************************************************************************/
+void cache_put(kv_cache * cache, int key, int value, double expires);
+
+/*******************************************************************************
+ * FORGETS THE KEY, A WRITE OF THIS CLIENT CHANGED IT.                         *
+ ******************************************************************************/
+void cache_invalidate(kv_cache * cache, int key);
+
+/*******************************************************************************
+ * PRINTS THE HITS, MISSES AND EVICTIONS OF THE CACHE ON ONE LINE.             *
+ ******************************************************************************/
+void cache_print(kv_cache * cache, FILE * out);
+
+/*******************************************************************************
+ * RETURNS THE TIME IN MS OF THE MONOTONIC CLOCK, THE ONE LEASES ARE COUNTED   *
+ * ON.                                                                         *
+ ******************************************************************************/
+double cache_now_ms();
+
+#endif /* CACHE_H */
@@ -12,6 +12,15 @@
 #include "client.h"
 #endif
 
+// EVERY THREAD HAS ITS OWN HANDLES, A CLIENT HANDLE CAN'T BE SHARED BETWEEN CALLS IN FLIGHT
+__thread char *   client_handle_host[CLIENT_MAX_HANDLES];  // hosts with a cached rpc handle
+__thread CLIENT * client_handle[CLIENT_MAX_HANDLES];       // the cached rpc handles
+__thread int      client_handle_count = 0;
+
+int client_leader = RPC_NO_HINT;  // line of serverlist.txt the last reply named the leader, shared by the threads
+kv_cache * client_cache = NULL;   // the read cache shared by the threads, NULL unless client_cache_enable was called
+version_session * client_session = NULL;  // the session tokens shared by the threads, NULL unless client_session_enable was called
+
 /*******************************************************
  * SENDS A MESSAGE/COMMAND TO THE SERVER PROVIDED AS   *
  * HOSTNAME.  THE RESPONSE FROM THE SERVER IS STORED   *
@@ -25,6 +34,20 @@ int client_rpc_send(char* hostname, int command, xdrMsg * message, xdrMsg * resp
 {
 
 	char s_command[BUFFSIZE];
+
+	// A KEY UNDER LEASE IS ANSWERED FROM THE CACHE, WITHOUT A ROUND TRIP, UNLESS THE GET ASKS FOR ANOTHER CONSISTENCY
+	if (command == RPC_GET && client_cache != NULL && message->consistency == READ_QUORUM
+	&&  cache_get(client_cache, message->key, &response->value, cache_now_ms()) == 0)
+	{
+		response->key     = message->key;
+		response->status  = OK;
+		response->command = RPC_GET;
+		response->hint    = RPC_NO_HINT;
+		sprintf(s_command,"RECV=CACHED_VALUE(%d)", response->value);
+		log_write("client.log", hostname, s_command);
+		return(0);
+	}
+
 	switch (command)
 	{
 	case RPC_PUT:
@@ -45,7 +68,49 @@ int client_rpc_send(char* hostname, int command, xdrMsg * message, xdrMsg * resp
 
 	log_write("client.log", hostname, s_command);
 
-	int status = callrpc(hostname, RPC_PROG_NUM, RPC_PROC_VER, command, xdr_rpc, message, xdr_rpc, response);
+	// TELL THE PROPOSER HOW LONG WE WILL WAIT SO IT CAN GIVE UP IN TIME
+	message->deadline = RPC_CLIENT_TIMEOUT_MS;
+
+	// EVERY OPERATION GETS ITS OWN TRACE ID, THE SERVERS RECORD THEIR PART UNDER IT
+	message->pid = (int) trace_new_id();
+	uint64_t started = trace_now_ns();
+
+	// THE LEASE IS COUNTED FROM NOW, BEFORE ANY SERVER GRANTED IT
+	message->lease = (command == RPC_GET && client_cache != NULL) ? CACHE_LEASE_MS : 0;
+
+	// A GET ASKS FOR AT LEAST THE VERSION OF THE KEY THIS SESSION HAS WRITTEN OR READ
+	if (command == RPC_GET && version_token(client_session, message->key) > message->version)
+		message->version = version_token(client_session, message->key);
+	double asked = cache_now_ms();
+
+	int status = RPC_CANTSEND;
+	CLIENT * handle = client_get_handle(hostname);
+	if (handle != NULL)
+	{
+		struct timeval timeout;
+		timeout.tv_sec  = RPC_CLIENT_TIMEOUT_MS / 1000;
+		timeout.tv_usec = (RPC_CLIENT_TIMEOUT_MS % 1000) * 1000;
+		status = clnt_call(handle, command, (xdrproc_t) xdr_rpc, (caddr_t) message,
+				(xdrproc_t) xdr_rpc, (caddr_t) response, timeout);
+
+		if (status != RPC_SUCCESS)
+			client_drop_handle(hostname);
+	}
+
+	if (status == 0)
+		version_observe(client_session, message->key, response->version);
+
+	if (client_cache != NULL)
+	{
+		if (command != RPC_GET)
+			cache_invalidate(client_cache, message->key);
+		else if (status == 0 && response->status == OK && response->lease > 0)
+			cache_put(client_cache, message->key, response->value, asked + response->lease);
+	}
+
+	TRACE_EVENT(TRACE_CLIENT, (uint32_t) message->pid, TRACE_NO_PEER, message->key,
+			status == 0 ? response->value : message->value, status == 0 ? response->lc : -1,
+			status == 0 ? response->status : FAILURE, (trace_now_ns() - started) / 1e6);
 
 	if (status != 0)
 	{
@@ -72,12 +137,382 @@ int client_rpc_send(char* hostname, int command, xdrMsg * message, xdrMsg * resp
 				sprintf(s_command,"RECV=KEYNOTFOUND(%d)", message->key);
 			break;
 		}
+
+		// WRITE OUT TO THE LOG, ONLY NOW S_COMMAND IS THE ANSWER (TRACECAPTURE READS EVERY SENT= AS ONE OPERATION)
+		log_write("client.log", hostname, s_command);
+	}
+	return status;
+
+}
+
+/*******************************************************
+ * SENDS A GET, PUT OR DEL LIKE CLIENT_RPC_SEND, BUT   *
+ * A PUT OR DEL GOES TO THE LEADER THE LAST REPLY      *
+ * NAMED INSTEAD OF SERVERS[SERVER], SO IT DOESN'T     *
+ * DUEL WITH THE LEADER'S PROPOSALS.  A WRITE NACKED   *
+ * BY A SERVER THAT NAMES ANOTHER LEADER IS SENT TO    *
+ * IT ONCE MORE (A REDIRECT).  A CALL TO THE LEADER    *
+ * THAT FAILS FORGETS IT AND IS SENT ONCE MORE TO      *
+ * SERVERS[SERVER], OR THE NEXT ONE IF THAT WAS IT.    *
+ * THE HINTS NAME A SERVER BY ITS LINE OF              *
+ * SERVERLIST.TXT, SO SERVERS MUST BE IN THAT ORDER.   *
+ * RETURNS WHAT THE LAST CLIENT_RPC_SEND RETURNED.     *
+ ******************************************************/
+int client_rpc_route(char** servers, int server_count, int server, int command, xdrMsg * message, xdrMsg * response)
+{
+	int leader = __atomic_load_n(&client_leader, __ATOMIC_RELAXED);
+	int target = server;
+	if (command != RPC_GET && leader >= 0 && leader < server_count)
+		target = leader;
+
+	int status = client_rpc_send(servers[target], command, message, response);
+	if (status != 0)
+	{
+		// THE LEADER IS DOWN OR GONE, FALL BACK TO THE SERVER THE CALLER PICKED
+		if (target != leader)
+			return(status);
+		__atomic_compare_exchange_n(&client_leader, &leader, RPC_NO_HINT, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		target = (target == server) ? (server + 1) % server_count : server;
+		log_write("client.log", servers[target], "FALLBACK=LEADER_DOWN");
+		return(client_rpc_send(servers[target], command, message, response));
+	}
+
+	int hint = response->hint;
+	if (hint < 0 || hint >= server_count)
+		return(status);
+	__atomic_store_n(&client_leader, hint, __ATOMIC_RELAXED);
+
+	// I LOST TO ANOTHER PROPOSER, IT IS THE ONE TO ASK
+	if (command != RPC_GET && response->status != OK && hint != target)
+	{
+		log_write("client.log", servers[hint], "REDIRECT=LEADER");
+		status = client_rpc_send(servers[hint], command, message, response);
+	}
+	return(status);
+}
+
+/*******************************************************
+ * RETURNS THE CACHED RPC HANDLE FOR THE HOST PROVIDED *
+ * CREATING IT ON FIRST USE.  RETURNS NULL IF THE HOST *
+ * CANNOT BE REACHED.                                  *
+ ******************************************************/
+CLIENT * client_get_handle(char* hostname)
+{
+	// A HOST:INSTANCE ENTRY SELECTS THE PROGRAM OF THAT INSTANCE
+	char host[PEER_HOST_LENGTH];
+	unsigned long program = peer_parse_entry(hostname, host);
+
+	for (int i = 0; i < client_handle_count; i++)
+	{
+		if (strcmp(client_handle_host[i], hostname) == 0)
+		{
+			if (client_handle[i] == NULL)
+				client_handle[i] = clnt_create(host, program, RPC_PROC_VER, "udp");
+			return(client_handle[i]);
+		}
+	}
+
+	CLIENT * handle = clnt_create(host, program, RPC_PROC_VER, "udp");
+	if (handle != NULL && client_handle_count < CLIENT_MAX_HANDLES)
+	{
+		client_handle_host[client_handle_count] = malloc(strlen(hostname) + 1);
+		strcpy(client_handle_host[client_handle_count], hostname);
+		client_handle[client_handle_count] = handle;
+		client_handle_count++;
+	}
+
+	return(handle);
+}
+
+/*******************************************************
+ * SENDS AN RPC_MGET OR RPC_MPUT BATCH TO THE SERVER   *
+ * PROVIDED AS HOSTNAME, LIKE CLIENT_RPC_SEND SENDS A  *
+ * MESSAGE.  THE ANSWER OF EVERY KEY IS STORED IN      *
+ * RESPONSE.  RETURNS 0 ON SUCCESS, -1 IF THE BATCH IS *
+ * POORLY FORMED, OTHERWISE THE CLNT_STAT.             *
+ ******************************************************/
+int client_rpc_batch(char* hostname, int command, xdrBatch * message, xdrBatch * response)
+{
+	char s_command[BUFFSIZE];
+	if ((command != RPC_MGET && command != RPC_MPUT) || message->count < 1 || message->count > RPC_BATCH_MAX)
+	{
+		sprintf(s_command, "BAD COMMAND");
+		log_write("client.log", hostname, s_command);
+		return (-1);
+	}
+
+	sprintf(s_command, "SENT=%s(N=%d)", command == RPC_MGET ? "MGET" : "MPUT", message->count);
+	log_write("client.log", hostname, s_command);
+
+	message->command  = command;
+	message->deadline = RPC_CLIENT_TIMEOUT_MS;
+	message->pid      = (int) trace_new_id();
+	uint64_t started = trace_now_ns();
+
+	int status = RPC_CANTSEND;
+	CLIENT * handle = client_get_handle(hostname);
+	if (handle != NULL)
+	{
+		struct timeval timeout;
+		timeout.tv_sec  = RPC_CLIENT_TIMEOUT_MS / 1000;
+		timeout.tv_usec = (RPC_CLIENT_TIMEOUT_MS % 1000) * 1000;
+		status = clnt_call(handle, command, (xdrproc_t) xdr_batch, (caddr_t) message,
+				(xdrproc_t) xdr_batch, (caddr_t) response, timeout);
+
+		if (status != RPC_SUCCESS)
+			client_drop_handle(hostname);
+	}
+
+	TRACE_EVENT(TRACE_CLIENT, (uint32_t) message->pid, TRACE_NO_PEER, message->count, command,
+			status == 0 ? response->lc : -1, status == 0 ? response->status : FAILURE,
+			(trace_now_ns() - started) / 1e6);
+
+	if (status != 0)
+	{
+		sprintf(s_command, "RECV=SEND_FAILURE");
+	} else {
+		int ok = 0;
+		for (int k = 0; k < response->count; k++)
+			if (response->results[k] == OK)
+				ok++;
+		sprintf(s_command, "RECV=%s_%s(%d of %d OK)", command == RPC_MGET ? "MGET" : "MPUT",
+				response->status == OK ? "SUCCESS" : "FAILURE", ok, message->count);
 	}
 
-	// WRITE OUT TO THE LOG
 	log_write("client.log", hostname, s_command);
 	return status;
+}
+
+/*******************************************************
+ * GETS COUNT KEYS FROM THE SERVER HOST IN ONE RPC_MGET*
+ * THE VALUE OF KEYS[I] IS STORED IN VALUES[I] AND OK  *
+ * (FOUND BY A QUAROM) OR NACK IN RESULTS[I].  RETURNS *
+ * THE NUMBER OF KEYS FOUND, OR -1 IF THE CALL FAILED. *
+ ******************************************************/
+int client_mget(char* host, int count, int * keys, int * values, int * results)
+{
+	xdrBatch message  = { 0 };
+	xdrBatch response = { 0 };
+	message.count = count;
+	for (int k = 0; k < count && k < RPC_BATCH_MAX; k++)
+		message.keys[k] = keys[k];
+
+	if (client_rpc_batch(host, RPC_MGET, &message, &response) != 0 || response.count != count)
+		return(-1);
+
+	int found = 0;
+	for (int k = 0; k < count; k++)
+	{
+		values[k]  = response.values[k];
+		results[k] = response.results[k];
+		if (results[k] == OK)
+			found++;
+	}
+	return(found);
+}
+
+/*******************************************************
+ * PUTS COUNT KEYS ON THE SERVER HOST IN ONE RPC_MPUT, *
+ * ALL OF THEM DECIDED BY ONE PAXOS INSTANCE.  OK OR   *
+ * NACK FOR KEYS[I] IS STORED IN RESULTS[I].  RETURNS  *
+ * THE NUMBER OF KEYS PUT, OR -1 IF THE CALL FAILED.   *
+ ******************************************************/
+int client_mput(char* host, int count, int * keys, int * values, int * results)
+{
+	xdrBatch message  = { 0 };
+	xdrBatch response = { 0 };
+	message.count = count;
+	for (int k = 0; k < count && k < RPC_BATCH_MAX; k++)
+	{
+		message.keys[k]   = keys[k];
+		message.values[k] = values[k];
+	}
+
+	if (client_rpc_batch(host, RPC_MPUT, &message, &response) != 0 || response.count != count)
+		return(-1);
+
+	int put = 0;
+	for (int k = 0; k < count; k++)
+	{
+		results[k] = response.results[k];
+		if (results[k] == OK)
+			put++;
+		version_observe(client_session, keys[k], response.version);
+	}
+	return(put);
+}
+
+/*******************************************************
+ * TURNS ON THE READ CACHE OF CLIENT_RPC_SEND WITH     *
+ * ROOM FOR ENTRIES KEYS.  A GET THEN ASKS FOR A LEASE *
+ * AND THE KEY IS READ FROM THE CACHE UNTIL IT RUNS    *
+ * OUT.  RETURNS -1 IF THE CACHE CANNOT BE MADE.       *
+ ******************************************************/
+int client_cache_enable(int entries)
+{
+	if (client_cache != NULL)
+		return(0);
+	client_cache = cache_new(entries);
+	return(client_cache == NULL ? -1 : 0);
+}
+
+/*******************************************************
+ * TURNS ON READ-YOUR-WRITES SESSION TOKENS IN         *
+ * CLIENT_RPC_SEND.  THE VERSION OF EVERY REPLY IS     *
+ * KEPT, AND A GET CARRIES THE TOKEN OF ITS KEY, SO    *
+ * ANY SERVER THAT HAS APPLIED THE CLIENT'S OWN WRITES *
+ * CAN ANSWER IT.  RETURNS -1 IF THERE IS NO MEMORY.   *
+ ******************************************************/
+int client_session_enable()
+{
+	if (client_session != NULL)
+		return(0);
+	client_session = version_session_new();
+	return(client_session == NULL ? -1 : 0);
+}
+
+/*******************************************************
+ * DESTROYS THE CACHED RPC HANDLE FOR THE HOST AFTER A *
+ * FAILED CALL.  THE SERVER MAY HAVE RESTARTED ON A    *
+ * NEW PORT SO IT IS LOOKED UP AGAIN ON THE NEXT CALL. *
+ ******************************************************/
+void client_drop_handle(char* hostname)
+{
+	for (int i = 0; i < client_handle_count; i++)
+	{
+		if (strcmp(client_handle_host[i], hostname) == 0 && client_handle[i] != NULL)
+		{
+			clnt_destroy(client_handle[i]);
+			client_handle[i] = NULL;
+		}
+	}
+}
+
+/*******************************************************
+ * DESTROYS EVERY RPC HANDLE THE CALLING THREAD HAS    *
+ * CACHED.  A BENCHMARK THREAD CALLS IT BEFORE IT ENDS.*
+ ******************************************************/
+void client_close_handles()
+{
+	for (int i = 0; i < client_handle_count; i++)
+	{
+		if (client_handle[i] != NULL)
+			clnt_destroy(client_handle[i]);
+		free(client_handle_host[i]);
+	}
+	client_handle_count = 0;
+}
+
+/*******************************************************
+ * ASKS THE CLUSTER TO ADD (CONFIG_ADD_NODE) OR REMOVE *
+ * (CONFIG_DEL_NODE) THE SERVER HOST.  EACH SERVER IS  *
+ * TRIED IN TURN UNTIL ONE OF THEM GETS THE CHANGE     *
+ * DECIDED.  RETURNS 0 ON SUCCESS AND -1 OTHERWISE.    *
+ ******************************************************/
+int client_reconfig(char** servers, int server_count, int command, char* host)
+{
+	char s_command[BUFFSIZE];
+
+	// THE SERVERS IDENTIFY A MEMBER BY ITS IPV4 ADDRESS
+	peer * target = peer_new(0, host, NULL);
+	if (target == NULL || target->resolved != PEER_RESOLVED)
+	{
+		printf("Cannot resolve %s\n", host);
+		free(target);
+		return(-1);
+	}
+
+	xdrMsg message = { 0 };
+	message.command  = command;
+	message.value    = (int) target->addr.sin_addr.s_addr;
+	message.key      = -1;
+	message.deadline = RPC_CLIENT_TIMEOUT_MS;
+	free(target);
+
+	struct timeval timeout;
+	timeout.tv_sec  = RPC_CLIENT_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (RPC_CLIENT_TIMEOUT_MS % 1000) * 1000;
+
+	for (int i = 0; i < server_count; i++)
+	{
+		sprintf(s_command, "SENT=%s(%s)", command == CONFIG_ADD_NODE ? "ADD_NODE" : "DEL_NODE", host);
+		log_write("client.log", servers[i], s_command);
+
+		CLIENT * handle = client_get_handle(servers[i]);
+		if (handle == NULL)
+			continue;
+
+		xdrMsg response = { 0 };
+		int status = clnt_call(handle, RPC_RECONFIG, (xdrproc_t) xdr_rpc, (caddr_t) &message,
+				(xdrproc_t) xdr_rpc, (caddr_t) &response, timeout);
+
+		if (status != RPC_SUCCESS)
+		{
+			client_drop_handle(servers[i]);
+			log_write("client.log", servers[i], "RECV=SEND_FAILURE");
+		} else if (response.status == OK) {
+			sprintf(s_command, "RECV=RECONFIG_SUCCESS(id=%d, learned=%d)", response.key, response.value);
+			log_write("client.log", servers[i], s_command);
+			printf("%s %s as node %d, learned by %d servers\n", host,
+					command == CONFIG_ADD_NODE ? "added" : "removed", response.key, response.value);
+			return(0);
+		} else {
+			log_write("client.log", servers[i], "RECV=RECONFIG_FAILURE");
+		}
+	}
 
+	printf("No server could decide the change, try again\n");
+	return(-1);
+}
+
+/*******************************************************
+ * ASKS THE SERVER HOST FOR ITS LATENCY HISTOGRAMS AND *
+ * COUNTERS (RPC_STATS) AND PRINTS THEM.  REPEATS EVERY*
+ * INTERVAL SECONDS IF INTERVAL IS MORE THAN 0.  RESET *
+ * CLEARS THE SERVER'S STATS AFTER EACH SNAPSHOT, SO   *
+ * EVERY TABLE COVERS ONE INTERVAL.  RETURNS -1 IF THE *
+ * SERVER CANNOT BE REACHED.                           *
+ ******************************************************/
+int client_stats(char* host, int interval, int reset)
+{
+	xdrMsg message = { 0 };
+	message.key      = reset ? STATS_RESET : 0;
+	message.deadline = RPC_CLIENT_TIMEOUT_MS;
+
+	struct timeval timeout;
+	timeout.tv_sec  = RPC_CLIENT_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (RPC_CLIENT_TIMEOUT_MS % 1000) * 1000;
+
+	do
+	{
+		CLIENT * handle = client_get_handle(host);
+		if (handle == NULL)
+			return(-1);
+
+		stats_reply reply;
+		memset(&reply, 0, sizeof(reply));
+		int status = clnt_call(handle, RPC_STATS, (xdrproc_t) xdr_rpc, (caddr_t) &message,
+				(xdrproc_t) xdr_stats, (caddr_t) &reply, timeout);
+
+		if (status != RPC_SUCCESS)
+		{
+			client_drop_handle(host);
+			printf("Cannot get the stats of %s\n", host);
+			return(-1);
+		}
+
+		char time_stamp[30];
+		buildTimeStamp(time_stamp);
+		printf("%s %s\n", time_stamp, host);
+		stats_print(&reply, stdout);
+		printf("\n");
+		fflush(stdout);
+
+		if (interval > 0)
+			sleep(interval);
+	} while (interval > 0);
+
+	return(0);
 }
 
 /***********************************************
@@ -227,7 +662,7 @@ char * client_ui_get_command_word(int command)
 int client_ui_get_command(int * command)
 {
 	char user_input[128];
-	printf("Please Choose a Command:\n  1. GET\n  2. PUT\n  3. DEL\n  4. Run Script (PUT/GET/DEL to random servers) \n Q. Quit\n>> ");
+	printf("Please Choose a Command:\n  1. GET\n  2. PUT\n  3. DEL\n  4. Run Script (PUT/GET/DEL to random servers) \n  5. Run Latency Benchmark (PUT/GET to random servers) \n Q. Quit\n>> ");
 	fgets(user_input, 128, stdin);
 
 	switch (user_input[0]) {
@@ -247,6 +682,10 @@ int client_ui_get_command(int * command)
 		//SCRIPT COMMAND
 		*command = 4;
 		break;
+	case '5':
+		//BENCHMARK COMMAND
+		*command = 5;
+		break;
 	case 'Q':
 	case 'q':
 		printf("Goodbye!\n");
@@ -353,7 +792,7 @@ void client_ui_runscript(char** servers, int server_count)
 
 	xdrMsg response;
 
-	xdrMsg messages[15];
+	xdrMsg messages[15] = { 0 };  // EVERY GET OF THE SCRIPT IS READ_QUORUM
 	getRPCMessages(messages);
 
 	int commands[15];
@@ -368,6 +807,53 @@ void client_ui_runscript(char** servers, int server_count)
 	return;
 }
 
+void client_ui_runbenchmark(char** servers, int server_count)
+{
+	int ops;
+	printf("How many operations? [%d]:\n>> ", BENCH_DEFAULT_OPS);
+	if (client_ui_get_int_from_user(&ops) == -1 || ops < 1)
+		ops = BENCH_DEFAULT_OPS;
+
+	printf("Running %d PUT/GET operations on random servers!\n", ops);
+
+	bench * the_bench = bench_new(ops);
+	bench * put_bench = bench_new(ops);
+	bench * get_bench = bench_new(ops);
+	if (the_bench == NULL || put_bench == NULL || get_bench == NULL)
+	{
+		printf("Unable to allocate memory for the benchmark.\n");
+		return;
+	}
+
+	for (int i = 0; i < ops; i++)
+	{
+		xdrMsg message  = { 0 };
+		xdrMsg response = { 0 };
+
+		// PUT A KEY, THEN READ IT BACK ON THE NEXT OPERATION
+		int command = (i % 2 == 0) ? RPC_PUT : RPC_GET;
+		message.key     = i / 2;
+		message.value   = rand();
+		message.command = command;
+
+		int r = rand() % server_count;
+		double start = bench_now_ms();
+		int status = client_rpc_send(servers[r], command, &message, &response);
+		double latency = bench_now_ms() - start;
+		int failed = (status != 0 || response.status != OK);
+		bench_record(the_bench, latency, failed);
+		bench_record(command == RPC_PUT ? put_bench : get_bench, latency, failed);
+	}
+
+	// WRITES AND READS USE DIFFERENT QUAROMS, SO REPORT THEM APART TOO
+	bench_report(the_bench, "benchmark", stdout);
+	bench_report(put_bench, "put", stdout);
+	bench_report(get_bench, "get", stdout);
+	bench_free(the_bench);
+	bench_free(put_bench);
+	bench_free(get_bench);
+}
+
 int client_ui(char** servers, int server_count) {
 
 	while (1) {
@@ -379,6 +865,8 @@ int client_ui(char** servers, int server_count) {
 		if (command == 4)  // IT IS THE SCRIPT
 		{
 			client_ui_runscript(servers, server_count);
+		} else if (command == 5) {  // IT IS THE BENCHMARK
+			client_ui_runbenchmark(servers, server_count);
 		} else {  // MANUALLY PERFORM COMMANDS.
 			// GET THE KEY
 			int key;
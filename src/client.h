@@ -25,6 +25,7 @@
 #ifndef BUFFSIZE
   #define BUFFSIZE 128
 #endif
+#define CLIENT_MAX_HANDLES 128
 
 #ifndef XDRCONV_H
   #include "xdrconv.h"
@@ -35,6 +36,36 @@
   #include "log.h"
 #endif
 
+#ifndef PEER_H
+  #include "peer.h"
+#endif
+
+#ifndef BENCH_H
+  #include "bench.h"
+#endif
+
+#ifndef STATS_H
+  #include "stats.h"
+#endif
+
+#ifndef TRACE_H
+  #include "trace.h"
+#endif
+
+#ifndef CACHE_H
+  #include "cache.h"
+#endif
+
+#ifndef VERSION_H
+  #include "version.h"
+#endif
+
+// THE READ CACHE OF CLIENT_RPC_SEND, NULL WHILE IT IS OFF
+extern kv_cache * client_cache;
+
+// THE SESSION TOKENS OF CLIENT_RPC_SEND, NULL WHILE THEY ARE OFF
+extern version_session * client_session;
+
 
 /*******************************************************
  * SENDS A MESSAGE/COMMAND TO THE SERVER PROVIDED AS   *
@@ -47,6 +78,101 @@
  ******************************************************/
 int client_rpc_send(char* hostname, int command, xdrMsg * message, xdrMsg * response);
 
+/*******************************************************
+ * SENDS A GET, PUT OR DEL LIKE CLIENT_RPC_SEND, BUT   *
+ * A PUT OR DEL GOES TO THE LEADER THE LAST REPLY      *
+ * NAMED INSTEAD OF SERVERS[SERVER], SO IT DOESN'T     *
+ * DUEL WITH THE LEADER'S PROPOSALS.  A WRITE NACKED   *
+ * BY A SERVER THAT NAMES ANOTHER LEADER IS SENT TO    *
+ * IT ONCE MORE (A REDIRECT).  A CALL TO THE LEADER    *
+ * THAT FAILS FORGETS IT AND IS SENT ONCE MORE TO      *
+ * SERVERS[SERVER], OR THE NEXT ONE IF THAT WAS IT.    *
+ * THE HINTS NAME A SERVER BY ITS LINE OF              *
+ * SERVERLIST.TXT, SO SERVERS MUST BE IN THAT ORDER.   *
+ * RETURNS WHAT THE LAST CLIENT_RPC_SEND RETURNED.     *
+ ******************************************************/
+int client_rpc_route(char** servers, int server_count, int server, int command, xdrMsg * message, xdrMsg * response);
+
+
+/*******************************************************
+ * SENDS AN RPC_MGET OR RPC_MPUT BATCH TO THE SERVER   *
+ * PROVIDED AS HOSTNAME, LIKE CLIENT_RPC_SEND SENDS A  *
+ * MESSAGE.  THE ANSWER OF EVERY KEY IS STORED IN      *
+ * RESPONSE.  RETURNS 0 ON SUCCESS, -1 IF THE BATCH IS *
+ * POORLY FORMED, OTHERWISE THE CLNT_STAT.             *
+ ******************************************************/
+int client_rpc_batch(char* hostname, int command, xdrBatch * message, xdrBatch * response);
+
+/*******************************************************
+ * GETS COUNT KEYS FROM THE SERVER HOST IN ONE RPC_MGET*
+ * THE VALUE OF KEYS[I] IS STORED IN VALUES[I] AND OK  *
+ * (FOUND BY A QUAROM) OR NACK IN RESULTS[I].  RETURNS *
+ * THE NUMBER OF KEYS FOUND, OR -1 IF THE CALL FAILED. *
+ ******************************************************/
+int client_mget(char* host, int count, int * keys, int * values, int * results);
+
+/*******************************************************
+ * PUTS COUNT KEYS ON THE SERVER HOST IN ONE RPC_MPUT, *
+ * ALL OF THEM DECIDED BY ONE PAXOS INSTANCE.  OK OR   *
+ * NACK FOR KEYS[I] IS STORED IN RESULTS[I].  RETURNS  *
+ * THE NUMBER OF KEYS PUT, OR -1 IF THE CALL FAILED.   *
+ ******************************************************/
+int client_mput(char* host, int count, int * keys, int * values, int * results);
+
+/*******************************************************
+ * TURNS ON THE READ CACHE OF CLIENT_RPC_SEND WITH     *
+ * ROOM FOR ENTRIES KEYS.  A GET THEN ASKS FOR A LEASE *
+ * AND THE KEY IS READ FROM THE CACHE UNTIL IT RUNS    *
+ * OUT.  RETURNS -1 IF THE CACHE CANNOT BE MADE.       *
+ ******************************************************/
+int client_cache_enable(int entries);
+
+/*******************************************************
+ * TURNS ON READ-YOUR-WRITES SESSION TOKENS IN         *
+ * CLIENT_RPC_SEND.  THE VERSION OF EVERY REPLY IS     *
+ * KEPT, AND A GET CARRIES THE TOKEN OF ITS KEY, SO    *
+ * ANY SERVER THAT HAS APPLIED THE CLIENT'S OWN WRITES *
+ * CAN ANSWER IT.  RETURNS -1 IF THERE IS NO MEMORY.   *
+ ******************************************************/
+int client_session_enable();
+
+/*******************************************************
+ * RETURNS THE CACHED RPC HANDLE FOR THE HOST PROVIDED *
+ * CREATING IT ON FIRST USE.  RETURNS NULL IF THE HOST *
+ * CANNOT BE REACHED.                                  *
+ ******************************************************/
+CLIENT * client_get_handle(char* hostname);
+
+/*******************************************************
+ * DESTROYS THE CACHED RPC HANDLE FOR THE HOST AFTER A *
+ * FAILED CALL.  THE SERVER MAY HAVE RESTARTED ON A    *
+ * NEW PORT SO IT IS LOOKED UP AGAIN ON THE NEXT CALL. *
+ ******************************************************/
+void client_drop_handle(char* hostname);
+
+/*******************************************************
+ * DESTROYS EVERY RPC HANDLE THE CALLING THREAD HAS    *
+ * CACHED.  A BENCHMARK THREAD CALLS IT BEFORE IT ENDS.*
+ ******************************************************/
+void client_close_handles();
+
+/*******************************************************
+ * ASKS THE CLUSTER TO ADD (CONFIG_ADD_NODE) OR REMOVE *
+ * (CONFIG_DEL_NODE) THE SERVER HOST.  EACH SERVER IS  *
+ * TRIED IN TURN UNTIL ONE OF THEM GETS THE CHANGE     *
+ * DECIDED.  RETURNS 0 ON SUCCESS AND -1 OTHERWISE.    *
+ ******************************************************/
+int client_reconfig(char** servers, int server_count, int command, char* host);
+
+/*******************************************************
+ * ASKS THE SERVER HOST FOR ITS LATENCY HISTOGRAMS AND *
+ * COUNTERS (RPC_STATS) AND PRINTS THEM.  REPEATS EVERY*
+ * INTERVAL SECONDS IF INTERVAL IS MORE THAN 0.  RESET *
+ * CLEARS THE SERVER'S STATS AFTER EACH SNAPSHOT, SO   *
+ * EVERY TABLE COVERS ONE INTERVAL.  RETURNS -1 IF THE *
+ * SERVER CANNOT BE REACHED.                           *
+ ******************************************************/
+int client_stats(char* host, int interval, int reset);
 
 /***********************************************
  * CALLED BY THE MAIN FUNCTION AND INITIALIZES *
@@ -115,6 +241,15 @@ void ClientErrorHandle(char *errorMessage);
  */
 int client_ui(char** servers, int server_count);
 
+/*****************************************************
+ * PART OF THE UI.  ASKS THE USER FOR A NUMBER OF
+ * OPERATIONS AND SENDS ALTERNATING PUTS AND GETS TO
+ * RANDOM SERVERS, THEN REPORTS THE LATENCY PERCENTILES.
+ * RUN IT WITH A SERVER KILLED TO SEE THE LATENCY WITH
+ * ONE NODE DOWN.
+ * **************************************************/
+void client_ui_runbenchmark(char** servers, int server_count);
+
 /*****************************************************
  * ACCEPTS AN INTEGER AND RESPONDS WITH A CHAR ARRAY *
  * WITH A HUMAN READABLE VERSION OF THAT COMMAND     *
@@ -0,0 +1,282 @@
+/*
+ ============================================================================
+ Name        : config.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.16
+ Description : Cluster membership changes.  See config.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef CONFIG_H
+#include "config.h"
+#endif
+
+// WHAT THE CATCH UP THREAD NEEDS
+typedef struct config_catchup_args {
+	peer * the_peer;
+	handoff_write * writes;  // the snapshot, a put or a del of every key
+	int count;
+} config_catchup_args;
+
+void * config_catchup_thread(void * arg);
+
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE PEER WITH THE IPV4 ADDRESS PROVIDED (NETWORK BYTE  *
+ * ORDER), OR -1 IF NO PEER IN THE TABLE HAS THAT ADDRESS.                     *
+ ******************************************************************************/
+int config_find_address(peer_table * table, int address)
+{
+	for (int i = 0; i < table->count; i++)
+	{
+		if (table->peers[i]->resolved == PEER_RESOLVED
+		&&  table->peers[i]->addr.sin_addr.s_addr == (in_addr_t) address)
+			return(i);
+	}
+
+	return(-1);
+}
+
+
+/*******************************************************************************
+ * BUILDS THE TABLE THAT RESULTS FROM APPLYING THE CHANGE PROVIDED TO THE      *
+ * TABLE PROVIDED.  COMMAND IS CONFIG_ADD_NODE OR CONFIG_DEL_NODE, ID IS THE   *
+ * NODE ID OF AN ADDED SERVER AND ADDRESS ITS IPV4 ADDRESS.  THE PEERS ARE     *
+ * SHARED WITH THE OLD TABLE.  RETURNS NULL IF THE CHANGE IS A NO-OP (ADDING A *
+ * SERVER THAT IS ALREADY A MEMBER, REMOVING ONE THAT ISN'T OR REMOVING THE    *
+ * LAST ONE) OR IF MEMORY RUNS OUT.                                            *
+ ******************************************************************************/
+peer_table * config_build(peer_table * table, int command, int id, int address)
+{
+	int index = config_find_address(table, address);
+	peer_table * new_table;
+
+	if (command == CONFIG_ADD_NODE)
+	{
+		if (index >= 0 || table->count >= PEER_MAX)
+			return NULL;
+
+		new_table = peer_table_new(table->count + 1);
+		if (new_table == NULL)
+			return NULL;
+
+		for (int i = 0; i < table->count; i++)
+			new_table->peers[i] = table->peers[i];
+
+		// THE NEW SERVER IS KNOWN BY ITS ADDRESS
+		struct in_addr in;
+		in.s_addr = (in_addr_t) address;
+		char hostname[INET_ADDRSTRLEN];
+		inet_ntop(AF_INET, &in, hostname, sizeof(hostname));
+
+		new_table->peers[table->count] = peer_new(id, hostname, NULL);
+		if (new_table->peers[table->count] == NULL)
+		{
+			free(new_table);
+			return NULL;
+		}
+	} else if (command == CONFIG_DEL_NODE) {
+		if (index < 0 || table->count <= 1)
+			return NULL;
+
+		new_table = peer_table_new(table->count - 1);
+		if (new_table == NULL)
+			return NULL;
+
+		int c = 0;
+		for (int i = 0; i < table->count; i++)
+		{
+			if (i != index)
+				new_table->peers[c++] = table->peers[i];
+		}
+	} else {
+		return NULL;
+	}
+
+	// THE SELF INDEX MOVES WITH THE PEERS
+	for (int i = 0; i < new_table->count; i++)
+	{
+		if (new_table->peers[i]->is_self)
+			new_table->self = i;
+	}
+
+	return new_table;
+}
+
+
+/*******************************************************************************
+ * APPLIES A DECIDED CHANGE TO THE CURRENT TABLE AND SWAPS IT IN.  STARTS THE  *
+ * FAILURE DETECTOR OF AN ADDED SERVER AND STOPS THE ONE OF A REMOVED SERVER.  *
+ * RETURNS 0 IF THE TABLE CHANGED AND -1 IF THE CHANGE WAS ALREADY APPLIED.    *
+ ******************************************************************************/
+int config_apply(int command, int id, int address)
+{
+	peer_table * table = peer_table_current();
+	peer_table * new_table = config_build(table, command, id, address);
+
+	if (new_table == NULL)
+		return(-1);
+
+	if (command == CONFIG_ADD_NODE)
+	{
+		fd_start(new_table->peers[new_table->count - 1]);
+	} else {
+		peer * removed = table->peers[config_find_address(table, address)];
+		__atomic_store_n(&removed->removed, 1, __ATOMIC_RELEASE);
+	}
+
+	peer_table_swap(new_table);
+
+	LOG_INFO("server.log", "localhost", "CONFIG=%s(id=%d, servers=%d, q1=%d, q2=%d)",
+			command == CONFIG_ADD_NODE ? "ADD" : "DEL", id, new_table->count,
+			new_table->prepare_quorum, new_table->accept_quorum);
+
+	return(0);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NEXT UNUSED NODE ID OF THE TABLE.                               *
+ ******************************************************************************/
+int config_next_id(peer_table * table)
+{
+	int next = 0;
+	for (int i = 0; i < table->count; i++)
+	{
+		if (table->peers[i]->id >= next)
+			next = table->peers[i]->id + 1;
+	}
+
+	return(next);
+}
+
+
+/*******************************************************************************
+ * STARTS A BACKGROUND THREAD THAT COPIES EVERY KEY OF THE STORE TO THE NEW    *
+ * MEMBER PROVIDED WITH LEARN MESSAGES, EACH WITH THE VERSION I APPLIED, AND   *
+ * A DEL OF EVERY KEY I DELETED.  THE SNAPSHOT IS TAKEN HERE, CALL IT FROM THE *
+ * RPC THREAD.  RETURNS -1 IF THE THREAD CANNOT BE STARTED.                    *
+ ******************************************************************************/
+int config_catchup(peer * the_peer, kv * the_kv, version_table * versions)
+{
+	element * elements;
+	int count = kv_snapshot(the_kv, &elements);
+	if (count < 0)
+		return(-1);
+
+	config_catchup_args * args = (config_catchup_args *) malloc(sizeof(config_catchup_args));
+	int capacity = count + ((versions != NULL) ? versions->size : 0) + 1;
+	handoff_write * writes = (handoff_write *) malloc(sizeof(handoff_write) * capacity);
+	if (args == NULL || writes == NULL)
+	{
+		free(args);
+		free(writes);
+		free(elements);
+		return(-1);
+	}
+
+	int n = 0;
+	for (int i = 0; i < count; i++)
+		writes[n++] = (handoff_write) { elements[i].key, RPC_PUT, elements[i].value, version_get(versions, elements[i].key) };
+	free(elements);
+
+	// A KEY THAT HAS A VERSION BUT ISN'T IN THE STORE WAS DELETED, THE DEL KEEPS AN OLDER PUT FROM COMING BACK
+	int value;
+	for (int s = 0; versions != NULL && s < versions->capacity; s++)
+		if (versions->versions[s] != VERSION_NONE && kv_get(the_kv, versions->keys[s], &value) != 0)
+			writes[n++] = (handoff_write) { versions->keys[s], RPC_DEL, 0, versions->versions[s] };
+
+	args->the_peer = the_peer;
+	args->writes   = writes;
+	args->count    = n;
+
+	// ITS PINGS TELL IT IT STILL MISSES WRITES UNTIL THE COPY IS DONE
+	__atomic_store_n(&the_peer->catching_up, 1, __ATOMIC_RELEASE);
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, config_catchup_thread, args) != 0)
+	{
+		__atomic_store_n(&the_peer->catching_up, 0, __ATOMIC_RELEASE);
+		free(writes);
+		free(args);
+		return(-1);
+	}
+
+	pthread_detach(thread);
+	return(0);
+}
+
+
+/******************************************************
+ * SENDS THE SNAPSHOT TO THE NEW MEMBER AS LEARNS.  A *
+ * KEY GOES AS A CONFIG_CATCHUP WITH ITS VERSION IN   *
+ * LC AND A DELETED KEY AS AN RPC_DEL OF ITS VERSION, *
+ * AND THE LEARNER SKIPS EITHER IF IT APPLIED A NEWER *
+ * WRITE OF THE KEY SINCE, SO A VALUE OR A DELETE IT  *
+ * LEARNED AFTER THE SNAPSHOT IS NEVER UNDONE.  USES  *
+ * ITS OWN RPC HANDLE SO THE PROPOSER IS NOT HELD UP. *
+ *****************************************************/
+void * config_catchup_thread(void * arg)
+{
+	config_catchup_args * args = (config_catchup_args *) arg;
+	peer * the_peer = args->the_peer;
+	handoff_write * writes = args->writes;
+	int count = args->count;
+	free(args);
+
+	// THE NEW SERVER MAY STILL BE STARTING UP
+	CLIENT * handle = NULL;
+	for (int attempt = 0; attempt < 10 && handle == NULL; attempt++)
+	{
+		handle = peer_connect(the_peer, RTT_MAX_MS);
+		if (handle == NULL)
+			sleep(1);
+	}
+
+	if (handle == NULL)
+	{
+		LOG_WARN("server.log", the_peer->hostname, "CATCHUP=UNREACHABLE");
+		for (int i = 0; i < count; i++)
+			handoff_add(&the_peer->missed, writes[i].command, writes[i].key, writes[i].value, writes[i].version);
+		__atomic_store_n(&the_peer->catching_up, 0, __ATOMIC_RELEASE);
+		free(writes);
+		return(NULL);
+	}
+
+	struct timeval timeout;
+	timeout.tv_sec  = RTT_MAX_MS / 1000;
+	timeout.tv_usec = (RTT_MAX_MS % 1000) * 1000;
+
+	int failed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		xdrMsg message  = { 0 };
+		xdrMsg response = { 0 };
+		message.command = (writes[i].command == RPC_DEL) ? RPC_DEL : CONFIG_CATCHUP;
+		message.status  = OK;
+		message.key     = writes[i].key;
+		message.value   = writes[i].value;
+		message.lc      = writes[i].version;
+		message.hint    = peer_table_self_id(peer_table_current());
+
+		enum clnt_stat status = clnt_call(handle, RPC_LEARN,
+				(xdrproc_t) xdr_rpc, (caddr_t) &message,
+				(xdrproc_t) xdr_rpc, (caddr_t) &response,
+				timeout);
+
+		// A KEY THAT DIDN'T MAKE IT IS LEFT TO HINTED HANDOFF
+		if (status != RPC_SUCCESS || response.status == FAILURE)
+		{
+			handoff_add(&the_peer->missed, writes[i].command, writes[i].key, writes[i].value, writes[i].version);
+			failed++;
+		}
+	}
+
+	clnt_destroy(handle);
+	free(writes);
+	__atomic_store_n(&the_peer->catching_up, 0, __ATOMIC_RELEASE);
+
+	LOG_INFO("server.log", the_peer->hostname, "CATCHUP=DONE(keys=%d, failed=%d)", count, failed);
+	return(NULL);
+}
@@ -0,0 +1,84 @@
+/*
+ ============================================================================
+ Name        : config.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.16
+ Description : Cluster membership changes.  A change adds or removes exactly
+             : one server so any majority of the old configuration overlaps
+             : any majority of the new one.  The change itself is decided by
+             : a Paxos round that needs a quarom of both configurations
+             : (joint consensus), after which every learner swaps in the new
+             : peer table.  A new member is caught up in the background by
+             : copying the key value store to it.
+ ============================================================================
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#ifndef BUFFSIZE
+  #define BUFFSIZE 128
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef PEER_H
+  #include "peer.h"
+#endif
+
+#ifndef KEYVALUE_H
+  #include "keyvalue.h"
+#endif
+
+#ifndef VERSION_H
+  #include "version.h"
+#endif
+
+#ifndef LOG_H
+  #include "log.h"
+#endif
+
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE PEER WITH THE IPV4 ADDRESS PROVIDED (NETWORK BYTE  *
+ * ORDER), OR -1 IF NO PEER IN THE TABLE HAS THAT ADDRESS.                     *
+ ******************************************************************************/
+int config_find_address(peer_table * table, int address);
+
+/*******************************************************************************
+ * BUILDS THE TABLE THAT RESULTS FROM APPLYING THE CHANGE PROVIDED TO THE      *
+ * TABLE PROVIDED.  COMMAND IS CONFIG_ADD_NODE OR CONFIG_DEL_NODE, ID IS THE   *
+ * NODE ID OF AN ADDED SERVER AND ADDRESS ITS IPV4 ADDRESS.  THE PEERS ARE     *
+ * SHARED WITH THE OLD TABLE.  RETURNS NULL IF THE CHANGE IS A NO-OP (ADDING A *
+ * SERVER THAT IS ALREADY A MEMBER, REMOVING ONE THAT ISN'T OR REMOVING THE    *
+ * LAST ONE) OR IF MEMORY RUNS OUT.                                            *
+ ******************************************************************************/
+peer_table * config_build(peer_table * table, int command, int id, int address);
+
+/*******************************************************************************
+ * APPLIES A DECIDED CHANGE TO THE CURRENT TABLE AND SWAPS IT IN.  STARTS THE  *
+ * FAILURE DETECTOR OF AN ADDED SERVER AND STOPS THE ONE OF A REMOVED SERVER.  *
+ * RETURNS 0 IF THE TABLE CHANGED AND -1 IF THE CHANGE WAS ALREADY APPLIED.    *
+ ******************************************************************************/
+int config_apply(int command, int id, int address);
+
+/*******************************************************************************
+ * RETURNS THE NEXT UNUSED NODE ID OF THE TABLE.                               *
+ ******************************************************************************/
+int config_next_id(peer_table * table);
+
+/*******************************************************************************
+ * STARTS A BACKGROUND THREAD THAT COPIES EVERY KEY OF THE STORE TO THE NEW    *
+ * MEMBER PROVIDED WITH LEARN MESSAGES, EACH WITH THE VERSION I APPLIED, AND   *
+ * A DEL OF EVERY KEY I DELETED.  THE SNAPSHOT IS TAKEN HERE, CALL IT FROM THE *
+ * RPC THREAD.  RETURNS -1 IF THE THREAD CANNOT BE STARTED.                    *
+ ******************************************************************************/
+int config_catchup(peer * the_peer, kv * the_kv, version_table * versions);
+
+#endif /* CONFIG_H */
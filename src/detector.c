@@ -0,0 +1,283 @@
+/*
+ ============================================================================
+ Name        : detector.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Heartbeat based phi-accrual failure detector.  See detector.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef DETECTOR_H
+#include "detector.h"
+#endif
+
+#ifndef PEER_H
+#include "peer.h"
+#endif
+
+#ifndef FAULT_H
+#include "fault.h"
+#endif
+
+#ifndef LOG_H
+#include "log.h"
+#endif
+
+pthread_mutex_t fd_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void * fd_heartbeat_thread(void * arg);
+void fd_handoff(peer * the_peer, struct timeval timeout);
+
+double (*fd_clock)() = NULL;  // the simulator's clock, the real time when NULL
+
+
+/*******************************************************************************
+ * RESETS THE STATE AS IF THE PEER HAD JUST RESPONDED.                         *
+ ******************************************************************************/
+void fd_reset(fd_state * fd)
+{
+	fd->last_heartbeat = fd_now_ms();
+	fd->mean           = FD_HEARTBEAT_MS;
+	fd->variance       = FD_MIN_STD_DEV * FD_MIN_STD_DEV;
+	fd->handle         = NULL;
+}
+
+
+/*******************************************************************************
+ * STARTS THE HEARTBEAT THREAD OF THE PEER PROVIDED.  EVERY PEER HAS ITS OWN   *
+ * THREAD SO A SLOW PEER CAN'T DELAY THE PINGS TO THE OTHERS.  RETURNS -1 IF   *
+ * THE THREAD CANNOT BE STARTED.                                               *
+ ******************************************************************************/
+int fd_start(struct peer * the_peer)
+{
+	if (the_peer->is_self)
+		return(0);
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, fd_heartbeat_thread, the_peer) != 0)
+		return(-1);
+
+	pthread_detach(thread);
+	return(0);
+}
+
+
+/*******************************************************************************
+ * RECORDS A HEARTBEAT FROM THE PEER.  ANY SUCCESSFUL RESPONSE FROM A PEER     *
+ * COUNTS AS A HEARTBEAT, NOT ONLY THE PINGS.                                  *
+ ******************************************************************************/
+void fd_heartbeat(fd_state * fd)
+{
+	pthread_mutex_lock(&fd_lock);
+
+	double now      = fd_now_ms();
+	double interval = now - fd->last_heartbeat;
+	double delta    = interval - fd->mean;
+
+	// EXPONENTIALLY WEIGHTED MEAN AND VARIANCE (ALPHA = 1/8)
+	fd->mean           = fd->mean + delta / 8.0;
+	fd->variance       = fd->variance + ((delta * delta) - fd->variance) / 8.0;
+	fd->last_heartbeat = now;
+
+	pthread_mutex_unlock(&fd_lock);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE CURRENT SUSPICION LEVEL (PHI) OF THE PEER.                      *
+ ******************************************************************************/
+double fd_phi(fd_state * fd)
+{
+	pthread_mutex_lock(&fd_lock);
+	double elapsed  = fd_now_ms() - fd->last_heartbeat;
+	double mean     = fd->mean;
+	double std_dev  = sqrt(fd->variance);
+	pthread_mutex_unlock(&fd_lock);
+
+	if (std_dev < FD_MIN_STD_DEV)
+		std_dev = FD_MIN_STD_DEV;
+
+	// LOGISTIC APPROXIMATION OF THE NORMAL CDF
+	double y = (elapsed - mean) / std_dev;
+	double e = exp(-y * (1.5976 + 0.070566 * y * y));
+
+	if (elapsed > mean)
+		return(-log10(e / (1.0 + e)));
+	else
+		return(-log10(1.0 - 1.0 / (1.0 + e)));
+}
+
+
+/*******************************************************************************
+ * RETURNS FD_SUSPECTED IF THE PHI OF THE PEER IS ABOVE THE THRESHOLD, AND     *
+ * FD_ALIVE OTHERWISE.  THE LOCAL SERVER IS NEVER SUSPECTED.                   *
+ ******************************************************************************/
+int fd_suspected(struct peer * the_peer)
+{
+	if (!the_peer->is_self && fd_phi(&the_peer->fd) > FD_PHI_THRESHOLD)
+		return(FD_SUSPECTED);
+	else
+		return(FD_ALIVE);
+}
+
+
+/*******************************************************************************
+ * FILLS ORDER WITH THE TABLE INDEXES IN THE ORDER THE SERVERS SHOULD BE       *
+ * CONTACTED.  SELF FIRST, THEN THE LIVE PEERS, THEN THE SUSPECTED PEERS.      *
+ * RETURNS THE NUMBER OF SERVERS THAT ARE NOT SUSPECTED (INCLUDING SELF).      *
+ ******************************************************************************/
+int fd_order(struct peer_table * table, int* order)
+{
+	int suspected[table->count];
+	int suspected_count = 0;
+	int live_count = 0;
+
+	if (table->self >= 0)
+		order[live_count++] = table->self;
+
+	for (int i = 0; i < table->count; i++)
+	{
+		if (i == table->self)
+			continue;
+
+		if (fd_suspected(table->peers[i]) == FD_SUSPECTED)
+			suspected[suspected_count++] = i;
+		else
+			order[live_count++] = i;
+	}
+
+	// THE SUSPECTED PEERS GO LAST, ONLY USED IF THE LIVE ONES CAN'T MAKE A QUAROM
+	for (int i = 0; i < suspected_count; i++)
+		order[live_count + i] = suspected[i];
+
+	return(live_count);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN MILLISECONDS.                                   *
+ ******************************************************************************/
+double fd_now_ms()
+{
+	if (fd_clock != NULL)
+		return(fd_clock());
+
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return((tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0));
+}
+
+
+/******************************************************
+ * PINGS THE PEER PROVIDED ONCE PER FD_HEARTBEAT_MS.  *
+ * A HANDLE THAT FAILS IS DESTROYED AND RECREATED ON  *
+ * THE NEXT ROUND SO A RESTARTED PEER IS PICKED UP    *
+ * AGAIN.  A PEER THAT ANSWERS IS SENT THE WRITES IT  *
+ * MISSED.                                            *
+ *****************************************************/
+void * fd_heartbeat_thread(void * arg)
+{
+	peer * the_peer = (peer *) arg;
+
+	struct timeval timeout;
+	timeout.tv_sec  = 0;
+	timeout.tv_usec = FD_HEARTBEAT_TIMEOUT * 1000;
+
+	// A REMOVED PEER IS NEVER FREED, SO THE THREAD CAN SAFELY CHECK THE FLAG
+	while (!__atomic_load_n(&the_peer->removed, __ATOMIC_ACQUIRE))
+	{
+		if (the_peer->fd.handle == NULL)
+			the_peer->fd.handle = peer_connect(the_peer, FD_HEARTBEAT_TIMEOUT);
+
+		// A PARTITIONED PEER MISSES ITS PINGS, SO IT IS SUSPECTED LIKE A REAL ONE
+		if (the_peer->fd.handle != NULL && !fault_partitioned(the_peer->hostname))
+		{
+			xdrMsg message  = { 0 };
+			xdrMsg response = { 0 };
+			message.command = RPC_HEARTBEAT;
+
+			// WHO I AM AND HOW MANY OF ITS MISSED WRITES I STILL HOLD, 0 TELLS IT IT HAS ALL I ACKNOWLEDGED
+			message.hint    = peer_table_self_id(peer_table_current());
+			message.value   = handoff_pending(&the_peer->missed) + __atomic_load_n(&the_peer->catching_up, __ATOMIC_ACQUIRE);
+
+			enum clnt_stat status = clnt_call(the_peer->fd.handle, RPC_HEARTBEAT,
+					(xdrproc_t) xdr_rpc, (caddr_t) &message,
+					(xdrproc_t) xdr_rpc, (caddr_t) &response,
+					timeout);
+
+			if (status == RPC_SUCCESS)
+			{
+				fd_heartbeat(&the_peer->fd);
+				peer_lease_seen(the_peer, response.lease, fd_now_ms());  // A WRITE IT MISSES WAITS THIS OUT
+				fd_handoff(the_peer, timeout);
+			} else {
+				clnt_destroy(the_peer->fd.handle);
+				the_peer->fd.handle = NULL;
+
+				// A DEAD PEER MAY COME BACK ON ANOTHER PORT, ITS PORTMAPPER IS ASKED AGAIN
+				if (fd_suspected(the_peer) == FD_SUSPECTED)
+					peer_forget_port(the_peer);
+			}
+		}
+
+		usleep(FD_HEARTBEAT_MS * 1000);
+	}
+
+	if (the_peer->fd.handle != NULL)
+		clnt_destroy(the_peer->fd.handle);
+
+	return(NULL);
+}
+
+
+// SENDS THE PEER UP TO HANDOFF_PER_ROUND OF THE WRITES IT MISSED AS LEARNS, AND KEEPS THE REST FOR THE NEXT ROUND
+void fd_handoff(peer * the_peer, struct timeval timeout)
+{
+	handoff_write * writes;
+	int count = handoff_take(&the_peer->missed, &writes);
+	int delivered = 0;
+	int failed = 0;
+	for (int w = 0; w < count; w++)
+	{
+		if (!failed && delivered < HANDOFF_PER_ROUND)
+		{
+			xdrMsg message  = { 0 };
+			xdrMsg response = { 0 };
+			message.command = writes[w].command;
+			message.key     = writes[w].key;
+			message.value   = writes[w].value;
+			message.lc      = writes[w].version;  // THE LEARNER SKIPS IT IF IT HAS APPLIED A NEWER ONE SINCE
+			message.status  = OK;
+			message.hint    = peer_table_self_id(peer_table_current());
+
+			enum clnt_stat status = clnt_call(the_peer->fd.handle, RPC_LEARN,
+					(xdrproc_t) xdr_rpc, (caddr_t) &message,
+					(xdrproc_t) xdr_rpc, (caddr_t) &response,
+					timeout);
+			failed = (status != RPC_SUCCESS || response.status == FAILURE);
+			if (!failed)
+			{
+				delivered++;
+				continue;
+			}
+		}
+		handoff_add(&the_peer->missed, writes[w].command, writes[w].key, writes[w].value, writes[w].version);
+	}
+	free(writes);
+
+	if (count > 0)
+		LOG_INFO("server.log", the_peer->hostname, "HANDOFF(%d of %d writes)", delivered, count);
+}
+
+
+/*******************************************************************************
+ * MAKES FD_NOW_MS RETURN THE TIME OF THE CLOCK PROVIDED INSTEAD OF THE REAL   *
+ * TIME, SO THE SIMULATOR CAN RUN THE SERVERS ON VIRTUAL TIME.  NULL GOES BACK *
+ * TO THE REAL TIME.                                                           *
+ ******************************************************************************/
+void fd_set_clock(double (*clock)())
+{
+	fd_clock = clock;
+}
@@ -0,0 +1,104 @@
+/*
+ ============================================================================
+ Name        : detector.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Heartbeat based phi-accrual failure detector.  A background
+             : thread pings every peer on a fixed interval and the arrival
+             : times of the replies are used to compute a suspicion level
+             : (phi) for each peer.  The proposer loops use the detector to
+             : contact the live peers first.
+ ============================================================================
+ */
+
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#define FD_HEARTBEAT_MS       200   /* How often each peer is pinged */
+#define FD_HEARTBEAT_TIMEOUT  150   /* How long a single ping waits for a reply (ms) */
+#define FD_MIN_STD_DEV        100.0 /* Floor for the standard deviation of the intervals (ms) */
+#define FD_PHI_THRESHOLD      8.0   /* Phi above which a peer is suspected */
+#define FD_SUSPECTED          1
+#define FD_ALIVE              0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <rpc/rpc.h>
+
+#ifndef XDRCONV_H
+  #include "xdrconv.h"
+#endif
+
+
+/*******************************************************
+ * THE HEARTBEAT HISTORY KEPT FOR A SINGLE PEER.  THE  *
+ * INTER-ARRIVAL TIMES ARE TRACKED AS AN EXPONENTIALLY *
+ * WEIGHTED MEAN AND VARIANCE.                         *
+ ******************************************************/
+typedef struct fd_state {
+	double last_heartbeat;  // time of the last reply in ms
+	double mean;            // mean time between replies in ms
+	double variance;        // variance of the time between replies
+	CLIENT * handle;        // rpc handle used by the heartbeat thread
+} fd_state;
+
+
+struct peer;
+struct peer_table;
+
+
+/*******************************************************************************
+ * RESETS THE STATE AS IF THE PEER HAD JUST RESPONDED.                         *
+ ******************************************************************************/
+void fd_reset(fd_state * fd);
+
+/*******************************************************************************
+ * STARTS THE HEARTBEAT THREAD OF THE PEER PROVIDED.  EVERY PEER HAS ITS OWN   *
+ * THREAD SO A SLOW PEER CAN'T DELAY THE PINGS TO THE OTHERS.  THE THREAD      *
+ * EXITS ONCE THE PEER IS MARKED REMOVED.  RETURNS -1 IF THE THREAD CANNOT BE  *
+ * STARTED.                                                                    *
+ ******************************************************************************/
+int fd_start(struct peer * the_peer);
+
+/*******************************************************************************
+ * RECORDS A HEARTBEAT FROM THE PEER.  ANY SUCCESSFUL RESPONSE FROM A PEER     *
+ * COUNTS AS A HEARTBEAT, NOT ONLY THE PINGS.                                  *
+ ******************************************************************************/
+void fd_heartbeat(fd_state * fd);
+
+/*******************************************************************************
+ * RETURNS THE CURRENT SUSPICION LEVEL (PHI) OF THE PEER.                      *
+ ******************************************************************************/
+double fd_phi(fd_state * fd);
+
+/*******************************************************************************
+ * RETURNS FD_SUSPECTED IF THE PHI OF THE PEER IS ABOVE THE THRESHOLD, AND     *
+ * FD_ALIVE OTHERWISE.  THE LOCAL SERVER IS NEVER SUSPECTED.                   *
+ ******************************************************************************/
+int fd_suspected(struct peer * the_peer);
+
+/*******************************************************************************
+ * FILLS ORDER WITH THE TABLE INDEXES IN THE ORDER THE SERVERS SHOULD BE       *
+ * CONTACTED.  SELF FIRST, THEN THE LIVE PEERS, THEN THE SUSPECTED PEERS.      *
+ * RETURNS THE NUMBER OF SERVERS THAT ARE NOT SUSPECTED (INCLUDING SELF).      *
+ ******************************************************************************/
+int fd_order(struct peer_table * table, int* order);
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN MILLISECONDS.                                   *
+ ******************************************************************************/
+double fd_now_ms();
+
+/*******************************************************************************
+ * MAKES FD_NOW_MS RETURN THE TIME OF THE CLOCK PROVIDED INSTEAD OF THE REAL   *
+ * TIME, SO THE SIMULATOR CAN RUN THE SERVERS ON VIRTUAL TIME.  NULL GOES BACK *
+ * TO THE REAL TIME.                                                           *
+ ******************************************************************************/
+void fd_set_clock(double (*clock)());
+
+#endif /* DETECTOR_H */
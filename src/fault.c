@@ -0,0 +1,323 @@
+/*
+ ============================================================================
+ Name        : fault.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.24
+ Description : Fault injection.  See fault.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef FAULT_H
+#include "fault.h"
+#endif
+
+#ifdef FAULT_INJECTION
+
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#ifndef LOG_H
+#include "log.h"
+#endif
+
+#ifndef DETECTOR_H
+#include "detector.h"
+#endif
+
+fault_rule fault_rules[FAULT_MAX_RULES];
+int fault_count = 0;
+char fault_filename[FAULT_LINE_LENGTH] = "";
+struct timespec fault_modified;  // of the file when it was last read
+double fault_checked  = 0;       // when the file was last checked
+uint64_t fault_random = 1;       // xorshift state, never 0
+pthread_mutex_t fault_lock = PTHREAD_MUTEX_INITIALIZER;  // the rules and the random state
+
+int fault_read(char * filename);
+void fault_reload();
+fault_rule * fault_find(int kind, char * hostname);
+int fault_chance(double percent);
+double fault_delay(fault_rule * rule);
+double fault_uniform();
+
+
+/*******************************************************************************
+ * READS THE RULES FROM THE FILE PROVIDED AND KEEPS WATCHING IT.  RETURNS -1   *
+ * IF THE FILE CANNOT BE READ OR A LINE IS NOT A RULE.                         *
+ ******************************************************************************/
+int fault_load(char * filename)
+{
+	pthread_mutex_lock(&fault_lock);
+	strncpy(fault_filename, filename, FAULT_LINE_LENGTH - 1);
+	fault_checked = fd_now_ms();
+	int result = fault_read(filename);
+	pthread_mutex_unlock(&fault_lock);
+	return(result);
+}
+
+
+/*******************************************************************************
+ * DECIDES WHAT HAPPENS TO A CALL TO THE PEER PROVIDED.  SLEEPS FOR AN         *
+ * INJECTED DELAY AND TAKES IT OFF THE TIMEOUT (MS).  A LOST CALL SLEEPS THE   *
+ * WHOLE TIMEOUT.  RETURNS FAULT_NONE, FAULT_DROP OR FAULT_DUPLICATE.          *
+ ******************************************************************************/
+int fault_send(char * hostname, double * timeout)
+{
+	fault_reload();
+	pthread_mutex_lock(&fault_lock);
+
+	int fault = FAULT_NONE;
+	fault_rule * rule;
+	if (fault_find(FAULT_PARTITION, hostname) != NULL)
+		fault = FAULT_DROP;
+	else if ((rule = fault_find(FAULT_LOSS, hostname)) != NULL && fault_chance(rule->a))
+		fault = FAULT_DROP;
+	else if ((rule = fault_find(FAULT_DOUBLE, hostname)) != NULL && fault_chance(rule->a))
+		fault = FAULT_DUPLICATE;
+
+	double delay = 0;
+	if ((rule = fault_find(FAULT_DELAY, hostname)) != NULL)
+		delay = fault_delay(rule);
+
+	pthread_mutex_unlock(&fault_lock);
+
+	// A DELAY LONGER THAN THE TIMEOUT LOSES THE CALL TOO
+	if (fault == FAULT_DROP || delay >= *timeout)
+	{
+		usleep((useconds_t) (*timeout * 1000));
+		return(FAULT_DROP);
+	}
+
+	if (delay > 0)
+	{
+		usleep((useconds_t) (delay * 1000));
+		*timeout = *timeout - delay;
+	}
+	return(fault);
+}
+
+
+/*******************************************************************************
+ * RETURNS 1 IF THE PEER PROVIDED IS CUT OFF BY A PARTITION, 0 OTHERWISE (OR   *
+ * IF HOSTNAME IS NULL, AN UNKNOWN SENDER).                                    *
+ ******************************************************************************/
+int fault_partitioned(char * hostname)
+{
+	if (hostname == NULL)
+		return(0);
+	fault_reload();
+	pthread_mutex_lock(&fault_lock);
+	int partitioned = (fault_find(FAULT_PARTITION, hostname) != NULL);
+	pthread_mutex_unlock(&fault_lock);
+	return(partitioned);
+}
+
+
+/*******************************************************************************
+ * CALLED BY EVERY ACCEPTOR AND LEARNER HANDLER WITH THE HOSTNAME OF THE       *
+ * SENDER (NULL IF UNKNOWN).  RETURNS FAULT_DROP IF A PARTITION CUTS THE       *
+ * SENDER OFF, THE HANDLER THEN DOESN'T REPLY.  OTHERWISE STALLS OR EXITS THE  *
+ * SERVER AS THE RULES SAY AND RETURNS FAULT_NONE.                             *
+ ******************************************************************************/
+int fault_receive(char * hostname)
+{
+	fault_reload();
+	pthread_mutex_lock(&fault_lock);
+
+	// A PARTITION LOSES THE MESSAGES COMING IN AS WELL AS GOING OUT
+	if (hostname != NULL && fault_find(FAULT_PARTITION, hostname) != NULL)
+	{
+		pthread_mutex_unlock(&fault_lock);
+		LOG_DEBUG("server.log", hostname, "PARTITIONED=DROP");
+		return(FAULT_DROP);
+	}
+
+	fault_rule * rule;
+	int crash = ((rule = fault_find(FAULT_CRASH, "*")) != NULL && fault_chance(rule->a));
+	double stall = 0;
+	if ((rule = fault_find(FAULT_STALL, "*")) != NULL && fault_chance(rule->b))
+		stall = rule->a;
+
+	pthread_mutex_unlock(&fault_lock);
+
+	if (crash)
+	{
+		LOG_WARN("server.log", "faults", "!!!!!!!SYSTEM_FAILURE!!!!!");
+		exit(-1);
+	}
+
+	if (stall > 0)
+	{
+		LOG_DEBUG("server.log", "faults", "STALL(%.0fms)", stall);
+		usleep((useconds_t) (stall * 1000));
+	}
+	return(FAULT_NONE);
+}
+
+
+// READS THE RULES, KEEPING THE OLD ONES IF A LINE IS BAD.  CALLED WITH THE LOCK HELD
+int fault_read(char * filename)
+{
+	FILE * file = fopen(filename, "r");
+	if (file == NULL)
+		return(-1);
+
+	struct stat status;
+	if (fstat(fileno(file), &status) == 0)
+		fault_modified = status.st_mtim;
+
+	fault_rule rules[FAULT_MAX_RULES];
+	int count = 0;
+	int bad = 0;
+	unsigned long long seed = 0;
+	char line[FAULT_LINE_LENGTH];
+	while (fgets(line, FAULT_LINE_LENGTH, file) != NULL && !bad)
+	{
+		line[strcspn(line, "\n")] = '\0';
+		char * comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		char word[32] = "";
+		char name[32] = "";
+		fault_rule rule = { 0 };
+		if (sscanf(line, "%31s", word) != 1)
+			continue;  // A BLANK LINE
+
+		if (strcmp(word, "seed") == 0)
+			bad = (sscanf(line, "%*s %llu", &seed) != 1);
+		else if (strcmp(word, "delay") == 0)
+		{
+			rule.kind = FAULT_DELAY;
+			int fields = sscanf(line, "%*s %127s %31s %lf %lf", rule.peer, name, &rule.a, &rule.b);
+			if (strcmp(name, "fixed") == 0 && fields >= 3)
+				rule.distribution = FAULT_FIXED;
+			else if (strcmp(name, "uniform") == 0 && fields == 4 && rule.b >= rule.a)
+				rule.distribution = FAULT_UNIFORM;
+			else if (strcmp(name, "exponential") == 0 && fields >= 3)
+				rule.distribution = FAULT_EXPONENTIAL;
+			else if (strcmp(name, "pareto") == 0 && fields == 4 && rule.b > 0)
+				rule.distribution = FAULT_PARETO;
+			else
+				bad = 1;
+		}
+		else if (strcmp(word, "drop") == 0)
+		{
+			rule.kind = FAULT_LOSS;
+			bad = (sscanf(line, "%*s %127s %lf", rule.peer, &rule.a) != 2);
+		}
+		else if (strcmp(word, "duplicate") == 0)
+		{
+			rule.kind = FAULT_DOUBLE;
+			bad = (sscanf(line, "%*s %127s %lf", rule.peer, &rule.a) != 2);
+		}
+		else if (strcmp(word, "partition") == 0)
+		{
+			rule.kind = FAULT_PARTITION;
+			bad = (sscanf(line, "%*s %127s", rule.peer) != 1);
+		}
+		else if (strcmp(word, "stall") == 0)
+		{
+			rule.kind = FAULT_STALL;
+			strcpy(rule.peer, "*");
+			bad = (sscanf(line, "%*s %lf %lf", &rule.a, &rule.b) != 2);
+		}
+		else if (strcmp(word, "crash") == 0)
+		{
+			rule.kind = FAULT_CRASH;
+			strcpy(rule.peer, "*");
+			bad = (sscanf(line, "%*s %lf", &rule.a) != 1);
+		}
+		else
+			bad = 1;
+
+		if (!bad && strcmp(word, "seed") != 0)
+		{
+			if (count == FAULT_MAX_RULES)
+				bad = 1;
+			else
+				rules[count++] = rule;
+		}
+	}
+	fclose(file);
+
+	if (bad)
+	{
+		LOG_WARN("server.log", "faults", "BAD_RULE(%s)", line);
+		return(-1);
+	}
+
+	// WITHOUT A SEED EVERY RUN IS DIFFERENT, LOG IT SO THE RUN CAN BE REPEATED
+	if (seed == 0)
+		seed = ((unsigned long long) time(NULL) << 16) ^ (unsigned long long) getpid();
+	fault_random = seed;
+	memcpy(fault_rules, rules, sizeof(fault_rule) * count);
+	fault_count = count;
+
+	LOG_INFO("server.log", "faults", "LOADED(rules=%d, seed=%llu)", count, seed);
+	return(0);
+}
+
+
+// READS THE FILE AGAIN IF IT CHANGED, CHECKING AT MOST EVERY FAULT_RELOAD_MS
+void fault_reload()
+{
+	pthread_mutex_lock(&fault_lock);
+	double now = fd_now_ms();
+	if (fault_filename[0] != '\0' && now - fault_checked >= FAULT_RELOAD_MS)
+	{
+		fault_checked = now;
+		struct stat status;
+		if (stat(fault_filename, &status) == 0 && (status.st_mtim.tv_sec != fault_modified.tv_sec || status.st_mtim.tv_nsec != fault_modified.tv_nsec))
+			fault_read(fault_filename);
+	}
+	pthread_mutex_unlock(&fault_lock);
+}
+
+
+// THE FIRST RULE OF THE KIND FOR THE PEER PROVIDED, NULL IF THERE IS NONE
+fault_rule * fault_find(int kind, char * hostname)
+{
+	for (int i = 0; i < fault_count; i++)
+		if (fault_rules[i].kind == kind &&
+				(strcmp(fault_rules[i].peer, "*") == 0 || strcmp(fault_rules[i].peer, hostname) == 0))
+			return(&fault_rules[i]);
+	return(NULL);
+}
+
+
+// 1 WITH THE PROBABILITY PROVIDED
+int fault_chance(double percent)
+{
+	return(fault_uniform() * 100.0 < percent);
+}
+
+
+// MS DRAWN FROM THE DISTRIBUTION OF THE DELAY RULE
+double fault_delay(fault_rule * rule)
+{
+	double u = fault_uniform();
+	switch (rule->distribution)
+	{
+	case FAULT_UNIFORM:     return(rule->a + u * (rule->b - rule->a));
+	case FAULT_EXPONENTIAL: return(-rule->a * log(1.0 - u));
+	case FAULT_PARETO:      return(rule->a / pow(1.0 - u, 1.0 / rule->b));
+	default:                return(rule->a);
+	}
+}
+
+
+// XORSHIFT64*, UNIFORM IN [0, 1)
+double fault_uniform()
+{
+	fault_random ^= fault_random >> 12;
+	fault_random ^= fault_random << 25;
+	fault_random ^= fault_random >> 27;
+	return((double) ((fault_random * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ ============================================================================
+ Name        : fault.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.24
+ Description : Fault injection for testing the servers under bad conditions
+             : on one machine.  The faults are read from a file given with
+             : -faults file, one rule per line, and the file is read again
+             : whenever it changes, so they can be turned on and off while
+             : the server runs:
+             :
+             :   seed 42                    random numbers for the faults
+             :   delay n02 exponential 5    latency added to calls to n02
+             :   delay * uniform 1 3        fixed ms, uniform lo hi,
+             :                              exponential mean, pareto min shape
+             :   drop n03 10                lose 10% of the calls to n03
+             :   duplicate * 5              send 5% of the calls twice
+             :   partition n04              lose every call and ping to and from n04
+             :   stall 500 1                hold 1% of received messages 500ms
+             :   crash 1                    exit on 1% of received messages
+             :
+             : The first rule of a kind that names the peer (or *) is used.
+             : A lost call costs the caller its whole timeout, like a real
+             : one.  The faults are only built with
+             : make CFLAGS=-DFAULT_INJECTION; otherwise every hook is empty.
+ ============================================================================
+ */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#define FAULT_NONE        0   // send the call normally
+#define FAULT_DROP        1   // lose the call
+#define FAULT_DUPLICATE   2   // send the call twice
+
+#define FAULT_MAX_RULES   32
+#define FAULT_LINE_LENGTH 256
+#define FAULT_HOST_LENGTH 128   // same as PEER_HOST_LENGTH
+#define FAULT_RELOAD_MS   1000  // how often the file is checked for changes
+
+// KINDS OF RULE
+#define FAULT_DELAY       0
+#define FAULT_LOSS        1
+#define FAULT_DOUBLE      2
+#define FAULT_PARTITION   3
+#define FAULT_STALL       4
+#define FAULT_CRASH       5
+
+// DISTRIBUTIONS OF A DELAY
+#define FAULT_FIXED       0
+#define FAULT_UNIFORM     1
+#define FAULT_EXPONENTIAL 2
+#define FAULT_PARETO      3
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+
+// ONE LINE OF THE FAULT FILE
+typedef struct fault_rule {
+	int kind;
+	char peer[FAULT_HOST_LENGTH];  // hostname from serverlist.txt, or * for every peer
+	int distribution;             // of a delay
+	double a;                     // ms of a delay or stall, percent of the others
+	double b;                     // second parameter of a delay, percent of a stall
+} fault_rule;
+
+
+#ifdef FAULT_INJECTION
+
+/*******************************************************************************
+ * READS THE RULES FROM THE FILE PROVIDED AND KEEPS WATCHING IT.  RETURNS -1   *
+ * IF THE FILE CANNOT BE READ OR A LINE IS NOT A RULE.                         *
+ ******************************************************************************/
+int fault_load(char * filename);
+
+/*******************************************************************************
+ * DECIDES WHAT HAPPENS TO A CALL TO THE PEER PROVIDED.  SLEEPS FOR AN         *
+ * INJECTED DELAY AND TAKES IT OFF THE TIMEOUT (MS).  A LOST CALL SLEEPS THE   *
+ * WHOLE TIMEOUT.  RETURNS FAULT_NONE, FAULT_DROP OR FAULT_DUPLICATE.          *
+ ******************************************************************************/
+int fault_send(char * hostname, double * timeout);
+
+/*******************************************************************************
+ * RETURNS 1 IF THE PEER PROVIDED IS CUT OFF BY A PARTITION, 0 OTHERWISE (OR   *
+ * IF HOSTNAME IS NULL, AN UNKNOWN SENDER).                                    *
+ ******************************************************************************/
+int fault_partitioned(char * hostname);
+
+/*******************************************************************************
+ * CALLED BY EVERY ACCEPTOR AND LEARNER HANDLER WITH THE HOSTNAME OF THE       *
+ * SENDER (NULL IF UNKNOWN).  RETURNS FAULT_DROP IF A PARTITION CUTS THE       *
+ * SENDER OFF, THE HANDLER THEN DOESN'T REPLY.  OTHERWISE STALLS OR EXITS THE  *
+ * SERVER AS THE RULES SAY AND RETURNS FAULT_NONE.                             *
+ ******************************************************************************/
+int fault_receive(char * hostname);
+
+#else
+
+#define fault_load(filename)           (-1)
+#define fault_send(hostname, timeout)  FAULT_NONE
+#define fault_partitioned(hostname)    0
+#define fault_receive(hostname)        FAULT_NONE
+
+#endif
+
+#endif /* FAULT_H */
@@ -0,0 +1,45 @@
+#!/bin/bash
+# Measures the write latency of Flexible Paxos quorum choices on a 5 and a 7
+# server cluster running on this host.  Every server is an instance of
+# localhost with its own rpc program (localhost:0, localhost:1, ...) and runs
+# in its own directory so the logs stay apart.  rpcbind must be running.
+#
+#	./flexible_bench.sh [operations]
+
+OPS="${1:-1000}"
+BIN="$(pwd)/tcss558"
+WORK="/tmp/flexible_bench"
+
+make || exit 1
+
+run()
+{
+	local N=$1 Q1=$2 Q2=$3
+	rm -rf "${WORK}" && mkdir -p "${WORK}/client"
+	for ((i = 0; i < N; i++)); do echo "localhost:${i}"; done > "${WORK}/client/serverlist.txt"
+
+	local PIDS=""
+	for ((i = 0; i < N; i++))
+	do
+		mkdir -p "${WORK}/${i}"
+		cp "${WORK}/client/serverlist.txt" "${WORK}/${i}/"
+		(cd "${WORK}/${i}" && exec "${BIN}" server -self "localhost:${i}" -q1 ${Q1} -q2 ${Q2} > server.out 2>&1) &
+		PIDS="${PIDS} $!"
+	done
+	sleep 2
+
+	echo "== N=${N} Q1=${Q1} Q2=${Q2}"
+	(cd "${WORK}/client" && printf "5\n${OPS}\nq\n" | "${BIN}" client | grep -E "^(put|get):")
+
+	kill ${PIDS} 2> /dev/null
+	wait 2> /dev/null
+}
+
+# MAJORITY FIRST, THEN SMALLER ACCEPT QUORUMS
+run 5 3 3
+run 5 4 2
+run 5 5 1
+run 7 4 4
+run 7 5 3
+run 7 6 2
+run 7 7 1
@@ -0,0 +1,141 @@
+/*
+ ============================================================================
+ Name        : handoff.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.09
+ Description : Hinted handoff of missed writes.  See handoff.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef HANDOFF_H
+#include "handoff.h"
+#endif
+
+int handoff_slot(handoff_write * writes, int capacity, int key);
+int handoff_grow(handoff_table * table);
+
+
+/*******************************************************************************
+ * MAKES AN EMPTY TABLE, IT TAKES NO MEMORY UNTIL A WRITE IS ADDED.            *
+ ******************************************************************************/
+void handoff_init(handoff_table * table)
+{
+	pthread_mutex_init(&table->lock, NULL);
+	table->capacity = 0;
+	table->size     = 0;
+	table->writes   = NULL;
+}
+
+
+/*******************************************************************************
+ * KEEPS THE WRITE FOR THE PEER UNLESS A NEWER WRITE OF THE KEY IS KEPT        *
+ * ALREADY.  RETURNS -1 IF THE TABLE COULD NOT GROW, THE WRITE IS LOST THEN.   *
+ ******************************************************************************/
+int handoff_add(handoff_table * table, int command, int key, int value, int version)
+{
+	pthread_mutex_lock(&table->lock);
+
+	int slot = (table->capacity > 0) ? handoff_slot(table->writes, table->capacity, key) : -1;
+	if (slot < 0 || table->writes[slot].version == VERSION_NONE)
+	{
+		// A NEW KEY, KEEP A QUARTER OF THE SLOTS FREE SO THE PROBES STAY SHORT
+		if ((table->size + 1) * 4 > table->capacity * 3)
+		{
+			if (handoff_grow(table) != 0)
+			{
+				pthread_mutex_unlock(&table->lock);
+				return(-1);
+			}
+			slot = handoff_slot(table->writes, table->capacity, key);
+		}
+		table->writes[slot].key = key;
+		table->size++;
+	}
+
+	// A VERSION IS NEVER VERSION_NONE, THAT MARKS A FREE SLOT
+	handoff_write * write = &table->writes[slot];
+	if (write->version == VERSION_NONE || version >= write->version)
+	{
+		write->command = command;
+		write->value   = value;
+		write->version = (version > VERSION_NONE) ? version : VERSION_NONE + 1;
+	}
+
+	pthread_mutex_unlock(&table->lock);
+	return(0);
+}
+
+
+/*******************************************************************************
+ * EMPTIES THE TABLE AND RETURNS HOW MANY WRITES IT HELD, WITH THEM IN WRITES  *
+ * (NULL IF THERE WERE NONE).  THE CALLER FREES THE ARRAY AND ADDS BACK THE    *
+ * WRITES IT COULD NOT DELIVER.                                                *
+ ******************************************************************************/
+int handoff_take(handoff_table * table, handoff_write ** writes)
+{
+	pthread_mutex_lock(&table->lock);
+	handoff_write * taken = table->writes;
+	int capacity = table->capacity;
+	int count    = table->size;
+	table->writes   = NULL;
+	table->capacity = 0;
+	table->size     = 0;
+	pthread_mutex_unlock(&table->lock);
+
+	// MOVE THE WRITES TO THE FRONT, THE CALLER ONLY SEES THOSE
+	int used = 0;
+	for (int s = 0; s < capacity; s++)
+		if (taken[s].version != VERSION_NONE)
+			taken[used++] = taken[s];
+
+	if (count == 0)
+	{
+		free(taken);
+		taken = NULL;
+	}
+	*writes = taken;
+	return(count);
+}
+
+
+/*******************************************************************************
+ * RETURNS HOW MANY WRITES THE TABLE HOLDS.                                    *
+ ******************************************************************************/
+int handoff_pending(handoff_table * table)
+{
+	pthread_mutex_lock(&table->lock);
+	int count = table->size;
+	pthread_mutex_unlock(&table->lock);
+	return(count);
+}
+
+
+// THE SLOT OF THE KEY, OR THE FREE SLOT WHERE IT GOES
+int handoff_slot(handoff_write * writes, int capacity, int key)
+{
+	int slot = (int) (((uint32_t) key * 2654435761u) % (uint32_t) capacity);
+	while (writes[slot].version != VERSION_NONE && writes[slot].key != key)
+		slot = (slot + 1) % capacity;
+	return(slot);
+}
+
+
+// DOUBLES THE SLOTS AND PUTS EVERY WRITE BACK.  CALLED WITH THE LOCK HELD
+int handoff_grow(handoff_table * table)
+{
+	int capacity = (table->capacity == 0) ? HANDOFF_INITIAL_SLOTS : table->capacity * 2;
+	handoff_write * writes = (handoff_write *) calloc(capacity, sizeof(handoff_write));
+	if (writes == NULL)
+		return(-1);
+
+	for (int s = 0; s < table->capacity; s++)
+		if (table->writes[s].version != VERSION_NONE)
+			writes[handoff_slot(writes, capacity, table->writes[s].key)] = table->writes[s];
+
+	free(table->writes);
+	table->writes   = writes;
+	table->capacity = capacity;
+	return(0);
+}
@@ -0,0 +1,74 @@
+/*
+ ============================================================================
+ Name        : handoff.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.09
+ Description : Hinted handoff of the writes a learner missed.  A proposer
+             : that skips a suspected learner, or whose LEARN to it fails,
+             : keeps the write in the handoff_table of that peer, and the
+             : heartbeat thread of the peer sends it again as a LEARN once
+             : the peer answers its pings.  Only the latest write of every
+             : key is kept (a DEL too, so a deleted key doesn't come back):
+             : the learner applies writes in version order, so the older
+             : ones no longer matter.  The rpc thread adds and the heartbeat
+             : thread takes, so the table has a lock.
+ ============================================================================
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#define HANDOFF_INITIAL_SLOTS   64   // slots of a new table, it doubles when 3/4 full
+#define HANDOFF_PER_ROUND       64   // writes sent again after one ping, so the pings keep their pace
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef VERSION_H
+  #include "version.h"
+#endif
+
+
+// THE LATEST WRITE OF ONE KEY A LEARNER MISSED
+typedef struct handoff_write {
+	int key;
+	int command;        // RPC_PUT or RPC_DEL
+	int value;
+	int version;        // lc of the proposal, VERSION_NONE in a free slot
+} handoff_write;
+
+// THE WRITES ONE PEER MISSED, OPEN ADDRESSING
+typedef struct handoff_table {
+	pthread_mutex_t lock;
+	int capacity;       // 0 until the first write is added
+	int size;
+	handoff_write * writes;
+} handoff_table;
+
+
+/*******************************************************************************
+ * MAKES AN EMPTY TABLE, IT TAKES NO MEMORY UNTIL A WRITE IS ADDED.            *
+ ******************************************************************************/
+void handoff_init(handoff_table * table);
+
+/*******************************************************************************
+ * KEEPS THE WRITE FOR THE PEER UNLESS A NEWER WRITE OF THE KEY IS KEPT        *
+ * ALREADY.  RETURNS -1 IF THE TABLE COULD NOT GROW, THE WRITE IS LOST THEN.   *
+ ******************************************************************************/
+int handoff_add(handoff_table * table, int command, int key, int value, int version);
+
+/*******************************************************************************
+ * EMPTIES THE TABLE AND RETURNS HOW MANY WRITES IT HELD, WITH THEM IN WRITES  *
+ * (NULL IF THERE WERE NONE).  THE CALLER FREES THE ARRAY AND ADDS BACK THE    *
+ * WRITES IT COULD NOT DELIVER.                                                *
+ ******************************************************************************/
+int handoff_take(handoff_table * table, handoff_write ** writes);
+
+/*******************************************************************************
+ * RETURNS HOW MANY WRITES THE TABLE HOLDS.                                    *
+ ******************************************************************************/
+int handoff_pending(handoff_table * table);
+
+#endif /* HANDOFF_H */
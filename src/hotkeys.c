@@ -0,0 +1,180 @@
+/*
+ ============================================================================
+ Name        : hotkeys.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.23
+ Description : Hot key sketch.  See hotkeys.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef HOTKEYS_H
+#include "hotkeys.h"
+#endif
+
+#include <time.h>
+
+hot_half hot_halves[HOT_KINDS][2];
+int hot_current = 0;              // the half being filled, the other is the older one
+uint64_t hot_started_ms = 0;      // when the current half started
+
+// ONE MULTIPLIER PER ROW, THE TOP BITS OF KEY * MULTIPLIER PICK THE COUNTER
+uint32_t hot_multipliers[HOT_DEPTH] = { 0x9E3779B1U, 0x85EBCA77U, 0xC2B2AE3DU, 0x27D4EB2FU };
+
+void hot_rotate();
+void hot_admit(hot_half * half, int key, uint32_t estimate);
+uint32_t hot_estimate(hot_half * half, int key);
+uint64_t hot_now_ms();
+
+
+/*******************************************************************************
+ * RECORDS A READ (HOT_READS) OR A WRITE (HOT_WRITES) OF THE KEY PROVIDED.     *
+ ******************************************************************************/
+void hot_record(int kind, int key)
+{
+	hot_rotate();
+	hot_half * half = &hot_halves[kind][hot_current];
+
+	uint32_t estimate = UINT32_MAX;
+	for (int d = 0; d < HOT_DEPTH; d++)
+	{
+		uint32_t column = ((uint32_t) key * hot_multipliers[d]) >> (32 - HOT_WIDTH_BITS);
+		uint32_t count = ++half->sketch[d][column];
+		if (count < estimate)
+			estimate = count;
+	}
+
+	// A KEY NO HOTTER THAN THE COLDEST ONE OF A FULL TABLE CAN'T GET IN
+	if (estimate > half->minimum)
+		hot_admit(half, key, estimate);
+}
+
+
+/*******************************************************************************
+ * FILLS IN THE REPORT WITH THE HOT_TOP KEYS OF THE KIND PROVIDED AND HOW      *
+ * OFTEN THEY WERE USED OVER THE WINDOW.                                       *
+ ******************************************************************************/
+void hot_snapshot(int kind, hot_report * report)
+{
+	hot_rotate();
+	memset(report, 0, sizeof(hot_report));
+
+	// THE CANDIDATES ARE THE KEYS OF BOTH TABLES, COUNTED OVER BOTH HALVES
+	for (int h = 0; h < 2; h++)
+	{
+		hot_half * half = &hot_halves[kind][h];
+		for (int i = 0; i < HOT_CAPACITY; i++)
+		{
+			if (half->table[i].count == 0)
+				continue;
+
+			int key = half->table[i].key;
+			int seen = 0;
+			for (int r = 0; r < report->count; r++)
+				seen |= (report->keys[r].key == key);
+			if (seen)
+				continue;
+
+			uint32_t count = hot_estimate(&hot_halves[kind][0], key) + hot_estimate(&hot_halves[kind][1], key);
+
+			// INSERT IT IN ORDER, THE COLDEST FALLS OFF THE END
+			int at = report->count;
+			while (at > 0 && report->keys[at - 1].count < count)
+				at--;
+			if (at >= HOT_TOP)
+				continue;
+
+			int last = (report->count < HOT_TOP) ? report->count : HOT_TOP - 1;
+			memmove(&report->keys[at + 1], &report->keys[at], sizeof(hot_entry) * (last - at));
+			report->keys[at].key   = key;
+			report->keys[at].count = count;
+			if (report->count < HOT_TOP)
+				report->count++;
+		}
+	}
+}
+
+
+/*******************************************************************************
+ * FORGETS EVERY KEY.                                                          *
+ ******************************************************************************/
+void hot_reset()
+{
+	memset(hot_halves, 0, sizeof(hot_halves));
+	hot_started_ms = hot_now_ms();
+}
+
+
+// STARTS A NEW HALF OF THE WINDOW WHEN THE CURRENT ONE IS OVER
+void hot_rotate()
+{
+	uint64_t now = hot_now_ms();
+	if (now - hot_started_ms < HOT_WINDOW_MS)
+		return;
+
+	// AFTER A WHOLE WINDOW OF SILENCE THE OLDER HALF IS STALE TOO
+	if (now - hot_started_ms >= 2 * HOT_WINDOW_MS)
+		memset(hot_halves, 0, sizeof(hot_halves));
+
+	hot_current = 1 - hot_current;
+	for (int kind = 0; kind < HOT_KINDS; kind++)
+		memset(&hot_halves[kind][hot_current], 0, sizeof(hot_half));
+	hot_started_ms = now;
+}
+
+
+// PUTS THE KEY IN THE TABLE WITH ITS NEW ESTIMATE, IN PLACE OF THE COLDEST KEY IF IT ISN'T THERE
+void hot_admit(hot_half * half, int key, uint32_t estimate)
+{
+	int coldest = 0;
+	int found = -1;
+	for (int i = 0; i < HOT_CAPACITY; i++)
+	{
+		if (half->table[i].count > 0 && half->table[i].key == key)
+		{
+			found = i;
+			break;
+		}
+		if (half->table[i].count < half->table[coldest].count)
+			coldest = i;
+	}
+
+	if (found < 0)
+		found = coldest;
+	uint32_t was = half->table[found].count;
+	half->table[found].key   = key;
+	half->table[found].count = estimate;
+
+	// ONLY RAISING THE COLDEST ENTRY CAN MOVE THE MINIMUM
+	if (was > half->minimum)
+		return;
+	uint32_t minimum = UINT32_MAX;
+	for (int i = 0; i < HOT_CAPACITY; i++)
+		if (half->table[i].count < minimum)
+			minimum = half->table[i].count;
+	half->minimum = minimum;
+}
+
+
+// HOW OFTEN THE KEY WAS USED IN THE HALF, NEVER LESS THAN THE REAL COUNT
+uint32_t hot_estimate(hot_half * half, int key)
+{
+	uint32_t estimate = UINT32_MAX;
+	for (int d = 0; d < HOT_DEPTH; d++)
+	{
+		uint32_t column = ((uint32_t) key * hot_multipliers[d]) >> (32 - HOT_WIDTH_BITS);
+		if (half->sketch[d][column] < estimate)
+			estimate = half->sketch[d][column];
+	}
+	return(estimate);
+}
+
+
+// A CHEAP CLOCK, A FEW MILLISECONDS OFF IS FINE FOR THE WINDOW
+uint64_t hot_now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+	return((uint64_t) now.tv_sec * 1000ULL + (uint64_t) now.tv_nsec / 1000000ULL);
+}
@@ -0,0 +1,79 @@
+/*
+ ============================================================================
+ Name        : hotkeys.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.23
+ Description : The most read and most written keys over a sliding window.
+             : Every read or write adds one to a Count-Min sketch (4 rows of
+             : 1024 counters), whose smallest counter is an estimate of how
+             : often the key was used that can only be too high.  A table of
+             : the 32 keys with the highest estimates is kept beside it; a key
+             : that is not in the table replaces the smallest entry when its
+             : estimate passes it, like Space-Saving.  The window is two
+             : halves of HOT_WINDOW_MS: the older half is dropped when a new
+             : one starts, and a key's count is the sum of both halves.
+             :
+             : A record costs four multiplications and increments, and a scan
+             : of the table only when the key is hot.  The memory is fixed.
+             : The server records and reads them on the rpc thread only, so
+             : nothing is locked.
+ ============================================================================
+ */
+
+#ifndef HOTKEYS_H
+#define HOTKEYS_H
+
+#define HOT_READS       0
+#define HOT_WRITES      1
+#define HOT_KINDS       2
+
+#define HOT_DEPTH       4      // rows of the sketch
+#define HOT_WIDTH_BITS  10
+#define HOT_WIDTH       (1 << HOT_WIDTH_BITS)
+#define HOT_CAPACITY    32     // keys the table of each half keeps
+#define HOT_TOP         8      // keys reported
+#define HOT_WINDOW_MS   30000  // length of one half of the window
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+
+// ONE KEY OF THE TABLE
+typedef struct hot_entry {
+	int key;
+	uint32_t count;   // estimate of the sketch, 0 if the entry is free
+} hot_entry;
+
+// ONE HALF OF THE WINDOW, FOR ONE KIND
+typedef struct hot_half {
+	uint32_t sketch[HOT_DEPTH][HOT_WIDTH];
+	hot_entry table[HOT_CAPACITY];
+	uint32_t minimum;   // smallest count of the table, 0 while it has a free entry
+} hot_half;
+
+// THE HOTTEST KEYS, FROM THE HOTTEST DOWN
+typedef struct hot_report {
+	int count;
+	hot_entry keys[HOT_TOP];
+} hot_report;
+
+
+/*******************************************************************************
+ * RECORDS A READ (HOT_READS) OR A WRITE (HOT_WRITES) OF THE KEY PROVIDED.     *
+ ******************************************************************************/
+void hot_record(int kind, int key);
+
+/*******************************************************************************
+ * FILLS IN THE REPORT WITH THE HOT_TOP KEYS OF THE KIND PROVIDED AND HOW      *
+ * OFTEN THEY WERE USED OVER THE WINDOW.                                       *
+ ******************************************************************************/
+void hot_snapshot(int kind, hot_report * report);
+
+/*******************************************************************************
+ * FORGETS EVERY KEY.                                                          *
+ ******************************************************************************/
+void hot_reset();
+
+#endif /* HOTKEYS_H */
@@ -21,6 +21,9 @@
  ******************************************************************************/
 char *substring(char *string, int position, int length);
 
+int kv_grow(kv * the_kv);
+int kv_put_locked(kv * the_kv, int key, int value);
+
 
 
 /*******************************************************************************
@@ -35,7 +38,7 @@ kv * kv_new()
 	if (p_list == NULL)
 		return NULL;
 
-	if (pthread_mutex_init(&(p_list->lock), NULL) != 0)
+	if (lockstat_init(&(p_list->lock), "kv") != 0)
 		return NULL;
 
 	// INITIALIZE STRUCT VALUES
@@ -91,16 +94,21 @@ int kv_set_lock_status(kv * the_kv, int key, int status)
  ******************************************************************************/
 int kv_expand(kv * the_kv)
 {
-	pthread_mutex_lock(&(the_kv->lock));
+	lockstat_acquire(&(the_kv->lock));
+	int result = kv_grow(the_kv);
+	lockstat_release(&(the_kv->lock));
+	return result;
+}
+
+// DOUBLES THE CAPACITY LIKE KV_EXPAND, THE CALLER HOLDS THE LOCK
+int kv_grow(kv * the_kv)
+{
 	int new_capacity = the_kv->capacity * 2;
 
 	element * new_elements = (element *) malloc(sizeof(element) * new_capacity);
 
 	if (new_elements == NULL)
-	{
-		pthread_mutex_unlock(&(the_kv->lock));
 		return MEMORY_ALLOCATION_ERROR;
-	}
 
 	// INITIALIZE new_elements;
 	for(int i = 0; i < new_capacity; i++)
@@ -126,7 +134,6 @@ int kv_expand(kv * the_kv)
 	free(the_kv->elements);
 	the_kv->capacity = new_capacity;
 	the_kv->elements = new_elements;
-	pthread_mutex_unlock(&(the_kv->lock));
 
 	return 0;
 }
@@ -141,16 +148,16 @@ int kv_expand(kv * the_kv)
 int kv_get(kv * the_kv, int key, int * value)
 {
 	//LOOK TO SEE IF THE KEY EXISTS AND IF SO, GET ITS INDEX
-	pthread_mutex_lock(&(the_kv->lock));
+	lockstat_acquire(&(the_kv->lock));
 
 	int result = kv_exists(the_kv, key);
 	if (result != -1)
 	{
 		*value = the_kv->elements[result].value;
-		pthread_mutex_unlock(&(the_kv->lock));
+		lockstat_release(&(the_kv->lock));
 		return 0;
 	} else {
-		pthread_mutex_unlock(&(the_kv->lock));
+		lockstat_release(&(the_kv->lock));
 		return -1;
 	}
 
@@ -166,22 +173,71 @@ int kv_get(kv * the_kv, int key, int * value)
  ******************************************************************************/
 int kv_put(kv * the_kv, int key , int value)
 {
-	pthread_mutex_lock(&(the_kv->lock));
+	lockstat_acquire(&(the_kv->lock));
+	int result = kv_put_locked(the_kv, key, value);
+	lockstat_release(&(the_kv->lock));
+	return result;
+}
 
+/*******************************************************************************
+ * GETS THE VALUES OF COUNT KEYS UNDER A SINGLE LOCK.  VALUES[I] IS THE VALUE  *
+ * OF KEYS[I] AND RESULTS[I] IS WHAT KV_GET WOULD HAVE RETURNED FOR IT (0 OR   *
+ * -1, THEN THE VALUE IS LEFT AS IT WAS).  RETURNS THE NUMBER OF KEYS FOUND.   *
+ ******************************************************************************/
+int kv_get_many(kv * the_kv, int count, int * keys, int * values, int * results)
+{
+	lockstat_acquire(&(the_kv->lock));
 
-	if(key == -1) // CANNOT PLACE KEY OF -1, IT IS A SENTINAL KEY
+	int found = 0;
+	for (int i = 0; i < count; i++)
 	{
-		pthread_mutex_unlock(&(the_kv->lock));
-		return -1;
+		int location = kv_exists(the_kv, keys[i]);
+		results[i] = (location == -1) ? -1 : 0;
+		if (location != -1)
+		{
+			values[i] = the_kv->elements[location].value;
+			found++;
+		}
+	}
+
+	lockstat_release(&(the_kv->lock));
+	return found;
+}
+
+/*******************************************************************************
+ * PUTS COUNT VALUES UNDER A SINGLE LOCK, VALUES[I] UNDER KEYS[I].  RESULTS[I] *
+ * IS WHAT KV_PUT WOULD HAVE RETURNED FOR IT.  RETURNS 0 IF EVERY PUT WORKED,  *
+ * -1 OTHERWISE.                                                               *
+ ******************************************************************************/
+int kv_put_many(kv * the_kv, int count, int * keys, int * values, int * results)
+{
+	lockstat_acquire(&(the_kv->lock));
+
+	int failed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		results[i] = kv_put_locked(the_kv, keys[i], values[i]);
+		if (results[i] != 0)
+			failed = 1;
 	}
 
+	lockstat_release(&(the_kv->lock));
+	return failed ? -1 : 0;
+}
+
+// THE BODY OF KV_PUT, THE CALLER HOLDS THE LOCK
+int kv_put_locked(kv * the_kv, int key, int value)
+{
+	if(key == -1) // CANNOT PLACE KEY OF -1, IT IS A SENTINAL KEY
+		return -1;
+
 	int location = kv_exists(the_kv, key);
 
 	if (location == -1)
 	{  //INSERT A NEW RECORD
 		//CHECK SIZE AND INCREASE IF NECESSARY
-		if (the_kv->size == the_kv->capacity)
-			kv_expand(the_kv);
+		if (the_kv->size == the_kv->capacity && kv_grow(the_kv) != 0)
+			return MEMORY_ALLOCATION_ERROR;
 
 		// PUT THE VALUE IN THE FIRST OPEN SLOT AND INCREMENT
 		int first_slot = kv_firstOpenSlot(the_kv);
@@ -192,10 +248,7 @@ int kv_put(kv * the_kv, int key , int value)
 		// REPLACE THE OLD KEY
 			the_kv->elements[location].value = value;
 	}
-
-	pthread_mutex_unlock(&(the_kv->lock));
 	return 0;
-
 }
 
 /*******************************************************************************
@@ -238,7 +291,7 @@ int kv_exists(kv * the_kv, int key)
  ******************************************************************************/
 int kv_del(kv* the_kv, int key)
 {
-	pthread_mutex_lock(&(the_kv->lock));
+	lockstat_acquire(&(the_kv->lock));
 
 	int results = kv_exists(the_kv, key);
 
@@ -246,14 +299,46 @@ int kv_del(kv* the_kv, int key)
 	{
 		the_kv->elements[results].key = -1;
 		the_kv->size--;
-		pthread_mutex_unlock(&(the_kv->lock));
+		lockstat_release(&(the_kv->lock));
 		return 0;
 	} else {
-		pthread_mutex_unlock(&(the_kv->lock));
+		lockstat_release(&(the_kv->lock));
 		return -1;
 	}
 }
 
+/*******************************************************************************
+ * COPIES EVERY KEY AND VALUE OF THE STORE INTO A NEW ARRAY SAVED AT THE       *
+ * ADDRESS PROVIDED, UNDER A SINGLE LOCK.  RETURNS THE NUMBER OF ELEMENTS, OR  *
+ * MEMORY_ALLOCATION_ERROR.  THE CALLER FREES THE ARRAY.                       *
+ ******************************************************************************/
+int kv_snapshot(kv * the_kv, element ** elements)
+{
+	lockstat_acquire(&(the_kv->lock));
+
+	element * copy = (element *) malloc(sizeof(element) * (the_kv->size + 1));
+	if (copy == NULL)
+	{
+		lockstat_release(&(the_kv->lock));
+		return MEMORY_ALLOCATION_ERROR;
+	}
+
+	int c = 0;
+	for (int i = 0; i < the_kv->capacity && c < the_kv->size; i++)
+	{
+		if (the_kv->elements[i].key != -1)
+		{
+			copy[c].key   = the_kv->elements[i].key;
+			copy[c].value = the_kv->elements[i].value;
+			c++;
+		}
+	}
+
+	lockstat_release(&(the_kv->lock));
+	*elements = copy;
+	return c;
+}
+
 /*******************************************************************************
  * PARSES MESSAGES THAT ARE SENT TO A SERVER TO DETERMINE THE COMMAND, KEY,    *
  * AND VALUES IF APPLICABLE.  THE RESULTS ARE STORED IN RESPECTIVE POINTERS    *
@@ -378,7 +463,7 @@ char *substring(char *string, int position, int length)
  ******************************************************************************/
 void kv_print(kv* the_kv)
 {
-	pthread_mutex_lock(&(the_kv->lock));
+	lockstat_acquire(&(the_kv->lock));
 	printf("The KV currently has %d elements and %d capacity.\n",the_kv->size, the_kv->capacity);
 	printf("The elements are as follows\n");
 	for (int i = 0; i < the_kv->capacity; i++)
@@ -389,6 +474,6 @@ void kv_print(kv* the_kv)
 			printf("[%d]\tKey: %d\tValue: %d\n", i, the_kv->elements[i].key, the_kv->elements[i].value);
 	}
 
-	pthread_mutex_unlock(&(the_kv->lock));
+	lockstat_release(&(the_kv->lock));
 
 }
@@ -35,6 +35,10 @@
   #include <stdlib.h>
 #endif
 
+#ifndef LOCKSTAT_H
+  #include "lockstat.h"
+#endif
+
 
 
 
@@ -47,7 +51,7 @@ typedef struct element {
 } element;
 
 typedef struct kv {
-	pthread_mutex_t lock;
+	lockstat lock;
 	int capacity;
 	int size;
 	element * elements;
@@ -89,6 +93,20 @@ int kv_get(kv * the_kv, int key, int * value);
  ******************************************************************************/
 int kv_put(kv * the_kv, int key , int value);
 
+/*******************************************************************************
+ * GETS THE VALUES OF COUNT KEYS UNDER A SINGLE LOCK.  VALUES[I] IS THE VALUE  *
+ * OF KEYS[I] AND RESULTS[I] IS WHAT KV_GET WOULD HAVE RETURNED FOR IT (0 OR   *
+ * -1, THEN THE VALUE IS LEFT AS IT WAS).  RETURNS THE NUMBER OF KEYS FOUND.   *
+ ******************************************************************************/
+int kv_get_many(kv * the_kv, int count, int * keys, int * values, int * results);
+
+/*******************************************************************************
+ * PUTS COUNT VALUES UNDER A SINGLE LOCK, VALUES[I] UNDER KEYS[I].  RESULTS[I] *
+ * IS WHAT KV_PUT WOULD HAVE RETURNED FOR IT.  RETURNS 0 IF EVERY PUT WORKED,  *
+ * -1 OTHERWISE.                                                               *
+ ******************************************************************************/
+int kv_put_many(kv * the_kv, int count, int * keys, int * values, int * results);
+
 
 /*******************************************************************************
  * A HELPFER FUNTION THAT WILL LOOK FOR THE FIRST EMPTY SLOT IN THE ELEMENTS   *
@@ -131,6 +149,14 @@ void kv_print(kv* the_kv);
 int kv_parser(char* message, int* ret_command, int* ret_key, int* ret_value);
 
 
+/*******************************************************************************
+ * COPIES EVERY KEY AND VALUE OF THE STORE INTO A NEW ARRAY SAVED AT THE       *
+ * ADDRESS PROVIDED, UNDER A SINGLE LOCK.  RETURNS THE NUMBER OF ELEMENTS, OR  *
+ * MEMORY_ALLOCATION_ERROR.  THE CALLER FREES THE ARRAY.                       *
+ ******************************************************************************/
+int kv_snapshot(kv * the_kv, element ** elements);
+
+
 int kv_get_lock_status(kv * the_kv, int key);
 int kv_set_lock_status(kv * the_kv, int key, int status);
 
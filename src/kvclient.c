@@ -0,0 +1,710 @@
+/*
+ ============================================================================
+ Name        : kvclient.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.28
+ Description : Asynchronous client library.  See kvclient.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef KVCLIENT_H
+#include "kvclient.h"
+#endif
+
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <rpc/pmap_prot.h>
+
+#define KVC_SLOT_MASK   (KVC_MAX_PENDING - 1)
+#define KVC_BATCH       64   // requests finished per pass of the timeout check
+
+void * kvc_receive(void * arg);
+void * kvc_resolve(void * arg);
+void kvc_check_timeouts(kvc_client * client, double now);
+void kvc_reply(kvc_client * client, char * buffer, int length);
+int kvc_redirect(kvc_client * client, kvc_request * request, xdrMsg * response);
+int kvc_submit(kvc_client * client, int server, int command, int key, int value,
+		kvc_callback callback, void * arg, kvc_future * future);
+int kvc_transmit(kvc_client * client, uint32_t xid, unsigned long program, xdrMsg * message, struct sockaddr_in * addr);
+int kvc_lookup(char * hostname, struct sockaddr_in * addr, unsigned long * program);
+void kvc_send_unsent(kvc_client * client, int server);
+kvc_request * kvc_take(kvc_client * client, int slot);
+void kvc_finish(kvc_client * client, kvc_request * request, int result, xdrMsg * response);
+double kvc_now_ms();
+
+
+/*******************************************************************************
+ * OPENS A CLIENT OF THE SERVERS PROVIDED (HOST OR HOST:INSTANCE ENTRIES OF    *
+ * SERVERLIST.TXT) AND STARTS THE RECEIVER AND THE RESOLVER THREADS, WHICH     *
+ * LOOKS UP THEIR PORTS.  RETURNS NULL IF THE SOCKET OR A THREAD CANNOT BE     *
+ * MADE.  A SERVER THAT IS DOWN IS LOOKED UP AGAIN WHEN A REQUEST IS SENT TO   *
+ * IT.                                                                         *
+ ******************************************************************************/
+kvc_client * kvc_open(char ** servers, int server_count)
+{
+	if (server_count < 1 || server_count > KVC_MAX_SERVERS)
+		return(NULL);
+
+	kvc_client * client = (kvc_client *) calloc(1, sizeof(kvc_client));
+	if (client == NULL)
+		return(NULL);
+
+	client->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (client->sock < 0)
+	{
+		free(client);
+		return(NULL);
+	}
+
+	client->server_count = server_count;
+	client->leader       = KVC_NO_LEADER;
+	client->timeout_ms   = KVC_DEFAULT_TIMEOUT_MS;
+	client->retries      = KVC_DEFAULT_RETRIES;
+	client->running      = 1;
+	client->checked_ms   = kvc_now_ms();
+	pthread_mutex_init(&client->lock, NULL);
+	pthread_cond_init(&client->completed, NULL);
+
+	// THE RESOLVER WAITS ON THE CLOCK OF KVC_NOW_MS
+	pthread_condattr_t monotonic;
+	pthread_condattr_init(&monotonic);
+	pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+	pthread_cond_init(&client->lookup, &monotonic);
+	pthread_condattr_destroy(&monotonic);
+
+	// EVERY SLOT IS FREE, THE LIST GOES 0, 1, 2...
+	for (int slot = 0; slot < KVC_MAX_PENDING; slot++)
+	{
+		client->requests[slot].xid = (uint32_t) slot;
+		client->requests[slot].next_free = (slot + 1 < KVC_MAX_PENDING) ? slot + 1 : -1;
+	}
+	client->free_head = 0;
+
+	for (int s = 0; s < server_count; s++)
+	{
+		strncpy(client->servers[s].hostname, servers[s], sizeof(client->servers[s].hostname) - 1);
+		client->servers[s].wanted = 1;
+	}
+
+	if (pthread_create(&client->receiver, NULL, kvc_receive, client) != 0)
+	{
+		close(client->sock);
+		free(client);
+		return(NULL);
+	}
+	if (pthread_create(&client->resolver, NULL, kvc_resolve, client) != 0)
+	{
+		__atomic_store_n(&client->running, 0, __ATOMIC_RELAXED);
+		pthread_join(client->receiver, NULL);
+		close(client->sock);
+		free(client);
+		return(NULL);
+	}
+	return(client);
+}
+
+
+/*******************************************************************************
+ * STOPS THE THREADS, FINISHES EVERY REQUEST STILL IN FLIGHT WITH KVC_CLOSED   *
+ * AND FREES THE CLIENT.                                                       *
+ ******************************************************************************/
+void kvc_close(kvc_client * client)
+{
+	pthread_mutex_lock(&client->lock);
+	client->running = 0;
+	pthread_cond_signal(&client->lookup);
+	pthread_mutex_unlock(&client->lock);
+	pthread_join(client->receiver, NULL);
+	pthread_join(client->resolver, NULL);
+
+	for (int slot = 0; slot < KVC_MAX_PENDING; slot++)
+	{
+		pthread_mutex_lock(&client->lock);
+		kvc_request * taken = kvc_take(client, slot);
+		kvc_request request;
+		if (taken != NULL)
+			request = *taken;
+		pthread_mutex_unlock(&client->lock);
+		if (taken != NULL)
+			kvc_finish(client, &request, KVC_CLOSED, NULL);
+	}
+
+	close(client->sock);
+	pthread_cond_destroy(&client->lookup);
+	pthread_cond_destroy(&client->completed);
+	pthread_mutex_destroy(&client->lock);
+	free(client);
+}
+
+
+/*******************************************************************************
+ * SETS THE TIMEOUT (MS) OF ONE ATTEMPT AND THE ATTEMPTS AFTER THE FIRST ONE   *
+ * OF THE REQUESTS SENT FROM NOW ON.                                           *
+ ******************************************************************************/
+void kvc_set_timeout(kvc_client * client, int timeout_ms, int retries)
+{
+	pthread_mutex_lock(&client->lock);
+	client->timeout_ms = (timeout_ms > 0) ? timeout_ms : KVC_DEFAULT_TIMEOUT_MS;
+	client->retries    = (retries >= 0) ? retries : 0;
+	pthread_mutex_unlock(&client->lock);
+}
+
+
+/*******************************************************************************
+ * SENDS A GET, PUT OR DEL (RPC_GET...) TO THE SERVER PROVIDED (AN INDEX OF    *
+ * THE SERVERS, OR KVC_ANY_SERVER) AND RETURNS AT ONCE.  THE CALLBACK GETS THE *
+ * RESULT.  RETURNS KVC_OK IF THE REQUEST IS ON ITS WAY, KVC_FULL OR KVC_ERROR *
+ * OTHERWISE, AND THEN THE CALLBACK IS NOT CALLED.  A REQUEST TO A SERVER      *
+ * WHOSE PORT IS NOT KNOWN YET WAITS FOR THE RESOLVER WITHIN ITS TIMEOUT AND   *
+ * RETRIES.                                                                    *
+ ******************************************************************************/
+int kvc_send(kvc_client * client, int server, int command, int key, int value, kvc_callback callback, void * arg)
+{
+	return(kvc_submit(client, server, command, key, value, callback, arg, NULL));
+}
+
+int kvc_get(kvc_client * client, int server, int key, kvc_callback callback, void * arg)
+{
+	return(kvc_submit(client, server, RPC_GET, key, 0, callback, arg, NULL));
+}
+
+int kvc_put(kvc_client * client, int server, int key, int value, kvc_callback callback, void * arg)
+{
+	return(kvc_submit(client, server, RPC_PUT, key, value, callback, arg, NULL));
+}
+
+int kvc_del(kvc_client * client, int server, int key, kvc_callback callback, void * arg)
+{
+	return(kvc_submit(client, server, RPC_DEL, key, 0, callback, arg, NULL));
+}
+
+
+/*******************************************************************************
+ * THE SAME WITH A FUTURE INSTEAD OF A CALLBACK.  IF THE SEND FAILS THE FUTURE *
+ * IS ALREADY DONE WITH THE RESULT.                                            *
+ ******************************************************************************/
+int kvc_send_future(kvc_client * client, int server, int command, int key, int value, kvc_future * future)
+{
+	memset(future, 0, sizeof(kvc_future));
+	int result = kvc_submit(client, server, command, key, value, NULL, NULL, future);
+	if (result != KVC_OK)
+	{
+		future->result = result;
+		future->done   = 1;
+	}
+	return(result);
+}
+
+int kvc_get_future(kvc_client * client, int server, int key, kvc_future * future)
+{
+	return(kvc_send_future(client, server, RPC_GET, key, 0, future));
+}
+
+int kvc_put_future(kvc_client * client, int server, int key, int value, kvc_future * future)
+{
+	return(kvc_send_future(client, server, RPC_PUT, key, value, future));
+}
+
+int kvc_del_future(kvc_client * client, int server, int key, kvc_future * future)
+{
+	return(kvc_send_future(client, server, RPC_DEL, key, 0, future));
+}
+
+
+/*******************************************************************************
+ * WAITS FOR THE FUTURE PROVIDED AND RETURNS ITS RESULT.  THE RESPONSE IS IN   *
+ * THE FUTURE.                                                                 *
+ ******************************************************************************/
+int kvc_wait(kvc_client * client, kvc_future * future)
+{
+	pthread_mutex_lock(&client->lock);
+	while (!future->done)
+		pthread_cond_wait(&client->completed, &client->lock);
+	pthread_mutex_unlock(&client->lock);
+	return(future->result);
+}
+
+
+/*******************************************************************************
+ * WAITS UNTIL NO REQUEST IS IN FLIGHT.                                        *
+ ******************************************************************************/
+void kvc_drain(kvc_client * client)
+{
+	pthread_mutex_lock(&client->lock);
+	while (client->pending > 0)
+		pthread_cond_wait(&client->completed, &client->lock);
+	pthread_mutex_unlock(&client->lock);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NUMBER OF REQUESTS IN FLIGHT.                                   *
+ ******************************************************************************/
+int kvc_pending(kvc_client * client)
+{
+	pthread_mutex_lock(&client->lock);
+	int pending = client->pending;
+	pthread_mutex_unlock(&client->lock);
+	return(pending);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE SERVER THE LAST REPLY NAMED THE LEADER, OR         *
+ * KVC_NO_LEADER.                                                              *
+ ******************************************************************************/
+int kvc_leader(kvc_client * client)
+{
+	pthread_mutex_lock(&client->lock);
+	int leader = client->leader;
+	pthread_mutex_unlock(&client->lock);
+	return(leader);
+}
+
+
+// TAKES A FREE SLOT, SENDS THE FIRST ATTEMPT OR HOLDS IT FOR THE RESOLVER.  NEVER WAITS ON THE NETWORK
+int kvc_submit(kvc_client * client, int server, int command, int key, int value,
+		kvc_callback callback, void * arg, kvc_future * future)
+{
+	if (command != RPC_GET && command != RPC_PUT && command != RPC_DEL)
+		return(KVC_ERROR);
+
+	pthread_mutex_lock(&client->lock);
+	int routed = (server == KVC_ANY_SERVER);
+	if (routed && command != RPC_GET && client->leader != KVC_NO_LEADER)
+		server = client->leader;
+	else if (routed)
+		server = client->next_server++ % client->server_count;
+	if (server < 0 || server >= client->server_count || !client->running)
+	{
+		pthread_mutex_unlock(&client->lock);
+		return(KVC_ERROR);
+	}
+
+	if (client->free_head < 0)
+	{
+		pthread_mutex_unlock(&client->lock);
+		return(KVC_FULL);
+	}
+
+	int slot = client->free_head;
+	kvc_request * request = &client->requests[slot];
+	client->free_head = request->next_free;
+	client->pending++;
+
+	double now = kvc_now_ms();
+	request->xid        = (request->xid & ~(uint32_t) KVC_SLOT_MASK) + KVC_MAX_PENDING + (uint32_t) slot;
+	request->in_use     = 1;
+	request->server     = server;
+	request->routed     = routed;
+	request->redirected = 0;
+	request->attempts   = 1;
+	request->unsent     = 0;
+	request->sent_ms    = now;
+	request->started_ms = now;
+	request->timeout_ms = client->timeout_ms;
+	request->retries    = client->retries;
+	request->callback   = callback;
+	request->arg        = arg;
+	request->future     = future;
+	memset(&request->message, 0, sizeof(xdrMsg));
+	request->message.command  = command;
+	request->message.key      = key;
+	request->message.value    = value;
+	request->message.deadline = client->timeout_ms;  // SO THE PROPOSER GIVES UP IN TIME
+	request->message.pid      = (int) trace_new_id();
+
+	// NO PORT YET: THE RESOLVER SENDS IT, OR THE TIMEOUT FAILS IT
+	if (client->servers[server].addr.sin_port == 0)
+	{
+		request->unsent = 1;
+		client->servers[server].wanted = 1;
+		pthread_cond_signal(&client->lookup);
+		pthread_mutex_unlock(&client->lock);
+		return(KVC_OK);
+	}
+
+	uint32_t xid = request->xid;
+	xdrMsg message = request->message;
+	struct sockaddr_in addr = client->servers[server].addr;
+	unsigned long program = client->servers[server].program;
+	pthread_mutex_unlock(&client->lock);
+
+	if (kvc_transmit(client, xid, program, &message, &addr) == 0)
+		return(KVC_OK);
+
+	// NOT SENT: GIVE THE SLOT BACK, NO CALLBACK
+	pthread_mutex_lock(&client->lock);
+	if (client->requests[slot].xid == xid && kvc_take(client, slot) != NULL)
+	{
+		client->pending--;
+		if (client->pending == 0)
+			pthread_cond_broadcast(&client->completed);
+	}
+	pthread_mutex_unlock(&client->lock);
+	return(KVC_ERROR);
+}
+
+
+// THE RECEIVER THREAD: READS THE REPLIES AND CHECKS THE TIMEOUTS EVERY KVC_TICK_MS
+void * kvc_receive(void * arg)
+{
+	kvc_client * client = (kvc_client *) arg;
+	char buffer[KVC_BUFFER_SIZE];
+
+	while (__atomic_load_n(&client->running, __ATOMIC_RELAXED))
+	{
+		struct pollfd ready;
+		ready.fd      = client->sock;
+		ready.events  = POLLIN;
+		ready.revents = 0;
+		if (poll(&ready, 1, KVC_TICK_MS) > 0)
+		{
+			// EMPTY THE SOCKET BEFORE LOOKING AT THE CLOCK AGAIN
+			int length;
+			while ((length = recv(client->sock, buffer, KVC_BUFFER_SIZE, MSG_DONTWAIT)) > 0)
+				kvc_reply(client, buffer, length);
+		}
+
+		double now = kvc_now_ms();
+		if (now - client->checked_ms >= KVC_TICK_MS)
+		{
+			client->checked_ms = now;
+			kvc_check_timeouts(client, now);
+		}
+	}
+	return(NULL);
+}
+
+
+// MATCHES ONE REPLY TO ITS REQUEST AND FINISHES IT.  A LATE OR UNKNOWN REPLY IS DROPPED
+void kvc_reply(kvc_client * client, char * buffer, int length)
+{
+	struct rpc_msg reply;
+	xdrMsg response;
+	memset(&reply, 0, sizeof(reply));
+	memset(&response, 0, sizeof(response));
+	reply.acpted_rply.ar_verf          = _null_auth;
+	reply.acpted_rply.ar_results.where = (caddr_t) &response;
+	reply.acpted_rply.ar_results.proc  = (xdrproc_t) xdr_rpc;
+
+	XDR xdrs;
+	xdrmem_create(&xdrs, buffer, length, XDR_DECODE);
+	int decoded = xdr_replymsg(&xdrs, &reply);
+	xdr_destroy(&xdrs);
+	if (!decoded)
+		return;
+
+	int accepted = reply.rm_reply.rp_stat == MSG_ACCEPTED && reply.acpted_rply.ar_stat == SUCCESS;
+
+	pthread_mutex_lock(&client->lock);
+	if (accepted && response.hint >= 0 && response.hint < client->server_count)
+		client->leader = response.hint;
+
+	int slot = (int) (reply.rm_xid & KVC_SLOT_MASK);
+	kvc_request * taken = NULL;
+	kvc_request request;
+	if (client->requests[slot].in_use && client->requests[slot].xid == reply.rm_xid)
+	{
+		kvc_request * pending = &client->requests[slot];
+		if (accepted && kvc_redirect(client, pending, &response) == 0)
+		{
+			pthread_mutex_unlock(&client->lock);
+			return;
+		}
+		taken = kvc_take(client, slot);
+		request = *taken;
+	}
+	pthread_mutex_unlock(&client->lock);
+
+	if (taken == NULL)
+		return;
+	if (!accepted)
+		kvc_finish(client, &request, KVC_ERROR, NULL);
+	else
+		kvc_finish(client, &request, (response.status == OK) ? KVC_OK : KVC_NACK, &response);
+}
+
+
+// SENDS AGAIN THE REQUESTS THAT TIMED OUT, FAILS THE ONES WITHOUT RETRIES LEFT.  A REQUEST STILL
+// WAITING FOR ITS PORT COUNTS ITS ATTEMPTS THE SAME WAY
+void kvc_check_timeouts(kvc_client * client, double now)
+{
+	kvc_request failed[KVC_BATCH];
+	int slot = 0;
+	while (slot < KVC_MAX_PENDING)
+	{
+		int count = 0;
+		int wanted = 0;
+		pthread_mutex_lock(&client->lock);
+		for (; slot < KVC_MAX_PENDING && count < KVC_BATCH; slot++)
+		{
+			kvc_request * request = &client->requests[slot];
+			if (!request->in_use || now - request->sent_ms < request->timeout_ms)
+				continue;
+
+			if (request->attempts <= request->retries)
+			{
+				// THE LEADER DIDN'T ANSWER, FORGET IT AND TRY ANOTHER SERVER
+				if (request->routed && request->server == client->leader)
+				{
+					client->leader = KVC_NO_LEADER;
+					int next = client->next_server++ % client->server_count;
+					if (next == request->server)
+						next = client->next_server++ % client->server_count;
+					request->server = next;
+				}
+
+				// THE SAME XID, SO A LATE REPLY TO AN EARLIER ATTEMPT STILL COUNTS
+				request->attempts++;
+				request->sent_ms = now;
+				kvc_server * server = &client->servers[request->server];
+				request->unsent = (kvc_transmit(client, request->xid, server->program, &request->message, &server->addr) != 0);
+				if (request->unsent && server->addr.sin_port == 0)
+					server->wanted = wanted = 1;
+			} else {
+				// THE SERVER MAY HAVE RESTARTED ON A NEW PORT, LOOK IT UP AGAIN
+				client->servers[request->server].wanted = wanted = 1;
+				failed[count++] = *kvc_take(client, slot);
+			}
+		}
+		if (wanted)
+			pthread_cond_signal(&client->lookup);
+		pthread_mutex_unlock(&client->lock);
+
+		for (int f = 0; f < count; f++)
+			kvc_finish(client, &failed[f], KVC_TIMEOUT, NULL);
+	}
+}
+
+
+// SENDS A ROUTED WRITE THAT WAS NACKED ON TO THE LEADER THE REPLY NAMED, ONCE, UNDER A NEW XID
+// SO A LATE REPLY OF THE FIRST SERVER IS DROPPED.  CALLED WITH THE LOCK.  RETURNS -1 IF IT WASN'T
+int kvc_redirect(kvc_client * client, kvc_request * request, xdrMsg * response)
+{
+	int leader = response->hint;
+	if (!request->routed || request->redirected || request->message.command == RPC_GET || response->status == OK
+			|| leader < 0 || leader >= client->server_count || leader == request->server)
+		return(-1);
+
+	kvc_server * server = &client->servers[leader];
+	if (server->addr.sin_port == 0)
+		return(-1);
+
+	request->xid       += KVC_MAX_PENDING;
+	request->server     = leader;
+	request->redirected = 1;
+	request->attempts   = 1;
+	request->sent_ms    = kvc_now_ms();
+	kvc_transmit(client, request->xid, server->program, &request->message, &server->addr);
+	return(0);
+}
+
+
+// ENCODES ONE CALL AND SENDS IT.  RETURNS -1 IF IT CANNOT BE SENT
+int kvc_transmit(kvc_client * client, uint32_t xid, unsigned long program, xdrMsg * message, struct sockaddr_in * addr)
+{
+	char buffer[KVC_BUFFER_SIZE];
+	struct rpc_msg call;
+	memset(&call, 0, sizeof(call));
+	call.rm_xid       = xid;
+	call.rm_direction = CALL;
+	call.rm_call.cb_rpcvers = RPC_MSG_VERSION;
+	call.rm_call.cb_prog    = program;
+	call.rm_call.cb_vers    = RPC_PROC_VER;
+	call.rm_call.cb_proc    = message->command;
+	call.rm_call.cb_cred    = _null_auth;
+	call.rm_call.cb_verf    = _null_auth;
+
+	XDR xdrs;
+	xdrmem_create(&xdrs, buffer, KVC_BUFFER_SIZE, XDR_ENCODE);
+	int encoded = xdr_callmsg(&xdrs, &call) && xdr_rpc(&xdrs, message);
+	int length = (int) xdr_getpos(&xdrs);
+	xdr_destroy(&xdrs);
+
+	if (!encoded || addr->sin_port == 0)
+		return(-1);
+	if (sendto(client->sock, buffer, length, 0, (struct sockaddr *) addr, sizeof(struct sockaddr_in)) != length)
+		return(-1);
+	return(0);
+}
+
+
+// THE RESOLVER THREAD: LOOKS UP THE WANTED SERVERS, EACH AT MOST EVERY KVC_LOOKUP_MS, AND SENDS THE
+// REQUESTS THAT WAITED FOR THEIR PORT.  A PORT THAT WAS KNOWN IS KEPT IF THE LOOKUP FAILS
+void * kvc_resolve(void * arg)
+{
+	kvc_client * client = (kvc_client *) arg;
+
+	pthread_mutex_lock(&client->lock);
+	while (client->running)
+	{
+		double now  = kvc_now_ms();
+		double next = now + KVC_LOOKUP_MS;
+		int server  = -1;
+		for (int s = 0; s < client->server_count && server < 0; s++)
+		{
+			kvc_server * entry = &client->servers[s];
+			double due = entry->looked_up_ms + KVC_LOOKUP_MS;
+			if (entry->wanted && (entry->looked_up_ms == 0 || due <= now))
+				server = s;
+			else if (entry->wanted && due < next)
+				next = due;
+		}
+
+		if (server < 0)
+		{
+			struct timespec until;
+			until.tv_sec  = (time_t) (next / 1000);
+			until.tv_nsec = (long) ((next - until.tv_sec * 1000.0) * 1000000);
+			pthread_cond_timedwait(&client->lookup, &client->lock, &until);
+			continue;
+		}
+
+		kvc_server * entry = &client->servers[server];
+		entry->wanted       = 0;
+		entry->looked_up_ms = now;
+		char hostname[sizeof(entry->hostname)];
+		strcpy(hostname, entry->hostname);
+		pthread_mutex_unlock(&client->lock);
+
+		// THE LOOKUP BLOCKS, SO DO IT WITHOUT THE LOCK
+		struct sockaddr_in addr;
+		unsigned long program;
+		int found = kvc_lookup(hostname, &addr, &program);
+
+		pthread_mutex_lock(&client->lock);
+		if (found == 0)
+		{
+			entry->program = program;
+			entry->addr    = addr;
+			kvc_send_unsent(client, server);
+		}
+	}
+	pthread_mutex_unlock(&client->lock);
+	return(NULL);
+}
+
+
+// SENDS THE REQUESTS THAT WAITED FOR THE PORT OF THE SERVER.  CALLED WITH THE LOCK HELD
+void kvc_send_unsent(kvc_client * client, int server)
+{
+	kvc_server * entry = &client->servers[server];
+	double now = kvc_now_ms();
+	for (int slot = 0; slot < KVC_MAX_PENDING; slot++)
+	{
+		kvc_request * request = &client->requests[slot];
+		if (!request->in_use || !request->unsent || request->server != server)
+			continue;
+		request->sent_ms = now;
+		request->unsent  = (kvc_transmit(client, request->xid, entry->program, &request->message, &entry->addr) != 0);
+	}
+}
+
+
+// FINDS THE ADDRESS AND THE PORT OF A HOST OR HOST:INSTANCE ENTRY, ASKING THE PORTMAPPER LIKE
+// PMAP_GETPORT BUT FOR AT MOST KVC_LOOKUP_TIMEOUT_MS.  RETURNS -1 IF EITHER CANNOT BE FOUND
+int kvc_lookup(char * hostname, struct sockaddr_in * addr, unsigned long * program)
+{
+	// A HOST:INSTANCE ENTRY SELECTS THE PROGRAM OF THAT INSTANCE, AS IN PEER_PARSE_ENTRY
+	char host[sizeof(((kvc_server *) NULL)->hostname)];
+	strcpy(host, hostname);
+	*program = RPC_PROG_NUM;
+	char * colon = strchr(host, ':');
+	if (colon != NULL)
+	{
+		*colon = '\0';
+		*program = RPC_PROG_NUM + strtoul(colon + 1, NULL, 10);
+	}
+
+	struct addrinfo hints;
+	struct addrinfo * result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, NULL, &hints, &result) != 0)
+		return(-1);
+	memset(addr, 0, sizeof(struct sockaddr_in));
+	memcpy(addr, result->ai_addr, sizeof(struct sockaddr_in));
+	freeaddrinfo(result);
+
+	struct sockaddr_in portmapper_addr = *addr;
+	portmapper_addr.sin_port = htons(PMAPPORT);
+	struct timeval wait = { KVC_LOOKUP_TIMEOUT_MS / 1000, (KVC_LOOKUP_TIMEOUT_MS % 1000) * 1000 };
+	int sock = RPC_ANYSOCK;
+	CLIENT * portmapper = clntudp_create(&portmapper_addr, PMAPPROG, PMAPVERS, wait, &sock);
+	if (portmapper == NULL)
+		return(-1);
+
+	struct pmap query;
+	query.pm_prog = *program;
+	query.pm_vers = RPC_PROC_VER;
+	query.pm_prot = IPPROTO_UDP;
+	query.pm_port = 0;
+	u_long port = 0;
+
+	enum clnt_stat status = clnt_call(portmapper, PMAPPROC_GETPORT,
+			(xdrproc_t) xdr_pmap, (caddr_t) &query,
+			(xdrproc_t) xdr_u_long, (caddr_t) &port,
+			wait);
+	clnt_destroy(portmapper);
+
+	if (status != RPC_SUCCESS || port == 0 || port > 0xFFFF)
+		return(-1);
+	addr->sin_port = htons((uint16_t) port);
+	return(0);
+}
+
+
+// FREES THE SLOT AND RETURNS ITS REQUEST, NULL IF IT IS NOT IN USE.  THE REQUEST STAYS PENDING
+// UNTIL KVC_FINISH HAS GIVEN ITS RESULT.  CALLED WITH THE LOCK HELD
+kvc_request * kvc_take(kvc_client * client, int slot)
+{
+	kvc_request * request = &client->requests[slot];
+	if (!request->in_use)
+		return(NULL);
+
+	request->in_use    = 0;
+	request->next_free = client->free_head;
+	client->free_head  = slot;
+	return(request);
+}
+
+
+// GIVES THE RESULT TO THE CALLBACK OR THE FUTURE.  CALLED WITHOUT THE LOCK
+void kvc_finish(kvc_client * client, kvc_request * request, int result, xdrMsg * response)
+{
+	TRACE_EVENT(TRACE_CLIENT, (uint32_t) request->message.pid, TRACE_NO_PEER, request->message.key,
+			response != NULL ? response->value : request->message.value, response != NULL ? response->lc : -1,
+			response != NULL ? response->status : FAILURE, kvc_now_ms() - request->started_ms);
+
+	if (request->callback != NULL)
+		request->callback(request->arg, result, response);
+
+	pthread_mutex_lock(&client->lock);
+	if (request->future != NULL)
+	{
+		if (response != NULL)
+			request->future->response = *response;
+		request->future->result = result;
+		request->future->done   = 1;
+	}
+	client->pending--;
+	if (request->future != NULL || client->pending == 0)
+		pthread_cond_broadcast(&client->completed);
+	pthread_mutex_unlock(&client->lock);
+}
+
+
+// MS OF THE MONOTONIC CLOCK
+double kvc_now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return(now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0);
+}
@@ -0,0 +1,207 @@
+/*
+ ============================================================================
+ Name        : kvclient.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.28
+ Description : Asynchronous client library.  client_rpc_send blocks in
+             : clnt_call, so a thread has one operation in flight.  A
+             : kvc_client writes the ONC RPC calls itself on one UDP socket
+             : and a receiver thread matches the replies to the requests by
+             : their xid, so one client keeps up to KVC_MAX_PENDING GETs,
+             : PUTs and DELs outstanding against all the servers at once.
+             : A request that gets no reply in its timeout is sent again
+             : with the same xid, up to the retries, then fails with
+             : KVC_TIMEOUT.  The ports are looked up by a thread of their
+             : own, so a send never waits on the DNS or a portmapper: a
+             : request to a server whose port is not known yet is held and
+             : sent once the lookup gives it, or fails with KVC_TIMEOUT like
+             : one that got no reply.
+             :
+             : Every reply names the leader, the server whose proposals
+             : last won a quarom, and a PUT or DEL sent to KVC_ANY_SERVER
+             : goes to it: one proposer does not duel with the others over
+             : the lamport clock, so its prepares aren't NACKed.  A write
+             : NACKed by a server that names another leader is sent on to
+             : it once (a redirect); when the leader doesn't answer in the
+             : timeout it is forgotten and the retry goes round robin.
+             :
+             : The result comes back through a callback, run on the receiver
+             : thread (keep it short, it may send more requests), or through
+             : a future to wait on.  The library only needs xdrconv.c and
+             : trace.c: make libkvclient.a builds it, link it with -lpthread
+             : (and -ltirpc where the rpc library is separate).
+             :
+             :   kvc_client * kv = kvc_open(servers, count);
+             :   kvc_future f;
+             :   kvc_put_future(kv, KVC_ANY_SERVER, 7, 42, &f);
+             :   if (kvc_wait(kv, &f) == KVC_OK) ...
+             :   kvc_close(kv);
+ ============================================================================
+ */
+
+#ifndef KVCLIENT_H
+#define KVCLIENT_H
+
+#define KVC_MAX_PENDING          4096    // requests in flight per client, a power of two
+#define KVC_MAX_SERVERS          64
+#define KVC_DEFAULT_TIMEOUT_MS   1000    // of one attempt
+#define KVC_DEFAULT_RETRIES      2       // attempts after the first
+#define KVC_TICK_MS              5       // how often the timeouts are checked
+#define KVC_LOOKUP_MS            1000    // least time between two port lookups of a server
+#define KVC_LOOKUP_TIMEOUT_MS    500     // the portmapper answers in it or the lookup fails
+#define KVC_BUFFER_SIZE          512     // one call or reply
+#define KVC_ANY_SERVER           -1      // let the client pick the server (the leader for a write, round robin otherwise)
+#define KVC_NO_LEADER            -1
+
+// RESULTS, GIVEN TO THE CALLBACK OR RETURNED BY A SEND
+#define KVC_OK        0    // the server answered OK
+#define KVC_NACK      1    // the server answered something else (key not found, failed quarom...)
+#define KVC_TIMEOUT  -1    // no reply after every retry
+#define KVC_ERROR    -2    // the server cannot be reached or the reply is not one
+#define KVC_FULL     -3    // KVC_MAX_PENDING requests are already in flight
+#define KVC_CLOSED   -4    // the client was closed before the reply came
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <rpc/rpc.h>
+#include <netinet/in.h>
+
+#ifndef XDRCONV_H
+#include "xdrconv.h"
+#endif
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+
+// CALLED ONCE PER REQUEST WITH ITS RESULT.  RESPONSE IS ONLY SET WHEN THE RESULT IS KVC_OK OR KVC_NACK
+typedef void (*kvc_callback)(void * arg, int result, xdrMsg * response);
+
+// A REQUEST TO WAIT FOR WITH KVC_WAIT
+typedef struct kvc_future {
+	int done;
+	int result;
+	xdrMsg response;
+} kvc_future;
+
+// ONE REQUEST IN FLIGHT
+typedef struct kvc_request {
+	uint32_t xid;               // slot in the low bits, a generation above
+	int in_use;
+	int next_free;
+	int server;
+	int routed;                 // sent to KVC_ANY_SERVER, so it follows the leader
+	int redirected;             // a NACK already sent it on to the leader
+	int attempts;
+	int unsent;                 // its server had no port, the resolver sends it once it has one
+	double sent_ms;             // of the last attempt
+	double started_ms;          // of the first attempt
+	int timeout_ms;             // of one attempt
+	int retries;
+	xdrMsg message;
+	kvc_callback callback;
+	void * arg;
+	kvc_future * future;        // NULL for a callback
+} kvc_request;
+
+// ONE SERVER
+typedef struct kvc_server {
+	char hostname[128];
+	struct sockaddr_in addr;    // port 0 until the portmapper gave it
+	unsigned long program;
+	double looked_up_ms;
+	int wanted;                 // no port yet or a request timed out, ask the portmapper (again)
+} kvc_server;
+
+typedef struct kvc_client {
+	int sock;
+	int server_count;
+	int next_server;
+	int leader;                 // index of the server the last reply named the leader, or KVC_NO_LEADER
+	kvc_server servers[KVC_MAX_SERVERS];
+	kvc_request requests[KVC_MAX_PENDING];
+	int free_head;
+	int pending;
+	int timeout_ms;
+	int retries;
+	int running;
+	double checked_ms;          // when the timeouts were last checked
+	pthread_mutex_t lock;       // the requests and the servers
+	pthread_cond_t completed;   // a future is done or a request is finished
+	pthread_cond_t lookup;      // a server is wanted, on the monotonic clock
+	pthread_t receiver;
+	pthread_t resolver;         // looks up the ports
+} kvc_client;
+
+
+/*******************************************************************************
+ * OPENS A CLIENT OF THE SERVERS PROVIDED (HOST OR HOST:INSTANCE ENTRIES OF    *
+ * SERVERLIST.TXT) AND STARTS THE RECEIVER AND THE RESOLVER THREADS, WHICH     *
+ * LOOKS UP THEIR PORTS.  RETURNS NULL IF THE SOCKET OR A THREAD CANNOT BE     *
+ * MADE.  A SERVER THAT IS DOWN IS LOOKED UP AGAIN WHEN A REQUEST IS SENT TO   *
+ * IT.                                                                         *
+ ******************************************************************************/
+kvc_client * kvc_open(char ** servers, int server_count);
+
+/*******************************************************************************
+ * STOPS THE THREADS, FINISHES EVERY REQUEST STILL IN FLIGHT WITH KVC_CLOSED   *
+ * AND FREES THE CLIENT.                                                       *
+ ******************************************************************************/
+void kvc_close(kvc_client * client);
+
+/*******************************************************************************
+ * SETS THE TIMEOUT (MS) OF ONE ATTEMPT AND THE ATTEMPTS AFTER THE FIRST ONE   *
+ * OF THE REQUESTS SENT FROM NOW ON.                                           *
+ ******************************************************************************/
+void kvc_set_timeout(kvc_client * client, int timeout_ms, int retries);
+
+/*******************************************************************************
+ * SENDS A GET, PUT OR DEL (RPC_GET...) TO THE SERVER PROVIDED (AN INDEX OF    *
+ * THE SERVERS, OR KVC_ANY_SERVER) AND RETURNS AT ONCE.  THE CALLBACK GETS THE *
+ * RESULT.  RETURNS KVC_OK IF THE REQUEST IS ON ITS WAY, KVC_FULL OR KVC_ERROR *
+ * OTHERWISE, AND THEN THE CALLBACK IS NOT CALLED.  A REQUEST TO A SERVER      *
+ * WHOSE PORT IS NOT KNOWN YET WAITS FOR THE RESOLVER WITHIN ITS TIMEOUT AND   *
+ * RETRIES.  THE HINTS NAME A SERVER BY ITS LINE OF SERVERLIST.TXT, SO PASS    *
+ * THE SERVERS IN THAT ORDER.                                                  *
+ ******************************************************************************/
+int kvc_send(kvc_client * client, int server, int command, int key, int value, kvc_callback callback, void * arg);
+int kvc_get(kvc_client * client, int server, int key, kvc_callback callback, void * arg);
+int kvc_put(kvc_client * client, int server, int key, int value, kvc_callback callback, void * arg);
+int kvc_del(kvc_client * client, int server, int key, kvc_callback callback, void * arg);
+
+/*******************************************************************************
+ * THE SAME WITH A FUTURE INSTEAD OF A CALLBACK.  IF THE SEND FAILS THE FUTURE *
+ * IS ALREADY DONE WITH THE RESULT.                                            *
+ ******************************************************************************/
+int kvc_send_future(kvc_client * client, int server, int command, int key, int value, kvc_future * future);
+int kvc_get_future(kvc_client * client, int server, int key, kvc_future * future);
+int kvc_put_future(kvc_client * client, int server, int key, int value, kvc_future * future);
+int kvc_del_future(kvc_client * client, int server, int key, kvc_future * future);
+
+/*******************************************************************************
+ * WAITS FOR THE FUTURE PROVIDED AND RETURNS ITS RESULT.  THE RESPONSE IS IN   *
+ * THE FUTURE.                                                                 *
+ ******************************************************************************/
+int kvc_wait(kvc_client * client, kvc_future * future);
+
+/*******************************************************************************
+ * WAITS UNTIL NO REQUEST IS IN FLIGHT.                                        *
+ ******************************************************************************/
+void kvc_drain(kvc_client * client);
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE SERVER THE LAST REPLY NAMED THE LEADER, OR         *
+ * KVC_NO_LEADER.                                                              *
+ ******************************************************************************/
+int kvc_leader(kvc_client * client);
+
+/*******************************************************************************
+ * RETURNS THE NUMBER OF REQUESTS IN FLIGHT.                                   *
+ ******************************************************************************/
+int kvc_pending(kvc_client * client);
+
+#endif /* KVCLIENT_H */
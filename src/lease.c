@@ -0,0 +1,119 @@
+/*
+ ============================================================================
+ Name        : lease.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.02
+ Description : Read leases of a learner.  See lease.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef LEASE_H
+#include "lease.h"
+#endif
+
+#include <math.h>
+#include <unistd.h>
+
+int lease_bucket(int key);
+
+void (*lease_waiter)(int ms) = NULL;   // the simulator's wait, usleep when NULL
+
+
+/*******************************************************************************
+ * RETURNS A NEW TABLE WITHOUT ANY LEASE, OR NULL IF THERE IS NO MEMORY.       *
+ ******************************************************************************/
+lease_table * lease_new()
+{
+	return((lease_table *) calloc(1, sizeof(lease_table)));
+}
+
+
+/*******************************************************************************
+ * FREES THE TABLE.                                                            *
+ ******************************************************************************/
+void lease_free(lease_table * table)
+{
+	free(table);
+}
+
+
+/*******************************************************************************
+ * GRANTS A LEASE ON THE KEY OF REQUESTED MS, AT MOST LEASE_MAX_MS, STARTING   *
+ * AT NOW.  RETURNS THE MS GRANTED, 0 IF NONE WAS ASKED FOR.                   *
+ ******************************************************************************/
+int lease_grant(lease_table * table, int key, int requested, double now)
+{
+	if (table == NULL || requested <= 0)
+		return(0);
+	if (requested > LEASE_MAX_MS)
+		requested = LEASE_MAX_MS;
+
+	// AN EARLIER LEASE OF THE BUCKET MAY RUN LONGER, KEEP THE LATER EXPIRY
+	int bucket = lease_bucket(key);
+	if (now + requested > table->expires[bucket])
+		table->expires[bucket] = now + requested;
+	if (now + requested > table->latest)
+		table->latest = now + requested;
+	return(requested);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT BEFORE EVERY LEASE ON THE KEY RUNS OUT, 0 IF IT HAS     *
+ * NONE.                                                                       *
+ ******************************************************************************/
+int lease_remaining(lease_table * table, int key, double now)
+{
+	if (table == NULL)
+		return(0);
+
+	double left = table->expires[lease_bucket(key)] - now;
+	if (left <= 0)
+		return(0);
+	return((int) ceil(left));  // ROUNDED UP, A WRITER NEVER WAITS TOO LITTLE
+}
+
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT BEFORE EVERY LEASE OF THE TABLE RUNS OUT, WHATEVER ITS  *
+ * KEY, 0 IF IT HAS NONE.                                                      *
+ ******************************************************************************/
+int lease_latest(lease_table * table, double now)
+{
+	if (table == NULL || table->latest <= now)
+		return(0);
+	return((int) ceil(table->latest - now));
+}
+
+
+
+/*******************************************************************************
+ * SLEEPS FOR THE MS PROVIDED, A WRITE WAITING OUT A LEASE.                    *
+ ******************************************************************************/
+void lease_wait(int ms)
+{
+	if (ms <= 0)
+		return;
+	if (lease_waiter != NULL)
+		lease_waiter(ms);
+	else
+		usleep((useconds_t) ms * 1000);
+}
+
+
+/*******************************************************************************
+ * MAKES LEASE_WAIT CALL THE FUNCTION PROVIDED INSTEAD OF SLEEPING, SO THE     *
+ * SIMULATOR CAN WAIT OUT A LEASE ON VIRTUAL TIME.  NULL GOES BACK TO SLEEPING.*
+ ******************************************************************************/
+void lease_set_wait(void (*wait)(int ms))
+{
+	lease_waiter = wait;
+}
+
+// THE BUCKET OF THE KEY, NEIGHBOURING KEYS FALL IN DIFFERENT BUCKETS
+int lease_bucket(int key)
+{
+	return((int) (((uint32_t) key * 0x9E3779B1U) % LEASE_BUCKETS));
+}
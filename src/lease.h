@@ -0,0 +1,90 @@
+/*
+ ============================================================================
+ Name        : lease.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.02
+ Description : The read leases a learner has granted.  A GET that asks for a
+             : lease gets one from every learner that answers it, and the
+             : client may answer the key from its cache until the shortest of
+             : them runs out.  A learner that applies a write to a leased key
+             : reports how long the lease has left, and the proposer waits it
+             : out before it answers the writer, so no cache still holds the
+             : old value once the write is acknowledged.  A learner that
+             : misses the write can't report its lease on the key, so every
+             : learner also tells the others, in its heartbeat replies and
+             : its grants, how long the longest lease it granted has left,
+             : and the proposer waits that out for the learners that missed
+             : it.  Where no lease was granted the write doesn't wait.
+             :
+             : Keys share LEASE_BUCKETS expiry times, so a lease covers every
+             : key of its bucket and the memory is fixed.  Only the rpc thread
+             : grants and checks leases, so nothing is locked.
+ ============================================================================
+ */
+
+#ifndef LEASE_H
+#define LEASE_H
+
+#define LEASE_BUCKETS  4096   // expiry times kept, the keys share them
+#define LEASE_MAX_MS   1000   // longest lease a learner grants, must stay well below RPC_CLIENT_TIMEOUT_MS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifndef XDRCONV_H
+  #include "xdrconv.h"
+#endif
+
+#if LEASE_MAX_MS >= RPC_CLIENT_TIMEOUT_MS
+  #error "LEASE_MAX_MS must be below RPC_CLIENT_TIMEOUT_MS"
+#endif
+
+
+// WHEN THE LEASES OF EVERY BUCKET RUN OUT, IN MS OF FD_NOW_MS
+typedef struct lease_table {
+	double expires[LEASE_BUCKETS];
+	double latest;        // when the longest lease granted runs out, 0 if none was
+} lease_table;
+
+
+/*******************************************************************************
+ * RETURNS A NEW TABLE WITHOUT ANY LEASE, OR NULL IF THERE IS NO MEMORY.       *
+ ******************************************************************************/
+lease_table * lease_new();
+
+/*******************************************************************************
+ * FREES THE TABLE.                                                            *
+ ******************************************************************************/
+void lease_free(lease_table * table);
+
+/*******************************************************************************
+ * GRANTS A LEASE ON THE KEY OF REQUESTED MS, AT MOST LEASE_MAX_MS, STARTING   *
+ * AT NOW.  RETURNS THE MS GRANTED, 0 IF NONE WAS ASKED FOR.                   *
+ ******************************************************************************/
+int lease_grant(lease_table * table, int key, int requested, double now);
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT BEFORE EVERY LEASE ON THE KEY RUNS OUT, 0 IF IT HAS     *
+ * NONE.                                                                       *
+ ******************************************************************************/
+int lease_remaining(lease_table * table, int key, double now);
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT BEFORE EVERY LEASE OF THE TABLE RUNS OUT, WHATEVER ITS  *
+ * KEY, 0 IF IT HAS NONE.                                                      *
+ ******************************************************************************/
+int lease_latest(lease_table * table, double now);
+
+/*******************************************************************************
+ * SLEEPS FOR THE MS PROVIDED, A WRITE WAITING OUT A LEASE.                    *
+ ******************************************************************************/
+void lease_wait(int ms);
+
+/*******************************************************************************
+ * MAKES LEASE_WAIT CALL THE FUNCTION PROVIDED INSTEAD OF SLEEPING, SO THE     *
+ * SIMULATOR CAN WAIT OUT A LEASE ON VIRTUAL TIME.  NULL GOES BACK TO SLEEPING.*
+ ******************************************************************************/
+void lease_set_wait(void (*wait)(int ms));
+
+#endif /* LEASE_H */
@@ -0,0 +1,982 @@
+/*
+ ============================================================================
+ Name        : loadgen.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.27
+ Description : Load generator.  See loadgen.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef LOADGEN_H
+#include "loadgen.h"
+#endif
+
+struct loadgen_op;
+
+// ONE BENCHMARK THREAD
+typedef struct loadgen_thread {
+	loadgen_config * config;
+	uint64_t random;   // xorshift state of the thread
+	int sequence;      // last value of LOADGEN_VALUE_SEQUENCE
+	struct loadgen_op * ops;   // -outstanding: the operations in flight
+	int free_op;               // first free one, -1 if none
+	int in_flight;
+	pthread_mutex_t lock;      // the free ops, taken by the thread and the kvc receiver
+	pthread_cond_t freed;
+} loadgen_thread;
+
+// ONE OPERATION SENT WITH THE ASYNCHRONOUS CLIENT
+typedef struct loadgen_op {
+	loadgen_thread * thread;
+	int kind;
+	int level;         // READ_* of a get
+	double start;      // when it was sent
+	double due;        // open loop: when it was due
+	int next_free;
+} loadgen_op;
+
+loadgen_result loadgen_results[LOADGEN_KINDS + 1];
+loadgen_result loadgen_reads[READ_LEVELS];  // -consistency: the gets of every level
+int loadgen_by_level = 0;        // -consistency: count the gets in loadgen_reads too
+loadgen_result loadgen_service;  // open loop: every operation timed from its send
+int64_t loadgen_remaining = 0;   // operations not started yet
+int64_t loadgen_inserted  = 0;   // next key an insert puts
+int64_t loadgen_scheduled = 0;   // open loop: next operation of the schedule
+uint64_t loadgen_late     = 0;   // open loop: operations sent late
+double loadgen_started    = 0;   // ms when the run started
+double loadgen_deadline   = 0;   // ms when a timed run ends
+kvc_client * loadgen_kvc  = NULL;  // -outstanding: shared by every thread
+loadgen_zipf loadgen_keys_zipf;        // over the keys, for zipfian and latest
+loadgen_zipf loadgen_scrambled_zipf;   // over LOADGEN_SCRAMBLED_ITEMS
+
+char * loadgen_labels[LOADGEN_KINDS + 1]  = { "get", "put", "del", "insert", "scan", "rmw", "all" };
+char * loadgen_distributions[] = { "uniform", "zipfian", "scrambled", "latest" };
+char * loadgen_levels[READ_LEVELS] = { "quorum", "linearizable", "local" };
+char * loadgen_level_labels[READ_LEVELS] = { "get.quorum", "get.linearizable", "get.local" };
+
+void * loadgen_thread_run(void * arg);
+int loadgen_send(loadgen_thread * thread, int server, int command, int key, int value, int level);
+void loadgen_send_async(loadgen_thread * thread, int kind, int server, int command, int key, int value, double due);
+void loadgen_done(void * arg, int result, xdrMsg * response);
+void loadgen_record(loadgen_config * config, int kind, int level, int status, double start, double due, double end);
+int loadgen_consistency(loadgen_config * config, char * levels);
+int loadgen_level(loadgen_thread * thread);
+int loadgen_open_loop(loadgen_config * config);
+int loadgen_replay(loadgen_config * config);
+int loadgen_server(loadgen_thread * thread, char * name);
+loadgen_result * loadgen_row(int row, char ** label);
+int loadgen_value(loadgen_thread * thread);
+int loadgen_key(loadgen_thread * thread);
+int loadgen_main_option(char * name);
+int loadgen_csv(loadgen_config * config, double elapsed);
+int loadgen_hdr(loadgen_config * config);
+void loadgen_sleep_until(double when_ms);
+uint64_t loadgen_random(loadgen_thread * thread);
+double loadgen_uniform(loadgen_thread * thread);
+void loadgen_report(char * label, loadgen_result * result, double elapsed, FILE * out);
+
+
+/*******************************************************************************
+ * PARSES THE OPTIONS OF TCSS558 BENCH, RUNS THE LOAD AGAINST THE SERVERS      *
+ * PROVIDED AND PRINTS THE REPORT.  RETURNS -1 IF AN OPTION IS BAD.  THE       *
+ * OPTIONS ARE -THREADS N, -OUTSTANDING N, -OPS N OR -DURATION SECONDS,        *
+ * -RATE OPS/S, -WORKLOAD A-F|LOAD, -MIX GET:PUT:DEL[:INSERT:SCAN:RMW],        *
+ * -KEYS N, -DISTRIBUTION UNIFORM|ZIPFIAN|SCRAMBLED|LATEST, -SCAN N, -VALUES   *
+ * RANDOM|SEQUENCE|N, -ROUTE RANDOM|LEADER, -CACHE ENTRIES, -CONSISTENCY       *
+ * LEVEL[,LEVEL...], -SESSION ON|OFF, -REPLAY FILE, -SPEED N, -SEED N, -CSV    *
+ * FILE, -HDR PREFIX AND -LABEL NAME.                                          *
+ ******************************************************************************/
+int loadgen_main(int argc, char * argv[], char ** servers, int server_count)
+{
+	loadgen_config config;
+	memset(&config, 0, sizeof(config));
+	config.threads      = LOADGEN_DEFAULT_THREADS;
+	config.outstanding  = 1;
+	config.ops          = LOADGEN_DEFAULT_OPS;
+	config.duration     = 0;
+	config.rate         = 0;
+	config.mix[LOADGEN_GET] = 50;
+	config.mix[LOADGEN_PUT] = 50;
+	config.keys         = LOADGEN_DEFAULT_KEYS;
+	config.distribution = LOADGEN_UNIFORM;
+	config.route        = LOADGEN_ROUTE_RANDOM;
+	config.cache        = 0;
+	config.consistency[READ_QUORUM] = 1;
+	config.staleness    = 0;
+	config.session      = 0;
+	config.replay_file  = NULL;
+	config.replay       = NULL;
+	config.speed        = 1;
+	config.scan         = LOADGEN_DEFAULT_SCAN;
+	config.values       = LOADGEN_VALUE_RANDOM;
+	config.constant     = 0;
+	config.seed         = 1;
+	config.csv          = NULL;
+	config.hdr          = NULL;
+	config.servers      = servers;
+	config.server_count = server_count;
+	strcpy(config.workload, "custom");
+	strcpy(config.label, "-");
+
+	int ops_given = 0;
+	int shaped = 0;    // -rate, -workload or -mix, which a replay brings itself
+	int bad = (argc % 2 != 0);
+	for (int i = 0; i + 1 < argc && !bad; i += 2)
+	{
+		char * value = argv[i + 1];
+		if (strcmp(argv[i], "-threads") == 0)
+			config.threads = atoi(value);
+		else if (strcmp(argv[i], "-outstanding") == 0)
+			config.outstanding = atoi(value);
+		else if (strcmp(argv[i], "-ops") == 0)
+		{
+			config.ops = atoi(value);
+			ops_given = 1;
+		}
+		else if (strcmp(argv[i], "-duration") == 0)
+			config.duration = atof(value);
+		else if (strcmp(argv[i], "-rate") == 0)
+		{
+			config.rate = atof(value);
+			shaped = 1;
+		}
+		else if (strcmp(argv[i], "-workload") == 0)
+		{
+			bad = (loadgen_workload(&config, value) != 0);
+			shaped = 1;
+		}
+		else if (strcmp(argv[i], "-mix") == 0)
+		{
+			shaped = 1;
+			int * mix = config.mix;
+			memset(mix, 0, sizeof(config.mix));
+			bad = (sscanf(value, "%d:%d:%d:%d:%d:%d", &mix[0], &mix[1], &mix[2], &mix[3], &mix[4], &mix[5]) < 2);
+			strcpy(config.workload, "custom");
+		}
+		else if (strcmp(argv[i], "-keys") == 0)
+			config.keys = atoi(value);
+		else if (strcmp(argv[i], "-distribution") == 0)
+		{
+			bad = 1;
+			for (int d = 0; d < (int) (sizeof(loadgen_distributions) / sizeof(loadgen_distributions[0])); d++)
+				if (strcmp(value, loadgen_distributions[d]) == 0)
+				{
+					config.distribution = d;
+					bad = 0;
+				}
+		}
+		else if (strcmp(argv[i], "-scan") == 0)
+			config.scan = atoi(value);
+		else if (strcmp(argv[i], "-values") == 0)
+		{
+			if (strcmp(value, "random") == 0)
+				config.values = LOADGEN_VALUE_RANDOM;
+			else if (strcmp(value, "sequence") == 0)
+				config.values = LOADGEN_VALUE_SEQUENCE;
+			else
+			{
+				config.values = LOADGEN_VALUE_CONSTANT;
+				bad = (sscanf(value, "%d", &config.constant) != 1);
+			}
+		}
+		else if (strcmp(argv[i], "-route") == 0)
+		{
+			config.route = (strcmp(value, "leader") == 0) ? LOADGEN_ROUTE_LEADER : LOADGEN_ROUTE_RANDOM;
+			bad = (config.route == LOADGEN_ROUTE_RANDOM && strcmp(value, "random") != 0);
+		}
+		else if (strcmp(argv[i], "-cache") == 0)
+			config.cache = atoi(value);
+		else if (strcmp(argv[i], "-consistency") == 0)
+			bad = (loadgen_consistency(&config, value) != 0);
+		else if (strcmp(argv[i], "-session") == 0)
+		{
+			config.session = (strcmp(value, "on") == 0);
+			bad = (!config.session && strcmp(value, "off") != 0);
+		}
+		else if (strcmp(argv[i], "-replay") == 0)
+			config.replay_file = value;
+		else if (strcmp(argv[i], "-speed") == 0)
+			config.speed = atof(value);
+		else if (strcmp(argv[i], "-seed") == 0)
+			config.seed = strtoull(value, NULL, 10);
+		else if (strcmp(argv[i], "-csv") == 0)
+			config.csv = value;
+		else if (strcmp(argv[i], "-hdr") == 0)
+			config.hdr = value;
+		else if (strcmp(argv[i], "-label") == 0)
+			strncpy(config.label, value, LOADGEN_LABEL_LENGTH - 1);
+		else if (!loadgen_main_option(argv[i]))
+			bad = 1;
+	}
+
+	// A REPLAY HAS ITS OWN OPERATIONS, SCHEDULE AND MIX
+	if (config.replay_file != NULL && (shaped || ops_given))
+		bad = 1;
+	if (config.speed <= 0 || (config.speed != 1 && config.replay_file == NULL))
+		bad = 1;
+	if (!bad && config.replay_file != NULL && loadgen_replay(&config) != 0)
+		return(-1);
+
+	// THE LOAD PHASE PUTS EVERY KEY ONCE, UNLESS TOLD OTHERWISE
+	if (strcmp(config.workload, "load") == 0 && !ops_given)
+		config.ops = config.keys;
+
+	int weights = 0;
+	for (int k = 0; k < LOADGEN_KINDS; k++)
+	{
+		weights += config.mix[k];
+		if (config.mix[k] < 0)
+			bad = 1;
+	}
+	if (config.threads < 1 || config.threads > LOADGEN_MAX_THREADS || config.ops < 1 || config.duration < 0 || config.rate < 0
+			|| config.keys < 1 || config.scan < 1 || weights <= 0 || server_count < 1)
+		bad = 1;
+
+	// A SCAN OR A READ-MODIFY-WRITE IS SEVERAL CALLS IN A ROW, ONLY SINGLE CALLS GO ASYNCHRONOUS
+	if (config.outstanding < 1 || config.outstanding * config.threads > KVC_MAX_PENDING
+			|| (config.outstanding > 1 && (config.mix[LOADGEN_SCAN] > 0 || config.mix[LOADGEN_RMW] > 0)))
+		bad = 1;
+
+	// THE READ CACHE IS CLIENT_RPC_SEND'S, THE ASYNCHRONOUS CLIENT DOESN'T HAVE ONE
+	if (config.cache < 0 || (config.cache > 0 && config.outstanding > 1))
+		bad = 1;
+
+	// NOR A CONSISTENCY OR SESSION TOKENS, ITS GETS ARE ALL PLAIN READ_QUORUM
+	if (config.outstanding > 1 && (config.consistency[READ_LINEARIZABLE] || config.consistency[READ_LOCAL] || config.session))
+		bad = 1;
+
+	if (bad)
+	{
+		printf("Usage: tcss558 bench [-threads n] [-outstanding n] [-ops n | -duration seconds] [-rate ops/s] [-workload a|b|c|d|e|f|load]"
+				" [-mix get:put:del[:insert:scan:rmw]] [-keys n] [-distribution uniform|zipfian|scrambled|latest]"
+				" [-scan n] [-values random|sequence|n] [-route random|leader] [-cache entries]"
+				" [-consistency quorum|linearizable|local[:ms][,...]] [-session on|off] [-replay file [-speed n]] [-seed n]"
+				" [-csv file] [-hdr prefix] [-label name]\n");
+		replay_free(config.replay);
+		return(-1);
+	}
+
+	int result = loadgen_run(&config, stdout);
+	replay_free(config.replay);
+	if (result != 0)
+	{
+		printf("Unable to run the benchmark.\n");
+		return(-1);
+	}
+	return(0);
+}
+
+
+/*******************************************************************************
+ * RUNS THE LOAD AND PRINTS THE THROUGHPUT AND THE P50, P99 AND P99.9 LATENCY  *
+ * OF EVERY KIND OF OPERATION TO THE FILE PROVIDED, APPENDS THEM TO THE CSV    *
+ * FILE OF THE CONFIG AND SAVES THE HISTOGRAMS.  RETURNS -1 IF THE THREADS     *
+ * CANNOT BE STARTED OR A FILE CANNOT BE WRITTEN.                              *
+ ******************************************************************************/
+int loadgen_run(loadgen_config * config, FILE * out)
+{
+	memset(loadgen_results, 0, sizeof(loadgen_results));
+	memset(loadgen_reads, 0, sizeof(loadgen_reads));
+	loadgen_by_level = config->consistency[READ_LINEARIZABLE] || config->consistency[READ_LOCAL];
+	memset(&loadgen_service, 0, sizeof(loadgen_service));
+	loadgen_scheduled = 0;
+	loadgen_late = 0;
+	log_set_echo(0);  // CLIENT.LOG STILL GETS EVERY OPERATION, THE CONSOLE ONLY THE REPORT
+	loadgen_remaining = (config->duration > 0 && config->replay == NULL) ? INT64_MAX : config->ops;  // A REPLAY ENDS WITH ITS FILE
+	loadgen_inserted  = (strcmp(config->workload, "load") == 0) ? 0 : config->keys;
+
+	// ZETA OF THE KEYS TAKES ONE PASS OVER THEM, THE SCRAMBLED ONE IS A CONSTANT
+	loadgen_zipf_init(&loadgen_keys_zipf, config->keys, LOADGEN_ZIPF_THETA, 0);
+	loadgen_zipf_init(&loadgen_scrambled_zipf, LOADGEN_SCRAMBLED_ITEMS, LOADGEN_ZIPF_THETA, LOADGEN_SCRAMBLED_ZETAN);
+
+	char length[32];
+	if (config->duration > 0)
+		sprintf(length, "duration=%.1fs", config->duration);
+	else
+		sprintf(length, "ops=%d", config->ops);
+	char loop[96];
+	if (config->replay != NULL)
+		snprintf(loop, 64, "replay=%s speed=%gx", config->replay_file, config->speed);
+	else if (config->rate > 0)
+		sprintf(loop, "rate=%.1f/s", config->rate);
+	else
+		strcpy(loop, "closed-loop");
+	if (config->outstanding > 1)
+		sprintf(loop + strlen(loop), " outstanding=%d", config->outstanding);
+
+	// -OUTSTANDING: ONE ASYNCHRONOUS CLIENT, EVERY THREAD KEEPS ITS WINDOW OF CALLS IN IT
+	if (config->outstanding > 1 && (loadgen_kvc = kvc_open(config->servers, config->server_count)) == NULL)
+		return(-1);
+	int * mix = config->mix;
+	// -CACHE: EVERY THREAD READS THROUGH ONE CACHE, A GET UNDER LEASE NEVER LEAVES THE CLIENT
+	if (config->cache > 0 && client_cache_enable(config->cache) != 0)
+		return(-1);
+	// -SESSION: THE THREADS SHARE ONE SESSION, EACH READS WHAT ANY OF THEM WROTE
+	if (config->session && client_session_enable() != 0)
+		return(-1);
+	char levels[64] = "";
+	for (int l = 0; l < READ_LEVELS; l++)
+		if (config->consistency[l])
+			sprintf(levels + strlen(levels), "%s%s", levels[0] ? "," : "", loadgen_levels[l]);
+	if (config->consistency[READ_LOCAL] && config->staleness > 0)
+		sprintf(levels + strlen(levels), ":%d", config->staleness);
+	fprintf(out, "bench: threads=%d %s %s keys=%d workload=%s distribution=%s mix=%d:%d:%d:%d:%d:%d servers=%d route=%s cache=%d consistency=%s session=%s\n",
+			config->threads, length, loop, config->keys, config->workload, loadgen_distributions[config->distribution],
+			mix[0], mix[1], mix[2], mix[3], mix[4], mix[5], config->server_count,
+			config->route == LOADGEN_ROUTE_LEADER ? "leader" : "random", config->cache, levels, config->session ? "on" : "off");
+
+	pthread_t threads[config->threads];
+	loadgen_thread args[config->threads];
+	double started = bench_now_ms();
+	loadgen_started  = started;
+	loadgen_deadline = started + config->duration * 1000.0;
+
+	int started_threads = 0;
+	for (int t = 0; t < config->threads; t++)
+	{
+		// SPLITMIX THE SEED SO EVERY THREAD GETS ITS OWN STREAM, NEVER 0
+		uint64_t z = config->seed + 0x9E3779B97F4A7C15ULL * (uint64_t) (t + 1);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		args[t].config   = config;
+		args[t].random   = (z ^ (z >> 31)) | 1;
+		args[t].sequence = 0;
+		args[t].ops      = (loadgen_op *) calloc(config->outstanding, sizeof(loadgen_op));
+		args[t].free_op  = 0;
+		args[t].in_flight = 0;
+		pthread_mutex_init(&args[t].lock, NULL);
+		pthread_cond_init(&args[t].freed, NULL);
+		for (int o = 0; args[t].ops != NULL && o < config->outstanding; o++)
+		{
+			args[t].ops[o].thread    = &args[t];
+			args[t].ops[o].next_free = (o + 1 < config->outstanding) ? o + 1 : -1;
+		}
+		if (args[t].ops == NULL || pthread_create(&threads[t], NULL, loadgen_thread_run, &args[t]) != 0)
+		{
+			free(args[t].ops);
+			break;
+		}
+		started_threads++;
+	}
+
+	for (int t = 0; t < started_threads; t++)
+	{
+		pthread_join(threads[t], NULL);
+		free(args[t].ops);
+	}
+
+	if (loadgen_kvc != NULL)
+	{
+		kvc_close(loadgen_kvc);
+		loadgen_kvc = NULL;
+	}
+
+	if (started_threads < config->threads)
+		return(-1);
+
+	double elapsed = (bench_now_ms() - started) / 1000.0;
+	loadgen_result * all = &loadgen_results[LOADGEN_ALL];
+	fprintf(out, "bench: ops=%llu errors=%llu nacks=%llu elapsed=%.2fs throughput=%.1f ops/s\n",
+			(unsigned long long) all->ops, (unsigned long long) all->errors, (unsigned long long) all->nacks,
+			elapsed, elapsed > 0 ? all->ops / elapsed : 0.0);
+
+	for (int k = 0; k <= LOADGEN_KINDS; k++)
+		if (loadgen_results[k].ops > 0)
+			loadgen_report(loadgen_labels[k], &loadgen_results[k], elapsed, out);
+
+	for (int l = 0; l < READ_LEVELS; l++)
+		if (loadgen_reads[l].ops > 0)
+			loadgen_report(loadgen_level_labels[l], &loadgen_reads[l], elapsed, out);
+
+	if (config->cache > 0 && client_cache != NULL)
+		cache_print(client_cache, out);
+
+	// WHAT THE CLOSED LOOP WOULD HAVE REPORTED, AND HOW OFTEN THE SCHEDULE SLIPPED
+	if (loadgen_open_loop(config))
+	{
+		loadgen_report("service", &loadgen_service, elapsed, out);
+		fprintf(out, "bench: late=%llu (sent more than %.1fms after they were due, add threads if it is not 0 on a healthy cluster)\n",
+				(unsigned long long) loadgen_late, LOADGEN_LATE_MS);
+	}
+
+	if (config->csv != NULL && loadgen_csv(config, elapsed) != 0)
+	{
+		fprintf(out, "Unable to write %s.\n", config->csv);
+		return(-1);
+	}
+	if (config->hdr != NULL && loadgen_hdr(config) != 0)
+	{
+		fprintf(out, "Unable to write the histograms %s.*.hgrm.\n", config->hdr);
+		return(-1);
+	}
+	return(0);
+}
+
+
+/*******************************************************************************
+ * SETS UP THE CONFIG FOR THE YCSB CORE WORKLOAD PROVIDED (A TO F, OR LOAD).   *
+ * RETURNS -1 IF THERE IS NO SUCH WORKLOAD.                                    *
+ ******************************************************************************/
+int loadgen_workload(loadgen_config * config, char * name)
+{
+	int * mix = config->mix;
+	memset(mix, 0, sizeof(config->mix));
+	config->distribution = LOADGEN_ZIPFIAN;
+
+	if (strcmp(name, "a") == 0)
+	{
+		mix[LOADGEN_GET] = 50;
+		mix[LOADGEN_PUT] = 50;
+	}
+	else if (strcmp(name, "b") == 0)
+	{
+		mix[LOADGEN_GET] = 95;
+		mix[LOADGEN_PUT] = 5;
+	}
+	else if (strcmp(name, "c") == 0)
+		mix[LOADGEN_GET] = 100;
+	else if (strcmp(name, "d") == 0)
+	{
+		mix[LOADGEN_GET]    = 95;
+		mix[LOADGEN_INSERT] = 5;
+		config->distribution = LOADGEN_LATEST;
+	}
+	else if (strcmp(name, "e") == 0)
+	{
+		mix[LOADGEN_SCAN]   = 95;
+		mix[LOADGEN_INSERT] = 5;
+	}
+	else if (strcmp(name, "f") == 0)
+	{
+		mix[LOADGEN_GET] = 50;
+		mix[LOADGEN_RMW] = 50;
+	}
+	else if (strcmp(name, "load") == 0)
+		mix[LOADGEN_INSERT] = 100;
+	else
+		return(-1);
+
+	strncpy(config->workload, name, LOADGEN_LABEL_LENGTH - 1);
+	return(0);
+}
+
+
+/*******************************************************************************
+ * COMPUTES THE CONSTANTS OF A ZIPFIAN DISTRIBUTION OVER ITEMS.  ZETAN IS THE  *
+ * SUM OF 1 / I^THETA, PASS 0 TO HAVE IT COMPUTED (ONE PASS OVER THE ITEMS).   *
+ ******************************************************************************/
+void loadgen_zipf_init(loadgen_zipf * zipf, uint64_t items, double theta, double zetan)
+{
+	if (zetan <= 0)
+	{
+		zetan = 0;
+		for (uint64_t i = 1; i <= items; i++)
+			zetan += 1.0 / pow((double) i, theta);
+	}
+	double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+
+	zipf->items = items;
+	zipf->theta = theta;
+	zipf->zetan = zetan;
+	zipf->alpha = 1.0 / (1.0 - theta);
+	zipf->eta   = (1.0 - pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+	zipf->half  = 1.0 + pow(0.5, theta);
+}
+
+
+/*******************************************************************************
+ * DRAWS AN ITEM FROM 0 TO ITEMS - 1, 0 THE MOST LIKELY.  U IS UNIFORM IN      *
+ * [0, 1).                                                                     *
+ ******************************************************************************/
+uint64_t loadgen_zipf_next(loadgen_zipf * zipf, double u)
+{
+	double uz = u * zipf->zetan;
+	if (uz < 1.0 || zipf->items < 2)
+		return(0);
+	if (uz < zipf->half)
+		return(1);
+
+	uint64_t item = (uint64_t) (zipf->items * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+	return(item < zipf->items ? item : zipf->items - 1);
+}
+
+
+// ONE CLIENT: SENDS AN OPERATION, WAITS FOR IT, SENDS THE NEXT
+void * loadgen_thread_run(void * arg)
+{
+	loadgen_thread * thread = (loadgen_thread *) arg;
+	loadgen_config * config = thread->config;
+	int weights = 0;
+	for (int k = 0; k < LOADGEN_KINDS; k++)
+		weights += config->mix[k];
+
+	while (__atomic_sub_fetch(&loadgen_remaining, 1, __ATOMIC_RELAXED) >= 0)
+	{
+		// OPEN LOOP: TAKE THE NEXT SLOT OF THE SCHEDULE AND WAIT FOR IT, UNLESS IT IS ALREADY PAST
+		double due = 0;
+		replay_op * replayed = NULL;  // -replay: the operation of the slot
+		if (loadgen_open_loop(config))
+		{
+			int64_t slot = __atomic_fetch_add(&loadgen_scheduled, 1, __ATOMIC_RELAXED);
+			if (config->replay != NULL)
+			{
+				replayed = &config->replay->ops[slot];
+				due = loadgen_started + replayed->offset_ms / config->speed;
+			}
+			else
+				due = loadgen_started + slot * 1000.0 / config->rate;
+			if (config->duration > 0 && due >= loadgen_deadline)
+				break;
+			loadgen_sleep_until(due);
+		}
+		else if (config->duration > 0 && bench_now_ms() >= loadgen_deadline)
+			break;
+
+		int kind = LOADGEN_GET;
+		int index;
+		if (replayed != NULL)
+		{
+			// -REPLAY: THE OPERATION AS IT WAS CAPTURED, ONLY THE LEVEL OF A GET IS OURS
+			kind  = (replayed->command == RPC_GET) ? LOADGEN_GET : (replayed->command == RPC_DEL) ? LOADGEN_DEL : LOADGEN_PUT;
+			index = loadgen_server(thread, replayed->server);
+		}
+		else
+		{
+			int pick = (int) (loadgen_random(thread) % weights);
+			while (pick >= config->mix[kind])
+				pick -= config->mix[kind++];
+			index = (int) (loadgen_random(thread) % config->server_count);
+		}
+		int level = loadgen_level(thread);  // EVERY GET OF THE OPERATION IS SENT AT IT
+
+		// -OUTSTANDING: HAND IT TO THE ASYNCHRONOUS CLIENT, LOADGEN_DONE RECORDS IT
+		if (loadgen_kvc != NULL)
+		{
+			int command = (kind == LOADGEN_GET) ? RPC_GET : (kind == LOADGEN_DEL) ? RPC_DEL : RPC_PUT;
+			int key = (replayed != NULL) ? replayed->key : (kind == LOADGEN_INSERT)
+					? (int) __atomic_fetch_add(&loadgen_inserted, 1, __ATOMIC_RELAXED) : loadgen_key(thread);
+			int value = (replayed != NULL) ? replayed->value : loadgen_value(thread);
+			loadgen_send_async(thread, kind, config->route == LOADGEN_ROUTE_LEADER ? KVC_ANY_SERVER : index, command, key, value, due);
+			continue;
+		}
+
+		double start = bench_now_ms();
+		if (loadgen_open_loop(config) && start - due > LOADGEN_LATE_MS)
+			__atomic_fetch_add(&loadgen_late, 1, __ATOMIC_RELAXED);
+
+		int status = 0;
+		int key;
+		switch (kind)
+		{
+		case LOADGEN_INSERT:
+			key = (int) __atomic_fetch_add(&loadgen_inserted, 1, __ATOMIC_RELAXED);
+			status = loadgen_send(thread, index, RPC_PUT, key, loadgen_value(thread), level);
+			break;
+
+		case LOADGEN_SCAN:
+		{
+			// NO RANGE QUERY IN THE STORE: GET THE KEYS ONE BY ONE, THE WORST ONE COUNTS
+			key = loadgen_key(thread);
+			int length = 1 + (int) (loadgen_random(thread) % config->scan);
+			int64_t end = __atomic_load_n(&loadgen_inserted, __ATOMIC_RELAXED);
+			for (int i = 0; i < length && key + i < end && status >= 0; i++)
+			{
+				int got = loadgen_send(thread, index, RPC_GET, key + i, loadgen_value(thread), level);
+				if (got < 0 || status == 0)
+					status = got;
+			}
+			break;
+		}
+
+		case LOADGEN_RMW:
+			key = loadgen_key(thread);
+			status = loadgen_send(thread, index, RPC_GET, key, loadgen_value(thread), level);
+			if (status >= 0)
+			{
+				int put = loadgen_send(thread, index, RPC_PUT, key, loadgen_value(thread), level);
+				status = (put != 0) ? put : status;
+			}
+			break;
+
+		default:
+			key = (replayed != NULL) ? replayed->key : loadgen_key(thread);
+			status = loadgen_send(thread, index, (kind == LOADGEN_GET) ? RPC_GET : (kind == LOADGEN_PUT) ? RPC_PUT : RPC_DEL,
+					key, (replayed != NULL) ? replayed->value : loadgen_value(thread), level);
+			break;
+		}
+		loadgen_record(config, kind, level, status, start, due, bench_now_ms());
+	}
+
+	// WAIT FOR THE WINDOW TO EMPTY
+	pthread_mutex_lock(&thread->lock);
+	while (thread->in_flight > 0)
+		pthread_cond_wait(&thread->freed, &thread->lock);
+	pthread_mutex_unlock(&thread->lock);
+
+	client_close_handles();
+	return(NULL);
+}
+
+
+// SENDS ONE CALL WITH THE ASYNCHRONOUS CLIENT, WAITING FOR A FREE OP OF THE WINDOW FIRST
+void loadgen_send_async(loadgen_thread * thread, int kind, int server, int command, int key, int value, double due)
+{
+	pthread_mutex_lock(&thread->lock);
+	while (thread->free_op < 0)
+		pthread_cond_wait(&thread->freed, &thread->lock);
+	loadgen_op * op = &thread->ops[thread->free_op];
+	thread->free_op = op->next_free;
+	thread->in_flight++;
+	pthread_mutex_unlock(&thread->lock);
+
+	// AN OPEN LOOP OPERATION THAT WAITED FOR THE WINDOW IS LATE, ITS LATENCY STILL COUNTS FROM WHEN IT WAS DUE
+	op->kind  = kind;
+	op->start = bench_now_ms();
+	op->due   = due;
+	if (loadgen_open_loop(thread->config) && op->start - due > LOADGEN_LATE_MS)
+		__atomic_fetch_add(&loadgen_late, 1, __ATOMIC_RELAXED);
+	int sent = kvc_send(loadgen_kvc, server, command, key, value, loadgen_done, op);
+	if (sent != KVC_OK)
+		loadgen_done(op, sent, NULL);
+}
+
+
+// THE CALLBACK OF AN ASYNCHRONOUS CALL: RECORDS IT AND FREES ITS OP.  RUNS ON THE KVC RECEIVER
+void loadgen_done(void * arg, int result, xdrMsg * response)
+{
+	(void) response;  // ONLY THE RESULT IS RECORDED
+	loadgen_op * op = (loadgen_op *) arg;
+	loadgen_thread * thread = op->thread;
+	int status = (result == KVC_OK) ? 0 : (result == KVC_NACK) ? 1 : -1;
+	loadgen_record(thread->config, op->kind, READ_QUORUM, status, op->start, op->due, bench_now_ms());
+
+	pthread_mutex_lock(&thread->lock);
+	op->next_free = thread->free_op;
+	thread->free_op = (int) (op - thread->ops);
+	thread->in_flight--;
+	pthread_cond_signal(&thread->freed);
+	pthread_mutex_unlock(&thread->lock);
+}
+
+
+// COUNTS ONE OPERATION.  THE KIND, ALL AND THE LEVEL OF A GET COUNT FROM WHEN IT WAS DUE, THE SERVICE TIME FROM THE SEND
+void loadgen_record(loadgen_config * config, int kind, int level, int status, double start, double due, double end)
+{
+	loadgen_result * counted[4] = { &loadgen_results[kind], &loadgen_results[LOADGEN_ALL], &loadgen_reads[level], &loadgen_service };
+	double latency = loadgen_open_loop(config) ? end - due : end - start;
+	double latencies[4] = { latency, latency, latency, end - start };
+	int count = (kind == LOADGEN_GET && loadgen_by_level) ? 3 : 2;
+	if (loadgen_open_loop(config))
+	{
+		counted[count] = &loadgen_service;
+		latencies[count] = end - start;
+		count++;
+	}
+	for (int c = 0; c < count; c++)
+	{
+		loadgen_result * result = counted[c];
+		stats_add(&result->latency, latencies[c]);
+		__atomic_fetch_add(&result->ops, 1, __ATOMIC_RELAXED);
+		if (status < 0)
+			__atomic_fetch_add(&result->errors, 1, __ATOMIC_RELAXED);
+		else if (status > 0)
+			__atomic_fetch_add(&result->nacks, 1, __ATOMIC_RELAXED);
+	}
+}
+
+
+// ONE RPC TO THE SERVER PROVIDED, OR THE LEADER.  -1 IF THE CALL FAILED, 1 IF THE SERVER DID NOT ANSWER OK, 0 OTHERWISE
+int loadgen_send(loadgen_thread * thread, int server, int command, int key, int value, int level)
+{
+	loadgen_config * config = thread->config;
+	xdrMsg message  = { 0 };
+	xdrMsg response = { 0 };
+	message.command = command;
+	message.key     = key;
+	message.value   = value;
+	if (command == RPC_GET)
+	{
+		message.consistency = level;
+		message.staleness   = (level == READ_LOCAL) ? config->staleness : 0;
+	}
+
+	int status = (config->route == LOADGEN_ROUTE_LEADER)
+			? client_rpc_route(config->servers, config->server_count, server, command, &message, &response)
+			: client_rpc_send(config->servers[server], command, &message, &response);
+	if (status != 0)
+		return(-1);
+	return(response.status == OK ? 0 : 1);
+}
+
+
+// THE VALUE OF A PUT
+int loadgen_value(loadgen_thread * thread)
+{
+	loadgen_config * config = thread->config;
+	if (config->values == LOADGEN_VALUE_SEQUENCE)
+		return(++thread->sequence);
+	else if (config->values == LOADGEN_VALUE_CONSTANT)
+		return(config->constant);
+	return((int) (loadgen_random(thread) >> 33));
+}
+
+
+// THE KEY OF A READ, UPDATE, DELETE, SCAN OR READ-MODIFY-WRITE, DRAWN FROM THE DISTRIBUTION
+int loadgen_key(loadgen_thread * thread)
+{
+	loadgen_config * config = thread->config;
+	switch (config->distribution)
+	{
+	case LOADGEN_ZIPFIAN:
+		return((int) loadgen_zipf_next(&loadgen_keys_zipf, loadgen_uniform(thread)));
+
+	case LOADGEN_SCRAMBLED:
+	{
+		// FNV-1A OF THE ITEM, SO THE POPULAR ITEMS LAND ANYWHERE IN THE KEYS
+		uint64_t item = loadgen_zipf_next(&loadgen_scrambled_zipf, loadgen_uniform(thread));
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		for (int i = 0; i < 8; i++)
+		{
+			hash ^= (item >> (i * 8)) & 0xFF;
+			hash *= 0x100000001B3ULL;
+		}
+		return((int) (hash % config->keys));
+	}
+
+	case LOADGEN_LATEST:
+	{
+		// THE LAST INSERTED KEY IS THE MOST POPULAR, THEN THE ONE BEFORE...
+		int64_t last = __atomic_load_n(&loadgen_inserted, __ATOMIC_RELAXED) - 1;
+		int64_t back = (int64_t) loadgen_zipf_next(&loadgen_keys_zipf, loadgen_uniform(thread));
+		return((int) (last >= back ? last - back : 0));
+	}
+
+	default:
+		return((int) (loadgen_random(thread) % config->keys));
+	}
+}
+
+
+// 1 IF THE OPTION IS ONE MAIN HAS ALREADY TAKEN
+int loadgen_main_option(char * name)
+{
+	char * options[] = { "-self", "-q1", "-q2", "-log", "-trace", "-metrics", "-faults" };
+	for (int i = 0; i < (int) (sizeof(options) / sizeof(options[0])); i++)
+		if (strcmp(name, options[i]) == 0)
+			return(1);
+	return(0);
+}
+
+
+// PARSES -CONSISTENCY: LEVELS SEPARATED BY COMMAS, LOCAL MAY HAVE A STALENESS (LOCAL:MS).  -1 IF ONE IS BAD
+int loadgen_consistency(loadgen_config * config, char * levels)
+{
+	memset(config->consistency, 0, sizeof(config->consistency));
+	config->staleness = 0;
+
+	char copy[LOADGEN_LABEL_LENGTH];
+	strncpy(copy, levels, LOADGEN_LABEL_LENGTH - 1);
+	copy[LOADGEN_LABEL_LENGTH - 1] = '\0';
+	char * rest = copy;
+	char * level;
+	while ((level = strsep(&rest, ",")) != NULL)
+	{
+		char * staleness = strchr(level, ':');
+		if (staleness != NULL)
+			*staleness++ = '\0';
+
+		int found = -1;
+		for (int l = 0; l < READ_LEVELS; l++)
+			if (strcmp(level, loadgen_levels[l]) == 0)
+				found = l;
+		if (found < 0 || (staleness != NULL && (found != READ_LOCAL || (config->staleness = atoi(staleness)) < 1)))
+			return(-1);
+		config->consistency[found] = 1;
+	}
+	return(0);
+}
+
+
+// THE LEVEL OF THE GETS OF ONE OPERATION, ONE OF THE -CONSISTENCY LEVELS AT RANDOM
+int loadgen_level(loadgen_thread * thread)
+{
+	loadgen_config * config = thread->config;
+	int levels = 0;
+	for (int l = 0; l < READ_LEVELS; l++)
+		levels += config->consistency[l];
+	if (levels < 2)
+		return(config->consistency[READ_LINEARIZABLE] ? READ_LINEARIZABLE : config->consistency[READ_LOCAL] ? READ_LOCAL : READ_QUORUM);
+
+	int pick = (int) (loadgen_random(thread) % levels);
+	int level = 0;
+	while (!config->consistency[level] || pick-- > 0)
+		level++;
+	return(level);
+}
+
+
+// 1 IF THE OPERATIONS FOLLOW A SCHEDULE, -RATE OR -REPLAY, RATHER THAN THE REPLIES
+int loadgen_open_loop(loadgen_config * config)
+{
+	return(config->rate > 0 || config->replay != NULL);
+}
+
+
+// LOADS THE -REPLAY FILE: ITS OPERATIONS ARE THE RUN, ITS MIX IS REPORTED.  -1 IF IT CANNOT BE READ OR IS EMPTY
+int loadgen_replay(loadgen_config * config)
+{
+	config->replay = replay_load(config->replay_file);
+	if (config->replay == NULL)
+		return(-1);
+	if (config->replay->count == 0)
+	{
+		printf("%s has no operations\n", config->replay_file);
+		replay_free(config->replay);
+		config->replay = NULL;
+		return(-1);
+	}
+
+	memset(config->mix, 0, sizeof(config->mix));
+	for (int i = 0; i < config->replay->count; i++)
+	{
+		int command = config->replay->ops[i].command;
+		config->mix[(command == RPC_GET) ? LOADGEN_GET : (command == RPC_DEL) ? LOADGEN_DEL : LOADGEN_PUT]++;
+	}
+	config->ops = config->replay->count;
+	strcpy(config->workload, "replay");
+	return(0);
+}
+
+
+// THE INDEX IN THE SERVERS OF A REPLAYED OPERATION'S SERVER: ITS HOST NAME, OR ITS NODE ID, OR A RANDOM ONE
+int loadgen_server(loadgen_thread * thread, char * name)
+{
+	loadgen_config * config = thread->config;
+	for (int s = 0; s < config->server_count; s++)
+		if (strcmp(name, config->servers[s]) == 0)
+			return(s);
+
+	// A TRACE NAMES THE NODE, ITS LINE OF SERVERLIST.TXT
+	char * end;
+	long id = strtol(name, &end, 10);
+	if (end != name && *end == '\0' && id >= 0 && id < config->server_count)
+		return((int) id);
+	return((int) (loadgen_random(thread) % config->server_count));
+}
+
+
+// APPENDS ONE ROW PER KIND OF OPERATION TO THE CSV FILE, WITH A HEADER IF IT IS NEW
+int loadgen_csv(loadgen_config * config, double elapsed)
+{
+	FILE * file = fopen(config->csv, "a");
+	if (file == NULL)
+		return(-1);
+
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0)
+		fprintf(file, "timestamp,label,workload,distribution,threads,rate,kind,ops,errors,nacks,throughput,mean_ms,p50_ms,p99_ms,p999_ms,max_ms\n");
+
+	long long now = (long long) time(NULL);
+	char * label;
+	loadgen_result * result;
+	for (int row = 0; (result = loadgen_row(row, &label)) != NULL; row++)
+	{
+		stats_histogram * h = &result->latency;
+		uint64_t ops = result->ops;
+		if (ops == 0)
+			continue;
+		fprintf(file, "%lld,%s,%s,%s,%d,%.1f,%s,%llu,%llu,%llu,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+				now, config->label, config->workload, loadgen_distributions[config->distribution], config->threads,
+				config->rate, label, (unsigned long long) ops, (unsigned long long) result->errors,
+				(unsigned long long) result->nacks, elapsed > 0 ? ops / elapsed : 0.0, h->sum_us / 1000.0 / ops,
+				stats_percentile(h, ops, 50) / 1000.0, stats_percentile(h, ops, 99) / 1000.0,
+				stats_percentile(h, ops, 99.9) / 1000.0, h->max_us / 1000.0);
+	}
+	return(fclose(file) == 0 ? 0 : -1);
+}
+
+
+// THE RESULT AND LABEL OF ONE ROW OF THE CSV OR HISTOGRAMS: THE KINDS, ALL, THE LEVELS OF -CONSISTENCY, SERVICE.  NULL PAST THE LAST
+loadgen_result * loadgen_row(int row, char ** label)
+{
+	if (row <= LOADGEN_KINDS)
+	{
+		*label = loadgen_labels[row];
+		return(&loadgen_results[row]);
+	}
+	row -= LOADGEN_KINDS + 1;
+	if (row < READ_LEVELS)
+	{
+		*label = loadgen_level_labels[row];
+		return(&loadgen_reads[row]);
+	}
+	if (row == READ_LEVELS)
+	{
+		*label = "service";
+		return(&loadgen_service);
+	}
+	return(NULL);
+}
+
+
+// SAVES THE HISTOGRAM OF EVERY KIND OF OPERATION TO PREFIX.KIND.HGRM
+int loadgen_hdr(loadgen_config * config)
+{
+	char filename[FILENAME_MAX];
+	char * label;
+	loadgen_result * result;
+	for (int row = 0; (result = loadgen_row(row, &label)) != NULL; row++)
+	{
+		if (result->ops == 0)
+			continue;
+		snprintf(filename, FILENAME_MAX, "%s.%s.hgrm", config->hdr, label);
+		if (stats_save(&result->latency, filename) != 0)
+			return(-1);
+	}
+	return(0);
+}
+
+
+// SLEEPS UNTIL THE TIME PROVIDED (MS OF BENCH_NOW_MS), RETURNS AT ONCE IF IT IS PAST
+void loadgen_sleep_until(double when_ms)
+{
+	double wait = when_ms - bench_now_ms();
+	if (wait <= 0)
+		return;
+	struct timespec delay;
+	delay.tv_sec  = (time_t) (wait / 1000.0);
+	delay.tv_nsec = (long) ((wait - delay.tv_sec * 1000.0) * 1000000.0);
+	nanosleep(&delay, NULL);
+}
+
+
+// XORSHIFT64* OF THE THREAD
+uint64_t loadgen_random(loadgen_thread * thread)
+{
+	thread->random ^= thread->random >> 12;
+	thread->random ^= thread->random << 25;
+	thread->random ^= thread->random >> 27;
+	return(thread->random * 2685821657736338717ULL);
+}
+
+
+// UNIFORM IN [0, 1)
+double loadgen_uniform(loadgen_thread * thread)
+{
+	return((double) (loadgen_random(thread) >> 11) / 9007199254740992.0);
+}
+
+
+// ONE LINE OF THE REPORT
+void loadgen_report(char * label, loadgen_result * result, double elapsed, FILE * out)
+{
+	stats_histogram * h = &result->latency;
+	uint64_t ops = result->ops;
+	fprintf(out, "%s: ops=%llu errors=%llu nacks=%llu throughput=%.1f ops/s mean=%.3fms p50=%.3fms p99=%.3fms p99.9=%.3fms max=%.3fms\n",
+			label, (unsigned long long) ops, (unsigned long long) result->errors, (unsigned long long) result->nacks,
+			elapsed > 0 ? ops / elapsed : 0.0, ops > 0 ? h->sum_us / 1000.0 / ops : 0.0,
+			stats_percentile(h, ops, 50) / 1000.0, stats_percentile(h, ops, 99) / 1000.0,
+			stats_percentile(h, ops, 99.9) / 1000.0, h->max_us / 1000.0);
+}
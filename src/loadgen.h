@@ -0,0 +1,216 @@
+/*
+ ============================================================================
+ Name        : loadgen.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.27
+ Description : Non-interactive load generator, tcss558 bench.  Each thread
+             : has its own rpc handles and sends one operation at a time to
+             : a random server of serverlist.txt, until the operations run
+             : out or the duration is over.  The mix of operations, the
+             : number of keys, how keys are chosen and how values are made
+             : are options.  The latencies go into stats histograms (3%
+             : buckets), so a run of any length takes the same memory.
+             :
+             : -workload a to f runs the YCSB core workloads:
+             :   a  50% read, 50% update, zipfian
+             :   b  95% read, 5% update, zipfian
+             :   c  100% read, zipfian
+             :   d  95% read, 5% insert, latest
+             :   e  95% scan, 5% insert, zipfian
+             :   f  50% read, 50% read-modify-write, zipfian
+             : and -workload load inserts keys 0 to keys - 1 first.  The
+             : store has no range query, so a scan reads its keys one GET
+             : at a time and is timed as one operation.
+             :
+             : With -rate the load is open loop: operation i is due at
+             : start + i / rate, whatever happened to the ones before it,
+             : and its latency is measured from when it was due, not from
+             : when a free thread got to send it.  A closed loop (send,
+             : wait, send) stops sending while a server stalls, so the
+             : stall only shows up once per thread and the tail looks
+             : better than it is (coordinated omission).  The service time
+             : (from the send) is kept too, to show the difference.
+             :
+             : With -outstanding n every thread keeps n GETs, PUTs and DELs
+             : in flight over one asynchronous client (kvclient.h) instead
+             : of blocking in client_rpc_send, so a few threads make the
+             : load of hundreds.
+             :
+             : With -route leader the PUTs and DELs go to the leader the
+             : replies name (client_rpc_route, or KVC_ANY_SERVER with
+             : -outstanding) instead of a random server, so the proposers
+             : don't NACK each other's prepares.
+             :
+             : With -consistency the GETs are sent at the levels listed
+             : (quorum, linearizable, local or local:ms), one picked at
+             : random per operation, and every level gets its own row of
+             : the report (get.quorum, get.linearizable, get.local).
+             : With -session on the client keeps read-your-writes session
+             : tokens (client_session_enable) and every GET carries one.
+             :
+             : With -replay file the operations are the ones of a workload
+             : file (replay.h, made by tracecapture from a client.log or the
+             : traces of a production run) instead of a mix: every GET, PUT
+             : and DEL is sent with its key and value, to the server it was
+             : sent to (by host name, or by node id, the line of
+             : serverlist.txt, for a trace; a random one if neither is in
+             : serverlist.txt), at its offset from the start divided by
+             : -speed.  The run is open loop on that schedule, so it keeps
+             : the inter-arrival times of the capture, or speeds them up N
+             : times, and is timed from when every operation was due.
+ ============================================================================
+ */
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#define LOADGEN_DEFAULT_THREADS  4
+#define LOADGEN_DEFAULT_OPS      10000
+#define LOADGEN_DEFAULT_KEYS     1000
+#define LOADGEN_DEFAULT_SCAN     100     // longest scan, YCSB's default
+#define LOADGEN_MAX_THREADS      256
+#define LOADGEN_LABEL_LENGTH     64
+#define LOADGEN_LATE_MS          1.0     // an open loop operation sent later than this after it was due is late
+
+// KINDS OF OPERATION, AND ONE HISTOGRAM FOR ALL OF THEM
+#define LOADGEN_GET     0   // read
+#define LOADGEN_PUT     1   // update of a key that exists
+#define LOADGEN_DEL     2
+#define LOADGEN_INSERT  3   // put of the next new key
+#define LOADGEN_SCAN    4   // gets of consecutive keys
+#define LOADGEN_RMW     5   // get, then put of the same key
+#define LOADGEN_KINDS   6
+#define LOADGEN_ALL     6
+
+// HOW THE VALUE OF A PUT IS MADE
+#define LOADGEN_VALUE_RANDOM    0   // a random non-negative int
+#define LOADGEN_VALUE_SEQUENCE  1   // 1, 2, 3... per thread
+#define LOADGEN_VALUE_CONSTANT  2   // always the same value
+
+// HOW THE KEY OF AN OPERATION IS CHOSEN
+#define LOADGEN_UNIFORM    0
+#define LOADGEN_ZIPFIAN    1   // key 0 is the most popular, then 1...
+#define LOADGEN_SCRAMBLED  2   // zipfian, with the popular keys spread over the key space
+#define LOADGEN_LATEST     3   // zipfian, the last inserted key is the most popular
+
+// WHERE AN OPERATION IS SENT
+#define LOADGEN_ROUTE_RANDOM  0   // a random server
+#define LOADGEN_ROUTE_LEADER  1   // a put or del to the leader the servers name, a get to a random server
+
+#define LOADGEN_ZIPF_THETA          0.99
+#define LOADGEN_SCRAMBLED_ITEMS     10000000000ULL      // items of the scrambled zipfian, like YCSB
+#define LOADGEN_SCRAMBLED_ZETAN     26.46902820178302   // its zeta, computed once by YCSB
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef CLIENT_H
+#include "client.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#ifndef KVCLIENT_H
+#include "kvclient.h"
+#endif
+
+#ifndef REPLAY_H
+#include "replay.h"
+#endif
+
+
+// WHAT TO RUN
+typedef struct loadgen_config {
+	int threads;
+	int outstanding;            // calls in flight per thread, over the asynchronous client when more than 1
+	int ops;                    // operations of the whole run, ignored with a duration
+	double duration;            // seconds the run lasts, 0 to count operations
+	double rate;                // operations per second of an open loop, 0 for a closed loop
+	int mix[LOADGEN_KINDS];     // relative weights of every kind of operation
+	int keys;                   // keys that exist before the run
+	int distribution;           // LOADGEN_UNIFORM, ...
+	int route;                  // LOADGEN_ROUTE_RANDOM or LOADGEN_ROUTE_LEADER
+	int cache;                  // entries of the client's read cache, 0 for none
+	int consistency[READ_LEVELS];  // 1 if a get may be sent at that READ_* level
+	int staleness;              // ms a READ_LOCAL get may lag, 0 for any
+	int session;                // 1 if the gets carry the session tokens of client_rpc_send
+	char * replay_file;         // workload file to replay instead of the mix, NULL for none
+	replay_workload * replay;   // its operations, loaded by loadgen_main
+	double speed;               // how many times faster than captured the replay goes
+	int scan;                   // longest scan
+	int values;                 // LOADGEN_VALUE_*
+	int constant;               // the value of LOADGEN_VALUE_CONSTANT
+	uint64_t seed;
+	char workload[LOADGEN_LABEL_LENGTH];  // name of the mix, for the report
+	char label[LOADGEN_LABEL_LENGTH];     // name of the build or run, for the csv
+	char * csv;                 // file the results are appended to, NULL for none
+	char * hdr;                 // prefix of the .hgrm files of the histograms, NULL for none
+	char ** servers;
+	int server_count;
+} loadgen_config;
+
+// WHAT HAPPENED TO ONE KIND OF OPERATION
+typedef struct loadgen_result {
+	stats_histogram latency;
+	uint64_t ops;
+	uint64_t errors;            // the rpc call failed
+	uint64_t nacks;             // the server answered with something else than OK
+} loadgen_result;
+
+// THE CONSTANTS OF A ZIPFIAN DISTRIBUTION (GRAY ET AL, AS IN YCSB)
+typedef struct loadgen_zipf {
+	uint64_t items;
+	double theta;
+	double zetan;
+	double alpha;
+	double eta;
+	double half;                // 1 + 0.5 ^ theta
+} loadgen_zipf;
+
+
+/*******************************************************************************
+ * PARSES THE OPTIONS OF TCSS558 BENCH, RUNS THE LOAD AGAINST THE SERVERS      *
+ * PROVIDED AND PRINTS THE REPORT.  RETURNS -1 IF AN OPTION IS BAD.  THE       *
+ * OPTIONS ARE -THREADS N, -OUTSTANDING N, -OPS N OR -DURATION SECONDS,        *
+ * -RATE OPS/S, -WORKLOAD A-F|LOAD, -MIX GET:PUT:DEL[:INSERT:SCAN:RMW],        *
+ * -KEYS N, -DISTRIBUTION UNIFORM|ZIPFIAN|SCRAMBLED|LATEST, -SCAN N, -VALUES   *
+ * RANDOM|SEQUENCE|N, -ROUTE RANDOM|LEADER, -CACHE ENTRIES, -CONSISTENCY       *
+ * LEVEL[,LEVEL...], -SESSION ON|OFF, -REPLAY FILE, -SPEED N, -SEED N, -CSV    *
+ * FILE, -HDR PREFIX AND -LABEL NAME.                                          *
+ ******************************************************************************/
+int loadgen_main(int argc, char * argv[], char ** servers, int server_count);
+
+/*******************************************************************************
+ * RUNS THE LOAD AND PRINTS THE THROUGHPUT AND THE P50, P99 AND P99.9 LATENCY  *
+ * OF EVERY KIND OF OPERATION TO THE FILE PROVIDED, APPENDS THEM TO THE CSV    *
+ * FILE OF THE CONFIG AND SAVES THE HISTOGRAMS.  RETURNS -1 IF THE THREADS     *
+ * CANNOT BE STARTED OR A FILE CANNOT BE WRITTEN.                              *
+ ******************************************************************************/
+int loadgen_run(loadgen_config * config, FILE * out);
+
+/*******************************************************************************
+ * SETS UP THE CONFIG FOR THE YCSB CORE WORKLOAD PROVIDED (A TO F, OR LOAD).   *
+ * RETURNS -1 IF THERE IS NO SUCH WORKLOAD.                                    *
+ ******************************************************************************/
+int loadgen_workload(loadgen_config * config, char * name);
+
+/*******************************************************************************
+ * COMPUTES THE CONSTANTS OF A ZIPFIAN DISTRIBUTION OVER ITEMS.  ZETAN IS THE  *
+ * SUM OF 1 / I^THETA, PASS 0 TO HAVE IT COMPUTED (ONE PASS OVER THE ITEMS).   *
+ ******************************************************************************/
+void loadgen_zipf_init(loadgen_zipf * zipf, uint64_t items, double theta, double zetan);
+
+/*******************************************************************************
+ * DRAWS AN ITEM FROM 0 TO ITEMS - 1, 0 THE MOST LIKELY.  U IS UNIFORM IN      *
+ * [0, 1).                                                                     *
+ ******************************************************************************/
+uint64_t loadgen_zipf_next(loadgen_zipf * zipf, double u);
+
+#endif /* LOADGEN_H */
@@ -0,0 +1,109 @@
+/*
+ ============================================================================
+ Name        : lockstat.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.22
+ Description : Instrumented locks.  See lockstat.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef LOCKSTAT_H
+#include "lockstat.h"
+#endif
+
+#include <time.h>
+
+#ifndef LOCKSTAT_OFF
+lockstat * lockstat_locks = NULL;
+pthread_mutex_t lockstat_registry = PTHREAD_MUTEX_INITIALIZER;  // the list of locks
+
+uint64_t lockstat_now_ns();
+#endif
+
+
+/*******************************************************************************
+ * INITIALIZES THE LOCK AND REGISTERS IT UNDER THE NAME PROVIDED.  RETURNS -1  *
+ * IF THE MUTEX CANNOT BE CREATED.                                             *
+ ******************************************************************************/
+int lockstat_init(lockstat * lock, char * name)
+{
+	memset(lock, 0, sizeof(lockstat));
+	if (pthread_mutex_init(&lock->mutex, NULL) != 0)
+		return(-1);
+
+#ifndef LOCKSTAT_OFF
+	strncpy(lock->name, name, LOCKSTAT_NAME_LENGTH - 1);
+
+	pthread_mutex_lock(&lockstat_registry);
+	lock->next = lockstat_locks;
+	__atomic_store_n(&lockstat_locks, lock, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&lockstat_registry);
+#else
+	(void) name;
+#endif
+	return(0);
+}
+
+
+#ifndef LOCKSTAT_OFF
+/*******************************************************************************
+ * TAKES THE LOCK, TIMING THE WAIT IF ANOTHER THREAD HOLDS IT.                 *
+ ******************************************************************************/
+void lockstat_acquire(lockstat * lock)
+{
+	uint64_t waited = 0;
+	if (pthread_mutex_trylock(&lock->mutex) != 0)
+	{
+		uint64_t start = lockstat_now_ns();
+		pthread_mutex_lock(&lock->mutex);
+		waited = lockstat_now_ns() - start;
+	}
+
+	// ONLY THE HOLDER WRITES THE COUNTS, THE STORES ARE ATOMIC FOR THE READERS
+	lock->held_since_ns = lockstat_now_ns();
+	__atomic_store_n(&lock->acquisitions, lock->acquisitions + 1, __ATOMIC_RELAXED);
+	if (waited > 0)
+	{
+		__atomic_store_n(&lock->contended, lock->contended + 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock->wait_ns, lock->wait_ns + waited, __ATOMIC_RELAXED);
+	}
+}
+
+
+/*******************************************************************************
+ * RELEASES THE LOCK, KEEPING THE LONGEST TIME IT WAS HELD.                    *
+ ******************************************************************************/
+void lockstat_release(lockstat * lock)
+{
+	uint64_t held = lockstat_now_ns() - lock->held_since_ns;
+	if (held > lock->max_hold_ns)
+		__atomic_store_n(&lock->max_hold_ns, held, __ATOMIC_RELAXED);
+
+	pthread_mutex_unlock(&lock->mutex);
+}
+
+
+// MONOTONIC TIME IN NANOSECONDS
+uint64_t lockstat_now_ns()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec);
+}
+#endif
+
+
+/*******************************************************************************
+ * RETURNS THE FIRST REGISTERED LOCK, FOLLOW NEXT FOR THE OTHERS.  READ THE    *
+ * COUNTS WITH __ATOMIC_LOAD_N.  ALWAYS NULL WHEN BUILT WITH LOCKSTAT_OFF.     *
+ ******************************************************************************/
+lockstat * lockstat_list()
+{
+#ifdef LOCKSTAT_OFF
+	return(NULL);
+#else
+	return(__atomic_load_n(&lockstat_locks, __ATOMIC_ACQUIRE));
+#endif
+}
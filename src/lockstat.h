@@ -0,0 +1,70 @@
+/*
+ ============================================================================
+ Name        : lockstat.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.22
+ Description : A mutex that counts its acquisitions, how many of them had to
+             : wait, the total wait and the longest time it was held.  The
+             : counts are written by the holder of the lock only, so they cost
+             : two clock reads per acquisition and no atomic read-modify-write.
+             : Every lock is named and registered so RPC_STATS and the metrics
+             : endpoint can report it.  Build with -DLOCKSTAT_OFF to turn them
+             : back into plain mutexes.
+ ============================================================================
+ */
+
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#define LOCKSTAT_NAME_LENGTH  16
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// ONE INSTRUMENTED LOCK
+typedef struct lockstat {
+	pthread_mutex_t mutex;
+#ifndef LOCKSTAT_OFF
+	char name[LOCKSTAT_NAME_LENGTH];
+	uint64_t acquisitions;    // times it was taken
+	uint64_t contended;       // times it was already held by another thread
+	uint64_t wait_ns;         // total time spent waiting for it
+	uint64_t max_hold_ns;     // longest time it was held
+	uint64_t held_since_ns;   // when the current holder took it
+	struct lockstat * next;   // every registered lock
+#endif
+} lockstat;
+
+
+/*******************************************************************************
+ * INITIALIZES THE LOCK AND REGISTERS IT UNDER THE NAME PROVIDED.  RETURNS -1  *
+ * IF THE MUTEX CANNOT BE CREATED.                                             *
+ ******************************************************************************/
+int lockstat_init(lockstat * lock, char * name);
+
+#ifdef LOCKSTAT_OFF
+#define lockstat_acquire(lock)  pthread_mutex_lock(&(lock)->mutex)
+#define lockstat_release(lock)  pthread_mutex_unlock(&(lock)->mutex)
+#else
+/*******************************************************************************
+ * TAKES THE LOCK, TIMING THE WAIT IF ANOTHER THREAD HOLDS IT.                 *
+ ******************************************************************************/
+void lockstat_acquire(lockstat * lock);
+
+/*******************************************************************************
+ * RELEASES THE LOCK, KEEPING THE LONGEST TIME IT WAS HELD.                    *
+ ******************************************************************************/
+void lockstat_release(lockstat * lock);
+#endif
+
+/*******************************************************************************
+ * RETURNS THE FIRST REGISTERED LOCK, FOLLOW NEXT FOR THE OTHERS.  READ THE    *
+ * COUNTS WITH __ATOMIC_LOAD_N.  ALWAYS NULL WHEN BUILT WITH LOCKSTAT_OFF.     *
+ ******************************************************************************/
+lockstat * lockstat_list();
+
+#endif /* LOCKSTAT_H */
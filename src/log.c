@@ -5,33 +5,362 @@
  *      Author: kevanderson
  */
 
+#define _GNU_SOURCE
+
 #ifndef LOG_H
 #include "log.h"
 #endif
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+#ifndef BENCH_H
+#include "bench.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+// AN OPEN LOG FILE AND THE LINES WAITING TO BE WRITTEN TO IT
+typedef struct log_file {
+	char name[LOG_NAME_LENGTH];
+	int fd;                          // -1 if the file could not be opened
+	char buffer[LOG_BATCH_SIZE];
+	int length;
+} log_file;
+
+log_record log_ring[LOG_RING_SIZE];
+size_t log_tail = 0;         // next position a producer claims
+size_t log_head = 0;         // next position the writer reads (writer only)
+size_t log_written = 0;      // positions that have reached the files
+long log_drop_count = 0;
+long log_drop_reported = 0;  // drops already written to a file (writer only)
+int log_policy = LOG_BLOCK;
+int log_level = LOG_LEVEL_INFO;
+int log_echo = 1;
+
+log_file log_files[LOG_MAX_FILES];
+int log_file_count = 0;
+char log_echo_buffer[LOG_BATCH_SIZE];
+int log_echo_length = 0;
+
+pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+void log_start();
+log_record * log_claim(size_t * position);
+void log_publish(log_record * record, size_t position, char * filename, char * host);
+void * log_writer(void * arg);
+void log_append(log_record * record);
+void log_append_line(log_file * file, char * line, int length);
+void log_flush_files();
+log_file * log_open(char * name);
+void log_format_time(struct timeval * tv, char * output, time_t * cached_sec, char * cached_date);
+void log_sleep(long ns);
+
 
 /*******************************************************************************
- * WRITES A WELL FORMED MESSAGE AND RESPONSE TO THE SERVER.LOG FILE THAT WILL  *
- * INCLUDE A TIMESTAMP OF THE WRITE.  IF THE SERVER.LOG FILE DOES NOT EXIST IT *
- * WILL BE CREATED.  IF THE FILE IS UNABLE TO BE OPENED, LOG_WRITE WILL RETURN *
- * -1 OTHERWISE WILL RETURN 0.                                                 *
+ * QUEUES A WELL FORMED MESSAGE AND RESPONSE FOR THE LOG FILE PROVIDED WITH A  *
+ * TIMESTAMP OF THE CALL.  THE LINE IS WRITTEN BY THE LOG THREAD, WHICH IS     *
+ * STARTED ON THE FIRST CALL.  IF THE FILE DOES NOT EXIST IT WILL BE CREATED.  *
+ * RETURNS -1 IF THE RECORD WAS DROPPED BECAUSE THE RING WAS FULL (LOG_DROP),  *
+ * OTHERWISE 0.                                                                *
  ******************************************************************************/
 int log_write(char* filename, char * host, char * message)
 {
-	FILE * fd = fopen(filename, "a");
+	double started = bench_now_ms();
+	size_t position;
+	log_record * record = log_claim(&position);
+	if (record == NULL)
+		return(-1);
 
-	if (fd == NULL)
+	strncpy(record->message, message, LOG_MESSAGE_LENGTH - 1);
+	record->message[LOG_MESSAGE_LENGTH - 1] = '\0';
+
+	log_publish(record, position, filename, host);
+	stats_record(STATS_LOG, bench_now_ms() - started);
+	return 0;
+}
+
+
+/*******************************************************************************
+ * LIKE LOG_WRITE, BUT FORMATS THE MESSAGE (PRINTF STYLE) DIRECTLY INTO THE    *
+ * RING SLOT.  USE THE LOG_TRACE ... LOG_WARN MACROS RATHER THAN CALLING IT.   *
+ ******************************************************************************/
+int log_writef(char * filename, char * host, const char * format, ...)
+{
+	double started = bench_now_ms();
+	size_t position;
+	log_record * record = log_claim(&position);
+	if (record == NULL)
+		return(-1);
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(record->message, LOG_MESSAGE_LENGTH, format, args);
+	va_end(args);
+
+	log_publish(record, position, filename, host);
+	stats_record(STATS_LOG, bench_now_ms() - started);
+	return 0;
+}
+
+
+/*******************************************************************************
+ * SETS THE LOWEST LEVEL THAT IS WRITTEN.  RETURNS -1 IF THE NAME PROVIDED IS  *
+ * NOT ONE OF TRACE, DEBUG, INFO, WARN OR OFF.                                 *
+ ******************************************************************************/
+int log_set_level(char * name)
+{
+	char * names[] = { "trace", "debug", "info", "warn", "off" };
+
+	for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_OFF; level++)
 	{
-		printf("Cannot Open File");
-		return -1;
-	} else {
-		char timestamp[30];
-		buildTimeStamp(timestamp);
-		printf("{{Timestamp=%s},{host=%s},{%s}}\n", timestamp, host, message);
-		fprintf(fd, "{{Timestamp=%s},{host=%s},{%s}}", timestamp, host, message);
-		fclose(fd);
-		return 0;
+		if (strcmp(name, names[level]) == 0)
+		{
+			log_level = level;
+			return(0);
+		}
+	}
+
+	return(-1);
+}
+
+
+// CLAIMS A SLOT (BOUNDED MULTI-PRODUCER QUEUE, ONE SEQUENCE NUMBER PER SLOT).
+// RETURNS NULL IF THE RING IS FULL AND THE POLICY IS LOG_DROP.
+log_record * log_claim(size_t * position)
+{
+	pthread_once(&log_once, log_start);
+
+	log_record * record;
+	size_t claimed = __atomic_load_n(&log_tail, __ATOMIC_RELAXED);
+	while (1)
+	{
+		record = &log_ring[claimed & (LOG_RING_SIZE - 1)];
+		size_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+		long difference = (long) sequence - (long) claimed;
+
+		if (difference == 0)
+		{
+			if (__atomic_compare_exchange_n(&log_tail, &claimed, claimed + 1, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (difference < 0) {
+			// THE RING IS FULL
+			if (log_policy == LOG_DROP)
+			{
+				__atomic_add_fetch(&log_drop_count, 1, __ATOMIC_RELAXED);
+				return NULL;
+			}
+			sched_yield();
+			claimed = __atomic_load_n(&log_tail, __ATOMIC_RELAXED);
+		} else {
+			claimed = __atomic_load_n(&log_tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	*position = claimed;
+	return record;
+}
+
+
+// FILLS IN THE REST OF A CLAIMED SLOT AND HANDS IT TO THE WRITER
+void log_publish(log_record * record, size_t position, char * filename, char * host)
+{
+	gettimeofday(&record->time, NULL);
+	strncpy(record->filename, filename, LOG_NAME_LENGTH - 1);
+	record->filename[LOG_NAME_LENGTH - 1] = '\0';
+	strncpy(record->host, host, LOG_HOST_LENGTH - 1);
+	record->host[LOG_HOST_LENGTH - 1] = '\0';
+
+	__atomic_store_n(&record->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+
+/*******************************************************************************
+ * WAITS (AT MOST A SECOND) UNTIL EVERY RECORD QUEUED SO FAR IS WRITTEN.  IT   *
+ * IS REGISTERED WITH ATEXIT SO NOTHING IS LOST WHEN THE PROGRAM EXITS.        *
+ ******************************************************************************/
+void log_flush()
+{
+	size_t target = __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		if (__atomic_load_n(&log_written, __ATOMIC_ACQUIRE) >= target)
+			return;
+		log_sleep(LOG_IDLE_NS);
+	}
+}
+
+
+/*******************************************************************************
+ * CHOOSES WHAT LOG_WRITE DOES WHEN THE RING IS FULL, LOG_BLOCK OR LOG_DROP.   *
+ ******************************************************************************/
+void log_set_policy(int policy)
+{
+	log_policy = policy;
+}
+
+
+/*******************************************************************************
+ * TURNS THE ECHO OF EVERY LINE TO THE CONSOLE ON (1) OR OFF (0).              *
+ ******************************************************************************/
+void log_set_echo(int echo)
+{
+	log_echo = echo;
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NUMBER OF RECORDS DROPPED BECAUSE THE RING WAS FULL.            *
+ ******************************************************************************/
+long log_dropped()
+{
+	return __atomic_load_n(&log_drop_count, __ATOMIC_RELAXED);
+}
+
+
+// PREPARES THE RING AND STARTS THE WRITER, RUN ONCE BY THE FIRST LOG_WRITE
+void log_start()
+{
+	for (size_t i = 0; i < LOG_RING_SIZE; i++)
+		log_ring[i].sequence = i;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, log_writer, NULL) != 0)
+	{
+		printf("Cannot start the log thread\n");
+		exit(-1);
+	}
+	pthread_detach(thread);
+
+	atexit(log_flush);
+}
+
+
+/******************************************************
+ * THE LOG THREAD.  TAKES EVERY PUBLISHED RECORD OUT  *
+ * OF THE RING INTO THE BUFFER OF ITS FILE, AND WRITES*
+ * THE BUFFERS WHEN THEY FILL UP OR THE RING IS EMPTY.*
+ *****************************************************/
+void * log_writer(void * arg)
+{
+	(void) arg;
+	while (1)
+	{
+		log_record * record = &log_ring[log_head & (LOG_RING_SIZE - 1)];
+		size_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+
+		if (sequence == log_head + 1)
+		{
+			log_append(record);
+
+			// GIVE THE SLOT BACK FOR THE NEXT LAP OF THE RING
+			__atomic_store_n(&record->sequence, log_head + LOG_RING_SIZE, __ATOMIC_RELEASE);
+			log_head++;
+		} else {
+			// NOTHING (MORE) TO READ, WRITE WHAT WE HAVE AND WAIT
+			log_flush_files();
+			__atomic_store_n(&log_written, log_head, __ATOMIC_RELEASE);
+			log_sleep(LOG_IDLE_NS);
+		}
 	}
+
+	return NULL;
+}
+
+
+// FORMATS THE RECORD INTO THE BUFFER OF ITS FILE (AND OF THE CONSOLE)
+void log_append(log_record * record)
+{
+	static time_t cached_sec = -1;
+	static char cached_date[26];
+	char timestamp[30];
+	char line[LOG_HOST_LENGTH + LOG_MESSAGE_LENGTH + 64];
+
+	log_file * file = log_open(record->filename);
+	log_format_time(&record->time, timestamp, &cached_sec, cached_date);
+
+	// TELL THE READER THAT LINES ARE MISSING BEFORE THIS ONE
+	long dropped = __atomic_load_n(&log_drop_count, __ATOMIC_RELAXED);
+	if (dropped > log_drop_reported)
+	{
+		int length = sprintf(line, "{{Timestamp=%s},{host=localhost},{LOG=DROPPED(%ld)}}\n",
+				timestamp, dropped - log_drop_reported);
+		log_append_line(file, line, length);
+		log_drop_reported = dropped;
+	}
+
+	int length = sprintf(line, "{{Timestamp=%s},{host=%s},{%s}}\n", timestamp, record->host, record->message);
+	log_append_line(file, line, length);
+}
+
+
+// ADDS THE LINE TO THE FILE BUFFER AND THE CONSOLE BUFFER, WRITING THEM IF FULL
+void log_append_line(log_file * file, char * line, int length)
+{
+	if (file != NULL && file->fd >= 0)
+	{
+		if (file->length + length > LOG_BATCH_SIZE)
+			log_flush_files();
+		memcpy(file->buffer + file->length, line, length);
+		file->length += length;
+	}
+
+	if (log_echo)
+	{
+		if (log_echo_length + length > LOG_BATCH_SIZE)
+			log_flush_files();
+		memcpy(log_echo_buffer + log_echo_length, line, length);
+		log_echo_length += length;
+	}
+}
+
+
+// WRITES EVERY BUFFERED LINE TO ITS FILE AND TO THE CONSOLE
+void log_flush_files()
+{
+	for (int i = 0; i < log_file_count; i++)
+	{
+		if (log_files[i].length > 0)
+		{
+			write(log_files[i].fd, log_files[i].buffer, log_files[i].length);
+			log_files[i].length = 0;
+		}
+	}
+
+	if (log_echo_length > 0)
+	{
+		write(STDOUT_FILENO, log_echo_buffer, log_echo_length);
+		log_echo_length = 0;
+	}
+}
+
+
+// RETURNS THE OPEN LOG FILE WITH THE NAME PROVIDED, OPENING IT ON FIRST USE
+log_file * log_open(char * name)
+{
+	for (int i = 0; i < log_file_count; i++)
+	{
+		if (strcmp(log_files[i].name, name) == 0)
+			return &log_files[i];
+	}
+
+	if (log_file_count >= LOG_MAX_FILES)
+		return NULL;
+
+	log_file * file = &log_files[log_file_count++];
+	strcpy(file->name, name);
+	file->length = 0;
+	file->fd = open(name, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+	if (file->fd < 0)
+		printf("Cannot Open File %s\n", name);
+
+	return file;
 }
 
 
@@ -40,27 +369,154 @@ int log_write(char* filename, char * host, char * message)
  * CURRENT TIME WITH MILLISECOND PRECISION.  THE TIMESTAMP IS PROVIDED IN      *
  * LOCAL TIME.  THE FORMAT OF THE TIMESTAMP IS AS FOLLOWS:                     *
  * (TMZ) YYYY-MM-DD HH:MM:SS.SSS (e.g. (PDT) 2015-01-31 23:59:52.123           *
- * FOR MILLISECOND PRECISION, POSIX IS ASSUMED.                                *
+ * FOR MILLISECOND PRECISION, POSIX IS ASSUMED.  THE DATE IS ONLY FORMATTED    *
+ * AGAIN WHEN THE SECOND CHANGES.                                              *
  ******************************************************************************/
 void buildTimeStamp(char * output)
 {
+	static __thread time_t cached_sec = -1;
+	static __thread char cached_date[26];
 
 	// TIME_T IS ONLY SECOND PRECISION, RELY ON POSIX gettimeofday FUNCTION
 	struct timeval current_tv;
 	gettimeofday(&current_tv, NULL);
 
+	log_format_time(&current_tv, output, &cached_sec, cached_date);
+	return;
+}
+
+
+// FORMATS THE TIME, ONLY CALLING STRFTIME WHEN THE SECOND IS NOT THE CACHED ONE
+void log_format_time(struct timeval * tv, char * output, time_t * cached_sec, char * cached_date)
+{
 	// TO LEVERAGE BUILT IN TIME TO STRING FUNCTIONS, CONVERT to a TIME_T
-	time_t current_tm = (time_t) current_tv.tv_sec;
+	time_t current_tm = (time_t) tv->tv_sec;
 
-	// GET STRING OF TIME STAMP
+	if (current_tm != *cached_sec)
+	{
+		struct tm local;
+		localtime_r(&current_tm, &local);
+		strftime(cached_date, 26, "(%Z) %Y-%m-%d %H:%M:%S", &local);
+		*cached_sec = current_tm;
+	}
+
+	// PUT IT ALL TOGETHER TO RETURN
+	sprintf(output, "%s.%03d", cached_date, (int) (tv->tv_usec / 1000));
+}
+
+
+// SLEEPS FOR THE NUMBER OF NANOSECONDS PROVIDED
+void log_sleep(long ns)
+{
+	struct timespec wait;
+	wait.tv_sec  = ns / 1000000000L;
+	wait.tv_nsec = ns % 1000000000L;
+	nanosleep(&wait, NULL);
+}
+
+
+// WHAT A BENCHMARK THREAD NEEDS
+typedef struct log_bench_args {
+	int requests;
+	int lines;
+	int sync;             // 1 to use the old open/print/close per line
+	bench * the_bench;    // per request latency of this thread
+} log_bench_args;
+
+
+// THE OLD LOG_WRITE, KEPT TO COMPARE AGAINST
+int log_write_sync(char * filename, char * host, char * message)
+{
+	FILE * fd = fopen(filename, "a");
+	if (fd == NULL)
+		return -1;
+
+	char timestamp[30];
+	struct timeval current_tv;
+	gettimeofday(&current_tv, NULL);
+	time_t current_tm = (time_t) current_tv.tv_sec;
 	char cdate[26];
 	strftime(cdate, sizeof(cdate), "(%Z) %Y-%m-%d %H:%M:%S", localtime(&current_tm));
+	sprintf(timestamp, "%s.%03d", cdate, (int) (current_tv.tv_usec / 1000));
+
+	fprintf(fd, "{{Timestamp=%s},{host=%s},{%s}}\n", timestamp, host, message);
+	fclose(fd);
+	return 0;
+}
 
-	// GET STRING OF MILLISECONDS
-	char ms[4];
-	sprintf(ms, "%03d", current_tv.tv_usec / 1000);
 
-	// PUT IT ALL TOGETHER TO RETURN
-	sprintf(output, "%s.%s", cdate, ms);
-	return;
+// LOGS THE REQUESTS OF ONE BENCHMARK THREAD
+void * log_bench_thread(void * arg)
+{
+	log_bench_args * args = (log_bench_args *) arg;
+	char message[LOG_MESSAGE_LENGTH];
+
+	for (int r = 0; r < args->requests; r++)
+	{
+		double start = bench_now_ms();
+		for (int l = 0; l < args->lines; l++)
+		{
+			sprintf(message, "SEND=ACCEPT_PUT(L=%d, K=%d, V=%d)", r, l, r);
+			if (args->sync)
+				log_write_sync("logbench_sync.log", "localhost", message);
+			else
+				log_write("logbench_ring.log", "localhost", message);
+		}
+		bench_record(args->the_bench, bench_now_ms() - start, 0);
+	}
+
+	return NULL;
+}
+
+
+/*******************************************************************************
+ * MEASURES THE COST OF LOGGING ONE REQUEST (LINES LOG_WRITE CALLS) FROM THE   *
+ * NUMBER OF THREADS PROVIDED, FIRST WITH THE OLD OPEN/PRINT/CLOSE PER LINE    *
+ * AND THEN WITH THE RING, AND PRINTS THE PERCENTILES OF BOTH TO OUT.          *
+ ******************************************************************************/
+void log_benchmark(int requests, int lines, int threads, FILE * out)
+{
+	int echo = log_echo;
+	log_set_echo(0);
+
+	for (int sync = 1; sync >= 0; sync--)
+	{
+		pthread_t thread[threads];
+		log_bench_args args[threads];
+		bench * total = bench_new(requests);
+		if (total == NULL)
+			return;
+
+		for (int t = 0; t < threads; t++)
+		{
+			args[t].requests  = requests / threads;
+			args[t].lines     = lines;
+			args[t].sync      = sync;
+			args[t].the_bench = bench_new(requests / threads);
+			pthread_create(&thread[t], NULL, log_bench_thread, &args[t]);
+		}
+
+		for (int t = 0; t < threads; t++)
+		{
+			pthread_join(thread[t], NULL);
+			for (int i = 0; i < args[t].the_bench->count; i++)
+				bench_record(total, args[t].the_bench->samples[i], 0);
+			bench_free(args[t].the_bench);
+		}
+
+		double start = bench_now_ms();
+		if (!sync)
+			log_flush();
+		double drained = bench_now_ms() - start;
+
+		bench_report(total, sync ? "log open/print/close" : "log ring", out);
+		if (!sync)
+			fprintf(out, "log ring: writer drained in %.2fms after the last request, dropped=%ld\n",
+					drained, log_dropped());
+		bench_free(total);
+	}
+
+	unlink("logbench_sync.log");
+	unlink("logbench_ring.log");
+	log_set_echo(echo);
 }
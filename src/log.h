@@ -1,14 +1,36 @@
-
 /*
  * log.h
  *
  *  Created on: Jan 11, 2015
  *      Author: kevanderson
+ *
+ *  log_write only copies the record into a lock-free ring buffer.  A
+ *  background thread drains the ring, formats the lines and writes them in
+ *  batches to log files that are kept open (and echoes them to the console).
  */
 
 #ifndef LOG_H
  #define LOG_H
 
+#define LOG_RING_SIZE       4096   // records in the ring, must be a power of two
+#define LOG_NAME_LENGTH     64
+#define LOG_HOST_LENGTH     128
+#define LOG_MESSAGE_LENGTH  256
+#define LOG_MAX_FILES       8
+#define LOG_BATCH_SIZE      65536  // bytes buffered per file before a write
+#define LOG_IDLE_NS         1000000  // writer sleep when the ring is empty
+#define LOG_BENCH_LINES     12     // log lines of one proposer_propose
+
+// LOG LEVELS, A LINE IS WRITTEN IF ITS LEVEL IS AT LEAST LOG_LEVEL
+#define LOG_LEVEL_TRACE     0   // every message between the servers
+#define LOG_LEVEL_DEBUG     1   // every client request and its answer
+#define LOG_LEVEL_INFO      2   // membership changes and other rare events (default)
+#define LOG_LEVEL_WARN      3   // failed requests and unreachable servers
+#define LOG_LEVEL_OFF       4
+
+// WHAT LOG_WRITE DOES WHEN THE RING IS FULL
+#define LOG_BLOCK           0   // wait for the writer to make room (default)
+#define LOG_DROP            1   // drop the record and count it
 
 #ifndef _STDIO_H_
   #include <stdio.h>
@@ -22,23 +44,108 @@
 #include <time.h>
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+extern int log_level;
 
 
 /*******************************************************************************
- * WRITES A WELL FORMED MESSAGE AND RESPONSE TO THE SERVER.LOG FILE THAT WILL  *
- * INCLUDE A TIMESTAMP OF THE WRITE.  IF THE SERVER.LOG FILE DOES NOT EXIST IT *
- * WILL BE CREATED.  IF THE FILE IS UNABLE TO BE OPENED, LOG_WRITE WILL RETURN *
- * -1 OTHERWISE WILL RETURN 0.                                                 *
+ * LEVELED LOGGING.  LOG_DEBUG("server.log", host, "RECV=GET(%d)", key) ONLY  *
+ * EVALUATES AND FORMATS ITS ARGUMENTS WHEN THE LEVEL IS ENABLED, AND THEN     *
+ * FORMATS THEM STRAIGHT INTO THE RING.  BUILDING WITH -DLOG_NO_TRACE REMOVES  *
+ * THE LOG_TRACE LINES FROM THE PROGRAM ALTOGETHER.                            *
+ ******************************************************************************/
+#define LOG_AT(level, ...) \
+	do { if ((level) >= log_level) log_writef(__VA_ARGS__); } while (0)
+
+#ifdef LOG_NO_TRACE
+  #define LOG_TRACE(...) do { } while (0)
+#else
+  #define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#endif
+#define LOG_DEBUG(...)   LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)    LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+
+
+// ONE LINE WAITING TO BE WRITTEN
+typedef struct log_record {
+	size_t sequence;                     // ring position the slot is ready for
+	struct timeval time;                 // when log_write was called
+	char filename[LOG_NAME_LENGTH];
+	char host[LOG_HOST_LENGTH];
+	char message[LOG_MESSAGE_LENGTH];
+} log_record;
+
+
+/*******************************************************************************
+ * QUEUES A WELL FORMED MESSAGE AND RESPONSE FOR THE LOG FILE PROVIDED WITH A  *
+ * TIMESTAMP OF THE CALL.  THE LINE IS WRITTEN BY THE LOG THREAD, WHICH IS     *
+ * STARTED ON THE FIRST CALL.  IF THE FILE DOES NOT EXIST IT WILL BE CREATED.  *
+ * RETURNS -1 IF THE RECORD WAS DROPPED BECAUSE THE RING WAS FULL (LOG_DROP),  *
+ * OTHERWISE 0.                                                                *
  ******************************************************************************/
 int log_write(char* filename, char * host, char * message);
 
 
+/*******************************************************************************
+ * LIKE LOG_WRITE, BUT FORMATS THE MESSAGE (PRINTF STYLE) DIRECTLY INTO THE    *
+ * RING SLOT.  USE THE LOG_TRACE ... LOG_WARN MACROS RATHER THAN CALLING IT.   *
+ ******************************************************************************/
+int log_writef(char * filename, char * host, const char * format, ...)
+	__attribute__((format(printf, 3, 4)));
+
+
+/*******************************************************************************
+ * SETS THE LOWEST LEVEL THAT IS WRITTEN.  RETURNS -1 IF THE NAME PROVIDED IS  *
+ * NOT ONE OF TRACE, DEBUG, INFO, WARN OR OFF.                                 *
+ ******************************************************************************/
+int log_set_level(char * name);
+
+
+/*******************************************************************************
+ * WAITS (AT MOST A SECOND) UNTIL EVERY RECORD QUEUED SO FAR IS WRITTEN.  IT   *
+ * IS REGISTERED WITH ATEXIT SO NOTHING IS LOST WHEN THE PROGRAM EXITS.        *
+ ******************************************************************************/
+void log_flush();
+
+
+/*******************************************************************************
+ * CHOOSES WHAT LOG_WRITE DOES WHEN THE RING IS FULL, LOG_BLOCK OR LOG_DROP.   *
+ ******************************************************************************/
+void log_set_policy(int policy);
+
+
+/*******************************************************************************
+ * TURNS THE ECHO OF EVERY LINE TO THE CONSOLE ON (1) OR OFF (0).              *
+ ******************************************************************************/
+void log_set_echo(int echo);
+
+
+/*******************************************************************************
+ * RETURNS THE NUMBER OF RECORDS DROPPED BECAUSE THE RING WAS FULL.            *
+ ******************************************************************************/
+long log_dropped();
+
+
+/*******************************************************************************
+ * MEASURES THE COST OF LOGGING ONE REQUEST (LINES LOG_WRITE CALLS) FROM THE   *
+ * NUMBER OF THREADS PROVIDED, FIRST WITH THE OLD OPEN/PRINT/CLOSE PER LINE    *
+ * AND THEN WITH THE RING, AND PRINTS THE PERCENTILES OF BOTH TO OUT.          *
+ ******************************************************************************/
+void log_benchmark(int requests, int lines, int threads, FILE * out);
+
+
 /*******************************************************************************
  * A HELPER FUNCTION THAT RETURNS A 30 CHARACTER ARRAY REPRESENTING THE        *
  * CURRENT TIME WITH MILLISECOND PRECISION.  THE TIMESTAMP IS PROVIDED IN      *
  * LOCAL TIME.  THE FORMAT OF THE TIMESTAMP IS AS FOLLOWS:                     *
  * (TMZ) YYYY-MM-DD HH:MM:SS.SSS (e.g. (PDT) 2015-01-31 23:59:52.123           *
- * FOR MILLISECOND PRECISION, POSIX IS ASSUMED.                                *
+ * FOR MILLISECOND PRECISION, POSIX IS ASSUMED.  THE DATE IS ONLY FORMATTED    *
+ * AGAIN WHEN THE SECOND CHANGES.                                              *
  ******************************************************************************/
 void buildTimeStamp(char * output);
 
@@ -21,52 +21,142 @@
  ******************************************************/
 int main(int argc, char * argv[])
 {
-	// FIRST READ THE SERVER FILE
-	int server_count;
-	char** server_list[MAX_SERVERS];
-	for(int i = 0; i < MAX_SERVERS; i++)
-		server_list[i] = malloc(HOST_NAME_LENGTH);
-
-	FILE* fd = fopen("./serverlist.txt","r");
-	if (fd == NULL)
+	// THE SIMULATOR BUILDS ITS OWN CLUSTER, IT DOESN'T NEED SERVERLIST.TXT
+	if (argc >= 2 && strcmp(argv[1], "sim") == 0)
+		return(sim_main(argc - 2, argv + 2) == 0 ? 0 : -1);
+
+	// SERVER OPTIONS: -self ENTRY  -q1 N  -q2 N  -log LEVEL  -trace FILE  -metrics PORT  -faults FILE
+	struct utsname unameData;
+	uname(&unameData);
+
+	char * self_name = unameData.nodename;
+	int prepare_quorum = PEER_MAJORITY;
+	int accept_quorum  = PEER_MAJORITY;
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-self") == 0)
+			self_name = argv[i + 1];
+		else if (strcmp(argv[i], "-q1") == 0)
+			prepare_quorum = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-q2") == 0)
+			accept_quorum = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-log") == 0 && log_set_level(argv[i + 1]) != 0)
+		{
+			printf("Unknown log level %s, use trace, debug, info, warn or off.\n", argv[i + 1]);
+			exit(-1);
+		}
+		else if (strcmp(argv[i], "-trace") == 0 && trace_open(argv[i + 1]) != 0)
+		{
+			printf("Cannot create the trace file %s\n", argv[i + 1]);
+			exit(-1);
+		}
+		else if (strcmp(argv[i], "-metrics") == 0 && metrics_start(atoi(argv[i + 1])) != 0)
+		{
+			printf("Cannot serve the metrics on port %s\n", argv[i + 1]);
+			exit(-1);
+		}
+		else if (strcmp(argv[i], "-faults") == 0 && fault_load(argv[i + 1]) != 0)
+		{
+			printf("Cannot load the faults in %s, is it built with make CFLAGS=-DFAULT_INJECTION?\n", argv[i + 1]);
+			exit(-1);
+		}
+	}
+
+	// FIRST READ THE SERVER FILE INTO THE PEER TABLE
+	peer_table * table = peer_table_load("./serverlist.txt", self_name);
+	if (table == NULL)
 	{
 		printf("Cannot find file serverlist.txt, please create the file and try again.\n");
 		exit(-1);
 	}
 
-
-	// BUILD THE STRING OF SERVER NAMES
-	int i = 0;
-	char line[HOST_NAME_LENGTH];
-	while (fgets(line, sizeof(line), fd) && i < MAX_SERVERS)
+	// EVERY PREPARE QUORUM HAS TO OVERLAP EVERY ACCEPT QUORUM
+	if (peer_quorum_set(table, prepare_quorum, accept_quorum) != 0)
 	{
-		// TRIM THE STRING -- REPLACE \N WITH \0
-		for(int j = 0; j < strlen(line); j++)
-		{
-			if (line[j] == '\n')
-			{
-				line[j] = '\0';
-				break;
-			}
-		}
-		strcpy(server_list[i], line);
-		i++;
+		printf("Invalid quorums -q1 %d -q2 %d for %d servers, both must be between 1 and %d and add up to more than %d.\n",
+				prepare_quorum, accept_quorum, table->count, table->count, table->count);
+		exit(-1);
 	}
 
-	server_count = i;
+	// THE CLIENT ONLY NEEDS THE NAMES
+	int server_count = table->count;
+	char* server_list[server_count];
+	for (int i = 0; i < server_count; i++)
+		server_list[i] = table->peers[i]->hostname;
 
 
 	//NOW VALIDATE THE ARGUMENTS AND CALL THE PROPER FUNCTION
 
 	if (argc < 2)  // MUST HAVE AT LEAST ONE ADDITIONAL ARG
 	{
-		printf("Usage: tcss558 client|server\n");
+		printf("Usage: tcss558 client|server [-self entry] [-q1 n] [-q2 n] [-log level] [-trace file] [-metrics port] [-faults file]|reconfig add|remove host|stats host [seconds] [reset]|mget host key...|mput host key value...|bench [options]|sim [options]\n");
 		exit(-1);
 	} else if (strcmp(argv[1],"server") == 0) {
 		printf("Running as Server...\n");
-		server_rpc_init(server_list, server_count);
+		if (table->self >= 0)
+			trace_set_node(table->peers[table->self]->id);
+		server_rpc_init(table);
 	} else if (strcmp(argv[1], "client") == 0) {
 		client_rpc_init(server_list, server_count);
+	} else if (strcmp(argv[1], "logbench") == 0) {
+		int requests = (argc > 2) ? atoi(argv[2]) : BENCH_DEFAULT_OPS * 10;
+		int threads  = (argc > 3) ? atoi(argv[3]) : 1;
+		if (requests < 1 || threads < 1)
+		{
+			printf("Usage: tcss558 logbench [requests] [threads]\n");
+			exit(-1);
+		}
+		log_benchmark(requests, LOG_BENCH_LINES, threads, stdout);
+	} else if (strcmp(argv[1], "reconfig") == 0 && argc == 4) {
+		if (strcmp(argv[2], "add") == 0)
+			return client_reconfig(server_list, server_count, CONFIG_ADD_NODE, argv[3]);
+		else if (strcmp(argv[2], "remove") == 0)
+			return client_reconfig(server_list, server_count, CONFIG_DEL_NODE, argv[3]);
+
+		printf("Usage: tcss558 reconfig add|remove host\n");
+		exit(-1);
+	} else if (strcmp(argv[1], "bench") == 0) {
+		return(loadgen_main(argc - 2, argv + 2, server_list, server_count) == 0 ? 0 : -1);
+	} else if (strcmp(argv[1], "stats") == 0 && argc >= 3) {
+		int interval = (argc > 3) ? atoi(argv[3]) : 0;
+		int reset    = (argc > 4 && strcmp(argv[4], "reset") == 0);
+		return client_stats(argv[2], interval, reset);
+	} else if (strcmp(argv[1], "mget") == 0 && argc >= 4 && argc - 3 <= RPC_BATCH_MAX) {
+		// EVERY KEY IN ONE RPC_MGET
+		int count = argc - 3;
+		int keys[count], values[count], results[count];
+		for (int k = 0; k < count; k++)
+			keys[k] = atoi(argv[k + 3]);
+		int found = client_mget(argv[2], count, keys, values, results);
+		if (found < 0)
+		{
+			printf("Cannot get the keys from %s\n", argv[2]);
+			return(-1);
+		}
+		for (int k = 0; k < count; k++)
+			if (results[k] == OK)
+				printf("%d = %d\n", keys[k], values[k]);
+			else
+				printf("%d not found\n", keys[k]);
+		return(found == count ? 0 : -1);
+	} else if (strcmp(argv[1], "mput") == 0 && argc >= 5 && (argc - 3) % 2 == 0 && (argc - 3) / 2 <= RPC_BATCH_MAX) {
+		// EVERY PAIR IN ONE RPC_MPUT, DECIDED TOGETHER
+		int count = (argc - 3) / 2;
+		int keys[count], values[count], results[count];
+		for (int k = 0; k < count; k++)
+		{
+			keys[k]   = atoi(argv[2 * k + 3]);
+			values[k] = atoi(argv[2 * k + 4]);
+		}
+		int put = client_mput(argv[2], count, keys, values, results);
+		if (put < 0)
+		{
+			printf("Cannot put the keys on %s\n", argv[2]);
+			return(-1);
+		}
+		for (int k = 0; k < count; k++)
+			printf("%d = %d %s\n", keys[k], values[k], results[k] == OK ? "put" : "failed");
+		return(put == count ? 0 : -1);
 	}
 
 
@@ -9,8 +9,8 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-#define MAX_SERVERS      128
-#define HOST_NAME_LENGTH 128
+#define MAX_SERVERS      PEER_MAX
+#define HOST_NAME_LENGTH PEER_HOST_LENGTH
 
 #ifndef CLIENT_H
   #include "client.h"
@@ -20,6 +20,14 @@
   #include "server.h"
 #endif
 
+#ifndef SIM_H
+  #include "sim.h"
+#endif
+
+#ifndef LOADGEN_H
+  #include "loadgen.h"
+#endif
+
 #ifndef _STDIO_H_
   #include <stdio.h>
 #endif
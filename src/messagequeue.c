@@ -16,7 +16,7 @@ messagequeue * mq_new()
 	if(to_return == NULL)
 		exit(MEMORY_ALLOCATION_ERROR);
 
-	if (pthread_mutex_init(&(to_return->lock), NULL) != 0)
+	if (lockstat_init(&(to_return->lock), "messagequeue") != 0)
 		return NULL;
 
 
@@ -30,7 +30,7 @@ messagequeue * mq_new()
 int mq_push(messagequeue * mq, char * message, char* client)
 {
 	// LOCK THE QUEUE
-	pthread_mutex_lock(&(mq->lock));
+	lockstat_acquire(&(mq->lock));
 	item * to_add = mq_item_new(message, client);
 
 	// IF THE SIZE IS ZERO YOU NEED TO ADJUST THE HEAD
@@ -44,17 +44,17 @@ int mq_push(messagequeue * mq, char * message, char* client)
 	mq->tail = to_add;
 	mq->size = mq->size + 1;
 
-	pthread_mutex_unlock(&(mq->lock));
+	lockstat_release(&(mq->lock));
 	return(0);
 }
 
 int mq_pull(messagequeue * mq, char* response, char* client)
 {
-	pthread_mutex_lock(&(mq->lock));
+	lockstat_acquire(&(mq->lock));
 
 	if (mq->size < 1)
 	{
-		pthread_mutex_unlock(&(mq->lock));
+		lockstat_release(&(mq->lock));
 		return(-1);
 	} else {
 
@@ -75,7 +75,7 @@ int mq_pull(messagequeue * mq, char* response, char* client)
 		mq->size = mq->size - 1;
 
 		free(temp);
-		pthread_mutex_unlock(&(mq->lock));
+		lockstat_release(&(mq->lock));
 
 		return (0);
 	}
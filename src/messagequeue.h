@@ -17,9 +17,13 @@
 #include <pthread.h>
 #include <string.h>
 
+#ifndef LOCKSTAT_H
+#include "lockstat.h"
+#endif
+
 
 typedef struct messagequeue {
-	pthread_mutex_t lock;
+	lockstat lock;
 
 	int size;
 	struct item * head;
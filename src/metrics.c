@@ -0,0 +1,340 @@
+/*
+ ============================================================================
+ Name        : metrics.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.20
+ Description : Prometheus metrics endpoint.  See metrics.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef METRICS_H
+#include "metrics.h"
+#endif
+
+#ifndef PEER_H
+#include "peer.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#ifndef LOG_H
+#include "log.h"
+#endif
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define METRICS_CACHE_LINE  64
+
+metrics_shard * metrics_shards = NULL;
+pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;  // the shard list
+__thread metrics_shard * metrics_mine = NULL;
+kv * metrics_store = NULL;
+int metrics_socket = -1;
+
+// UPPER BOUNDS (MICROSECONDS) OF THE PROMETHEUS HISTOGRAM BUCKETS
+uint64_t metrics_bounds_us[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+		50000, 100000, 250000, 500000, 1000000, 2500000, 5000000 };
+#define METRICS_BOUNDS  (sizeof(metrics_bounds_us) / sizeof(metrics_bounds_us[0]))
+
+metrics_shard * metrics_shard_mine();
+void * metrics_thread(void * arg);
+void metrics_add(uint64_t * counter);
+
+
+/*******************************************************************************
+ * STARTS THE HTTP THREAD ON THE PORT PROVIDED.  THE METRICS ARE SERVED FROM   *
+ * ANY PATH.  RETURNS -1 IF THE PORT CANNOT BE OPENED.                         *
+ ******************************************************************************/
+int metrics_start(int port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return(-1);
+
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port        = htons(port);
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, METRICS_BACKLOG) < 0)
+	{
+		close(fd);
+		return(-1);
+	}
+
+	metrics_socket = fd;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, metrics_thread, NULL) != 0)
+	{
+		close(fd);
+		metrics_socket = -1;
+		return(-1);
+	}
+
+	pthread_detach(thread);
+	return(0);
+}
+
+
+/*******************************************************************************
+ * SETS THE STORE WHOSE SIZE AND CAPACITY ARE REPORTED.                        *
+ ******************************************************************************/
+void metrics_watch(kv * store)
+{
+	__atomic_store_n(&metrics_store, store, __ATOMIC_RELEASE);
+}
+
+
+/*******************************************************************************
+ * COUNTS A REQUEST ANSWERED BY THIS THREAD.  TYPE IS A TRACE EVENT TYPE.      *
+ ******************************************************************************/
+void metrics_request(int type)
+{
+	metrics_shard * shard = metrics_shard_mine();
+	if (shard != NULL && type >= 0 && type < TRACE_TYPES)
+		metrics_add(&shard->requests[type]);
+}
+
+
+/*******************************************************************************
+ * COUNTS A REQUEST THAT GOT (OK = 1) OR DIDN'T GET (OK = 0) ITS QUAROMS.      *
+ ******************************************************************************/
+void metrics_quorum(int ok)
+{
+	metrics_shard * shard = metrics_shard_mine();
+	if (shard != NULL)
+		metrics_add(ok ? &shard->quorum_ok : &shard->quorum_failed);
+}
+
+
+/*******************************************************************************
+ * WRITES EVERY METRIC IN THE PROMETHEUS TEXT FORMAT TO THE FILE PROVIDED.     *
+ ******************************************************************************/
+void metrics_print(FILE * out)
+{
+	// ADD UP THE SHARDS, A SHARD IS NEVER FREED SO THE LIST CAN BE WALKED WITHOUT THE LOCK
+	metrics_shard total;
+	memset(&total, 0, sizeof(total));
+	for (metrics_shard * shard = __atomic_load_n(&metrics_shards, __ATOMIC_ACQUIRE); shard != NULL; shard = shard->next)
+	{
+		for (int t = 0; t < TRACE_TYPES; t++)
+			total.requests[t] += __atomic_load_n(&shard->requests[t], __ATOMIC_RELAXED);
+		total.quorum_ok     += __atomic_load_n(&shard->quorum_ok, __ATOMIC_RELAXED);
+		total.quorum_failed += __atomic_load_n(&shard->quorum_failed, __ATOMIC_RELAXED);
+	}
+
+	char * commands[TRACE_TYPES] = { NULL, "get", "put", "del", NULL, NULL, NULL,
+			"prepare", "accept", "learn", "reconfig", NULL, "mget", "mput" };
+
+	fprintf(out, "# HELP kvpaxos_requests_total Requests answered, by command.\n");
+	fprintf(out, "# TYPE kvpaxos_requests_total counter\n");
+	for (int t = 0; t < TRACE_TYPES; t++)
+		if (commands[t] != NULL)
+			fprintf(out, "kvpaxos_requests_total{command=\"%s\"} %llu\n", commands[t],
+					(unsigned long long) total.requests[t]);
+
+	fprintf(out, "# HELP kvpaxos_quorum_total Client requests by whether they got their quaroms.\n");
+	fprintf(out, "# TYPE kvpaxos_quorum_total counter\n");
+	fprintf(out, "kvpaxos_quorum_total{result=\"ok\"} %llu\n", (unsigned long long) total.quorum_ok);
+	fprintf(out, "kvpaxos_quorum_total{result=\"failed\"} %llu\n", (unsigned long long) total.quorum_failed);
+
+	uint64_t attempts = total.quorum_ok + total.quorum_failed;
+	fprintf(out, "# HELP kvpaxos_quorum_success_ratio Share of client requests that got their quaroms.\n");
+	fprintf(out, "# TYPE kvpaxos_quorum_success_ratio gauge\n");
+	fprintf(out, "kvpaxos_quorum_success_ratio %.6f\n", attempts > 0 ? (double) total.quorum_ok / attempts : 1.0);
+
+	// THE STORE
+	kv * store = __atomic_load_n(&metrics_store, __ATOMIC_ACQUIRE);
+	if (store != NULL)
+	{
+		fprintf(out, "# HELP kvpaxos_kv_size Keys in the store.\n");
+		fprintf(out, "# TYPE kvpaxos_kv_size gauge\n");
+		fprintf(out, "kvpaxos_kv_size %d\n", __atomic_load_n(&store->size, __ATOMIC_RELAXED));
+		fprintf(out, "# HELP kvpaxos_kv_capacity Slots allocated in the store.\n");
+		fprintf(out, "# TYPE kvpaxos_kv_capacity gauge\n");
+		fprintf(out, "kvpaxos_kv_capacity %d\n", __atomic_load_n(&store->capacity, __ATOMIC_RELAXED));
+	}
+
+#ifndef LOCKSTAT_OFF
+	// THE LOCKS
+	fprintf(out, "# HELP kvpaxos_lock_acquisitions_total Times the lock was taken.\n");
+	fprintf(out, "# TYPE kvpaxos_lock_acquisitions_total counter\n");
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+		fprintf(out, "kvpaxos_lock_acquisitions_total{lock=\"%s\"} %llu\n", lock->name,
+				(unsigned long long) __atomic_load_n(&lock->acquisitions, __ATOMIC_RELAXED));
+	fprintf(out, "# HELP kvpaxos_lock_contended_total Times the lock was already held by another thread.\n");
+	fprintf(out, "# TYPE kvpaxos_lock_contended_total counter\n");
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+		fprintf(out, "kvpaxos_lock_contended_total{lock=\"%s\"} %llu\n", lock->name,
+				(unsigned long long) __atomic_load_n(&lock->contended, __ATOMIC_RELAXED));
+	fprintf(out, "# HELP kvpaxos_lock_wait_seconds_total Time spent waiting for the lock.\n");
+	fprintf(out, "# TYPE kvpaxos_lock_wait_seconds_total counter\n");
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+		fprintf(out, "kvpaxos_lock_wait_seconds_total{lock=\"%s\"} %.9f\n", lock->name,
+				__atomic_load_n(&lock->wait_ns, __ATOMIC_RELAXED) / 1e9);
+	fprintf(out, "# HELP kvpaxos_lock_max_hold_seconds Longest time the lock was held.\n");
+	fprintf(out, "# TYPE kvpaxos_lock_max_hold_seconds gauge\n");
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+		fprintf(out, "kvpaxos_lock_max_hold_seconds{lock=\"%s\"} %.9f\n", lock->name,
+				__atomic_load_n(&lock->max_hold_ns, __ATOMIC_RELAXED) / 1e9);
+#endif
+
+	// THE PEERS
+	peer_table * table = peer_table_current();
+	if (table != NULL)
+	{
+		fprintf(out, "# HELP kvpaxos_servers Servers in the current configuration.\n");
+		fprintf(out, "# TYPE kvpaxos_servers gauge\n");
+		fprintf(out, "kvpaxos_servers %d\n", table->count);
+
+		fprintf(out, "# HELP kvpaxos_peer_rtt_seconds Smoothed round trip time to the peer.\n");
+		fprintf(out, "# TYPE kvpaxos_peer_rtt_seconds gauge\n");
+		for (int i = 0; i < table->count; i++)
+			if (!table->peers[i]->is_self)
+				fprintf(out, "kvpaxos_peer_rtt_seconds{peer=\"%s\",id=\"%d\"} %.6f\n", table->peers[i]->hostname,
+						table->peers[i]->id, table->peers[i]->rtt.srtt / 1000.0);
+
+		fprintf(out, "# HELP kvpaxos_peer_rto_seconds Timeout of a call to the peer.\n");
+		fprintf(out, "# TYPE kvpaxos_peer_rto_seconds gauge\n");
+		for (int i = 0; i < table->count; i++)
+			if (!table->peers[i]->is_self)
+				fprintf(out, "kvpaxos_peer_rto_seconds{peer=\"%s\",id=\"%d\"} %.6f\n", table->peers[i]->hostname,
+						table->peers[i]->id, table->peers[i]->rtt.rto / 1000.0);
+
+		fprintf(out, "# HELP kvpaxos_peer_phi Suspicion of the failure detector for the peer.\n");
+		fprintf(out, "# TYPE kvpaxos_peer_phi gauge\n");
+		for (int i = 0; i < table->count; i++)
+			if (!table->peers[i]->is_self)
+				fprintf(out, "kvpaxos_peer_phi{peer=\"%s\",id=\"%d\"} %.3f\n", table->peers[i]->hostname,
+						table->peers[i]->id, fd_phi(&table->peers[i]->fd));
+	}
+
+	// THE STATS COUNTERS AND HISTOGRAMS
+	for (int c = 0; c < STATS_COUNTERS; c++)
+	{
+		fprintf(out, "# TYPE kvpaxos_%s_total counter\n", stats_counter_name(c));
+		fprintf(out, "kvpaxos_%s_total %llu\n", stats_counter_name(c),
+				(unsigned long long) __atomic_load_n(&stats_counters[c], __ATOMIC_RELAXED));
+	}
+
+	fprintf(out, "# HELP kvpaxos_log_dropped_total Log lines dropped because the ring was full.\n");
+	fprintf(out, "# TYPE kvpaxos_log_dropped_total counter\n");
+	fprintf(out, "kvpaxos_log_dropped_total %ld\n", log_dropped());
+
+	fprintf(out, "# HELP kvpaxos_latency_seconds Latency of each proposer phase and rpc handler.\n");
+	fprintf(out, "# TYPE kvpaxos_latency_seconds histogram\n");
+	for (int i = 0; i < STATS_HISTOGRAMS; i++)
+	{
+		stats_histogram * h = &stats_histograms[i];
+		uint64_t cumulative = 0;
+		int bucket = 0;
+		for (int n = 0; n < (int) METRICS_BOUNDS; n++)
+		{
+			// A BUCKET COUNTS UNDER THE FIRST BOUND ITS LARGEST VALUE FITS IN
+			for (; bucket < STATS_BUCKETS && stats_bucket_high(bucket) <= metrics_bounds_us[n]; bucket++)
+				cumulative += __atomic_load_n(&h->counts[bucket], __ATOMIC_RELAXED);
+			fprintf(out, "kvpaxos_latency_seconds_bucket{phase=\"%s\",le=\"%g\"} %llu\n",
+					stats_histogram_name(i), metrics_bounds_us[n] / 1e6, (unsigned long long) cumulative);
+		}
+		for (; bucket < STATS_BUCKETS; bucket++)
+			cumulative += __atomic_load_n(&h->counts[bucket], __ATOMIC_RELAXED);
+
+		fprintf(out, "kvpaxos_latency_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n",
+				stats_histogram_name(i), (unsigned long long) cumulative);
+		fprintf(out, "kvpaxos_latency_seconds_sum{phase=\"%s\"} %.6f\n", stats_histogram_name(i),
+				__atomic_load_n(&h->sum_us, __ATOMIC_RELAXED) / 1e6);
+		fprintf(out, "kvpaxos_latency_seconds_count{phase=\"%s\"} %llu\n",
+				stats_histogram_name(i), (unsigned long long) cumulative);
+	}
+}
+
+
+// RETURNS THE SHARD OF THE CALLING THREAD, CREATING IT ON ITS FIRST CALL
+metrics_shard * metrics_shard_mine()
+{
+	metrics_shard * shard = metrics_mine;
+	if (shard != NULL)
+		return(shard);
+
+	// A LINE OF ITS OWN, SO TWO THREADS NEVER WRITE THE SAME ONE
+	size_t size = (sizeof(metrics_shard) + METRICS_CACHE_LINE - 1) / METRICS_CACHE_LINE * METRICS_CACHE_LINE;
+	if (posix_memalign((void **) &shard, METRICS_CACHE_LINE, size) != 0)
+		return(NULL);
+	memset(shard, 0, size);
+
+	pthread_mutex_lock(&metrics_lock);
+	shard->next = metrics_shards;
+	__atomic_store_n(&metrics_shards, shard, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&metrics_lock);
+
+	metrics_mine = shard;
+	return(shard);
+}
+
+
+// ADDS ONE TO A COUNTER OF THE CALLING THREAD'S SHARD, ONLY THAT THREAD WRITES IT
+void metrics_add(uint64_t * counter)
+{
+	__atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+
+// ANSWERS EVERY CONNECTION WITH THE METRICS AND CLOSES IT
+void * metrics_thread(void * arg)
+{
+	(void) arg;
+	char request[METRICS_REQUEST_LENGTH];
+
+	while (1)
+	{
+		int client = accept(metrics_socket, NULL, NULL);
+		if (client < 0)
+			continue;
+
+		// THIS IS THE ONLY THREAD, A CONNECTION THAT SENDS OR READS NOTHING MUST NOT HOLD UP THE NEXT SCRAPE
+		struct timeval timeout;
+		timeout.tv_sec  = METRICS_TIMEOUT_MS / 1000;
+		timeout.tv_usec = (METRICS_TIMEOUT_MS % 1000) * 1000;
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		// THE REQUEST ITSELF DOESN'T MATTER, EVERY PATH GETS THE METRICS
+		if (read(client, request, sizeof(request)) < 0)
+		{
+			close(client);
+			continue;
+		}
+
+		char * body = NULL;
+		size_t length = 0;
+		FILE * out = open_memstream(&body, &length);
+		if (out != NULL)
+		{
+			metrics_print(out);
+			fclose(out);
+
+			char header[256];
+			int header_length = snprintf(header, sizeof(header),
+					"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+					"Content-Length: %zu\r\nConnection: close\r\n\r\n", length);
+			write(client, header, header_length);
+			write(client, body, length);
+			free(body);
+		}
+
+		close(client);
+	}
+
+	return(NULL);
+}
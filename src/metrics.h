@@ -0,0 +1,72 @@
+/*
+ ============================================================================
+ Name        : metrics.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.20
+ Description : Metrics in the Prometheus text format, served over HTTP by a
+             : thread of its own when the server is started with -metrics
+             : port.  Request and quarom counts are kept per thread; a thread
+             : only ever writes its own shard, so the request path takes no
+             : lock and shares no cache line.  A scrape adds the shards up and
+             : reads the store, the peer table and the stats histograms.
+ ============================================================================
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#define METRICS_REQUEST_LENGTH  1024   // bytes of a scrape request that are read
+#define METRICS_BACKLOG         8
+#define METRICS_TIMEOUT_MS      1000   // longest a scrape may take to send its request or read the reply
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef KEYVALUE_H
+#include "keyvalue.h"
+#endif
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+
+// THE COUNTS OF ONE THREAD
+typedef struct metrics_shard {
+	uint64_t requests[TRACE_TYPES];  // answered requests by trace event type
+	uint64_t quorum_ok;              // requests that got their quaroms
+	uint64_t quorum_failed;          // requests that didn't
+	struct metrics_shard * next;     // every shard, so a scrape can add them up
+} metrics_shard;
+
+
+/*******************************************************************************
+ * STARTS THE HTTP THREAD ON THE PORT PROVIDED.  THE METRICS ARE SERVED FROM   *
+ * ANY PATH.  RETURNS -1 IF THE PORT CANNOT BE OPENED.                         *
+ ******************************************************************************/
+int metrics_start(int port);
+
+/*******************************************************************************
+ * SETS THE STORE WHOSE SIZE AND CAPACITY ARE REPORTED.                        *
+ ******************************************************************************/
+void metrics_watch(kv * store);
+
+/*******************************************************************************
+ * COUNTS A REQUEST ANSWERED BY THIS THREAD.  TYPE IS A TRACE EVENT TYPE.      *
+ ******************************************************************************/
+void metrics_request(int type);
+
+/*******************************************************************************
+ * COUNTS A REQUEST THAT GOT (OK = 1) OR DIDN'T GET (OK = 0) ITS QUAROMS.      *
+ ******************************************************************************/
+void metrics_quorum(int ok);
+
+/*******************************************************************************
+ * WRITES EVERY METRIC IN THE PROMETHEUS TEXT FORMAT TO THE FILE PROVIDED.     *
+ ******************************************************************************/
+void metrics_print(FILE * out);
+
+#endif /* METRICS_H */
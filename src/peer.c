@@ -0,0 +1,369 @@
+/*
+ ============================================================================
+ Name        : peer.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.15
+ Description : The table of servers in the cluster.  See peer.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef PEER_H
+#include "peer.h"
+#endif
+
+peer_table * peer_current = NULL;  // the table in use
+int peer_prepare_size = PEER_MAJORITY;  // configured phase 1 quorum
+int peer_accept_size  = PEER_MAJORITY;  // configured phase 2 quorum
+
+int peer_lookup_port(peer * the_peer, struct timeval wait);
+
+
+/*******************************************************************************
+ * READS THE SERVER FILE PROVIDED INTO A NEW TABLE, RESOLVING EVERY HOSTNAME.  *
+ * MYNAME IS MATCHED AGAINST EACH ENTRY TO FIND THE SELF INDEX (PASS NULL FOR  *
+ * A CLIENT).  RETURNS NULL IF THE FILE CANNOT BE READ OR MEMORY RUNS OUT.     *
+ ******************************************************************************/
+peer_table * peer_table_load(char * filename, char * myname)
+{
+	FILE * fd = fopen(filename, "r");
+	if (fd == NULL)
+		return NULL;
+
+	// READ THE NAMES FIRST SO THE TABLE IS ONLY AS BIG AS THE FILE
+	char names[PEER_MAX][PEER_HOST_LENGTH];
+	int count = 0;
+	char line[PEER_HOST_LENGTH];
+	while (count < PEER_MAX && fgets(line, sizeof(line), fd))
+	{
+		// TRIM THE STRING -- REPLACE \N (AND \R) WITH \0
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0')
+			continue;
+
+		strcpy(names[count], line);
+		count++;
+	}
+	fclose(fd);
+
+	peer_table * table = peer_table_new(count);
+	if (table == NULL)
+		return NULL;
+
+	for (int i = 0; i < count; i++)
+	{
+		table->peers[i] = peer_new(i, names[i], myname);
+		if (table->peers[i] == NULL)
+		{
+			// NO THREAD HAS SEEN THE TABLE OR ITS PEERS YET
+			for (int j = 0; j < i; j++)
+				free(table->peers[j]);
+			free(table);
+			return NULL;
+		}
+
+		if (table->peers[i]->is_self)
+			table->self = i;
+	}
+
+	return table;
+}
+
+
+/*******************************************************************************
+ * ALLOCATES AN EMPTY TABLE WITH ROOM FOR COUNT PEERS AND THE QUORUM SIZES SET *
+ * BY PEER_QUORUM_SET.  RETURNS NULL IF THE MEMORY ALLOCATION FAILS.           *
+ ******************************************************************************/
+peer_table * peer_table_new(int count)
+{
+	peer_table * table = (peer_table *) malloc(sizeof(peer_table) + sizeof(peer *) * count);
+	if (table == NULL)
+		return NULL;
+
+	table->count   = count;
+	table->self    = -1;
+	table->retired = NULL;
+
+	int majority = (count / 2) + 1;
+	table->accept_quorum  = (peer_accept_size == PEER_MAJORITY) ? majority : peer_accept_size;
+	table->prepare_quorum = (peer_prepare_size == PEER_MAJORITY) ? majority : peer_prepare_size;
+	if (table->accept_quorum > count)
+		table->accept_quorum = count;
+	if (table->prepare_quorum > count)
+		table->prepare_quorum = count;
+
+	// THE TWO QUORUMS MUST STILL OVERLAP AFTER A MEMBERSHIP CHANGE
+	if (table->prepare_quorum + table->accept_quorum <= count)
+		table->prepare_quorum = count - table->accept_quorum + 1;
+
+	// A READ COMPARES WHAT THE LEARNERS APPLIED, NOT WHAT THE ACCEPTORS ACCEPTED, SO -q1 DOESN'T APPLY
+	table->read_quorum = majority;
+	table->learn_quorum = count - majority + 1;  // SO EVERY READ QUORUM HAS ONE OF THEM
+
+	for (int i = 0; i < count; i++)
+		table->peers[i] = NULL;
+
+	return table;
+}
+
+
+/*******************************************************************************
+ * SETS THE PHASE 1 (PREPARE) AND PHASE 2 (ACCEPT) QUORUM SIZES OF THE TABLE  *
+ * AND OF EVERY TABLE BUILT FROM IT (FLEXIBLE PAXOS).  PEER_MAJORITY KEEPS A   *
+ * SIMPLE MAJORITY.  EVERY PREPARE QUORUM MUST OVERLAP EVERY ACCEPT QUORUM, SO *
+ * RETURNS -1 WITHOUT CHANGING ANYTHING UNLESS PREPARE + ACCEPT > COUNT AND    *
+ * BOTH ARE BETWEEN 1 AND COUNT.  WHEN THE MEMBERSHIP CHANGES THE ACCEPT SIZE  *
+ * IS KEPT AND THE PREPARE SIZE GROWS IF IT HAS TO.                            *
+ ******************************************************************************/
+int peer_quorum_set(peer_table * table, int prepare, int accept)
+{
+	int count = table->count;
+	int majority = (count / 2) + 1;
+	int p = (prepare == PEER_MAJORITY) ? majority : prepare;
+	int a = (accept == PEER_MAJORITY) ? majority : accept;
+
+	if (p < 1 || p > count || a < 1 || a > count || p + a <= count)
+		return(-1);
+
+	peer_prepare_size = prepare;
+	peer_accept_size  = accept;
+	table->prepare_quorum = p;
+	table->accept_quorum  = a;
+	return(0);
+}
+
+
+/*******************************************************************************
+ * SPLITS A SERVER ENTRY OF THE FORM HOST OR HOST:INSTANCE.  COPIES THE HOST   *
+ * INTO HOST (PEER_HOST_LENGTH BYTES) AND RETURNS THE RPC PROGRAM NUMBER OF    *
+ * THE INSTANCE, RPC_PROG_NUM WHEN NO INSTANCE IS GIVEN.                       *
+ ******************************************************************************/
+unsigned long peer_parse_entry(char * entry, char * host)
+{
+	strncpy(host, entry, PEER_HOST_LENGTH - 1);
+	host[PEER_HOST_LENGTH - 1] = '\0';
+
+	char * colon = strchr(host, ':');
+	if (colon == NULL)
+		return(RPC_PROG_NUM);
+
+	*colon = '\0';
+	return(RPC_PROG_NUM + strtoul(colon + 1, NULL, 10));
+}
+
+
+/*******************************************************************************
+ * ALLOCATES AND RESOLVES A NEW PEER.  RETURNS NULL IF THE MEMORY ALLOCATION   *
+ * FAILS.  A HOSTNAME THAT DOES NOT RESOLVE IS KEPT AS PEER_UNRESOLVED AND IS  *
+ * LOOKED UP BY NAME WHEN IT IS CONTACTED.                                     *
+ ******************************************************************************/
+peer * peer_new(int id, char * hostname, char * myname)
+{
+	peer * the_peer = (peer *) calloc(1, sizeof(peer));
+	if (the_peer == NULL)
+		return NULL;
+
+	the_peer->id = id;
+	strncpy(the_peer->hostname, hostname, PEER_HOST_LENGTH - 1);
+	the_peer->is_self = (myname != NULL && strcmp(myname, hostname) == 0);
+	the_peer->handle  = NULL;
+	rtt_init(&the_peer->rtt);
+	fd_reset(&the_peer->fd);
+	handoff_init(&the_peer->missed);
+
+	// THE INSTANCE ONLY CHOOSES THE PROGRAM, THE HOST IS RESOLVED
+	char host[PEER_HOST_LENGTH];
+	the_peer->program = peer_parse_entry(hostname, host);
+
+	// RESOLVE THE NAME ONCE, NOT ON EVERY CALL
+	struct addrinfo hints;
+	struct addrinfo * result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (getaddrinfo(host, NULL, &hints, &result) == 0)
+	{
+		memcpy(&the_peer->addr, result->ai_addr, sizeof(struct sockaddr_in));
+		the_peer->addr.sin_port = 0;  // THE PORT COMES FROM THE PORTMAPPER
+		the_peer->resolved = PEER_RESOLVED;
+		freeaddrinfo(result);
+	} else {
+		the_peer->resolved = PEER_UNRESOLVED;
+	}
+
+	return the_peer;
+}
+
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TABLE.  A CALLER SHOULD LOAD IT ONCE PER REQUEST AND    *
+ * USE THAT SNAPSHOT FOR THE WHOLE REQUEST.                                    *
+ ******************************************************************************/
+peer_table * peer_table_current()
+{
+	return __atomic_load_n(&peer_current, __ATOMIC_ACQUIRE);
+}
+
+
+/*******************************************************************************
+ * ATOMICALLY REPLACES THE CURRENT TABLE WITH THE ONE PROVIDED.  THE HEARTBEAT *
+ * AND METRICS THREADS READ A SNAPSHOT WHENEVER THEY LIKE, SO THE OLD TABLE IS *
+ * NEVER FREED, ONLY CHAINED TO THE NEW ONE: A TABLE IS A FEW HUNDRED BYTES    *
+ * AND THE MEMBERSHIP RARELY CHANGES.  PEERS ARE SHARED BETWEEN TABLES AND ARE *
+ * NEVER FREED EITHER.                                                         *
+ ******************************************************************************/
+void peer_table_swap(peer_table * table)
+{
+	table->retired = __atomic_exchange_n(&peer_current, table, __ATOMIC_ACQ_REL);
+}
+
+
+/*******************************************************************************
+ * MAKES THE TABLE PROVIDED THE CURRENT ONE WITHOUT RETIRING THE OLD ONE.  THE *
+ * SIMULATOR SWITCHES BETWEEN THE TABLES OF ITS SERVERS WITH IT AND FREES THEM *
+ * ITSELF.                                                                     *
+ ******************************************************************************/
+void peer_table_use(peer_table * table)
+{
+	__atomic_store_n(&peer_current, table, __ATOMIC_RELEASE);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE PEER WITH THE NODE ID PROVIDED, -1 IF IT IS NOT IN *
+ * THE TABLE.                                                                  *
+ ******************************************************************************/
+int peer_table_find(peer_table * table, int id)
+{
+	for (int i = 0; i < table->count; i++)
+	{
+		if (table->peers[i]->id == id)
+			return(i);
+	}
+
+	return(-1);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NODE ID OF THE LOCAL SERVER, RPC_NO_HINT IF IT IS NOT IN THE    *
+ * TABLE.                                                                      *
+ ******************************************************************************/
+int peer_table_self_id(peer_table * table)
+{
+	if (table->self < 0)
+		return(RPC_NO_HINT);
+	return(table->peers[table->self]->id);
+}
+
+
+/*******************************************************************************
+ * CREATES AN RPC HANDLE FOR THE PEER FROM ITS RESOLVED ADDRESS.  THE PORT IS  *
+ * ASKED OF ITS PORTMAPPER ONCE, WAITING AT MOST TIMEOUT MS, AND KEPT, SO A    *
+ * NEW HANDLE COSTS NO ROUND TRIP UNTIL PEER_FORGET_PORT.  AN UNRESOLVED PEER  *
+ * IS LOOKED UP BY NAME WITH NO BOUND.  RETURNS NULL IF THE SERVER CANNOT BE   *
+ * REACHED.                                                                    *
+ ******************************************************************************/
+CLIENT * peer_connect(peer * the_peer, double timeout)
+{
+	if (the_peer->resolved != PEER_RESOLVED)
+	{
+		char host[PEER_HOST_LENGTH];
+		peer_parse_entry(the_peer->hostname, host);
+		return clnt_create(host, the_peer->program, RPC_PROC_VER, "udp");
+	}
+
+	struct timeval wait;
+	wait.tv_sec  = (long) timeout / 1000;
+	wait.tv_usec = ((long) (timeout * 1000)) % 1000000;
+
+	// THE HEARTBEAT, CATCH-UP AND RPC THREADS ALL CONNECT, A PORT IS WRITTEN WHOLE
+	int port = __atomic_load_n(&the_peer->port, __ATOMIC_ACQUIRE);
+	if (port == 0)
+	{
+		port = peer_lookup_port(the_peer, wait);
+		if (port == 0)
+			return(NULL);
+		__atomic_store_n(&the_peer->port, port, __ATOMIC_RELEASE);
+	}
+
+	// WITH THE PORT SET CLNTUDP_CREATE DOESN'T ASK THE PORTMAPPER
+	struct sockaddr_in addr = the_peer->addr;
+	addr.sin_port = (in_port_t) port;
+	int sock = RPC_ANYSOCK;
+
+	return clntudp_create(&addr, the_peer->program, RPC_PROC_VER, wait, &sock);
+}
+
+
+/*******************************************************************************
+ * DROPS THE PORT KEPT FOR THE PEER, THE NEXT PEER_CONNECT ASKS ITS PORTMAPPER *
+ * AGAIN.  FOR A PEER THAT MAY HAVE RESTARTED ON ANOTHER PORT.                 *
+ ******************************************************************************/
+void peer_forget_port(peer * the_peer)
+{
+	__atomic_store_n(&the_peer->port, 0, __ATOMIC_RELEASE);
+}
+
+
+/*******************************************************************************
+ * RECORDS THAT THE PEER HAS GRANTED A READ LEASE OF LEASE_MS, AS IT SAID AT   *
+ * NOW (FD_NOW_MS).  THE LATEST EXPIRY HEARD OF IS KEPT.                       *
+ ******************************************************************************/
+void peer_lease_seen(peer * the_peer, int lease_ms, double now)
+{
+	if (lease_ms <= 0)
+		return;
+
+	// THE HEARTBEAT THREAD AND THE RPC THREAD BOTH REPORT, AN EARLIER EXPIRY NEVER REPLACES A LATER ONE
+	double until = now + lease_ms;
+	double seen;
+	__atomic_load(&the_peer->leased_until, &seen, __ATOMIC_ACQUIRE);
+	while (until > seen && !__atomic_compare_exchange(&the_peer->leased_until, &seen, &until, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		;
+}
+
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT OF THE LONGEST READ LEASE THE PEER SAID IT GRANTED, 0   *
+ * IF IT HAS RUN OUT OR THERE WAS NONE.                                        *
+ ******************************************************************************/
+int peer_lease_left(peer * the_peer, double now)
+{
+	double until;
+	__atomic_load(&the_peer->leased_until, &until, __ATOMIC_ACQUIRE);
+	if (until <= now)
+		return(0);
+	return((int) (until - now) + 1);  // ROUNDED UP, A WRITER NEVER WAITS TOO LITTLE
+}
+
+
+// ASKS THE PORTMAPPER OF THE PEER FOR ITS PORT (NETWORK ORDER) LIKE PMAP_GETPORT, BUT GIVES UP AFTER WAIT.  0 IF IT DIDN'T ANSWER
+int peer_lookup_port(peer * the_peer, struct timeval wait)
+{
+	struct sockaddr_in addr = the_peer->addr;
+	addr.sin_port = htons(PMAPPORT);
+	int sock = RPC_ANYSOCK;
+	CLIENT * portmapper = clntudp_create(&addr, PMAPPROG, PMAPVERS, wait, &sock);
+	if (portmapper == NULL)
+		return(0);
+
+	struct pmap query;
+	query.pm_prog = the_peer->program;
+	query.pm_vers = RPC_PROC_VER;
+	query.pm_prot = IPPROTO_UDP;
+	query.pm_port = 0;
+	u_long port = 0;
+
+	enum clnt_stat status = clnt_call(portmapper, PMAPPROC_GETPORT,
+			(xdrproc_t) xdr_pmap, (caddr_t) &query,
+			(xdrproc_t) xdr_u_long, (caddr_t) &port,
+			wait);
+	clnt_destroy(portmapper);
+
+	if (status != RPC_SUCCESS || port == 0 || port > 0xFFFF)
+		return(0);
+	return((int) htons((uint16_t) port));
+}
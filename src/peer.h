@@ -0,0 +1,181 @@
+/*
+ ============================================================================
+ Name        : peer.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.15
+ Description : The table of servers in the cluster.  serverlist.txt is read
+             : once into a compact table with the resolved address, node id,
+             : rpc handle, round trip estimate and failure detector state of
+             : every server, and the index of this server is found once.
+             : The current table is swapped atomically when the membership
+             : changes.  An entry may be written host:instance to run several
+             : servers on one host, each instance uses its own rpc program.
+ ============================================================================
+ */
+
+#ifndef PEER_H
+#define PEER_H
+
+#define PEER_MAX             128
+#define PEER_HOST_LENGTH     128
+#define PEER_RESOLVED        1
+#define PEER_UNRESOLVED      0
+#define PEER_MAJORITY        0   // quorum size that means a simple majority
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <rpc/rpc.h>
+#include <rpc/pmap_prot.h>
+
+#ifndef XDRCONV_H
+  #include "xdrconv.h"
+#endif
+
+#ifndef DETECTOR_H
+  #include "detector.h"
+#endif
+
+#ifndef RTT_H
+  #include "rtt.h"
+#endif
+
+#ifndef HANDOFF_H
+  #include "handoff.h"
+#endif
+
+
+// A SINGLE SERVER OF THE CLUSTER
+typedef struct peer {
+	int id;                           // node id, the line of the server in serverlist.txt
+	char hostname[PEER_HOST_LENGTH];  // name as written in serverlist.txt
+	unsigned long program;            // rpc program, RPC_PROG_NUM + the instance
+	struct sockaddr_in addr;          // address resolved when the table was loaded
+	int resolved;                     // PEER_RESOLVED if addr is valid
+	int port;                         // rpc port from its portmapper (network order), 0 until looked up
+	int is_self;                      // 1 if this entry is the local server
+	int removed;                      // 1 once the server has left the cluster
+	CLIENT * handle;                  // cached rpc handle used by the proposer
+	rtt_state rtt;                    // round trip estimate used for the timeouts
+	fd_state fd;                      // failure detector state
+	handoff_table missed;             // writes it missed, sent again by its heartbeat thread
+	int catching_up;                  // 1 while a catch-up copies my store to it
+	double clean_ms;                  // when its last ping said it held none of the writes I missed, 0 if never
+	double leased_until;              // when the longest read lease it said it granted runs out, 0 if none
+} peer;
+
+// AN IMMUTABLE SNAPSHOT OF THE CLUSTER MEMBERSHIP
+typedef struct peer_table {
+	int count;           // number of servers
+	int self;            // index of the local server, -1 if it is not in the table
+	int prepare_quorum;  // promises needed in phase 1
+	int accept_quorum;   // accepts needed in phase 2
+	int read_quorum;     // matching applied values a GET needs, always a majority
+	int learn_quorum;    // learners that must apply a write before it is acknowledged
+	struct peer_table * retired;  // the table this one replaced, never freed (see peer_table_swap)
+	peer * peers[];      // the servers, in serverlist.txt order
+} peer_table;
+
+
+/*******************************************************************************
+ * READS THE SERVER FILE PROVIDED INTO A NEW TABLE, RESOLVING EVERY HOSTNAME.  *
+ * MYNAME IS MATCHED AGAINST EACH ENTRY TO FIND THE SELF INDEX (PASS NULL FOR  *
+ * A CLIENT).  RETURNS NULL IF THE FILE CANNOT BE READ OR MEMORY RUNS OUT.     *
+ ******************************************************************************/
+peer_table * peer_table_load(char * filename, char * myname);
+
+/*******************************************************************************
+ * ALLOCATES AN EMPTY TABLE WITH ROOM FOR COUNT PEERS AND THE QUORUM SIZES SET *
+ * BY PEER_QUORUM_SET.  RETURNS NULL IF THE MEMORY ALLOCATION FAILS.           *
+ ******************************************************************************/
+peer_table * peer_table_new(int count);
+
+/*******************************************************************************
+ * SETS THE PHASE 1 (PREPARE) AND PHASE 2 (ACCEPT) QUORUM SIZES OF THE TABLE  *
+ * AND OF EVERY TABLE BUILT FROM IT (FLEXIBLE PAXOS).  PEER_MAJORITY KEEPS A   *
+ * SIMPLE MAJORITY.  EVERY PREPARE QUORUM MUST OVERLAP EVERY ACCEPT QUORUM, SO *
+ * RETURNS -1 WITHOUT CHANGING ANYTHING UNLESS PREPARE + ACCEPT > COUNT AND    *
+ * BOTH ARE BETWEEN 1 AND COUNT.  WHEN THE MEMBERSHIP CHANGES THE ACCEPT SIZE  *
+ * IS KEPT AND THE PREPARE SIZE GROWS IF IT HAS TO.                            *
+ ******************************************************************************/
+int peer_quorum_set(peer_table * table, int prepare, int accept);
+
+/*******************************************************************************
+ * SPLITS A SERVER ENTRY OF THE FORM HOST OR HOST:INSTANCE.  COPIES THE HOST   *
+ * INTO HOST (PEER_HOST_LENGTH BYTES) AND RETURNS THE RPC PROGRAM NUMBER OF    *
+ * THE INSTANCE, RPC_PROG_NUM WHEN NO INSTANCE IS GIVEN.                       *
+ ******************************************************************************/
+unsigned long peer_parse_entry(char * entry, char * host);
+
+/*******************************************************************************
+ * ALLOCATES AND RESOLVES A NEW PEER.  RETURNS NULL IF THE MEMORY ALLOCATION   *
+ * FAILS.  A HOSTNAME THAT DOES NOT RESOLVE IS KEPT AS PEER_UNRESOLVED AND IS  *
+ * LOOKED UP BY NAME WHEN IT IS CONTACTED.                                     *
+ ******************************************************************************/
+peer * peer_new(int id, char * hostname, char * myname);
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TABLE.  A CALLER SHOULD LOAD IT ONCE PER REQUEST AND    *
+ * USE THAT SNAPSHOT FOR THE WHOLE REQUEST.                                    *
+ ******************************************************************************/
+peer_table * peer_table_current();
+
+/*******************************************************************************
+ * ATOMICALLY REPLACES THE CURRENT TABLE WITH THE ONE PROVIDED.  THE HEARTBEAT *
+ * AND METRICS THREADS READ A SNAPSHOT WHENEVER THEY LIKE, SO THE OLD TABLE IS *
+ * NEVER FREED, ONLY CHAINED TO THE NEW ONE: A TABLE IS A FEW HUNDRED BYTES    *
+ * AND THE MEMBERSHIP RARELY CHANGES.  PEERS ARE SHARED BETWEEN TABLES AND ARE *
+ * NEVER FREED EITHER.                                                         *
+ ******************************************************************************/
+void peer_table_swap(peer_table * table);
+
+/*******************************************************************************
+ * MAKES THE TABLE PROVIDED THE CURRENT ONE WITHOUT RETIRING THE OLD ONE.  THE *
+ * SIMULATOR SWITCHES BETWEEN THE TABLES OF ITS SERVERS WITH IT AND FREES THEM *
+ * ITSELF.                                                                     *
+ ******************************************************************************/
+void peer_table_use(peer_table * table);
+
+/*******************************************************************************
+ * RETURNS THE INDEX OF THE PEER WITH THE NODE ID PROVIDED, -1 IF IT IS NOT IN *
+ * THE TABLE.                                                                  *
+ ******************************************************************************/
+int peer_table_find(peer_table * table, int id);
+
+/*******************************************************************************
+ * RETURNS THE NODE ID OF THE LOCAL SERVER, RPC_NO_HINT IF IT IS NOT IN THE    *
+ * TABLE.                                                                      *
+ ******************************************************************************/
+int peer_table_self_id(peer_table * table);
+
+/*******************************************************************************
+ * CREATES AN RPC HANDLE FOR THE PEER FROM ITS RESOLVED ADDRESS.  THE PORT IS  *
+ * ASKED OF ITS PORTMAPPER ONCE, WAITING AT MOST TIMEOUT MS, AND KEPT, SO A    *
+ * NEW HANDLE COSTS NO ROUND TRIP UNTIL PEER_FORGET_PORT.  AN UNRESOLVED PEER  *
+ * IS LOOKED UP BY NAME WITH NO BOUND.  RETURNS NULL IF THE SERVER CANNOT BE   *
+ * REACHED.                                                                    *
+ ******************************************************************************/
+CLIENT * peer_connect(peer * the_peer, double timeout);
+
+/*******************************************************************************
+ * DROPS THE PORT KEPT FOR THE PEER, THE NEXT PEER_CONNECT ASKS ITS PORTMAPPER *
+ * AGAIN.  FOR A PEER THAT MAY HAVE RESTARTED ON ANOTHER PORT.                 *
+ ******************************************************************************/
+void peer_forget_port(peer * the_peer);
+
+/*******************************************************************************
+ * RECORDS THAT THE PEER HAS GRANTED A READ LEASE OF LEASE_MS, AS IT SAID AT   *
+ * NOW (FD_NOW_MS).  THE LATEST EXPIRY HEARD OF IS KEPT.                       *
+ ******************************************************************************/
+void peer_lease_seen(peer * the_peer, int lease_ms, double now);
+
+/*******************************************************************************
+ * RETURNS THE MS LEFT OF THE LONGEST READ LEASE THE PEER SAID IT GRANTED, 0   *
+ * IF IT HAS RUN OUT OR THERE WAS NONE.                                        *
+ ******************************************************************************/
+int peer_lease_left(peer * the_peer, double now);
+
+#endif /* PEER_H */
@@ -0,0 +1,299 @@
+/*
+ ============================================================================
+ Name        : replay.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.08
+ Description : Workload files.  See replay.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef REPLAY_H
+#include "replay.h"
+#endif
+
+int replay_capture_trace(replay_workload * workload, FILE * fd);
+int replay_capture_log(replay_workload * workload, FILE * fd);
+int replay_command(char * name);
+int replay_by_offset(const void * a, const void * b);
+
+
+/*******************************************************************************
+ * RETURNS A NEW EMPTY WORKLOAD, OR NULL IF THERE IS NO MEMORY.                *
+ ******************************************************************************/
+replay_workload * replay_new()
+{
+	replay_workload * workload = (replay_workload *) calloc(1, sizeof(replay_workload));
+	if (workload == NULL)
+		return(NULL);
+
+	workload->capacity = REPLAY_INITIAL_OPS;
+	workload->ops = (replay_op *) malloc(sizeof(replay_op) * workload->capacity);
+	if (workload->ops == NULL)
+	{
+		free(workload);
+		return(NULL);
+	}
+	return(workload);
+}
+
+
+/*******************************************************************************
+ * FREES THE WORKLOAD.                                                         *
+ ******************************************************************************/
+void replay_free(replay_workload * workload)
+{
+	if (workload == NULL)
+		return;
+	free(workload->ops);
+	free(workload);
+}
+
+
+/*******************************************************************************
+ * ADDS AN OPERATION SENT AT TIME_MS (ANY CLOCK, IN MS) TO THE SERVER NAMED.   *
+ * RETURNS -1 IF THERE IS NO MEMORY.                                           *
+ ******************************************************************************/
+int replay_add(replay_workload * workload, double time_ms, int command, int key, int value, char * server)
+{
+	if (workload->count == workload->capacity)
+	{
+		replay_op * bigger = (replay_op *) realloc(workload->ops, sizeof(replay_op) * workload->capacity * 2);
+		if (bigger == NULL)
+			return(-1);
+		workload->ops = bigger;
+		workload->capacity *= 2;
+	}
+
+	replay_op * op = &workload->ops[workload->count++];
+	op->offset_ms = time_ms;
+	op->command   = command;
+	op->key       = key;
+	op->value     = (command == RPC_PUT) ? value : 0;
+	strncpy(op->server, server, REPLAY_SERVER_LENGTH - 1);
+	op->server[REPLAY_SERVER_LENGTH - 1] = '\0';
+	return(0);
+}
+
+
+/*******************************************************************************
+ * SORTS THE OPERATIONS BY TIME AND MAKES THEIR TIMES OFFSETS FROM THE FIRST.  *
+ * CALL IT ONCE ALL THE CAPTURES ARE ADDED.                                    *
+ ******************************************************************************/
+void replay_finish(replay_workload * workload)
+{
+	if (workload->count == 0)
+		return;
+	qsort(workload->ops, workload->count, sizeof(replay_op), replay_by_offset);
+	double first = workload->ops[0].offset_ms;
+	for (int i = 0; i < workload->count; i++)
+		workload->ops[i].offset_ms -= first;
+}
+
+
+/*******************************************************************************
+ * ADDS THE OPERATIONS OF A CAPTURE: A BINARY TRACE OF A SERVER (ITS ANSWERED  *
+ * GETS, PUTS AND DELS, FROM WHEN THEY WERE RECEIVED) OR A CLIENT.LOG (ITS     *
+ * SENT= LINES).  RETURNS -1 IF THE FILE CANNOT BE READ OR THERE IS NO MEMORY. *
+ ******************************************************************************/
+int replay_capture(replay_workload * workload, char * filename)
+{
+	FILE * fd = fopen(filename, "rb");
+	if (fd == NULL)
+	{
+		printf("Cannot open %s\n", filename);
+		return(-1);
+	}
+
+	// A TRACE STARTS WITH ITS MAGIC, ANYTHING ELSE IS READ AS A LOG
+	char magic[sizeof(((trace_header *) NULL)->magic)];
+	int is_trace = (fread(magic, sizeof(magic), 1, fd) == 1 && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0);
+	fclose(fd);
+
+	fd = is_trace ? trace_read_open(filename) : fopen(filename, "r");
+	if (fd == NULL)
+		return(-1);
+	int result = is_trace ? replay_capture_trace(workload, fd) : replay_capture_log(workload, fd);
+	fclose(fd);
+	return(result);
+}
+
+
+/*******************************************************************************
+ * WRITES THE WORKLOAD TO THE FILE PROVIDED, STDOUT IF IT IS NULL.  RETURNS -1 *
+ * IF THE FILE CANNOT BE WRITTEN.                                              *
+ ******************************************************************************/
+int replay_save(replay_workload * workload, char * filename)
+{
+	FILE * fd = (filename == NULL) ? stdout : fopen(filename, "w");
+	if (fd == NULL)
+		return(-1);
+
+	fprintf(fd, "%s: offset_ms command key value server\n", REPLAY_HEADER);
+	for (int i = 0; i < workload->count; i++)
+	{
+		replay_op * op = &workload->ops[i];
+		fprintf(fd, "%.3f %s %d %d %s\n", op->offset_ms, replay_command_name(op->command), op->key, op->value, op->server);
+	}
+
+	if (filename == NULL)
+		return(fflush(fd) == 0 ? 0 : -1);
+	return(fclose(fd) == 0 ? 0 : -1);
+}
+
+
+/*******************************************************************************
+ * READS A WORKLOAD FILE, SORTED BY OFFSET.  RETURNS NULL (WITH A MESSAGE      *
+ * PRINTED) IF IT CANNOT BE READ OR A LINE IS BAD.                             *
+ ******************************************************************************/
+replay_workload * replay_load(char * filename)
+{
+	FILE * fd = fopen(filename, "r");
+	if (fd == NULL)
+	{
+		printf("Cannot open %s\n", filename);
+		return(NULL);
+	}
+
+	replay_workload * workload = replay_new();
+	char line[64 + REPLAY_SERVER_LENGTH];
+	int number = 0;
+	while (workload != NULL && fgets(line, sizeof(line), fd) != NULL)
+	{
+		number++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		double offset;
+		char command[8];
+		char server[REPLAY_SERVER_LENGTH];
+		int key, value;
+		if (sscanf(line, "%lf %7s %d %d %127s", &offset, command, &key, &value, server) != 5
+		||  replay_command(command) < 0 || offset < 0)
+		{
+			printf("%s:%d is not an operation of a workload\n", filename, number);
+			replay_free(workload);
+			workload = NULL;
+		}
+		else if (replay_add(workload, offset, replay_command(command), key, value, server) != 0)
+		{
+			replay_free(workload);
+			workload = NULL;
+		}
+	}
+	fclose(fd);
+
+	// A FILE EDITED BY HAND MAY BE OUT OF ORDER, THE OFFSETS STAY AS THEY ARE
+	if (workload != NULL)
+		qsort(workload->ops, workload->count, sizeof(replay_op), replay_by_offset);
+	return(workload);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE COMMAND (GET, PUT OR DEL), OR NULL IF IT IS NONE OF *
+ * THEM.                                                                       *
+ ******************************************************************************/
+char * replay_command_name(int command)
+{
+	switch (command)
+	{
+	case RPC_GET: return("GET");
+	case RPC_PUT: return("PUT");
+	case RPC_DEL: return("DEL");
+	}
+	return(NULL);
+}
+
+
+// THE GETS, PUTS AND DELS A SERVER ANSWERED, AT WHEN IT RECEIVED THEM (THE END MINUS THE LATENCY)
+int replay_capture_trace(replay_workload * workload, FILE * fd)
+{
+	trace_event event;
+	while (fread(&event, sizeof(event), 1, fd) == 1)
+	{
+		int command = (event.type == TRACE_GET) ? RPC_GET : (event.type == TRACE_PUT) ? RPC_PUT
+				: (event.type == TRACE_DEL) ? RPC_DEL : -1;
+		if (command < 0)
+		{
+			// THE KEYS OF AN MGET OR MPUT ARE NOT IN THE TRACE, ONLY HOW MANY THERE WERE
+			if (event.type == TRACE_MGET || event.type == TRACE_MPUT)
+				workload->skipped++;
+			continue;
+		}
+
+		char server[REPLAY_SERVER_LENGTH];
+		if (event.node < 0)
+			strcpy(server, REPLAY_ANY_SERVER);
+		else
+			sprintf(server, "%d", event.node);
+		double started = event.time_ns / 1e6 - event.latency_us / 1e3;
+		if (replay_add(workload, started, command, event.key, event.value, server) != 0)
+			return(-1);
+	}
+	return(0);
+}
+
+
+// THE SENT= LINES OF A CLIENT.LOG, {{Timestamp=(ZONE) YYYY-MM-DD HH:MM:SS.MMM},{host=HOST},{SENT=PUT(K,V)}}
+int replay_capture_log(replay_workload * workload, FILE * fd)
+{
+	char line[1024];
+	char host[REPLAY_SERVER_LENGTH];
+	char message[512];
+	while (fgets(line, sizeof(line), fd) != NULL)
+	{
+		struct tm when;
+		int ms;
+		memset(&when, 0, sizeof(when));
+		if (sscanf(line, "{{Timestamp=(%*[^)]) %d-%d-%d %d:%d:%d.%d},{host=%127[^}]},{%511[^}]}}",
+				&when.tm_year, &when.tm_mon, &when.tm_mday, &when.tm_hour, &when.tm_min, &when.tm_sec,
+				&ms, host, message) != 9 || strncmp(message, "SENT=", 5) != 0)
+			continue;
+
+		int key, value = 0;
+		int command = -1;
+		if (sscanf(message, "SENT=PUT(%d,%d)", &key, &value) == 2)
+			command = RPC_PUT;
+		else if (sscanf(message, "SENT=GET(%d)", &key) == 1)
+			command = RPC_GET;
+		else if (sscanf(message, "SENT=DEL(%d)", &key) == 1)
+			command = RPC_DEL;
+
+		if (command < 0)
+		{
+			workload->skipped++;  // AN MGET, MPUT OR RECONFIG
+			continue;
+		}
+
+		// THE LOG IS IN LOCAL TIME, ONLY THE DIFFERENCES MATTER
+		when.tm_year -= 1900;
+		when.tm_mon  -= 1;
+		when.tm_isdst = -1;
+		double time_ms = (double) mktime(&when) * 1000.0 + ms;
+		if (replay_add(workload, time_ms, command, key, value, host) != 0)
+			return(-1);
+	}
+	return(0);
+}
+
+
+// RPC_GET, RPC_PUT OR RPC_DEL OF THE NAME, -1 IF IT IS NONE OF THEM
+int replay_command(char * name)
+{
+	int commands[3] = { RPC_GET, RPC_PUT, RPC_DEL };
+	for (int c = 0; c < 3; c++)
+		if (strcmp(name, replay_command_name(commands[c])) == 0)
+			return(commands[c]);
+	return(-1);
+}
+
+
+// QSORT ORDER OF THE OPERATIONS, BY TIME, KEEPING THE ORDER OF A FILE FOR EQUAL TIMES AS WELL AS QSORT CAN
+int replay_by_offset(const void * a, const void * b)
+{
+	double x = ((replay_op *) a)->offset_ms;
+	double y = ((replay_op *) b)->offset_ms;
+	return((x > y) - (x < y));
+}
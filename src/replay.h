@@ -0,0 +1,112 @@
+/*
+ ============================================================================
+ Name        : replay.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.08
+ Description : Workload files, the GETs, PUTs and DELs of a run in the order
+             : and at the times they were sent, so the load of a production
+             : run can be sent again to a test cluster (tcss558 bench -replay)
+             : and two builds compared on it.  tracecapture makes one from
+             : the client.log of the clients or the binary traces of the
+             : servers.  A workload file is text, one operation per line:
+             :
+             :     # tcss558 workload
+             :     0.000 PUT 12 4411 n01
+             :     0.412 GET 12 0 n02
+             :
+             : the ms after the first operation, the command, the key, the
+             : value (0 for a GET or DEL) and the server it was sent to: its
+             : host name, its node id (from a trace) or - if unknown.  Lines
+             : starting with # are comments.
+ ============================================================================
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#define REPLAY_HEADER          "# tcss558 workload"
+#define REPLAY_SERVER_LENGTH   128   // like PEER_HOST_LENGTH
+#define REPLAY_ANY_SERVER      "-"
+#define REPLAY_INITIAL_OPS     1024
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef XDRCONV_H
+  #include "xdrconv.h"
+#endif
+
+#ifndef TRACE_H
+  #include "trace.h"
+#endif
+
+
+// ONE OPERATION OF A WORKLOAD
+typedef struct replay_op {
+	double offset_ms;     // when it was sent, ms after the first operation (absolute until replay_finish)
+	int command;          // RPC_GET, RPC_PUT or RPC_DEL
+	int key;
+	int value;
+	char server[REPLAY_SERVER_LENGTH];  // host name or node id it was sent to, REPLAY_ANY_SERVER if unknown
+} replay_op;
+
+// A WHOLE WORKLOAD, SORTED BY OFFSET ONCE FINISHED
+typedef struct replay_workload {
+	int count;
+	int capacity;
+	int skipped;          // lines or events of a capture that were not a GET, PUT or DEL
+	replay_op * ops;
+} replay_workload;
+
+
+/*******************************************************************************
+ * RETURNS A NEW EMPTY WORKLOAD, OR NULL IF THERE IS NO MEMORY.                *
+ ******************************************************************************/
+replay_workload * replay_new();
+
+/*******************************************************************************
+ * FREES THE WORKLOAD.                                                         *
+ ******************************************************************************/
+void replay_free(replay_workload * workload);
+
+/*******************************************************************************
+ * ADDS AN OPERATION SENT AT TIME_MS (ANY CLOCK, IN MS) TO THE SERVER NAMED.   *
+ * RETURNS -1 IF THERE IS NO MEMORY.                                           *
+ ******************************************************************************/
+int replay_add(replay_workload * workload, double time_ms, int command, int key, int value, char * server);
+
+/*******************************************************************************
+ * SORTS THE OPERATIONS BY TIME AND MAKES THEIR TIMES OFFSETS FROM THE FIRST.  *
+ * CALL IT ONCE ALL THE CAPTURES ARE ADDED.                                    *
+ ******************************************************************************/
+void replay_finish(replay_workload * workload);
+
+/*******************************************************************************
+ * ADDS THE OPERATIONS OF A CAPTURE: A BINARY TRACE OF A SERVER (ITS ANSWERED  *
+ * GETS, PUTS AND DELS, FROM WHEN THEY WERE RECEIVED) OR A CLIENT.LOG (ITS     *
+ * SENT= LINES).  RETURNS -1 IF THE FILE CANNOT BE READ OR THERE IS NO MEMORY. *
+ ******************************************************************************/
+int replay_capture(replay_workload * workload, char * filename);
+
+/*******************************************************************************
+ * WRITES THE WORKLOAD TO THE FILE PROVIDED, STDOUT IF IT IS NULL.  RETURNS -1 *
+ * IF THE FILE CANNOT BE WRITTEN.                                              *
+ ******************************************************************************/
+int replay_save(replay_workload * workload, char * filename);
+
+/*******************************************************************************
+ * READS A WORKLOAD FILE, SORTED BY OFFSET.  RETURNS NULL (WITH A MESSAGE      *
+ * PRINTED) IF IT CANNOT BE READ OR A LINE IS BAD.                             *
+ ******************************************************************************/
+replay_workload * replay_load(char * filename);
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE COMMAND (GET, PUT OR DEL), OR NULL IF IT IS NONE OF *
+ * THEM.                                                                       *
+ ******************************************************************************/
+char * replay_command_name(int command);
+
+#endif /* REPLAY_H */
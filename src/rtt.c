@@ -0,0 +1,80 @@
+/*
+ ============================================================================
+ Name        : rtt.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Round trip time estimator for the server to server calls.
+ ============================================================================
+ */
+
+#ifndef RTT_H
+#include "rtt.h"
+#endif
+
+double rtt_clamp(double timeout);
+
+
+/*******************************************************************************
+ * RESETS THE ESTIMATOR TO THE INITIAL TIMEOUT.                                *
+ ******************************************************************************/
+void rtt_init(rtt_state * rtt)
+{
+	rtt->srtt    = 0.0;
+	rtt->rttvar  = 0.0;
+	rtt->rto     = RTT_INITIAL_MS;
+	rtt->samples = 0;
+}
+
+
+/*******************************************************************************
+ * UPDATES THE ESTIMATOR WITH THE ROUND TRIP TIME (MS) OF A SUCCESSFUL CALL.   *
+ ******************************************************************************/
+void rtt_sample(rtt_state * rtt, double rtt_ms)
+{
+	if (rtt->samples == 0)
+	{
+		// FIRST SAMPLE: SRTT = R, RTTVAR = R/2
+		rtt->srtt   = rtt_ms;
+		rtt->rttvar = rtt_ms / 2.0;
+	} else {
+		// RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+		double delta = rtt->srtt - rtt_ms;
+		if (delta < 0)
+			delta = -delta;
+
+		rtt->rttvar = (0.75 * rtt->rttvar) + (0.25 * delta);
+		rtt->srtt   = (0.875 * rtt->srtt) + (0.125 * rtt_ms);
+	}
+
+	rtt->samples++;
+	rtt->rto = rtt_clamp(rtt->srtt + (4.0 * rtt->rttvar));
+}
+
+
+/*******************************************************************************
+ * DOUBLES THE TIMEOUT AFTER A CALL TIMED OUT, UP TO RTT_MAX_MS.               *
+ ******************************************************************************/
+void rtt_backoff(rtt_state * rtt)
+{
+	rtt->rto = rtt_clamp(rtt->rto * 2.0);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE TIMEOUT (MS) TO USE FOR THE NEXT CALL.                          *
+ ******************************************************************************/
+double rtt_timeout(rtt_state * rtt)
+{
+	return(rtt->rto);
+}
+
+
+// KEEPS THE TIMEOUT BETWEEN RTT_MIN_MS AND RTT_MAX_MS
+double rtt_clamp(double timeout)
+{
+	if (timeout < RTT_MIN_MS)
+		return(RTT_MIN_MS);
+	if (timeout > RTT_MAX_MS)
+		return(RTT_MAX_MS);
+	return(timeout);
+}
@@ -0,0 +1,60 @@
+/*
+ ============================================================================
+ Name        : rtt.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.14
+ Description : Round trip time estimator for the server to server calls.
+             : Works like the TCP retransmission timer (RFC 6298): a smoothed
+             : RTT plus four times the RTT variance, doubled on a timeout.
+             : The timeout is always kept below the client's deadline so a
+             : proposer can answer the client before the client gives up.
+ ============================================================================
+ */
+
+#ifndef RTT_H
+#define RTT_H
+
+#define RTT_INITIAL_MS   200   /* Timeout used before the first sample */
+#define RTT_MIN_MS        20   /* Lower bound of the timeout */
+#define RTT_MAX_MS      1000   /* Upper bound, must stay below RPC_CLIENT_TIMEOUT_MS */
+#define RTT_MARGIN_MS     50   /* Time kept in reserve to reply before the client's deadline */
+
+#ifndef XDRCONV_H
+  #include "xdrconv.h"
+#endif
+
+#if RTT_MAX_MS >= RPC_CLIENT_TIMEOUT_MS
+  #error "RTT_MAX_MS must be below RPC_CLIENT_TIMEOUT_MS"
+#endif
+
+
+// THE RTT HISTORY KEPT FOR A SINGLE PEER
+typedef struct rtt_state {
+	double srtt;      // smoothed round trip time in ms
+	double rttvar;    // round trip time variance in ms
+	double rto;       // current timeout in ms
+	int samples;      // number of samples taken
+} rtt_state;
+
+
+/*******************************************************************************
+ * RESETS THE ESTIMATOR TO THE INITIAL TIMEOUT.                                *
+ ******************************************************************************/
+void rtt_init(rtt_state * rtt);
+
+/*******************************************************************************
+ * UPDATES THE ESTIMATOR WITH THE ROUND TRIP TIME (MS) OF A SUCCESSFUL CALL.   *
+ ******************************************************************************/
+void rtt_sample(rtt_state * rtt, double rtt_ms);
+
+/*******************************************************************************
+ * DOUBLES THE TIMEOUT AFTER A CALL TIMED OUT, UP TO RTT_MAX_MS.               *
+ ******************************************************************************/
+void rtt_backoff(rtt_state * rtt);
+
+/*******************************************************************************
+ * RETURNS THE TIMEOUT (MS) TO USE FOR THE NEXT CALL.                          *
+ ******************************************************************************/
+double rtt_timeout(rtt_state * rtt);
+
+#endif /* RTT_H */
@@ -14,14 +14,17 @@
 #endif
 
 kv* kv_store;
-char** servers;
 char myname[1024];
-int server_count;
-int quarom_count;
+
+double request_deadline = 0;          // time (ms) by which the current client must be answered
 
 int my_lc  = -1;  // my lamport clock (for proposals)
 int hpc    = -1;  //my highest promised clock
 xdrMsg hpv = { 0 };  // my highest proposed value
+xdrBatch hpb = { 0 };  // the last batch I accepted, the keys and values behind an RPC_MPUT hpv
+int leader = RPC_NO_HINT;  // node id of the proposer that last won or is winning a quarom, the hint of every reply
+lease_table * leases = NULL;  // the read leases my learner granted
+version_table * versions = NULL;  // the version my learner last applied to every key
 
 xdrMsg outdata_get     = { 0 };
 xdrMsg outdata_propose = { 0 };
@@ -29,19 +32,26 @@ xdrMsg outdata_del     = { 0 };
 xdrMsg outdata_learn   = { 0 };
 xdrMsg outdata_prepare = { 0 };
 xdrMsg outdata_accept  = { 0 };
+xdrMsg outdata_heartbeat = { 0 };
+xdrMsg outdata_reconfig  = { 0 };
+xdrBatch outdata_mget  = { 0 };
+xdrBatch outdata_mput  = { 0 };
+xdrBatch outdata_learn_batch = { 0 };
+xdrBatch outdata_accept_batch = { 0 };
+
+server_transport_fn server_transport = server_rpc_call;
 
 
 // CODE THE ACCEPTER WILL RUN WHEN IT RECEIVES AN ACCEPT
-int server_rpc_init(char** servers_list, int the_server_count) {
+int server_rpc_init(peer_table * table) {
 
 	srand(time(NULL));  // seed the random number generator for failures.
 
 
 
-	server_count = the_server_count;
-	quarom_count = (server_count / 2) + 1;
-	printf("With %d Servers the required servers for a quarom is %d.\n", server_count, quarom_count);
-	servers = servers_list;
+	printf("With %d Servers the required servers for a quarom is %d to prepare, %d to accept and %d to read.\n",
+			table->count, table->prepare_quorum, table->accept_quorum, table->read_quorum);
+	peer_table_swap(table);
 
 	my_lc = 0;
 
@@ -50,56 +60,117 @@ int server_rpc_init(char** servers_list, int the_server_count) {
 	uname(&unameData);
 
 	strcpy(myname, unameData.nodename);
+	unsigned long program = RPC_PROG_NUM;
+	if (table->self >= 0)
+	{
+		strcpy(myname, table->peers[table->self]->hostname);
+		program = table->peers[table->self]->program;
+	}
 	printf("The host name is: %s\n", myname);
 
 	// INITIALIZE DATA STRUCTURES.
 	int status;
 	kv_store = kv_new();
+	leases   = lease_new();
+	versions = version_new();
+	metrics_watch(kv_store);
 
-	for (int i = 0; i < server_count; i++)
-		printf("Loaded Server: %s\n", servers[i]);
+	for (int i = 0; i < table->count; i++)
+		printf("Loaded Server: %s (id=%d%s)\n", table->peers[i]->hostname, table->peers[i]->id,
+				table->peers[i]->is_self ? ", self" : "");
+
+	if (table->self < 0)
+		printf("WARNING: %s is not in the server list\n", myname);
 
 	printf("Server Load Complete...\n");
 
 	printf("Registering RPC...\n");
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_PUT, proposer_propose,
+	status = registerrpc(program, RPC_PROC_VER, RPC_PUT, proposer_propose,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("PUT FAILED TO REGISTER\n");
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_DEL, proposer_propose,
+	status = registerrpc(program, RPC_PROC_VER, RPC_DEL, proposer_propose,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("DEL FAILED TO REGISTER\n");
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_GET, proposer_get,
+	status = registerrpc(program, RPC_PROC_VER, RPC_GET, proposer_get,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("GET FAILED TO REGISTER\n");
 
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_PREPARE, acceptor_prepare,
+	status = registerrpc(program, RPC_PROC_VER, RPC_PREPARE, acceptor_prepare,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("ACCEPT_PREPARE FAILED TO REGISTER\n");
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_ACCEPT, acceptor_accept,
+	status = registerrpc(program, RPC_PROC_VER, RPC_ACCEPT, acceptor_accept,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("ACCEPT_ACCEPT FAILED TO REGISTER\n");
 
-	status = registerrpc(RPC_PROG_NUM, RPC_PROC_VER, RPC_LEARN, learner_learn,
+	status = registerrpc(program, RPC_PROC_VER, RPC_LEARN, learner_learn,
 			xdr_rpc, &xdr_rpc);
 
 	if (status < 0)
 		printf("LEARN FAILED TO REGISTER\n");
 
+	status = registerrpc(program, RPC_PROC_VER, RPC_HEARTBEAT, server_heartbeat,
+			xdr_rpc, &xdr_rpc);
+
+	if (status < 0)
+		printf("HEARTBEAT FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_RECONFIG, proposer_reconfig,
+			xdr_rpc, &xdr_rpc);
+
+	if (status < 0)
+		printf("RECONFIG FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_STATS, server_stats,
+			xdr_rpc, &xdr_stats);
+
+	if (status < 0)
+		printf("STATS FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_MGET, proposer_mget,
+			xdr_batch, &xdr_batch);
+
+	if (status < 0)
+		printf("MGET FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_MPUT, proposer_mput,
+			xdr_batch, &xdr_batch);
+
+	if (status < 0)
+		printf("MPUT FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_LEARN_BATCH, learner_learn_batch,
+			xdr_batch, &xdr_batch);
+
+	if (status < 0)
+		printf("LEARN_BATCH FAILED TO REGISTER\n");
+
+	status = registerrpc(program, RPC_PROC_VER, RPC_ACCEPT_BATCH, acceptor_accept_batch,
+			xdr_batch, &xdr_batch);
+
+	if (status < 0)
+		printf("ACCEPT_BATCH FAILED TO REGISTER\n");
+
+	printf("Starting Failure Detector...\n");
+	for (int i = 0; i < table->count; i++)
+	{
+		if (fd_start(table->peers[i]) < 0)
+			printf("FAILURE DETECTOR FAILED TO START FOR %s\n", table->peers[i]->hostname);
+	}
 
 	printf("Now Listening for Commands...\n");
 	svc_run();
@@ -110,40 +181,70 @@ int server_rpc_init(char** servers_list, int the_server_count) {
 
 
 
-xdrMsg * acceptor_accept(xdrMsg * indata)
+// CODE EVERY SERVER WILL RUN WHEN ANOTHER SERVER'S FAILURE DETECTOR PINGS IT
+xdrMsg * server_heartbeat(xdrMsg * indata)
 {
-	chaos_function();
+	// A PARTITION CUTS THE PINGS BOTH WAYS
+	if (fault_partitioned(server_peer_name(indata->hint)))
+		return(NULL);
+
+	// THE PINGER HOLDS NONE OF MY MISSED WRITES, SO I HAVE EVERY WRITE IT ACKNOWLEDGED BEFORE IT SENT THE PING
+	peer_table * table = peer_table_current();
+	int index = peer_table_find(table, indata->hint);
+	if (indata->value == 0 && index >= 0 && !table->peers[index]->is_self)
+		table->peers[index]->clean_ms = fd_now_ms() - FD_HEARTBEAT_TIMEOUT;  // SENT AT MOST ITS TIMEOUT AGO
+
+	outdata_heartbeat.status  = OK;
+	outdata_heartbeat.command = RPC_HEARTBEAT;
+	outdata_heartbeat.lc      = my_lc;
+	outdata_heartbeat.pid     = 0;
+	outdata_heartbeat.hint    = leader;
+	outdata_heartbeat.lease   = lease_latest(leases, fd_now_ms());  // A WRITE I MISS WAITS THIS OUT
+	return(&outdata_heartbeat);
+}
+
 
+xdrMsg * acceptor_accept(xdrMsg * indata)
+{
+	double started = fd_now_ms();
+	if (fault_receive(server_peer_name(indata->hint)) == FAULT_DROP)
+		return(NULL);  // NO REPLY, THE SENDER TIMES OUT AS IF THE NETWORK LOST IT
 
-	char s_command[BUFFSIZE];
 
 	switch (indata->command)
 	{
 	case RPC_PUT:
-		sprintf(s_command, "RECV=ACCEPT_PUT(L=%d, K=%d, V=%d)", indata->lc, indata->key, indata->value);
+		LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_PUT(L=%d, K=%d, V=%d)", indata->lc, indata->key, indata->value);
 		break;
 	case RPC_DEL:
-		sprintf(s_command, "RECV=ACCEPT_DEL(L=%d, K=%d)", indata->lc, indata->key);
+		LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_DEL(L=%d, K=%d)", indata->lc, indata->key);
+		break;
+	case RPC_MPUT:
+		LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_MPUT(L=%d, N=%d)", indata->lc, indata->key);
+		break;
+	case RPC_GET:  // THE ROUND OF A READ_LINEARIZABLE GET, NOTHING IS LEARNED
+		LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_READ(L=%d, K=%d)", indata->lc, indata->key);
+		break;
+	case CONFIG_ADD_NODE:
+	case CONFIG_DEL_NODE:
+		LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_RECONFIG(L=%d, cmd=%d, id=%d)", indata->lc, indata->command, indata->key);
 		break;
 	default:
-		sprintf(s_command, "RECV=ACCEPT_BAD(cmd=%d, LC=%d)", indata->command, my_lc);
-		log_write("server.log", "proposer", s_command);
-		sprintf(s_command, "SEND=NACK");
-		log_write("server.log", "proposer", s_command);
+		LOG_WARN("server.log", "proposer", "RECV=ACCEPT_BAD(cmd=%d, LC=%d)", indata->command, my_lc);
+		LOG_WARN("server.log", "proposer", "SEND=NACK");
 		outdata_accept = hpv;
 		outdata_accept.status = NACK;
-		return (&outdata_accept);
+		outdata_accept.pid = indata->pid;
+		return (server_reply(TRACE_RECV_ACCEPT, &outdata_accept, started));
 	}
 
-	log_write("server.log", "proposer", s_command);
-
 	if (indata->lc < hpc)
 	{
 		// PROVIDE THE LAST VALUE
 		outdata_accept = hpv;
 		outdata_accept.lc = hpc;
 		outdata_accept.status = NACK;
-		sprintf(s_command, "SEND=NACK(L=%d)", hpc);
+		LOG_TRACE("server.log", "proposer", "SEND=NACK(L=%d)", hpc);
 	} else {
 		// ACCEPT THE MESSAGE, WITH THE HIGHEST PROPOSED VALUE
 		outdata_accept = hpv;
@@ -151,26 +252,59 @@ xdrMsg * acceptor_accept(xdrMsg * indata)
 		outdata_accept.status = ACCEPT;
 		if (indata->command == RPC_PUT)
 		{
-			sprintf(s_command, "SEND=ACCEPT_PUT(L=%d, K=%d, V=%d", outdata_accept.lc, outdata_accept.key, outdata_accept.value);
+			LOG_TRACE("server.log", "proposer", "SEND=ACCEPT_PUT(L=%d, K=%d, V=%d", outdata_accept.lc, outdata_accept.key, outdata_accept.value);
 		} else {
-			sprintf(s_command, "SEND=ACCEPT_DEL(L=%d, K=%d)", outdata_accept.lc, outdata_accept.key);
+			LOG_TRACE("server.log", "proposer", "SEND=ACCEPT_DEL(L=%d, K=%d)", outdata_accept.lc, outdata_accept.key);
 		}
 	}
 
-	log_write("server.log", "proposer", s_command);
-	return (&outdata_accept);
+	outdata_accept.pid = indata->pid;  // HPV MAY BE ANOTHER OPERATION'S, ANSWER UNDER THIS ONE
+	return (server_reply(TRACE_RECV_ACCEPT, &outdata_accept, started));
 
 }
 
+
+/********************************************************
+ * THE ACCEPT OF AN RPC_MPUT, WHICH CARRIES THE WHOLE    *
+ * BATCH.  ACCEPTS IT IF I PROMISED ITS ROUND AND ITS    *
+ * DIGEST, AND KEEPS IT IN HPB, SO EVERY ACCEPTOR OF THE *
+ * QUAROM HOLDS THE KEYS AND VALUES THEMSELVES.  THE     *
+ * REPLY CARRIES NO KEYS.                                *
+ *******************************************************/
+xdrBatch * acceptor_accept_batch(xdrBatch * indata)
+{
+	double started = fd_now_ms();
+	if (fault_receive(server_peer_name(indata->hint)) == FAULT_DROP)
+		return(NULL);  // NO REPLY, THE SENDER TIMES OUT AS IF THE NETWORK LOST IT
+
+	xdrMsg header = server_batch_header(indata);
+	header.value  = xdr_batch_digest(indata);
+	LOG_TRACE("server.log", "proposer", "RECV=ACCEPT_MPUT(L=%d, N=%d)", indata->lc, indata->count);
+
+	outdata_accept_batch = (xdrBatch) { 0 };
+	outdata_accept_batch.command = indata->command;
+	outdata_accept_batch.pid     = indata->pid;
+	outdata_accept_batch.lc      = hpc;
+	if (indata->command != RPC_MPUT || indata->lc < hpc || xdr_compare(&hpv, &header) != 1)
+	{
+		outdata_accept_batch.status = NACK;
+		LOG_TRACE("server.log", "proposer", "SEND=NACK(L=%d)", hpc);
+	} else {
+		hpb = *indata;
+		outdata_accept_batch.status = ACCEPT;
+		LOG_TRACE("server.log", "proposer", "SEND=ACCEPT_MPUT(L=%d, N=%d)", hpc, indata->count);
+	}
+	return(server_batch_reply(TRACE_RECV_ACCEPT, &outdata_accept_batch, started));
+}
+
 // CODE THE ACCEPTER WILL RUN WHEN IT RECEIVES A PREPARE
 xdrMsg * acceptor_prepare(xdrMsg * indata)
 {
-	chaos_function();
+	double started = fd_now_ms();
+	if (fault_receive(server_peer_name(indata->hint)) == FAULT_DROP)
+		return(NULL);  // NO REPLY, THE SENDER TIMES OUT AS IF THE NETWORK LOST IT
 
-	char s_command[BUFFSIZE];
-
-	sprintf(s_command, "RECV=PREPARE(L=%d)", indata->lc);
-	log_write("server.log", "proposer", s_command);
+	LOG_TRACE("server.log", "proposer", "RECV=PREPARE(L=%d)", indata->lc);
 
 	// WHEN ACCEPTING, IF THE REQUSTED LAMPORT LOCK IS LOWER, REJECT
 	if (indata->lc < hpc)
@@ -180,105 +314,131 @@ xdrMsg * acceptor_prepare(xdrMsg * indata)
 		outdata_prepare.command = indata->command;
 		outdata_prepare.key = indata->key;
 		outdata_prepare.value = indata->value;
-		outdata_prepare.pid = 0;
-		sprintf(s_command, "SEND=NACK(L=%d)", hpc);
+		outdata_prepare.pid = indata->pid;
+		LOG_TRACE("server.log", "proposer", "SEND=NACK(L=%d)", hpc);
 	} else {  // OTHERWISE, MAKE THE PROMISE AND UPDATE THE HIGHEST PROMISED VALUES.
 		hpc = indata->lc; // STORE THE HPC
 		hpv = *indata;  //STORE THE HPC
+		if (indata->hint != RPC_NO_HINT)
+			leader = indata->hint;  // THE PROPOSER I PROMISED IS ABOUT TO BE THE LEADER
 		outdata_prepare.status = PROMISE;
 		outdata_prepare.lc = hpc;
-		outdata_prepare.pid = 0;
+		outdata_prepare.pid = indata->pid;
 		outdata_prepare.command = indata->command;
 		outdata_prepare.key = indata->key;
 		outdata_prepare.value = indata->value;
-		sprintf(s_command, "SEND=PROMISE(L=%d)", hpc);
+		LOG_TRACE("server.log", "proposer", "SEND=PROMISE(L=%d)", hpc);
 	}
 
-	log_write("server.log", "proposer", s_command);
-	return (&outdata_prepare);
+	return (server_reply(TRACE_RECV_PREPARE, &outdata_prepare, started));
 }
 
 
 // CODE THE LEARNER WILL RUN WHEN IT RECEIVES A LEARN FROM ACCEPTOR
 xdrMsg * learner_learn(xdrMsg * indata)
 {
-	chaos_function();
-
-	char s_command[BUFFSIZE];
+	double started = fd_now_ms();
+	if (fault_receive(server_peer_name(indata->hint)) == FAULT_DROP)
+		return(NULL);  // NO REPLY, THE SENDER TIMES OUT AS IF THE NETWORK LOST IT
 
 	outdata_learn.lc = my_lc;
 	outdata_learn.command = indata->command;
-	outdata_learn.pid = 0;
+	outdata_learn.pid = indata->pid;
 	outdata_learn.key = indata->key;
 	outdata_learn.value = indata->value;
+	outdata_learn.lease = 0;
+	outdata_learn.version = VERSION_NONE;
 
 
 	int result;
+	int value;
 	switch (indata->command)
 	{
 	case RPC_PUT:
-		sprintf(s_command, "RECV=LEARN_PUT(%d, %d, L=%d)", indata->key, indata->value, my_lc);
-		log_write("server.log", "proposer", s_command);
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_PUT(%d, %d, L=%d)", indata->key, indata->value, my_lc);
 
-		result = kv_put(kv_store, indata->key, indata->value);
+		result = server_apply(RPC_PUT, indata->key, indata->value, indata->lc);
+		outdata_learn.lease = lease_remaining(leases, indata->key, fd_now_ms());  // THE PROPOSER WAITS IT OUT
 		if (result == 0)
 		{
-			sprintf(s_command, "SEND=PUT_SUCCESS(%d, %d, L=%d)", indata->key, indata->value, my_lc);
+			LOG_TRACE("server.log", "proposer", "SEND=PUT_SUCCESS(%d, %d, L=%d)", indata->key, indata->value, my_lc);
 			outdata_learn.status = OK;
 		}
 		else
 		{
-			sprintf(s_command, "SEND=PUT_FAILURE(%d, %d, L=%d)", indata->key, indata->value, my_lc);
-			outdata_learn.status = NACK;
+			LOG_WARN("server.log", "proposer", "SEND=PUT_FAILURE(%d, %d, L=%d)", indata->key, indata->value, my_lc);
+			outdata_learn.status = (result == MEMORY_ALLOCATION_ERROR) ? FAILURE : NACK;
 		}
 		break;
 
 
 	case RPC_DEL:
-		sprintf(s_command, "RECV=LEARN_DEL(%d, L=%d)", indata->key, my_lc);
-		log_write("server.log", "proposer", s_command);
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_DEL(%d, L=%d)", indata->key, my_lc);
 
-		result = kv_del(kv_store, indata->key);
+		result = server_apply(RPC_DEL, indata->key, 0, indata->lc);
+		outdata_learn.lease = lease_remaining(leases, indata->key, fd_now_ms());
 		if (result == 0)
 		{
-			sprintf(s_command, "SEND=DEL_SUCCESS(%d, L=%d)", indata->key, my_lc);
+			LOG_TRACE("server.log", "proposer", "SEND=DEL_SUCCESS(%d, L=%d)", indata->key, my_lc);
 			outdata_learn.status = OK;
 		} else {
-			sprintf(s_command, "SEND=DEL_FAILURE(%d, L=%d)", indata->key, my_lc);
-			outdata_learn.status = NACK;
+			LOG_TRACE("server.log", "proposer", "SEND=DEL_FAILURE(%d, L=%d)", indata->key, my_lc);
+			outdata_learn.status = (result == MEMORY_ALLOCATION_ERROR) ? FAILURE : NACK;
 		}
 		break;
 
 	case RPC_GET:
 
-		sprintf(s_command, "RECV=LEARN_GET(%d, L=%d)", indata->key, my_lc);
-		log_write("server.log", "proposer", s_command);
-		int value;
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_GET(%d, L=%d)", indata->key, my_lc);
 		result = kv_get(kv_store, indata->key, &value);
+		outdata_learn.version = version_get(versions, indata->key);
 
 		if (result == 0) {
 			outdata_learn.status = OK;
 			outdata_learn.value = value;
-			sprintf(s_command, "SEND=OK(%d, L=%d)", outdata_learn.value, my_lc);
+			outdata_learn.lease = lease_grant(leases, indata->key, indata->lease, fd_now_ms());
+			LOG_TRACE("server.log", "proposer", "SEND=OK(%d, L=%d)", outdata_learn.value, my_lc);
 		} else {  // KEY NOT FOUND
 			outdata_learn.status = NACK;
-			sprintf(s_command, "SEND=NACK(L=%d", my_lc);
+			LOG_TRACE("server.log", "proposer", "SEND=NACK(L=%d", my_lc);
 		}
 
 		break;
 
+	case CONFIG_CATCHUP:
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_CATCHUP(%d, %d, L=%d)", indata->key, indata->value, my_lc);
+
+		// NEVER OVERWRITE A VALUE OR A DELETE LEARNED FROM A NEWER PROPOSAL.  A KEY THE OLD MEMBER HAS NO
+		// VERSION OF (ONLY A READ REPAIR OF AN MGET LEAVES ONE) IS ONLY PUT IF I HAVE NEVER SEEN THE KEY
+		result = 0;
+		if (indata->lc > VERSION_NONE)
+			result = server_apply(RPC_PUT, indata->key, indata->value, indata->lc);
+		else if (version_get(versions, indata->key) == VERSION_NONE && kv_get(kv_store, indata->key, &value) != 0)
+			result = kv_put(kv_store, indata->key, indata->value);
+
+		LOG_TRACE("server.log", "proposer", "SEND=CATCHUP_SUCCESS(%d, L=%d)", indata->key, my_lc);
+		outdata_learn.status = (result == MEMORY_ALLOCATION_ERROR) ? FAILURE : OK;
+		break;
+
+	case CONFIG_ADD_NODE:
+	case CONFIG_DEL_NODE:
+		LOG_INFO("server.log", "proposer", "RECV=LEARN_RECONFIG(cmd=%d, id=%d, L=%d)", indata->command, indata->key, my_lc);
+
+		// A CHANGE THAT IS ALREADY APPLIED IS STILL A SUCCESS
+		config_apply(indata->command, indata->key, indata->value);
+		LOG_INFO("server.log", "proposer", "SEND=RECONFIG_SUCCESS(servers=%d, L=%d)", peer_table_current()->count, my_lc);
+		outdata_learn.status = OK;
+		break;
+
 	default:
-		sprintf(s_command, "RECV=BAD_LEARN(%d, L=%d)", indata->command, my_lc);
-		log_write("server.log", "proposer", s_command);
-		sprintf(s_command, "SEND=NACK");
+		LOG_WARN("server.log", "proposer", "RECV=BAD_LEARN(%d, L=%d)", indata->command, my_lc);
+		LOG_WARN("server.log", "proposer", "SEND=NACK");
 		outdata_learn.status = NACK;
 		break;
 
 	}
 
-	log_write("server.log", "proposer", s_command);
-
-	return(&outdata_learn);
+	return(server_reply(TRACE_RECV_LEARN, &outdata_learn, started));
 
 }
 
@@ -286,11 +446,70 @@ xdrMsg * learner_learn(xdrMsg * indata)
 // CODE THE PROPOSER WILL RUN WHEN A CLIENT SEND A GET
 xdrMsg * proposer_get(xdrMsg * indata)
 {
+	double started = fd_now_ms();
 
+	server_set_deadline(indata);
 	my_lc = my_lc + 1;
-	char s_command[BUFFSIZE];
-	sprintf(s_command, "RECV=GET(%d, L=%d)", indata->key, my_lc);
-	log_write("server.log", "client", s_command);
+	LOG_DEBUG("server.log", "client", "RECV=GET(%d, L=%d)", indata->key, my_lc);
+	hot_record(HOT_READS, indata->key);
+
+	// A SESSION TOKEN: ONCE I'VE APPLIED THE CLIENT'S OWN LAST WRITE OF THE KEY, MY STORE IS NEW ENOUGH FOR IT
+	int consistency = indata->consistency;
+	if (indata->version > VERSION_NONE && consistency != READ_LINEARIZABLE)
+	{
+		int applied = version_get(versions, indata->key);
+		if (applied < indata->version)
+		{
+			// I CAN'T LEARN WHILE I WAIT FOR THE WRITE, THE QUAROM READ CATCHES ME UP INSTEAD
+			LOG_DEBUG("server.log", "client", "BEHIND=GET(%d, V=%d < %d, L=%d)", indata->key, applied, indata->version, my_lc);
+			stats_count(STATS_BEHIND_READS);
+			consistency = READ_QUORUM;
+		}
+		else if (consistency == READ_QUORUM)
+			return(proposer_get_local(indata, server_staleness(), started));
+	}
+
+	// READ_LOCAL IS MY OWN STORE, UNLESS I'VE LAGGED MORE THAN THE CLIENT ALLOWS
+	if (consistency == READ_LOCAL)
+	{
+		int staleness = server_staleness();
+		if (indata->staleness <= 0 || staleness <= indata->staleness)
+			return(proposer_get_local(indata, staleness, started));
+
+		LOG_DEBUG("server.log", "client", "STALE=GET(%d, %dms > %dms, L=%d)", indata->key, staleness, indata->staleness, my_lc);
+		stats_count(STATS_STALE_READS);
+		consistency = READ_QUORUM;
+	}
+
+	// READ_LINEARIZABLE IS ORDERED AFTER EVERY WRITE A QUAROM ACCEPTED BY A ROUND OF ITS OWN
+	if (consistency == READ_LINEARIZABLE)
+	{
+		xdrMsg barrier = { 0 };
+		barrier.key     = indata->key;
+		barrier.value   = -1;
+		barrier.status  = OK;
+		barrier.command = RPC_GET;
+		barrier.lc      = my_lc;
+		barrier.pid     = server_trace_id(indata);
+		barrier.hint    = server_my_id();
+		if (proposer_round(&barrier, NULL) == 0)
+		{
+			LOG_WARN("server.log", "client", "SEND=NACK(L=%d)", my_lc);
+			outdata_get.key         = indata->key;
+			outdata_get.value       = -1;
+			outdata_get.status      = NACK;
+			outdata_get.command     = RPC_GET;
+			outdata_get.lc          = my_lc;
+			outdata_get.pid         = barrier.pid;
+			outdata_get.lease       = 0;
+			outdata_get.consistency = consistency;
+			outdata_get.staleness   = 0;
+			outdata_get.version     = VERSION_NONE;
+			stats_count(STATS_QUORUM_FAILURES);
+			metrics_quorum(0);
+			return(server_reply(TRACE_GET, &outdata_get, started));
+		}
+	}
 
 	xdrMsg message  = { 0 };
 	xdrMsg response = { 0 };
@@ -301,9 +520,13 @@ xdrMsg * proposer_get(xdrMsg * indata)
 	message.status  = OK;
 	message.command = RPC_GET;
 	message.lc      = my_lc;
-	message.pid     = 0;  //TODO FIGURE OUT PROCESS IDS
+	message.pid     = server_trace_id(indata);  // EVERY MESSAGE OF THE OPERATION CARRIES ITS TRACE ID
+	message.lease   = indata->lease;            // EVERY LEARNER GRANTS THE LEASE THE CLIENT ASKED FOR
+	message.hint    = server_my_id();           // SO A LEARNER CAN TELL WHO ASKS
 
-	int responses[quarom_count][3];  //three columns, 0 = live value, 1 = value, 2 = count;
+	peer_table * table = peer_table_current();
+	int quarom_count = table->read_quorum;  // MATCHING VALUES THE LEARNERS APPLIED, NOT -q1 OF ACCEPTED PROPOSALS
+	int responses[quarom_count][4];  //four columns, 0 = live value, 1 = value, 2 = count, 3 = highest version;
 
 	// INITIALIZE THE RESPONSES ARRAY
 	for (int i = 0; i < quarom_count; i++)
@@ -311,61 +534,67 @@ xdrMsg * proposer_get(xdrMsg * indata)
 		responses[i][0] =  -1;
 		responses[i][1] =  0;
 		responses[i][2] =  0;
+		responses[i][3] =  VERSION_NONE;
 	}
 
 	int my_value = -1;
-	// SEND LEARN_GET TO ALL LEARNERS
+	int lease = LEASE_MAX_MS;  // THE SHORTEST LEASE GRANTED, THE CLIENT'S CAN'T OUTLAST ANY OF THEM
+	// SEND LEARN_GET TO ALL LEARNERS, THE LIVE ONES FIRST
 	int have_quarom = 0;
 	int quarom_value = -1;
-	for (int i = 0; i < server_count ; i++)
+	int quarom_version = VERSION_NONE;
+	double phase = fd_now_ms();
+	int order[table->count];
+	fd_order(table, order);
+	for (int n = 0; n < table->count ; n++)
 	{
+		peer * the_peer = table->peers[order[n]];
 		int response_value = 0;
 		int response_status = NACK;
+		int response_lease = 0;
+		int response_version = VERSION_NONE;
 		int status;
-		sprintf(s_command, "SEND=LEARNER_GET(%d, L=%d)", indata->key, my_lc);
-		if (strcmp(myname, servers[i]) == 0)
+		if (the_peer->is_self)
 		{  // GET THE VALUE FROM LOCAL
-			log_write("server.log", "localhost", s_command);
+			LOG_TRACE("server.log", "localhost", "SEND=LEARNER_GET(%d, L=%d)", indata->key, my_lc);
 			status = kv_get(kv_store, indata->key, &response_value);
 			my_value = response_value;
 			response_status = OK;
+			response_version = version_get(versions, indata->key);
 			if (status == 0)
 			{
-				sprintf(s_command, "RECV=OK(%d, L=%d)", response_value, my_lc);
+				response_lease = lease_grant(leases, indata->key, indata->lease, fd_now_ms());
+				LOG_TRACE("server.log", "localhost", "RECV=OK(%d, L=%d)", response_value, my_lc);
 			} else {
-				sprintf(s_command, "RECV=NACK(L=%d", my_lc);
+				LOG_TRACE("server.log", "localhost", "RECV=NACK(L=%d", my_lc);
 			}
-			log_write("server.log", "localhost", s_command);
 		} else {
 			// GET THE VALUE FROM REMOTE;
-			log_write("server.log", servers[i], s_command);
-			status = callrpc(servers[i],
-					RPC_PROG_NUM,
-					RPC_PROC_VER,
-					RPC_LEARN,
-					xdr_rpc,
-					&message,
-					xdr_rpc,
-					&response);
+			LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARNER_GET(%d, L=%d)", indata->key, my_lc);
+			status = server_peer_call(the_peer, RPC_LEARN, &message, &response);
 
 			response_status = response.status;
 			response_value  = response.value;
+			response_lease  = response.lease;
+			response_version = response.version;
+			if (status == 0)
+				peer_lease_seen(the_peer, response_lease, fd_now_ms());
 
 			if (status == 0 && response_status == OK)
 			{
-				sprintf(s_command, "RECV=OK(%d, L=%d)", response.value, my_lc);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=OK(%d, L=%d)", response.value, my_lc);
 			} else {
-				sprintf(s_command, "RECV=NACK(L=%d)", my_lc);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=NACK(L=%d)", my_lc);
 			}
 
-			log_write("server.log",servers[i], s_command);
-
 		}
 
 
 		// STORE THE VALUE TO GET A QUAROM.
 		if (status == 0 && response_status == OK)  // IF WE HAVE A GOOD RESULT
 		{
+			if (response_lease < lease)
+				lease = response_lease;
 			for(int j = 0; j < quarom_count; j++)
 			{
 				if (responses[j][0] == 0)  // IT IS A LIVE VALUE, CHECK IT
@@ -373,10 +602,13 @@ xdrMsg * proposer_get(xdrMsg * indata)
 					if (responses[j][1] == response_value) // WE HAVE A MATCH
 					{
 						responses[j][2] = responses[j][2] + 1;  // INCREMENT THE COUNT
+						if (response_version > responses[j][3])
+							responses[j][3] = response_version;
 						if (responses[j][2] >= quarom_count)
 						{
 							have_quarom = 1;
 							quarom_value = responses[j][1]; // SAVE IT AS THE RETURN VALUE
+							quarom_version = responses[j][3];
 							break; // END FOR LOOP
 						}
 					}
@@ -384,6 +616,7 @@ xdrMsg * proposer_get(xdrMsg * indata)
 					responses[j][0] = 0; //MAKE IT LIVE
 					responses[j][1] = response_value;
 					responses[j][2] = 1;
+					responses[j][3] = response_version;
 					break;   // END FOR LOOP
 				}
 			}
@@ -396,6 +629,7 @@ xdrMsg * proposer_get(xdrMsg * indata)
 			break;
 		}
 	}  // LOOP TO THE NEXT SERVER
+	stats_record(STATS_READ, fd_now_ms() - phase);
 
 	if (have_quarom == 1)
 	{
@@ -404,14 +638,19 @@ xdrMsg * proposer_get(xdrMsg * indata)
 		outdata_get.status = OK;
 		outdata_get.command = RPC_GET;
 		outdata_get.lc = my_lc;
-		outdata_get.pid = 0;
-		sprintf(s_command, "SEND=OK(%d, L=%d)", outdata_get.value, my_lc);
-		if (my_value != outdata_get.value)  // I'M OUT OF DATE
+		outdata_get.pid = message.pid;
+		outdata_get.lease = lease;
+		outdata_get.consistency = consistency;
+		outdata_get.staleness = 0;
+		outdata_get.version = quarom_version;
+		metrics_quorum(1);
+		LOG_DEBUG("server.log", "client", "SEND=OK(%d, L=%d)", outdata_get.value, my_lc);
+		// I'M OUT OF DATE, UNLESS I ALREADY APPLIED A NEWER WRITE THE QUAROM HASN'T SEEN YET
+		if (my_value != outdata_get.value && quarom_version >= version_get(versions, outdata_get.key)
+		&&  version_set(versions, outdata_get.key, quarom_version) == 0)
 		{
-			char r_command[BUFFSIZE];
-			sprintf(r_command, "Learning Key=%d, Value=%d", outdata_get.key, outdata_get.value);
 			kv_put(kv_store, outdata_get.key, outdata_get.value);  //SO I'M LEARNING THE VALUE
-			log_write("server.log", "localhost", r_command);
+			LOG_DEBUG("server.log", "localhost", "Learning Key=%d, Value=%d", outdata_get.key, outdata_get.value);
 		}
 	} else {
 		outdata_get.key  = indata->key;
@@ -419,98 +658,99 @@ xdrMsg * proposer_get(xdrMsg * indata)
 		outdata_get.status = NACK;
 		outdata_get.command = RPC_GET;
 		outdata_get.lc = my_lc;
-		outdata_get.pid = 0;
-		sprintf(s_command, "SEND=NACK(L=%d)", my_lc);
+		outdata_get.pid = message.pid;
+		outdata_get.lease = 0;
+		outdata_get.consistency = consistency;
+		outdata_get.staleness = 0;
+		outdata_get.version = VERSION_NONE;
+		stats_count(STATS_QUORUM_FAILURES);
+		metrics_quorum(0);
+		LOG_WARN("server.log", "client", "SEND=NACK(L=%d)", my_lc);
 	}
 
-	log_write("server.log", "client", s_command);
-
-	return(&outdata_get);
+	return(server_reply(TRACE_GET, &outdata_get, started));
 
 }
 
-// CODE THE PROPOSER WILL RUN WHEN A CLIENT SEND A GET
-xdrMsg * proposer_propose(xdrMsg * indata)
-{
-
-	char s_command[BUFFSIZE];
-	my_lc = my_lc + 1;
-
-	switch (indata->command)
-	{
-	case RPC_PUT:
-		sprintf(s_command, "RECV=PROPOSE_PUT(L=%d, K=%d, V=%d)", my_lc, indata->key, indata->value);
-		break;
-	case RPC_DEL:
-		sprintf(s_command, "RECV=PROPOSE_DEL(L=%d, K=%d)", my_lc, indata->key);
-		break;
-	default:  // BAD COMMAND RETURN A NACK
-		sprintf(s_command, "RECV=PROPOSE_BAD(cmd=%d, L=%d)", indata->command, my_lc);
-		log_write("server.log", "client", s_command);
-		sprintf(s_command, "SEND=NACK(%d, L=%d)", indata->command, my_lc);
-		log_write("server.log", "client", s_command);
-		outdata_propose = *indata;
-		outdata_propose.status = NACK;
-		return(&outdata_propose);
-	}
-
-	log_write("server.log", "client", s_command);
 
+// ANSWERS A READ_LOCAL GET FROM MY OWN STORE, THE REPLY SAYS HOW STALE IT MAY BE
+xdrMsg * proposer_get_local(xdrMsg * indata, int staleness, double started)
+{
+	int value;
+	int result = kv_get(kv_store, indata->key, &value);
+
+	outdata_get.key         = indata->key;
+	outdata_get.value       = (result == 0) ? value : -1;
+	outdata_get.status      = (result == 0) ? OK : NACK;
+	outdata_get.command     = RPC_GET;
+	outdata_get.lc          = my_lc;
+	outdata_get.pid         = server_trace_id(indata);
+	outdata_get.lease       = 0;  // NO OTHER LEARNER KNOWS OF THIS READ, IT CAN'T BE CACHED
+	outdata_get.consistency = READ_LOCAL;
+	outdata_get.staleness   = staleness;
+	outdata_get.version     = version_get(versions, indata->key);
+	LOG_DEBUG("server.log", "client", "SEND=LOCAL_%s(%d, %dms, L=%d)", result == 0 ? "OK" : "NACK", outdata_get.value, staleness, my_lc);
+	return(server_reply(TRACE_GET, &outdata_get, started));
+}
 
-	xdrMsg message;
+/********************************************************
+ * RUNS THE PREPARE AND THE ACCEPT ROUND OF THE PROPOSAL *
+ * PROVIDED, THE LIVE ACCEPTORS FIRST.  RETURNS 1 IF A   *
+ * QUAROM ACCEPTED IT AND 0 IF NOT.                      *
+ *******************************************************/
+int proposer_round(xdrMsg * proposal, xdrBatch * batch)
+{
+	xdrMsg message  = *proposal;
 	xdrMsg response = { 0 };
 
-	message.key     = indata->key;
-	message.value   = indata->value;
-	message.lc      = my_lc;
-	message.pid     = 0;
-	message.status  = OK;
-	message.command = indata->command;
-
+	peer_table * table = peer_table_current();
+	int quarom_count = table->prepare_quorum;
 	int promise_count = 0;
 
 	int current_status;
 	xdrMsg current_result;
 
-	// SEND PREPARE(MESSAGE) TO ACCEPTORS
-	for (int i = 0; i < server_count; i++)
+	// SEND PREPARE(MESSAGE) TO ACCEPTORS, THE LIVE ONES FIRST
+	double phase = fd_now_ms();
+	int order[table->count];
+	fd_order(table, order);
+	for (int n = 0; n < table->count; n++)
 	{
+		peer * the_peer = table->peers[order[n]];
+		char * host = the_peer->is_self ? "localhost" : the_peer->hostname;
+		(void) host;  // ONLY THE TRACE LINES READ IT, AND LOG_NO_TRACE TAKES THEM OUT
 		if (message.command == RPC_PUT)
-			sprintf(s_command, "SEND=PREPARE_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
-		else // it has to be delete
-			sprintf(s_command, "SEND=PREPARE_DEL(L=%d, K=%d", message.lc, message.key);
+			LOG_TRACE("server.log", host, "SEND=PREPARE_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
+		else if (message.command == RPC_DEL)
+			LOG_TRACE("server.log", host, "SEND=PREPARE_DEL(L=%d, K=%d", message.lc, message.key);
+		else if (message.command == RPC_GET)
+			LOG_TRACE("server.log", host, "SEND=PREPARE_READ(L=%d, K=%d)", message.lc, message.key);
+		else
+			LOG_TRACE("server.log", host, "SEND=PREPARE_MPUT(L=%d, N=%d)", message.lc, message.key);
 
-		if (strcmp(myname, servers[i]) == 0)
+		if (the_peer->is_self)
 		{   // AUTOMATICALLY ASSUME THAT ONES SELF WOULD ACTUALLY REPSPOND WITH PROMISE
-			log_write("server.log", "localhost", s_command);
 			current_status         = 0;
 			current_result.lc      = message.lc;
 			current_result.status  = PROMISE;
 			current_result.key     = message.key;
 			current_result.value   = message.value;
 			current_result.command = message.command;
-			current_result.pid     = 0;
-			sprintf(s_command, "RECV=PROMISE(L=%d)", message.lc);
-			log_write("server.log", "localhost", s_command);
+			current_result.pid     = message.pid;
+			LOG_TRACE("server.log", "localhost", "RECV=PROMISE(L=%d)", message.lc);
 		} else {
-			log_write("server.log", servers[i], s_command);
-			current_status = callrpc(servers[i],
-					RPC_PROG_NUM,
-					RPC_PROC_VER,
-					RPC_PREPARE,
-					xdr_rpc,
-					&message,
-					xdr_rpc,
-					&response);
+			current_status = server_peer_call(the_peer, RPC_PREPARE, &message, &response);
 
 			current_result = response;
 
 			if (current_result.status == PROMISE)
-				sprintf(s_command, "REVC=PROMISE(L=%d)", response.lc);
+				LOG_TRACE("server.log", the_peer->hostname, "REVC=PROMISE(L=%d)", response.lc);
 			else
-				sprintf(s_command, "RECV=NACK(L-%d)", response.lc);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=NACK(L-%d)", response.lc);
 
-			log_write("server.log", servers[i], s_command);
+			// A NACK NAMES THE PROPOSER THAT BEAT ME, THE CLIENT SHOULD GO THERE
+			if (current_status == 0 && current_result.status == NACK && current_result.hint != RPC_NO_HINT)
+				leader = current_result.hint;
 
 		}
 
@@ -527,79 +767,75 @@ xdrMsg * proposer_propose(xdrMsg * indata)
 				break;  // WE HAVE A QUAROM!
 		}
 	}  // GET PROMISE FROM NEXT SERVER
+	stats_record(STATS_PREPARE, fd_now_ms() - phase);
 
 
 	if (promise_count < quarom_count)
-	{
-		// NO QUAROM, RESPOND TO CLIENT WITH FAILURE
-		if (message.command == RPC_PUT)
-			sprintf(s_command, "SEND=PUT_FAILURE(%d,%d, L=%d)", message.key, message.value, my_lc);
-		else
-			sprintf(s_command, "SEND=DEL_FAILURE(%d,%d, L=%d)", message.key, my_lc);
-
-		log_write("server.log", "client", s_command);
-		outdata_propose.lc = my_lc;
-		outdata_propose.pid = 0;
-		outdata_propose.status = NACK;
-		outdata_propose.key = message.key;
-		outdata_propose.value = message.value;
-		outdata_propose.command = message.command;
-
-		return(&outdata_propose);
+		return(0);  // NO QUAROM
 
-	}
-
-// NOW WE HAVE TO GET A QUAROM OF ACCEPTS
+// NOW WE HAVE TO GET A QUAROM OF ACCEPTS, WHICH MAY BE SMALLER THAN THE PREPARE QUAROM
+	quarom_count = table->accept_quorum;
 	promise_count = 0;
 	current_status = -1;
 	current_result = (xdrMsg) { 0 };
 	message.status = OK;
 
-	if (message.command == RPC_PUT)
-		sprintf(s_command, "SEND=ACCEPT_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
-	else
-		sprintf(s_command, "SEND=ACCEPT_DEL(L=%d, K=%d)", message.lc, message.key);
-	// LOOP THROUGH ALL SERVERS AND GET ACCEPTS
-	for (int i = 0; i < server_count; i++)
+	// LOOP THROUGH ALL SERVERS AND GET ACCEPTS, THE LIVE ONES FIRST
+	phase = fd_now_ms();
+	fd_order(table, order);
+	for (int n = 0; n < table->count; n++)
 	{
-		if (strcmp(myname, servers[i]) == 0)
+		peer * the_peer = table->peers[order[n]];
+		char * host = the_peer->is_self ? "localhost" : the_peer->hostname;
+		(void) host;  // ONLY THE TRACE LINES READ IT, AND LOG_NO_TRACE TAKES THEM OUT
+		if (message.command == RPC_PUT)
+			LOG_TRACE("server.log", host, "SEND=ACCEPT_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
+		else if (message.command == RPC_DEL)
+			LOG_TRACE("server.log", host, "SEND=ACCEPT_DEL(L=%d, K=%d)", message.lc, message.key);
+		else if (message.command == RPC_GET)
+			LOG_TRACE("server.log", host, "SEND=ACCEPT_READ(L=%d, K=%d)", message.lc, message.key);
+		else
+			LOG_TRACE("server.log", host, "SEND=ACCEPT_MPUT(L=%d, N=%d)", message.lc, message.key);
+
+		if (the_peer->is_self)
 		{
 			// ALWAYS ASSUME I WILL ACCEPT MY OWN VALUE.
-			current_status = 0;
-			log_write("server.log", "localhost", s_command);
 			current_status         = 0;
 			current_result.lc      = message.lc;
 			current_result.status  = ACCEPT;
 			current_result.key     = message.key;
 			current_result.value   = message.value;
 			current_result.command = message.command;
-			current_result.pid     = 0;
+			current_result.pid     = message.pid;
+			if (batch != NULL)
+				hpb = *batch;
 			if (message.command == RPC_PUT)
-				sprintf(s_command, "RECV=ACCEPTED_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
+				LOG_TRACE("server.log", "localhost", "RECV=ACCEPTED_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
 			else
-				sprintf(s_command, "RECV=ACCEPTED_DEL(L=%d, K=%d)", message.lc, message.key);
-
-			log_write("server.log", "localhost", s_command);
+				LOG_TRACE("server.log", "localhost", "RECV=ACCEPTED_DEL(L=%d, K=%d)", message.lc, message.key);
+		} else if (batch != NULL) {
+			// THE ACCEPTOR COMPARES THE BATCH WITH THE DIGEST IT PROMISED AND KEEPS IT
+			xdrBatch batch_response = { 0 };
+			current_status = server_peer_batch_call(the_peer, RPC_ACCEPT_BATCH, batch, &batch_response);
+			current_result = message;
+			current_result.status = (current_status == 0) ? batch_response.status : NACK;
+			current_result.lc     = batch_response.lc;
+
+			if (current_result.status == ACCEPT)
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=ACCEPTED_MPUT(L=%d, N=%d)", message.lc, batch->count);
+			else
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=NACK(L=%d)", message.lc);
 		} else {
 
-			current_status = callrpc(servers[i],
-					RPC_PROG_NUM,
-					RPC_PROC_VER,
-					RPC_ACCEPT,
-					xdr_rpc,
-					&message,
-					xdr_rpc,
-					&response);
+			current_status = server_peer_call(the_peer, RPC_ACCEPT, &message, &response);
 			current_result = response;
 
 			if (response.status == ACCEPT && message.command == RPC_PUT)
-				sprintf(s_command, "RECV=ACCEPTED_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=ACCEPTED_PUT(L=%d, K=%d, V=%d)", message.lc, message.key, message.value);
 			else if (response.status == ACCEPT && message.command == RPC_DEL)
-				sprintf(s_command, "RECV=ACCEPTED_DEL(L=%d, K=%d)", message.lc, message.key);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=ACCEPTED_DEL(L=%d, K=%d)", message.lc, message.key);
 			else
-				sprintf(s_command, "RECV=NACK(L=%d)", message.lc);
-
-			log_write("server.log", servers[i], s_command);
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=NACK(L=%d)", message.lc);
 
 		}
 
@@ -611,122 +847,1233 @@ xdrMsg * proposer_propose(xdrMsg * indata)
 				break;
 		}
 	}  // ASK THE NEXT SERVER
+	stats_record(STATS_ACCEPT, fd_now_ms() - phase);
 
 
 	if (promise_count < quarom_count)
+		return(0);  // NO QUAROM
+
+	leader = server_my_id();
+	return(1);
+}
+
+
+// CODE THE PROPOSER WILL RUN WHEN A CLIENT SEND A GET
+xdrMsg * proposer_propose(xdrMsg * indata)
+{
+	double started = fd_now_ms();
+
+	server_set_deadline(indata);
+	my_lc = my_lc + 1;
+
+	switch (indata->command)
+	{
+	case RPC_PUT:
+		LOG_DEBUG("server.log", "client", "RECV=PROPOSE_PUT(L=%d, K=%d, V=%d)", my_lc, indata->key, indata->value);
+		break;
+	case RPC_DEL:
+		LOG_DEBUG("server.log", "client", "RECV=PROPOSE_DEL(L=%d, K=%d)", my_lc, indata->key);
+		break;
+	default:  // BAD COMMAND RETURN A NACK
+		LOG_WARN("server.log", "client", "RECV=PROPOSE_BAD(cmd=%d, L=%d)", indata->command, my_lc);
+		LOG_WARN("server.log", "client", "SEND=NACK(%d, L=%d)", indata->command, my_lc);
+		outdata_propose = *indata;
+		outdata_propose.status = NACK;
+		return(server_reply(server_trace_type(indata), &outdata_propose, started));
+	}
+
+
+	xdrMsg message;
+	xdrMsg response = { 0 };
+
+	message.key     = indata->key;
+	message.value   = indata->value;
+	message.lc      = my_lc;
+	message.pid     = server_trace_id(indata);
+	message.status  = OK;
+	message.command = indata->command;
+	message.deadline = 0;
+	message.hint    = server_my_id();  // SO THE ACCEPTORS KNOW WHO THE LEADER IS
+	message.lease   = 0;
+	message.consistency = READ_QUORUM;
+	message.staleness   = 0;
+	message.version     = VERSION_NONE;  // THE LEARNERS TAKE THE VERSION FROM LC
+
+	if (proposer_round(&message, NULL) == 0)
 	{
-		// NO QUAROM, RETURN THE FAILURE MESSAGE.
+		// NO QUAROM, RESPOND TO CLIENT WITH FAILURE
 		if (message.command == RPC_PUT)
-			sprintf(s_command, "SEND=PUT_FAILURE(K=%d, V=%d, L=%d)", message.key, message.value, my_lc);
+			LOG_WARN("server.log", "client", "SEND=PUT_FAILURE(%d,%d, L=%d)", message.key, message.value, my_lc);
 		else
-			sprintf(s_command, "SEND=DEL_FAILURE(K=%d, L=%d)", message.key, my_lc);
-
-		log_write("server.log", "client", s_command);
+			LOG_WARN("server.log", "client", "SEND=DEL_FAILURE(%d, L=%d)", message.key, my_lc);
+		outdata_propose.lc = my_lc;
+		outdata_propose.pid = message.pid;
 		outdata_propose.status = NACK;
 		outdata_propose.key = message.key;
 		outdata_propose.value = message.value;
 		outdata_propose.command = message.command;
-		outdata_propose.pid = 0;
-		outdata_propose.lc = my_lc;
-		return (&outdata_propose);
+		outdata_propose.lease = 0;
+		outdata_propose.version = VERSION_NONE;
+		stats_count(STATS_QUORUM_FAILURES);
+		metrics_quorum(0);
+		return(server_reply(server_trace_type(indata), &outdata_propose, started));
 	}
 
 
 	// WE HAVE A QUAROM AT THIS POINT, WITH A MAJORITY OF ACCEPTORS, SO WE JUST NEED TO TELL THEM ALL TO LEARN IT!
-	for (int i = 0; i < server_count; i++)
+	metrics_quorum(1);
+	peer_table * table = peer_table_current();
+	int acked = 0;          // LEARNERS THAT APPLIED THE WRITE (A DEL OF A MISSING KEY TOO)
+	int found = 0;          // 1 ONCE A LEARNER HAD THE KEY, A DEL NO ONE HAD IS A NACK
+	int lease_wait = 0;     // LONGEST READ LEASE ON THE KEY A LEARNER MAY STILL HAVE
+	double phase = fd_now_ms();
+	for (int i = 0; i < table->count; i++)
 	{
-		if (strcmp(myname, servers[i]) == 0)
+		peer * the_peer = table->peers[i];
+		if (the_peer->is_self)
 		{
 			// IF IT IS THE SAME, JUST DO THE LEARNING YOURSELF
 			if (message.command == RPC_PUT)
-				sprintf(s_command, "SEND=LEARN_PUT(%d,%d, L=%d)", message.key, message.value, my_lc);
+				LOG_TRACE("server.log", "localhost", "SEND=LEARN_PUT(%d,%d, L=%d)", message.key, message.value, my_lc);
 			else
-				sprintf(s_command, "SEND=LEARN_DEL(%d, L=%d)", message.key, my_lc);
-
-			log_write("server.log", "localhost", s_command);
-
-			int result;
-			if (message.command == RPC_PUT)
-				result = kv_put(kv_store, indata->key, indata->value);
-			else
-				result = kv_del(kv_store, indata->key);
+				LOG_TRACE("server.log", "localhost", "SEND=LEARN_DEL(%d, L=%d)", message.key, my_lc);
+
+			int result = server_apply(message.command, indata->key, indata->value, message.lc);
+			int remaining = lease_remaining(leases, indata->key, fd_now_ms());
+			if (remaining > lease_wait)
+				lease_wait = remaining;
+			if (result != MEMORY_ALLOCATION_ERROR)
+				acked++;
+			if (result == 0)
+				found = 1;
 
 			if (result == 0)
 			{
 				if  (message.command == RPC_PUT)
-					sprintf(s_command, "RECV=LEARN_SUCCESS(%d, %d, L=%d)", indata->key, indata->value, my_lc);
+					LOG_TRACE("server.log", "localhost", "RECV=LEARN_SUCCESS(%d, %d, L=%d)", indata->key, indata->value, my_lc);
 				else
-					sprintf(s_command, "RECV=LEARN_SUCCESS(%d, L=%d)", indata->key, my_lc);
+					LOG_TRACE("server.log", "localhost", "RECV=LEARN_SUCCESS(%d, L=%d)", indata->key, my_lc);
 			} else {
 				if (message.command == RPC_PUT)
-					sprintf(s_command, "RECV=LEARN_FAILURE(%d, %d, L=%d)", indata->key, indata->value, my_lc);
+					LOG_TRACE("server.log", "localhost", "RECV=LEARN_FAILURE(%d, %d, L=%d)", indata->key, indata->value, my_lc);
 				else
-					sprintf(s_command, "RECV=LEARN_FAILURE(%d, L=%d)", indata->key, my_lc);
+					LOG_TRACE("server.log", "localhost", "RECV=LEARN_FAILURE(%d, L=%d)", indata->key, my_lc);
 			}
 
-			log_write("server.log", "localhost", s_command);
-
+		} else if (fd_suspected(the_peer) == FD_SUSPECTED) {
+			// DON'T WAIT OUT THE TIMEOUT OF A DEAD LEARNER, ITS HEARTBEAT THREAD SENDS IT THE WRITE ONCE IT ANSWERS
+			LOG_TRACE("server.log", the_peer->hostname, "SKIP=LEARN(%d, L=%d, PHI=%.1f)", message.key, my_lc, fd_phi(&the_peer->fd));
+			stats_count(STATS_SKIPPED);
+			server_handoff(the_peer, indata->command, indata->key, indata->value, message.lc);
+			lease_wait = server_missed_lease(the_peer, lease_wait);
 		} else {
 			if (message.command == RPC_PUT)
-				sprintf(s_command, "SEND=LEARN_PUT(%d,%d, L=%d)", message.key, message.value, my_lc);
+				LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARN_PUT(%d,%d, L=%d)", message.key, message.value, my_lc);
 			else
-				sprintf(s_command, "SEND=LEARN_DEL(%d,%d, L=%d)", message.key, my_lc);
-
-			log_write("server.log", servers[i], s_command);
+				LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARN_DEL(%d, L=%d)", message.key, my_lc);
 			message.command = indata->command;
 			message.status = OK;
-			message.pid = 0;
-			int status = callrpc(servers[i],
-					RPC_PROG_NUM,
-					RPC_PROC_VER,
-					RPC_LEARN,
-					xdr_rpc,
-					&message,
-					xdr_rpc,
-					&response);
-			if (status == 0 & response.status == OK)
+			int status = server_peer_call(the_peer, RPC_LEARN, &message, &response);
+
+			if (status == 0 && response.lease > lease_wait)
+				lease_wait = response.lease;
+			if (status == 0 && response.status != FAILURE)
+				acked++;
+			else
 			{
+				server_handoff(the_peer, indata->command, indata->key, indata->value, message.lc);
+				lease_wait = server_missed_lease(the_peer, lease_wait);
+			}
+
+			if (status == 0 && response.status == OK)
+			{
+				found = 1;
 				if (message.command == RPC_PUT)
-					sprintf(s_command, "RECV=LEARN_PUT_SUCCESS(%d,%d, L=%d)", response.key, response.value, my_lc);
+					LOG_TRACE("server.log", the_peer->hostname, "RECV=LEARN_PUT_SUCCESS(%d,%d, L=%d)", response.key, response.value, my_lc);
 				else
-					sprintf(s_command, "RECV=LEARN_DEL_SUCCESS(%d, L=%d)", response.key, my_lc);
+					LOG_TRACE("server.log", the_peer->hostname, "RECV=LEARN_DEL_SUCCESS(%d, L=%d)", response.key, my_lc);
 			} else {
 				if (message.command == RPC_PUT)
-					sprintf(s_command, "RECV=LEARN_PUT_FAILURE(%d,%d, L=%d)", response.key, response.value, my_lc);
+					LOG_WARN("server.log", the_peer->hostname, "RECV=LEARN_PUT_FAILURE(%d,%d, L=%d)", response.key, response.value, my_lc);
 				else
-					sprintf(s_command, "RECV=LEARN_DEL_FAILURE(%d, L=%d)", response.key, my_lc);
+					LOG_WARN("server.log", the_peer->hostname, "RECV=LEARN_DEL_FAILURE(%d, L=%d)", response.key, my_lc);
 			}
 
-
-			log_write("server.log", servers[i], s_command);
-
 		}
 	}
+	stats_record(STATS_LEARN, fd_now_ms() - phase);
+
+	int lease_left = server_wait_lease(lease_wait);
+
+	// THE WRITE IS ONLY ACKNOWLEDGED ONCE EVERY READ QUAROM HAS A LEARNER THAT APPLIED IT, THE OTHERS GET IT LATER
+	int learn_status = (acked >= table->learn_quorum && found) ? OK : NACK;
+	if (acked < table->learn_quorum)
+		LOG_WARN("server.log", "client", "SEND=UNACKNOWLEDGED(%d, %d of %d learners, L=%d)", message.key, acked, table->learn_quorum, my_lc);
 
 
 	// NOW THAT ALL OF THE STUFF HAS BEEN DONE.  RETURN TO THE CLIENT.
 	outdata_propose.command = message.command;
 	outdata_propose.lc = my_lc;
 	outdata_propose.key = message.key;
-	outdata_propose.status = response.status;
+	outdata_propose.status = learn_status;
 	outdata_propose.value = message.value;
-	outdata_propose.pid = 0;
-	return(&outdata_propose);
+	outdata_propose.pid = message.pid;
+	outdata_propose.lease = lease_left;    // A CACHE MAY HOLD THE OLD VALUE THAT MUCH LONGER
+	outdata_propose.version = message.lc;  // THE SESSION TOKEN OF THE WRITER
+	return(server_reply(server_trace_type(indata), &outdata_propose, started));
+
+}
+
+
+/********************************************************
+ * READS THE KEYS OF AN RPC_MGET IN ONE ROUND: EVERY     *
+ * LEARNER GETS ALL THE KEYS IN ONE RPC_LEARN_BATCH AND  *
+ * LOOKS THEM UP UNDER ONE LOCK, AND A KEY IS OK ONCE A  *
+ * READ QUAROM AGREES ON ITS VALUE, AS IN PROPOSER_GET.  *
+ * REPLIES WITH THE VALUE AND RESULT OF EVERY KEY, AND   *
+ * OK IF EVERY KEY IS.                                   *
+ *******************************************************/
+xdrBatch * proposer_mget(xdrBatch * indata)
+{
+	double started = fd_now_ms();
+
+	xdrMsg header = server_batch_header(indata);
+	server_set_deadline(&header);
+	my_lc = my_lc + 1;
+	int count = indata->count;
+	LOG_DEBUG("server.log", "client", "RECV=MGET(N=%d, L=%d)", count, my_lc);
+	for (int k = 0; k < count; k++)
+		hot_record(HOT_READS, indata->keys[k]);
+
+	xdrBatch message = *indata;
+	message.status  = OK;
+	message.command = RPC_MGET;
+	message.lc      = my_lc;
+	message.pid     = server_trace_id(&header);
+	message.hint    = server_my_id();
+	message.lease   = 0;
+
+	peer_table * table = peer_table_current();
+	int quarom_count = table->read_quorum;  // MATCHING VALUES THE LEARNERS APPLIED, LIKE A GET
+
+	// PER KEY, THE VALUES SEEN SO FAR AND HOW MANY LEARNERS GAVE EACH
+	int seen[count + 1][quarom_count];
+	int votes[count + 1][quarom_count];
+	int distinct[count + 1];
+	int decided[count + 1];
+	int my_values[count + 1];
+	int my_results[count + 1];
+	for (int k = 0; k < count; k++)
+	{
+		distinct[k]   = 0;
+		decided[k]    = 0;
+		my_results[k] = NACK;
+	}
+
+	xdrBatch response = { 0 };
+	int remaining = count;
+	double phase = fd_now_ms();
+	int order[table->count];
+	fd_order(table, order);
+	for (int n = 0; n < table->count && remaining > 0; n++)
+	{
+		peer * the_peer = table->peers[order[n]];
+		int status;
+		if (the_peer->is_self)
+		{
+			LOG_TRACE("server.log", "localhost", "SEND=LEARNER_MGET(N=%d, L=%d)", count, my_lc);
+			int results[RPC_BATCH_MAX];
+			kv_get_many(kv_store, count, message.keys, response.values, results);
+			for (int k = 0; k < count; k++)
+			{
+				response.results[k] = (results[k] == 0) ? OK : NACK;
+				my_values[k]  = response.values[k];
+				my_results[k] = response.results[k];
+			}
+			status = 0;
+		} else {
+			LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARNER_MGET(N=%d, L=%d)", count, my_lc);
+			status = server_peer_batch_call(the_peer, RPC_LEARN_BATCH, &message, &response);
+			if (status == 0 && response.count != count)
+				status = RPC_CANTDECODERES;
+		}
+
+		if (status != 0)
+		{
+			LOG_TRACE("server.log", the_peer->hostname, "RECV=FAILURE(L=%d)", my_lc);
+			continue;
+		}
+
+		// COUNT THE VALUE OF EVERY KEY THAT HAS NO QUAROM YET
+		for (int k = 0; k < count; k++)
+		{
+			if (decided[k] || response.results[k] != OK)
+				continue;
+			int j = 0;
+			while (j < distinct[k] && seen[k][j] != response.values[k])
+				j++;
+			if (j == distinct[k])
+			{
+				if (distinct[k] == quarom_count)
+					continue;  // AS MANY VALUES AS A QUAROM ALREADY, A NEW ONE CAN'T WIN
+				seen[k][j]  = response.values[k];
+				votes[k][j] = 0;
+				distinct[k]++;
+			}
+			votes[k][j]++;
+			if (votes[k][j] >= quarom_count)
+			{
+				decided[k] = 1;
+				outdata_mget.values[k] = seen[k][j];
+				remaining--;
+			}
+		}
+	}  // LOOP TO THE NEXT SERVER
+	stats_record(STATS_READ, fd_now_ms() - phase);
+
+	// I'M OUT OF DATE ON SOME KEYS, SO I'M LEARNING THEIR VALUES, UNDER ONE LOCK
+	int stale_keys[RPC_BATCH_MAX];
+	int stale_values[RPC_BATCH_MAX];
+	int stale_results[RPC_BATCH_MAX];
+	int stale = 0;
+	outdata_mget.count = count;
+	for (int k = 0; k < count; k++)
+	{
+		outdata_mget.keys[k]    = indata->keys[k];
+		outdata_mget.results[k] = decided[k] ? OK : NACK;
+		if (!decided[k])
+			outdata_mget.values[k] = -1;
+		else if (my_results[k] != OK || my_values[k] != outdata_mget.values[k])
+		{
+			stale_keys[stale]   = outdata_mget.keys[k];
+			stale_values[stale] = outdata_mget.values[k];
+			stale++;
+		}
+	}
+	if (stale > 0)
+	{
+		kv_put_many(kv_store, stale, stale_keys, stale_values, stale_results);
+		LOG_DEBUG("server.log", "localhost", "Learning %d Keys", stale);
+	}
+
+	outdata_mget.status  = (remaining == 0) ? OK : NACK;
+	outdata_mget.lease   = 0;
+	outdata_mget.version = VERSION_NONE;
+	outdata_mget.command = RPC_MGET;
+	outdata_mget.lc      = my_lc;
+	outdata_mget.pid     = message.pid;
+	if (remaining == 0)
+	{
+		LOG_DEBUG("server.log", "client", "SEND=MGET_OK(N=%d, L=%d)", count, my_lc);
+		metrics_quorum(1);
+	} else {
+		LOG_WARN("server.log", "client", "SEND=MGET_NACK(%d of %d keys, L=%d)", remaining, count, my_lc);
+		stats_count(STATS_QUORUM_FAILURES);
+		metrics_quorum(0);
+	}
+	return(server_batch_reply(TRACE_MGET, &outdata_mget, started));
+}
+
+
+/********************************************************
+ * COMMITS THE PUTS OF AN RPC_MPUT AS ONE PAXOS INSTANCE *
+ * WHOSE VALUE IS THE DIGEST OF THE BATCH.  THE ACCEPTS  *
+ * CARRY THE WHOLE BATCH, SO A QUAROM OF ACCEPTORS HOLDS *
+ * IT.  THEN SENDS IT TO EVERY LEARNER IN ONE            *
+ * RPC_LEARN_BATCH, APPLIED UNDER ONE LOCK.  REPLIES     *
+ * WITH THE RESULT OF EVERY PUT, AND OK IF EVERY ONE IS  *
+ * AND A LEARN QUAROM APPLIED THE BATCH.                 *
+ *******************************************************/
+xdrBatch * proposer_mput(xdrBatch * indata)
+{
+	double started = fd_now_ms();
+
+	xdrMsg header = server_batch_header(indata);
+	server_set_deadline(&header);
+	my_lc = my_lc + 1;
+	int count = indata->count;
+	LOG_DEBUG("server.log", "client", "RECV=PROPOSE_MPUT(L=%d, N=%d)", my_lc, count);
+
+	outdata_mput = *indata;
+	outdata_mput.command = RPC_MPUT;
+	outdata_mput.lease   = 0;
+	outdata_mput.version = VERSION_NONE;
+	outdata_mput.pid     = server_trace_id(&header);
+	for (int k = 0; k < count; k++)
+		outdata_mput.results[k] = NACK;
+
+	xdrMsg proposal = { 0 };
+	proposal.key     = count;
+	proposal.value   = xdr_batch_digest(indata);
+	proposal.lc      = my_lc;
+	proposal.pid     = outdata_mput.pid;
+	proposal.status  = OK;
+	proposal.command = RPC_MPUT;
+	proposal.hint    = server_my_id();
+
+	// THE ACCEPTORS GET THE BATCH ITSELF, NOT ONLY THE DIGEST A QUAROM AGREES ON
+	xdrBatch accepted = *indata;
+	accepted.status  = OK;
+	accepted.command = RPC_MPUT;
+	accepted.lc      = my_lc;
+	accepted.pid     = outdata_mput.pid;
+	accepted.hint    = proposal.hint;
+	accepted.lease   = 0;
+
+	if (count < 1 || proposer_round(&proposal, &accepted) == 0)
+	{
+		// NO QUAROM, NONE OF THE PUTS HAPPENED
+		LOG_WARN("server.log", "client", "SEND=MPUT_FAILURE(N=%d, L=%d)", count, my_lc);
+		outdata_mput.status = NACK;
+		outdata_mput.lc     = my_lc;
+		stats_count(STATS_QUORUM_FAILURES);
+		metrics_quorum(0);
+		return(server_batch_reply(TRACE_MPUT, &outdata_mput, started));
+	}
+
+	// A QUAROM ACCEPTED THE BATCH, EVERY SERVER LEARNS ALL OF IT
+	metrics_quorum(1);
+	xdrBatch message = accepted;
+
+	xdrBatch response = { 0 };
+	int have_results = 0;
+	int acked = 0;       // LEARNERS THAT APPLIED THE BATCH
+	int lease_wait = 0;  // LONGEST READ LEASE ON ANY OF THE KEYS A LEARNER MAY STILL HAVE
+	peer_table * table = peer_table_current();
+	double phase = fd_now_ms();
+	for (int i = 0; i < table->count; i++)
+	{
+		peer * the_peer = table->peers[i];
+		if (the_peer->is_self)
+		{
+			LOG_TRACE("server.log", "localhost", "SEND=LEARN_MPUT(N=%d, L=%d)", count, my_lc);
+			int results[RPC_BATCH_MAX];
+			server_apply_many(count, indata->keys, indata->values, results, message.lc);
+			int applied = 1;
+			for (int k = 0; k < count; k++)
+			{
+				outdata_mput.results[k] = (results[k] == 0) ? OK : NACK;
+				if (results[k] == MEMORY_ALLOCATION_ERROR)
+					applied = 0;
+			}
+			int remaining = server_lease_many(count, indata->keys);
+			if (remaining > lease_wait)
+				lease_wait = remaining;
+			have_results = 1;
+			acked += applied;
+		} else if (fd_suspected(the_peer) == FD_SUSPECTED) {
+			// DON'T WAIT OUT THE TIMEOUT OF A DEAD LEARNER, ITS HEARTBEAT THREAD SENDS IT THE PUTS ONCE IT ANSWERS
+			LOG_TRACE("server.log", the_peer->hostname, "SKIP=LEARN_MPUT(N=%d, L=%d, PHI=%.1f)", count, my_lc, fd_phi(&the_peer->fd));
+			stats_count(STATS_SKIPPED);
+			for (int k = 0; k < count; k++)
+				server_handoff(the_peer, RPC_PUT, indata->keys[k], indata->values[k], message.lc);
+			lease_wait = server_missed_lease(the_peer, lease_wait);
+		} else {
+			LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARN_MPUT(N=%d, L=%d)", count, my_lc);
+			int status = server_peer_batch_call(the_peer, RPC_LEARN_BATCH, &message, &response);
+			if (status == 0 && response.count == count)
+			{
+				LOG_TRACE("server.log", the_peer->hostname, "RECV=LEARN_MPUT_SUCCESS(N=%d, L=%d)", count, my_lc);
+				if (response.lease > lease_wait)
+					lease_wait = response.lease;
+				if (!have_results)  // I'M NOT A LEARNER, ANSWER WITH WHAT THIS ONE DID
+					for (int k = 0; k < count; k++)
+						outdata_mput.results[k] = response.results[k];
+				have_results = 1;
+
+				// A PUT IT COULD NOT RECORD IS SENT AGAIN LATER, LIKE THE WHOLE BATCH OF A LEARNER THAT DIDN'T ANSWER
+				int applied = 1;
+				for (int k = 0; k < count; k++)
+					if (response.results[k] == FAILURE)
+					{
+						server_handoff(the_peer, RPC_PUT, indata->keys[k], indata->values[k], message.lc);
+						applied = 0;
+					}
+				acked += applied;
+				if (!applied)
+					lease_wait = server_missed_lease(the_peer, lease_wait);
+			} else {
+				LOG_WARN("server.log", the_peer->hostname, "RECV=LEARN_MPUT_FAILURE(N=%d, L=%d)", count, my_lc);
+				for (int k = 0; k < count; k++)
+					server_handoff(the_peer, RPC_PUT, indata->keys[k], indata->values[k], message.lc);
+				lease_wait = server_missed_lease(the_peer, lease_wait);
+			}
+		}
+	}
+	stats_record(STATS_LEARN, fd_now_ms() - phase);
+
+	outdata_mput.lease = server_wait_lease(lease_wait);
+
+	// ACKNOWLEDGED LIKE A PUT, ONCE EVERY READ QUAROM HAS A LEARNER THAT APPLIED THE BATCH
+	outdata_mput.status = (acked >= table->learn_quorum) ? OK : NACK;
+	if (acked < table->learn_quorum)
+		LOG_WARN("server.log", "client", "SEND=MPUT_UNACKNOWLEDGED(N=%d, %d of %d learners, L=%d)", count, acked, table->learn_quorum, my_lc);
+	for (int k = 0; k < count; k++)
+		if (outdata_mput.results[k] != OK)
+			outdata_mput.status = NACK;
+	outdata_mput.lc = my_lc;
+	outdata_mput.version = message.lc;
+	return(server_batch_reply(TRACE_MPUT, &outdata_mput, started));
+}
+
+
+/********************************************************
+ * LOOKS UP (RPC_MGET) OR APPLIES (RPC_MPUT) EVERY KEY   *
+ * OF THE BATCH UNDER ONE LOCK OF THE STORE AND REPLIES  *
+ * WITH THE VALUE AND RESULT OF EACH.                    *
+ *******************************************************/
+xdrBatch * learner_learn_batch(xdrBatch * indata)
+{
+	double started = fd_now_ms();
+	if (fault_receive(server_peer_name(indata->hint)) == FAULT_DROP)
+		return(NULL);  // NO REPLY, THE SENDER TIMES OUT AS IF THE NETWORK LOST IT
+
+	outdata_learn_batch = *indata;
+	outdata_learn_batch.lc = my_lc;
+	outdata_learn_batch.lease = 0;
+	outdata_learn_batch.version = VERSION_NONE;
+
+	int count = indata->count;
+	int results[RPC_BATCH_MAX];
+	switch (indata->command)
+	{
+	case RPC_MGET:
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_MGET(N=%d, L=%d)", count, my_lc);
+		kv_get_many(kv_store, count, indata->keys, outdata_learn_batch.values, results);
+		break;
+	case RPC_MPUT:
+		LOG_TRACE("server.log", "proposer", "RECV=LEARN_MPUT(N=%d, L=%d)", count, my_lc);
+		server_apply_many(count, indata->keys, indata->values, results, indata->lc);
+		outdata_learn_batch.lease = server_lease_many(count, indata->keys);  // THE PROPOSER WAITS IT OUT
+		break;
+	default:
+		LOG_WARN("server.log", "proposer", "RECV=BAD_LEARN_BATCH(%d, L=%d)", indata->command, my_lc);
+		for (int k = 0; k < count; k++)
+			results[k] = -1;
+	}
 
+	outdata_learn_batch.status = OK;
+	for (int k = 0; k < count; k++)
+	{
+		outdata_learn_batch.results[k] = (results[k] == 0) ? OK : (results[k] == MEMORY_ALLOCATION_ERROR) ? FAILURE : NACK;
+		if (results[k] != 0)
+			outdata_learn_batch.status = NACK;
+	}
+	return(server_batch_reply(TRACE_RECV_LEARN, &outdata_learn_batch, started));
 }
 
 
-/******************
- * Randomly quits *
- *****************/
-void chaos_function()
+// CODE THE PROPOSER WILL RUN WHEN AN ADMIN ADDS OR REMOVES A SERVER
+xdrMsg * proposer_reconfig(xdrMsg * indata)
 {
-	int r = (rand() % 100);
-	if (r < FAIL_RATE)
+	double started = fd_now_ms();
+	server_set_deadline(indata);
+	my_lc = my_lc + 1;
+
+	peer_table * old_table = peer_table_current();
+	int index = config_find_address(old_table, indata->value);
+	int id;
+	if (indata->command == CONFIG_ADD_NODE)
+		id = (index >= 0) ? old_table->peers[index]->id : config_next_id(old_table);
+	else
+		id = (index >= 0) ? old_table->peers[index]->id : -1;
+
+	xdrMsg message = { 0 };
+	message.key     = id;
+	message.value   = indata->value;
+	message.lc      = my_lc;
+	message.pid     = server_trace_id(indata);
+	message.status  = OK;
+	message.command = indata->command;
+	message.hint    = server_my_id();
+
+	outdata_reconfig = message;
+	outdata_reconfig.status = NACK;
+
+	LOG_INFO("server.log", "client", "RECV=RECONFIG(cmd=%d, id=%d, L=%d)", message.command, id, my_lc);
+
+	if (indata->command != CONFIG_ADD_NODE && indata->command != CONFIG_DEL_NODE)
 	{
-		log_write("server.log", myname, "!!!!!!!SYSTEM_FAILURE!!!!!");
-		exit(-1);
+		LOG_WARN("server.log", "client", "SEND=NACK(BAD_RECONFIG)");
+		return(server_reply(TRACE_RECONFIG, &outdata_reconfig, started));
 	}
+
+	peer_table * new_table = config_build(old_table, message.command, id, message.value);
+
+	// THE UNION OF THE TWO CONFIGURATIONS IS THE LARGER ONE
+	peer_table * joint = old_table;
+	if (new_table != NULL && new_table->count > old_table->count)
+		joint = new_table;
+
+	if (new_table != NULL)
+	{
+		// THE CHANGE NEEDS A QUAROM OF THE OLD AND OF THE NEW CONFIGURATION
+		if (server_joint_round(joint, old_table, new_table, RPC_PREPARE, PROMISE, &message) == 0
+		||  server_joint_round(joint, old_table, new_table, RPC_ACCEPT, ACCEPT, &message) == 0)
+		{
+			LOG_WARN("server.log", "client", "SEND=RECONFIG_FAILURE(id=%d, L=%d)", id, my_lc);
+			server_free_joint(old_table, new_table);
+			stats_count(STATS_QUORUM_FAILURES);
+			metrics_quorum(0);
+			outdata_reconfig.lc = my_lc;
+			return(server_reply(TRACE_RECONFIG, &outdata_reconfig, started));
+		}
+	}
+	// OTHERWISE THE CHANGE WAS ALREADY DECIDED HERE, JUST TELL EVERYONE AGAIN
+	metrics_quorum(1);
+
+	// TELL EVERY SERVER OF BOTH CONFIGURATIONS TO LEARN IT
+	int changed = (new_table != NULL);
+	int learned = 0;
+	for (int i = 0; i < joint->count; i++)
+	{
+		peer * the_peer = joint->peers[i];
+		if (the_peer->is_self)
+		{
+			config_apply(message.command, message.key, message.value);
+			learned++;
+		} else {
+			xdrMsg response = { 0 };
+			message.status = OK;
+			LOG_TRACE("server.log", the_peer->hostname, "SEND=LEARN_RECONFIG(cmd=%d, id=%d, L=%d)", message.command, id, my_lc);
+			if (server_peer_call(the_peer, RPC_LEARN, &message, &response) == 0 && response.status == OK)
+				learned++;
+			else
+				LOG_WARN("server.log", the_peer->hostname, "RECV=LEARN_RECONFIG_FAILURE");
+		}
+	}
+
+	if (changed)
+		server_free_joint(old_table, new_table);
+
+	// THE NEW MEMBER STARTS EMPTY, COPY THE STORE TO IT IN THE BACKGROUND
+	peer_table * table = peer_table_current();
+	if (message.command == CONFIG_ADD_NODE && changed)
+	{
+		int new_index = peer_table_find(table, id);
+		if (new_index >= 0 && !table->peers[new_index]->is_self)
+			config_catchup(table->peers[new_index], kv_store, versions);
+	}
+
+	LOG_INFO("server.log", "client", "SEND=RECONFIG_SUCCESS(id=%d, learned=%d, servers=%d, q1=%d, q2=%d)",
+			id, learned, table->count, table->prepare_quorum, table->accept_quorum);
+
+	outdata_reconfig.status = OK;
+	outdata_reconfig.key    = id;
+	outdata_reconfig.value  = learned;
+	outdata_reconfig.lc     = my_lc;
+	return(server_reply(TRACE_RECONFIG, &outdata_reconfig, started));
+}
+
+
+// FREES THE PROPOSED TABLE AND THE PEER IT ADDED, THE LEARN MADE ITS OWN
+void server_free_joint(peer_table * old_table, peer_table * new_table)
+{
+	if (new_table->count > old_table->count)
+	{
+		peer * added = new_table->peers[new_table->count - 1];
+		if (added->handle != NULL)
+			clnt_destroy(added->handle);
+		free(added);
+	}
+	free(new_table);
+}
+
+
+/********************************************************
+ * SENDS THE MESSAGE TO EVERY SERVER OF THE JOINT TABLE  *
+ * WITH THE PROCEDURE PROVIDED AND COUNTS THE RESPONSES  *
+ * WITH THE EXPECTED STATUS.  RETURNS 1 ONCE A QUAROM OF *
+ * THE OLD AND A QUAROM OF THE NEW TABLE RESPONDED, AND  *
+ * 0 IF THAT CAN'T BE REACHED.                           *
+ *******************************************************/
+int server_joint_round(peer_table * joint, peer_table * old_table, peer_table * new_table,
+		int procedure, int expected, xdrMsg * message)
+{
+	int old_count = 0;
+	int new_count = 0;
+
+	int order[joint->count];
+	fd_order(joint, order);
+	for (int n = 0; n < joint->count; n++)
+	{
+		peer * the_peer = joint->peers[order[n]];
+		int ok;
+
+		if (the_peer->is_self)
+		{
+			// ALWAYS ASSUME I WILL PROMISE AND ACCEPT MY OWN VALUE.
+			ok = 1;
+		} else {
+			xdrMsg response = { 0 };
+			message->status = OK;
+			LOG_TRACE("server.log", the_peer->hostname, "SEND=%s_RECONFIG(L=%d, id=%d)", procedure == RPC_PREPARE ? "PREPARE" : "ACCEPT", message->lc, message->key);
+
+			int status = server_peer_call(the_peer, procedure, message, &response);
+			ok = (status == 0 && response.status == expected);
+			if (ok && procedure == RPC_ACCEPT)
+				ok = (xdr_compare(&response, message) == 1);
+
+			if (status == 0 && response.lc > my_lc)
+				my_lc = response.lc;
+
+			LOG_TRACE("server.log", the_peer->hostname, "RECV=%s(L=%d)", ok ? "OK" : "NACK", response.lc);
+		}
+
+		if (ok)
+		{
+			if (peer_table_find(old_table, the_peer->id) >= 0)
+				old_count++;
+			if (peer_table_find(new_table, the_peer->id) >= 0)
+				new_count++;
+		}
+
+		if (old_count >= server_quorum(old_table, procedure) && new_count >= server_quorum(new_table, procedure))
+			return(1);
+	}
+
+	return(0);
+}
+
+
+// RETURNS THE QUAROM THE TABLE NEEDS FOR THE PHASE OF THE PROCEDURE PROVIDED
+int server_quorum(peer_table * table, int procedure)
+{
+	if (procedure == RPC_ACCEPT)
+		return(table->accept_quorum);
+	return(table->prepare_quorum);
+}
+
+
+/********************************************************
+ * SENDS THE MESSAGE TO THE PEER PROVIDED AND WAITS FOR  *
+ * THE RESPONSE.  THE TIMEOUT COMES FROM THE ROUND TRIP  *
+ * ESTIMATE OF THAT PEER AND IS CUT TO WHAT IS LEFT      *
+ * BEFORE THE CLIENT'S DEADLINE.  RETURNS 0 ON SUCCESS,  *
+ * OTHERWISE THE CLNT_STAT OF THE FAILURE.               *
+ *******************************************************/
+int server_peer_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response)
+{
+	double now = fd_now_ms();
+	double timeout = rtt_timeout(&the_peer->rtt);
+
+	if (request_deadline > 0 && now + timeout > request_deadline)
+		timeout = request_deadline - now;
+
+	if (timeout <= 0)  // THE CLIENT HAS ALREADY GIVEN UP, DON'T BOTHER
+		return(RPC_TIMEDOUT);
+
+	int status = server_transport(the_peer, procedure, message, response, timeout);
+
+	if (procedure == RPC_PREPARE || procedure == RPC_ACCEPT || procedure == RPC_LEARN)
+		TRACE_EVENT(procedure == RPC_PREPARE ? TRACE_SEND_PREPARE : (procedure == RPC_ACCEPT ? TRACE_SEND_ACCEPT : TRACE_SEND_LEARN),
+				(uint32_t) message->pid, the_peer->id, message->key, message->value, message->lc,
+				status == RPC_SUCCESS ? response->status : FAILURE, fd_now_ms() - now);
+
+	if (status == RPC_SUCCESS)
+	{
+		rtt_sample(&the_peer->rtt, fd_now_ms() - now);
+		fd_heartbeat(&the_peer->fd);
+		if (response->status == NACK)
+			stats_count(STATS_NACKS);
+	} else {
+		stats_count(STATS_PEER_FAILURES);
+		if (status == RPC_TIMEDOUT)
+		{
+			stats_count(STATS_TIMEOUTS);
+			rtt_backoff(&the_peer->rtt);
+		}
+	}
+
+	return(status);
+}
+
+
+/********************************************************
+ * CALLS THE PEER OVER RPC, THE DEFAULT TRANSPORT.  ANY  *
+ * INJECTED FAULTS ARE APPLIED HERE.  A HANDLE THAT      *
+ * TIMED OUT IS KEPT, ONE THAT FAILED OTHERWISE OR OF A  *
+ * SUSPECTED PEER IS DROPPED WITH ITS PORT, SO THE NEXT  *
+ * CALL ASKS ITS PORTMAPPER AGAIN, WITHIN THE TIMEOUT.   *
+ *******************************************************/
+int server_rpc_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response, double timeout)
+{
+	if (server_peer_handle(the_peer, &timeout) != 0)
+		return(the_peer->handle == NULL ? RPC_CANTSEND : RPC_TIMEDOUT);
+
+	// AN INJECTED DELAY COMES OFF THE TIMEOUT
+	int fault = fault_send(the_peer->hostname, &timeout);
+
+	struct timeval tv;
+	tv.tv_sec  = (long) timeout / 1000;
+	tv.tv_usec = ((long) (timeout * 1000)) % 1000000;
+
+	// ONE TRANSMISSION PER CALL, SO EVERY REPLY IS A CLEAN RTT SAMPLE
+	clnt_control(the_peer->handle, CLSET_RETRY_TIMEOUT, (char *) &tv);
+	message->deadline = (int) timeout;
+
+	enum clnt_stat status;
+	if (fault == FAULT_DROP)
+	{
+		status = RPC_TIMEDOUT;  // FAULT_SEND HAS ALREADY WAITED IT OUT
+	} else {
+		status = clnt_call(the_peer->handle, procedure,
+				(xdrproc_t) xdr_rpc, (caddr_t) message,
+				(xdrproc_t) xdr_rpc, (caddr_t) response,
+				tv);
+
+		// THE PEER HANDLES THE SAME MESSAGE AGAIN.  A ZERO TIMEOUT SENDS IT WITHOUT WAITING, THE HANDLE DROPS ITS ANSWER LATER
+		if (fault == FAULT_DUPLICATE && status == RPC_SUCCESS)
+		{
+			struct timeval no_wait = { 0, 0 };
+			xdrMsg duplicate = { 0 };
+			clnt_call(the_peer->handle, procedure,
+					(xdrproc_t) xdr_rpc, (caddr_t) message,
+					(xdrproc_t) xdr_rpc, (caddr_t) &duplicate,
+					no_wait);
+		}
+	}
+
+	server_peer_failed(the_peer, status);
+
+	return(status);
+}
+
+
+/********************************************************
+ * SENDS THE BATCH TO THE PEER PROVIDED AS               *
+ * SERVER_PEER_CALL SENDS A MESSAGE, WITH THE SAME       *
+ * TIMEOUT AND BOOKKEEPING.  THE SIMULATOR ONLY CARRIES  *
+ * XDRMSG, SO UNDER IT THE CALL FAILS WITH               *
+ * RPC_PROCUNAVAIL.                                      *
+ *******************************************************/
+int server_peer_batch_call(peer * the_peer, int procedure, xdrBatch * message, xdrBatch * response)
+{
+	if (server_transport != server_rpc_call)
+		return(RPC_PROCUNAVAIL);
+
+	double now = fd_now_ms();
+	double timeout = rtt_timeout(&the_peer->rtt);
+
+	if (request_deadline > 0 && now + timeout > request_deadline)
+		timeout = request_deadline - now;
+
+	if (timeout <= 0)  // THE CLIENT HAS ALREADY GIVEN UP, DON'T BOTHER
+		return(RPC_TIMEDOUT);
+
+	int status = server_rpc_batch_call(the_peer, procedure, message, response, timeout);
+
+	TRACE_EVENT(TRACE_SEND_LEARN, (uint32_t) message->pid, the_peer->id, message->count, message->command, message->lc,
+			status == RPC_SUCCESS ? response->status : FAILURE, fd_now_ms() - now);
+
+	if (status == RPC_SUCCESS)
+	{
+		rtt_sample(&the_peer->rtt, fd_now_ms() - now);
+		fd_heartbeat(&the_peer->fd);
+		if (response->status == NACK)
+			stats_count(STATS_NACKS);
+	} else {
+		stats_count(STATS_PEER_FAILURES);
+		if (status == RPC_TIMEDOUT)
+		{
+			stats_count(STATS_TIMEOUTS);
+			rtt_backoff(&the_peer->rtt);
+		}
+	}
+
+	return(status);
+}
+
+
+// SERVER_RPC_CALL FOR AN XDRBATCH, WITH THE SAME INJECTED FAULTS
+int server_rpc_batch_call(peer * the_peer, int procedure, xdrBatch * message, xdrBatch * response, double timeout)
+{
+	if (server_peer_handle(the_peer, &timeout) != 0)
+		return(the_peer->handle == NULL ? RPC_CANTSEND : RPC_TIMEDOUT);
+
+	int fault = fault_send(the_peer->hostname, &timeout);
+
+	struct timeval tv;
+	tv.tv_sec  = (long) timeout / 1000;
+	tv.tv_usec = ((long) (timeout * 1000)) % 1000000;
+
+	clnt_control(the_peer->handle, CLSET_RETRY_TIMEOUT, (char *) &tv);
+	message->deadline = (int) timeout;
+
+	enum clnt_stat status;
+	if (fault == FAULT_DROP)
+	{
+		status = RPC_TIMEDOUT;
+	} else {
+		status = clnt_call(the_peer->handle, procedure,
+				(xdrproc_t) xdr_batch, (caddr_t) message,
+				(xdrproc_t) xdr_batch, (caddr_t) response,
+				tv);
+
+		if (fault == FAULT_DUPLICATE && status == RPC_SUCCESS)
+		{
+			struct timeval no_wait = { 0, 0 };
+			xdrBatch duplicate = { 0 };
+			clnt_call(the_peer->handle, procedure,
+					(xdrproc_t) xdr_batch, (caddr_t) message,
+					(xdrproc_t) xdr_batch, (caddr_t) &duplicate,
+					no_wait);
+		}
+	}
+
+	server_peer_failed(the_peer, status);
+
+	return(status);
+}
+
+
+// MAKES THE HANDLE OF THE PEER IF IT HAS NONE, TAKING THE TIME IT TOOK OFF THE TIMEOUT.  -1 IF THERE IS NO HANDLE OR TIME LEFT
+int server_peer_handle(peer * the_peer, double * timeout)
+{
+	if (the_peer->handle != NULL)
+		return(0);
+
+	double now = fd_now_ms();
+	the_peer->handle = peer_connect(the_peer, *timeout);
+	*timeout -= fd_now_ms() - now;
+	return((the_peer->handle == NULL || *timeout <= 0) ? -1 : 0);
+}
+
+
+// A HANDLE THAT ONLY TIMED OUT IS KEPT.  ANY OTHER FAILURE, OR A PEER THE DETECTOR HAS GIVEN UP ON, IS LOOKED UP AGAIN NEXT TIME
+void server_peer_failed(peer * the_peer, int status)
+{
+	if (status == RPC_SUCCESS || (status == RPC_TIMEDOUT && fd_suspected(the_peer) != FD_SUSPECTED))
+		return;
+
+	// THE SERVER MAY HAVE RESTARTED ON A NEW PORT
+	clnt_destroy(the_peer->handle);
+	the_peer->handle = NULL;
+	peer_forget_port(the_peer);
+}
+
+
+/********************************************************
+ * COPIES THE STATE OF THE SERVER INTO STATE.            *
+ *******************************************************/
+void server_state_save(server_state * state)
+{
+	state->kv_store = kv_store;
+	state->table    = peer_table_current();
+	strncpy(state->myname, myname, PEER_HOST_LENGTH - 1);
+	state->request_deadline = request_deadline;
+	state->my_lc = my_lc;
+	state->hpc   = hpc;
+	state->hpv   = hpv;
+	state->hpb   = hpb;
+	state->leader = leader;
+	state->leases = leases;
+	state->versions = versions;
+}
+
+
+/********************************************************
+ * MAKES STATE THE STATE OF THE SERVER.  THE NEXT        *
+ * HANDLER RUNS AS THE SERVER IT WAS SAVED FROM.         *
+ *******************************************************/
+void server_state_load(server_state * state)
+{
+	kv_store = state->kv_store;
+	peer_table_use(state->table);
+	strcpy(myname, state->myname);
+	request_deadline = state->request_deadline;
+	my_lc = state->my_lc;
+	hpc   = state->hpc;
+	hpv   = state->hpv;
+	hpb   = state->hpb;
+	leader = state->leader;
+	leases = state->leases;
+	versions = state->versions;
+}
+
+
+// RECORDS AN ANSWER IN THE TRACE AND THE HANDLER'S HISTOGRAM AND RETURNS IT
+xdrMsg * server_reply(int type, xdrMsg * reply, double started)
+{
+	double latency = fd_now_ms() - started;
+	TRACE_EVENT(type, (uint32_t) reply->pid, TRACE_NO_PEER, reply->key, reply->value, reply->lc, reply->status, latency);
+	metrics_request(type);
+	reply->hint = leader;
+
+	int get_histogram = STATS_H_GET;  // EVERY CONSISTENCY OF A GET HAS ITS OWN
+	if (reply->consistency == READ_LOCAL)
+		get_histogram = STATS_H_GET_LOCAL;
+	else if (reply->consistency == READ_LINEARIZABLE)
+		get_histogram = STATS_H_GET_LINEAR;
+
+	switch (type)
+	{
+	case TRACE_GET:          stats_record(get_histogram, latency);  break;
+	case TRACE_PUT:
+	case TRACE_DEL:          stats_record(STATS_H_PROPOSE, latency); break;
+	case TRACE_RECV_PREPARE: stats_record(STATS_H_PREPARE, latency); break;
+	case TRACE_RECV_ACCEPT:  stats_record(STATS_H_ACCEPT, latency);  break;
+	case TRACE_RECV_LEARN:   stats_record(STATS_H_LEARN, latency);   break;
+	}
+	return(reply);
+}
+
+
+// APPLIES A LEARNED PUT OR DEL OF THE VERSION PROVIDED TO THE LOCAL STORE, RETURNS WHAT KV_PUT OR KV_DEL DID.
+// A WRITE OLDER THAN THE ONE APPLIED TO THE KEY IS SKIPPED AND RETURNS 0, THE LEARNS OF TWO PROPOSERS CAN
+// ARRIVE IN EITHER ORDER.  RETURNS MEMORY_ALLOCATION_ERROR, WITHOUT TOUCHING THE STORE, IF THE VERSION
+// CANNOT BE RECORDED
+int server_apply(int command, int key, int value, int version)
+{
+	double started = fd_now_ms();
+	hot_record(HOT_WRITES, key);
+	if (version < version_get(versions, key))
+	{
+		LOG_TRACE("server.log", "localhost", "SUPERSEDED(%d, V=%d < %d)", key, version, version_get(versions, key));
+		return(0);
+	}
+	if (version_set(versions, key, version) != 0)
+	{
+		LOG_WARN("server.log", "localhost", "NO_MEMORY_FOR_VERSION(%d, V=%d)", key, version);
+		return(MEMORY_ALLOCATION_ERROR);
+	}
+
+	int result;
+	if (command == RPC_PUT)
+		result = kv_put(kv_store, key, value);
+	else
+		result = kv_del(kv_store, key);
+	stats_record(STATS_APPLY, fd_now_ms() - started);
+	return(result);
+}
+
+
+// KEEPS A WRITE THE PEER MISSED, ITS HEARTBEAT THREAD SENDS IT AGAIN ONCE THE PEER ANSWERS
+void server_handoff(peer * the_peer, int command, int key, int value, int version)
+{
+	stats_count(STATS_HANDOFFS);
+	if (handoff_add(&the_peer->missed, command, key, value, version) != 0)
+		LOG_WARN("server.log", the_peer->hostname, "HANDOFF_LOST(%d, V=%d)", key, version);
+}
+
+
+// SERVER_REPLY FOR AN XDRBATCH, THE TRACE CARRIES THE NUMBER OF KEYS
+xdrBatch * server_batch_reply(int type, xdrBatch * reply, double started)
+{
+	double latency = fd_now_ms() - started;
+	TRACE_EVENT(type, (uint32_t) reply->pid, TRACE_NO_PEER, reply->count, 0, reply->lc, reply->status, latency);
+	metrics_request(type);
+	reply->hint = leader;
+
+	switch (type)
+	{
+	case TRACE_MGET:       stats_record(STATS_H_MGET, latency);  break;
+	case TRACE_MPUT:       stats_record(STATS_H_MPUT, latency);  break;
+	case TRACE_RECV_LEARN: stats_record(STATS_H_LEARN, latency); break;
+	case TRACE_RECV_ACCEPT: stats_record(STATS_H_ACCEPT, latency); break;
+	}
+	return(reply);
+}
+
+
+// THE HEADER OF A BATCH AS AN XDRMSG (KEY = NUMBER OF KEYS), FOR THE DEADLINE AND THE TRACE ID
+xdrMsg server_batch_header(xdrBatch * batch)
+{
+	xdrMsg header = { 0 };
+	header.key      = batch->count;
+	header.status   = batch->status;
+	header.command  = batch->command;
+	header.lc       = batch->lc;
+	header.pid      = batch->pid;
+	header.deadline = batch->deadline;
+	header.hint     = batch->hint;
+	return(header);
+}
+
+
+// APPLIES THE LEARNED PUTS OF A BATCH TO THE LOCAL STORE UNDER ONE LOCK, RETURNS WHAT KV_PUT_MANY DID.
+// EVERY KEY IS CHECKED AGAINST ITS VERSION LIKE IN SERVER_APPLY
+int server_apply_many(int count, int * keys, int * values, int * results, int version)
+{
+	double started = fd_now_ms();
+	int apply_keys[RPC_BATCH_MAX];
+	int apply_values[RPC_BATCH_MAX];
+	int apply_results[RPC_BATCH_MAX];
+	int slots[RPC_BATCH_MAX];
+	int applying = 0;
+	for (int k = 0; k < count; k++)
+	{
+		hot_record(HOT_WRITES, keys[k]);
+		results[k] = 0;
+		if (version < version_get(versions, keys[k]))
+			continue;  // SUPERSEDED
+		if (version_set(versions, keys[k], version) != 0)
+		{
+			LOG_WARN("server.log", "localhost", "NO_MEMORY_FOR_VERSION(%d, V=%d)", keys[k], version);
+			results[k] = MEMORY_ALLOCATION_ERROR;
+			continue;
+		}
+		slots[applying]        = k;
+		apply_keys[applying]   = keys[k];
+		apply_values[applying] = values[k];
+		applying++;
+	}
+
+	kv_put_many(kv_store, applying, apply_keys, apply_values, apply_results);
+	int result = 0;
+	for (int a = 0; a < applying; a++)
+		results[slots[a]] = apply_results[a];
+	for (int k = 0; k < count; k++)
+		if (results[k] != 0)
+			result = -1;
+	stats_record(STATS_APPLY, fd_now_ms() - started);
+	return(result);
+}
+
+
+// RETURNS THE MS LEFT OF THE LONGEST READ LEASE ON ANY OF THE KEYS
+int server_lease_many(int count, int * keys)
+{
+	double now = fd_now_ms();
+	int longest = 0;
+	for (int k = 0; k < count; k++)
+	{
+		int remaining = lease_remaining(leases, keys[k], now);
+		if (remaining > longest)
+			longest = remaining;
+	}
+	return(longest);
+}
+
+
+// A LEARNER THAT MISSED A WRITE CAN'T REPORT ITS LEASE ON THE KEY, SO THE WRITE WAITS OUT THE LONGEST
+// LEASE IT SAID IT GRANTED.  RETURNS THAT OR LEASE_WAIT, WHICHEVER IS LONGER
+int server_missed_lease(peer * the_peer, int lease_wait)
+{
+	int remaining = peer_lease_left(the_peer, fd_now_ms());
+	return((remaining > lease_wait) ? remaining : lease_wait);
+}
+
+
+/********************************************************
+ * WAITS OUT THE READ LEASES A WRITE'S LEARNERS STILL    *
+ * HAD, SO NO CLIENT CACHE HOLDS THE OLD VALUE WHEN THE  *
+ * WRITER IS ANSWERED.  THE SERVER ANSWERS NOTHING ELSE  *
+ * IN THE MEANTIME, SO LEASE_MAX_MS AND THE DEADLINE OF  *
+ * THE REQUEST BOUND IT.  RETURNS THE MS OF LEASE LEFT   *
+ * WHEN THE DEADLINE CUT THE WAIT SHORT, 0 OTHERWISE.    *
+ *******************************************************/
+int server_wait_lease(int lease_ms)
+{
+	if (lease_ms <= 0)
+		return(0);
+	if (lease_ms > LEASE_MAX_MS)
+		lease_ms = LEASE_MAX_MS;
+
+	// THE WRITER GIVES UP AT ITS DEADLINE, WAITING PAST IT ONLY KEEPS THE PEERS UNANSWERED
+	int left = 0;
+	if (request_deadline > 0)
+	{
+		int until_deadline = (int) (request_deadline - fd_now_ms());
+		if (until_deadline < 0)
+			until_deadline = 0;
+		if (until_deadline < lease_ms)
+		{
+			left = lease_ms - until_deadline;
+			lease_ms = until_deadline;
+		}
+	}
+
+	LOG_DEBUG("server.log", "localhost", "WAIT=LEASE(%dms, L=%d)", lease_ms, my_lc);
+	stats_count(STATS_LEASE_WAITS);
+	lease_wait(lease_ms);
+	if (left > 0)
+		LOG_WARN("server.log", "localhost", "WAIT=LEASE_CUT_SHORT(%dms left, L=%d)", left, my_lc);
+	return(left);
+}
+
+
+/********************************************************
+ * ANSWERS RPC_STATS WITH THE LATENCY HISTOGRAMS AND THE *
+ * COUNTERS OF THIS SERVER.  A KEY OF STATS_RESET CLEARS *
+ * THEM AFTER THE SNAPSHOT IS TAKEN.                     *
+ *******************************************************/
+stats_reply * server_stats(xdrMsg * indata)
+{
+	static stats_reply outdata_stats;
+	stats_snapshot(&outdata_stats);
+	if (indata->key == STATS_RESET)
+		stats_reset();
+	return(&outdata_stats);
+}
+
+
+// RETURNS THE TRACE EVENT TYPE OF A CLIENT PUT OR DEL
+int server_trace_type(xdrMsg * indata)
+{
+	return(indata->command == RPC_DEL ? TRACE_DEL : TRACE_PUT);
+}
+
+
+// RETURNS THE HOSTNAME OF THE SERVER WITH THE NODE ID PROVIDED, NULL IF IT IS NOT IN MY TABLE
+char * server_peer_name(int id)
+{
+	peer_table * table = peer_table_current();
+	int index = peer_table_find(table, id);
+	return((index >= 0) ? table->peers[index]->hostname : NULL);
+}
+
+
+// RETURNS THE TRACE ID THE CLIENT SENT, OR A NEW ONE IF IT DIDN'T SEND ANY
+int server_trace_id(xdrMsg * indata)
+{
+	if (indata->pid != TRACE_NO_ID)
+		return(indata->pid);
+	return((int) trace_new_id());
+}
+
+
+// RETURNS THE MS SINCE EVERY OTHER SERVER LAST TOLD ME I HAD ALL THE WRITES IT ACKNOWLEDGED, INT_MAX IF ONE NEVER DID
+int server_staleness()
+{
+	peer_table * table = peer_table_current();
+	double now    = fd_now_ms();
+	double oldest = now;
+	for (int i = 0; i < table->count; i++)
+	{
+		peer * the_peer = table->peers[i];
+		if (the_peer->is_self)
+			continue;
+		if (the_peer->clean_ms <= 0)
+			return(INT_MAX);
+		if (the_peer->clean_ms < oldest)
+			oldest = the_peer->clean_ms;
+	}
+	double staleness = now - oldest;
+	return(staleness < INT_MAX ? (int) staleness : INT_MAX);
+}
+
+
+// RETURNS MY NODE ID, THE LINE OF SERVERLIST.TXT I'M ON, OR RPC_NO_HINT IF I'M NOT IN THE TABLE
+int server_my_id()
+{
+	return(peer_table_self_id(peer_table_current()));
+}
+
+
+/********************************************************
+ * SETS THE TIME BY WHICH THE CURRENT REQUEST MUST BE    *
+ * ANSWERED FROM THE DEADLINE THE CLIENT SENT, KEEPING A *
+ * MARGIN FOR THE REPLY.  A CLIENT THAT DOESN'T SEND A   *
+ * DEADLINE GETS RPC_CLIENT_TIMEOUT_MS.                  *
+ *******************************************************/
+void server_set_deadline(xdrMsg * indata)
+{
+	int deadline = indata->deadline;
+	if (deadline <= 0 || deadline > RPC_CLIENT_TIMEOUT_MS)
+		deadline = RPC_CLIENT_TIMEOUT_MS;
+
+	request_deadline = fd_now_ms() + deadline - RTT_MARGIN_MS;
 }
 
 
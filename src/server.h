@@ -14,8 +14,6 @@
 #define MAXPENDING 5    /* Maximum outstanding connection requests */
 #define BUFFSIZE 128    /* The size of the incoming and outgoing messages.*/
 #define THREAD_COUNT 10
-#define FAIL_RATE 1    /* The percentage which a server will randomly fail.  Do not use decimals for 20% use FAIL_RATE 20 */
-#define FAIL_DURATION 10  /* The duration (in seconds) for which a server will stall before returning to service */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +27,7 @@
 #include <rpc/rpc.h>
 #include <utmp.h>
 #include <sys/utsname.h>
+#include <limits.h>
 
 
 #ifndef KEYVALUE_H
@@ -43,6 +42,68 @@
 #include "xdrconv.h"
 #endif
 
+#ifndef DETECTOR_H
+#include "detector.h"
+#endif
+
+#ifndef RTT_H
+#include "rtt.h"
+#endif
+
+#ifndef PEER_H
+#include "peer.h"
+#endif
+
+#ifndef CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef FAULT_H
+#include "fault.h"
+#endif
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#ifndef METRICS_H
+#include "metrics.h"
+#endif
+
+#ifndef LEASE_H
+#include "lease.h"
+#endif
+
+#ifndef VERSION_H
+#include "version.h"
+#endif
+
+
+// EVERYTHING ONE SERVER KEEPS BETWEEN REQUESTS, SO THE SIMULATOR CAN RUN SEVERAL IN ONE PROCESS
+typedef struct server_state {
+	kv * kv_store;
+	peer_table * table;        // the current membership
+	char myname[PEER_HOST_LENGTH];
+	double request_deadline;
+	int my_lc;
+	int hpc;
+	xdrMsg hpv;
+	xdrBatch hpb;              // the last batch its acceptor accepted
+	int leader;
+	lease_table * leases;      // the read leases its learner granted
+	version_table * versions;  // the version its learner last applied to every key
+} server_state;
+
+// HOW A SERVER CALLS A PEER, RETURNS A CLNT_STAT.  TIMEOUT IS IN MS
+typedef int (*server_transport_fn)(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response, double timeout);
+
+// THE RPC NETWORK UNLESS THE SIMULATOR REPLACED IT
+extern server_transport_fn server_transport;
+
 
 
 ///*******************************************************
@@ -68,14 +129,166 @@
 
 xdrMsg * acceptor_accept(xdrMsg * indata);
 
+/********************************************************
+ * THE ACCEPT OF AN RPC_MPUT, WHICH CARRIES THE WHOLE    *
+ * BATCH.  ACCEPTS IT IF I PROMISED ITS ROUND AND ITS    *
+ * DIGEST, AND KEEPS IT IN HPB, SO EVERY ACCEPTOR OF THE *
+ * QUAROM HOLDS THE KEYS AND VALUES THEMSELVES.  THE     *
+ * REPLY CARRIES NO KEYS.                                *
+ *******************************************************/
+xdrBatch * acceptor_accept_batch(xdrBatch * indata);
+
 xdrMsg * acceptor_prepare(xdrMsg * indata);
 
 xdrMsg * learner_learn(xdrMsg * indata);
 
+/********************************************************
+ * ANSWERS A GET AT THE CONSISTENCY IT ASKS FOR.         *
+ * READ_QUORUM: A READ QUAROM OF LEARNERS AGREES ON THE  *
+ * VALUE.  READ_LINEARIZABLE: A PAXOS ROUND FOR THE READ *
+ * FIRST, THEN A QUAROM READ OF A MAJORITY OR MORE.      *
+ * READ_LOCAL: MY OWN STORE, OR A QUAROM READ IF I'VE    *
+ * LAGGED MORE THAN THE STALENESS THE CLIENT ALLOWS.     *
+ * A GET WITH A SESSION TOKEN IS ANSWERED FROM MY STORE  *
+ * ONCE I'VE APPLIED THAT VERSION OF THE KEY, BY A       *
+ * QUAROM READ BEFORE THAT.                              *
+ *******************************************************/
 xdrMsg * proposer_get(xdrMsg * indata);
 
+// ANSWERS A READ_LOCAL GET FROM MY OWN STORE, THE REPLY SAYS HOW STALE IT MAY BE
+xdrMsg * proposer_get_local(xdrMsg * indata, int staleness, double started);
+
 xdrMsg * proposer_propose(xdrMsg * indata);
 
+/********************************************************
+ * RUNS THE PREPARE AND THE ACCEPT ROUND OF THE PROPOSAL *
+ * PROVIDED, THE LIVE ACCEPTORS FIRST.  THE ACCEPTS OF   *
+ * AN RPC_MPUT CARRY ITS BATCH (NULL OTHERWISE).         *
+ * RETURNS 1 IF A QUAROM ACCEPTED IT AND 0 IF NOT.       *
+ *******************************************************/
+int proposer_round(xdrMsg * proposal, xdrBatch * batch);
+
+/********************************************************
+ * READS THE KEYS OF AN RPC_MGET IN ONE ROUND: EVERY     *
+ * LEARNER GETS ALL THE KEYS IN ONE RPC_LEARN_BATCH AND  *
+ * LOOKS THEM UP UNDER ONE LOCK, AND A KEY IS OK ONCE A  *
+ * READ QUAROM AGREES ON ITS VALUE, AS IN PROPOSER_GET.  *
+ * REPLIES WITH THE VALUE AND RESULT OF EVERY KEY, AND   *
+ * OK IF EVERY KEY IS.                                   *
+ *******************************************************/
+xdrBatch * proposer_mget(xdrBatch * indata);
+
+/********************************************************
+ * COMMITS THE PUTS OF AN RPC_MPUT AS ONE PAXOS INSTANCE *
+ * WHOSE VALUE IS THE DIGEST OF THE BATCH.  THE ACCEPTS  *
+ * CARRY THE WHOLE BATCH, SO A QUAROM OF ACCEPTORS HOLDS *
+ * IT.  THEN SENDS IT TO EVERY LEARNER IN ONE            *
+ * RPC_LEARN_BATCH, APPLIED UNDER ONE LOCK.  REPLIES     *
+ * WITH THE RESULT OF EVERY PUT, AND OK IF EVERY ONE IS  *
+ * AND A LEARN QUAROM APPLIED THE BATCH.                 *
+ *******************************************************/
+xdrBatch * proposer_mput(xdrBatch * indata);
+
+/********************************************************
+ * LOOKS UP (RPC_MGET) OR APPLIES (RPC_MPUT) EVERY KEY   *
+ * OF THE BATCH UNDER ONE LOCK OF THE STORE AND REPLIES  *
+ * WITH THE VALUE AND RESULT OF EACH.                    *
+ *******************************************************/
+xdrBatch * learner_learn_batch(xdrBatch * indata);
+
+/*******************************************************
+ * ADDS OR REMOVES THE SERVER AT THE IPV4 ADDRESS IN   *
+ * VALUE (CONFIG_ADD_NODE OR CONFIG_DEL_NODE).  RUNS   *
+ * PREPARE AND ACCEPT WITH A QUAROM OF BOTH THE OLD    *
+ * AND THE NEW CONFIGURATION, THEN TELLS EVERY SERVER  *
+ * TO LEARN THE CHANGE.  REPLIES WITH THE NODE ID IN   *
+ * KEY AND THE NUMBER OF SERVERS THAT LEARNED IT IN    *
+ * VALUE.                                              *
+ ******************************************************/
+xdrMsg * proposer_reconfig(xdrMsg * indata);
+
+/********************************************************
+ * SENDS THE MESSAGE TO EVERY SERVER OF THE JOINT TABLE  *
+ * WITH THE PROCEDURE PROVIDED AND COUNTS THE RESPONSES  *
+ * WITH THE EXPECTED STATUS.  RETURNS 1 ONCE A QUAROM OF *
+ * THE OLD AND A QUAROM OF THE NEW TABLE RESPONDED, AND  *
+ * 0 IF THAT CAN'T BE REACHED.                           *
+ *******************************************************/
+int server_joint_round(peer_table * joint, peer_table * old_table, peer_table * new_table,
+		int procedure, int expected, xdrMsg * message);
+
+// RECORDS AN ANSWER IN THE TRACE AND THE HANDLER'S HISTOGRAM, HINTS THE LEADER AND RETURNS IT
+xdrMsg * server_reply(int type, xdrMsg * reply, double started);
+
+// APPLIES A LEARNED PUT OR DEL OF THE VERSION PROVIDED TO THE LOCAL STORE UNLESS A NEWER ONE WAS, RETURNS
+// WHAT KV_PUT OR KV_DEL DID (0 IF SKIPPED) OR MEMORY_ALLOCATION_ERROR IF THE VERSION CANNOT BE RECORDED
+int server_apply(int command, int key, int value, int version);
+
+// KEEPS A WRITE THE PEER MISSED, ITS HEARTBEAT THREAD SENDS IT AGAIN ONCE THE PEER ANSWERS
+void server_handoff(peer * the_peer, int command, int key, int value, int version);
+
+// SERVER_REPLY FOR AN XDRBATCH, THE TRACE CARRIES THE NUMBER OF KEYS
+xdrBatch * server_batch_reply(int type, xdrBatch * reply, double started);
+
+// THE HEADER OF A BATCH AS AN XDRMSG (KEY = NUMBER OF KEYS), FOR THE DEADLINE AND THE TRACE ID
+xdrMsg server_batch_header(xdrBatch * batch);
+
+// APPLIES THE LEARNED PUTS OF A BATCH (ALL OF ONE VERSION) TO THE LOCAL STORE UNDER ONE LOCK, SKIPPING THE
+// KEYS A NEWER WRITE WAS APPLIED TO, RETURNS WHAT KV_PUT_MANY DID
+int server_apply_many(int count, int * keys, int * values, int * results, int version);
+
+// RETURNS THE MS LEFT OF THE LONGEST READ LEASE ON ANY OF THE KEYS
+int server_lease_many(int count, int * keys);
+
+// A LEARNER THAT MISSED A WRITE CAN'T REPORT ITS LEASE ON THE KEY, SO THE WRITE WAITS OUT THE LONGEST
+// LEASE IT SAID IT GRANTED.  RETURNS THAT OR LEASE_WAIT, WHICHEVER IS LONGER
+int server_missed_lease(peer * the_peer, int lease_wait);
+
+/********************************************************
+ * WAITS OUT THE READ LEASES A WRITE'S LEARNERS STILL    *
+ * HAD, SO NO CLIENT CACHE HOLDS THE OLD VALUE WHEN THE  *
+ * WRITER IS ANSWERED.  THE SERVER ANSWERS NOTHING ELSE  *
+ * IN THE MEANTIME, SO LEASE_MAX_MS AND THE DEADLINE OF  *
+ * THE REQUEST BOUND IT.  RETURNS THE MS OF LEASE LEFT   *
+ * WHEN THE DEADLINE CUT THE WAIT SHORT, 0 OTHERWISE.    *
+ *******************************************************/
+int server_wait_lease(int lease_ms);
+
+
+/********************************************************
+ * ANSWERS RPC_STATS WITH THE LATENCY HISTOGRAMS AND THE *
+ * COUNTERS OF THIS SERVER.  A KEY OF STATS_RESET CLEARS *
+ * THEM AFTER THE SNAPSHOT IS TAKEN.                     *
+ *******************************************************/
+stats_reply * server_stats(xdrMsg * indata);
+
+// RETURNS THE TRACE EVENT TYPE OF A CLIENT PUT OR DEL
+int server_trace_type(xdrMsg * indata);
+
+// RETURNS THE HOSTNAME OF THE SERVER WITH THE NODE ID PROVIDED, NULL IF IT IS NOT IN MY TABLE
+char * server_peer_name(int id);
+
+// RETURNS THE TRACE ID THE CLIENT SENT, OR A NEW ONE IF IT DIDN'T SEND ANY
+int server_trace_id(xdrMsg * indata);
+
+// RETURNS THE MS SINCE EVERY OTHER SERVER LAST TOLD ME I HAD ALL THE WRITES IT ACKNOWLEDGED, INT_MAX IF ONE NEVER DID
+int server_staleness();
+
+// RETURNS MY NODE ID, THE LINE OF SERVERLIST.TXT I'M ON, OR RPC_NO_HINT IF I'M NOT IN THE TABLE
+int server_my_id();
+
+// RETURNS THE QUAROM THE TABLE NEEDS FOR THE PHASE OF THE PROCEDURE PROVIDED
+int server_quorum(peer_table * table, int procedure);
+
+// FREES THE PROPOSED TABLE AND THE PEER IT ADDED, THE LEARN MADE ITS OWN
+void server_free_joint(peer_table * old_table, peer_table * new_table);
+
+/*******************************************************
+ * ANSWERS THE PINGS OF THE FAILURE DETECTOR RUNNING   *
+ * ON THE OTHER SERVERS.  REPLIES WITH OK AND MY_LC.   *
+ ******************************************************/
+xdrMsg * server_heartbeat(xdrMsg * indata);
+
 ///*********************************************************
 // * RPC FUNCTION FOR RESPONDING TO RPC CALLS FOR DELETING *
 // * A VALUE FROM THE KEY VALUE STORE.  INDATA IS THE      *
@@ -86,9 +299,10 @@ xdrMsg * proposer_propose(xdrMsg * indata);
 /********************************************************
  * THE FUNCTION CALLED BY THE MAIN MENU THAT SETSUP THE *
  * RPC FUNCTIONS AND BEGINS TO LISTEN FOR INCOMING      *
- * MEESAGES. DOES NOT RETURN.                           *
+ * MEESAGES. THE TABLE PROVIDED BECOMES THE CURRENT     *
+ * PEER TABLE.  DOES NOT RETURN.                        *
  *******************************************************/
-int server_rpc_init(char** servers, int server_count);
+int server_rpc_init(peer_table * table);
 
 ///******************************************
 // * LAUNCHES A TCP SERVER TO LISTEN ON THE *
@@ -117,16 +331,65 @@ int server_rpc_init(char** servers, int server_count);
 // *****************************************/
 //int server_handle_message(char* msg, char* response);
 
+/********************************************************
+ * SENDS THE MESSAGE TO THE PEER PROVIDED AND WAITS FOR  *
+ * THE RESPONSE.  THE TIMEOUT COMES FROM THE ROUND TRIP  *
+ * ESTIMATE OF THAT PEER AND IS CUT TO WHAT IS LEFT      *
+ * BEFORE THE CLIENT'S DEADLINE.  RETURNS 0 ON SUCCESS,  *
+ * OTHERWISE THE CLNT_STAT OF THE FAILURE.               *
+ *******************************************************/
+int server_peer_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response);
+
+/********************************************************
+ * CALLS THE PEER OVER RPC, THE DEFAULT TRANSPORT.  ANY  *
+ * INJECTED FAULTS ARE APPLIED HERE.  A HANDLE THAT      *
+ * TIMED OUT IS KEPT, ONE THAT FAILED OTHERWISE OR OF A  *
+ * SUSPECTED PEER IS DROPPED WITH ITS PORT, SO THE NEXT  *
+ * CALL ASKS ITS PORTMAPPER AGAIN, WITHIN THE TIMEOUT.   *
+ *******************************************************/
+int server_rpc_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response, double timeout);
+
+/********************************************************
+ * SENDS THE BATCH TO THE PEER PROVIDED AS               *
+ * SERVER_PEER_CALL SENDS A MESSAGE, WITH THE SAME       *
+ * TIMEOUT AND BOOKKEEPING.  THE SIMULATOR ONLY CARRIES  *
+ * XDRMSG, SO UNDER IT THE CALL FAILS WITH               *
+ * RPC_PROCUNAVAIL.                                      *
+ *******************************************************/
+int server_peer_batch_call(peer * the_peer, int procedure, xdrBatch * message, xdrBatch * response);
+
+// SERVER_RPC_CALL FOR AN XDRBATCH, WITH THE SAME INJECTED FAULTS
+int server_rpc_batch_call(peer * the_peer, int procedure, xdrBatch * message, xdrBatch * response, double timeout);
+
+// MAKES THE HANDLE OF THE PEER IF IT HAS NONE, TAKING THE TIME IT TOOK OFF THE TIMEOUT.  -1 IF THERE IS NO HANDLE OR TIME LEFT
+int server_peer_handle(peer * the_peer, double * timeout);
+
+// A HANDLE THAT ONLY TIMED OUT IS KEPT.  ANY OTHER FAILURE, OR A PEER THE DETECTOR HAS GIVEN UP ON, IS LOOKED UP AGAIN NEXT TIME
+void server_peer_failed(peer * the_peer, int status);
+
+/********************************************************
+ * COPIES THE STATE OF THE SERVER INTO STATE.            *
+ *******************************************************/
+void server_state_save(server_state * state);
+
+/********************************************************
+ * MAKES STATE THE STATE OF THE SERVER.  THE NEXT        *
+ * HANDLER RUNS AS THE SERVER IT WAS SAVED FROM.         *
+ *******************************************************/
+void server_state_load(server_state * state);
+
+/********************************************************
+ * SETS THE TIME BY WHICH THE CURRENT REQUEST MUST BE    *
+ * ANSWERED FROM THE DEADLINE THE CLIENT SENT, KEEPING A *
+ * MARGIN FOR THE REPLY.  A CLIENT THAT DOESN'T SEND A   *
+ * DEADLINE GETS RPC_CLIENT_TIMEOUT_MS.                  *
+ *******************************************************/
+void server_set_deadline(xdrMsg * indata);
+
 /**********************************
  * WRITES AN ERROR TO THE CONSOLE *
  * AND EXIST THE PROGRAM          *
  *********************************/
 void ServerErrorHandle(char *errorMessage);
 
-/***********************************
- * CAUSES THE SERVER TO FAIL ONCE
- * IN A WHILE
- * *********************************/
-void chaos_function();
-
 #endif /* SRC_SERVER_H_ */
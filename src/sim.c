@@ -0,0 +1,474 @@
+/*
+ ============================================================================
+ Name        : sim.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.25
+ Description : In-process cluster simulator.  See sim.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef SIM_H
+#include "sim.h"
+#endif
+
+#include <math.h>
+
+sim_config sim_settings;
+server_state * sim_nodes = NULL;
+int sim_current = 0;          // the server whose state is loaded in server.c
+double sim_clock = 0;         // virtual time in ms
+uint64_t sim_random_state = 1;
+
+double sim_now();
+void sim_wait(int ms);
+int sim_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response, double timeout);
+void sim_switch(int node);
+void sim_heartbeats(double * next);
+void sim_handoff(int from, int to);
+peer * sim_peer_new(int id, int self);
+double sim_hop();
+int sim_lost(int from, int to);
+uint64_t sim_random();
+uint64_t sim_digest(uint64_t digest, uint64_t value);
+
+
+/*******************************************************************************
+ * PARSES THE OPTIONS OF TCSS558 SIM (-NODES N -OPS N -KEYS N -READS PERCENT   *
+ * -LATENCY MS -JITTER MS -LOSS PERCENT -DOWN NODE -Q1 N -Q2 N -ROUTE          *
+ * RANDOM|LEADER -CONSISTENCY QUORUM|LINEARIZABLE|LOCAL[:MS] -SESSION ON|OFF   *
+ * -SEED N), RUNS THE SIMULATION AND PRINTS THE REPORT.  RETURNS -1 IF AN      *
+ * OPTION IS BAD.                                                              *
+ ******************************************************************************/
+int sim_main(int argc, char * argv[])
+{
+	sim_config config;
+	config.nodes          = SIM_DEFAULT_NODES;
+	config.ops            = SIM_DEFAULT_OPS;
+	config.keys           = SIM_DEFAULT_KEYS;
+	config.reads          = SIM_DEFAULT_READS;
+	config.latency        = SIM_DEFAULT_LATENCY;
+	config.jitter         = SIM_DEFAULT_JITTER;
+	config.loss           = 0;
+	config.down           = SIM_NO_NODE;
+	config.prepare_quorum = PEER_MAJORITY;
+	config.accept_quorum  = PEER_MAJORITY;
+	config.route          = SIM_ROUTE_RANDOM;
+	config.consistency    = READ_QUORUM;
+	config.staleness      = 0;
+	config.session        = 0;
+	config.seed           = 1;
+
+	int bad = (argc % 2 != 0);
+	for (int i = 0; i + 1 < argc && !bad; i += 2)
+	{
+		char * value = argv[i + 1];
+		if (strcmp(argv[i], "-nodes") == 0)
+			config.nodes = atoi(value);
+		else if (strcmp(argv[i], "-ops") == 0)
+			config.ops = atoi(value);
+		else if (strcmp(argv[i], "-keys") == 0)
+			config.keys = atoi(value);
+		else if (strcmp(argv[i], "-reads") == 0)
+			config.reads = atoi(value);
+		else if (strcmp(argv[i], "-latency") == 0)
+			config.latency = atof(value);
+		else if (strcmp(argv[i], "-jitter") == 0)
+			config.jitter = atof(value);
+		else if (strcmp(argv[i], "-loss") == 0)
+			config.loss = atof(value);
+		else if (strcmp(argv[i], "-down") == 0)
+			config.down = atoi(value);
+		else if (strcmp(argv[i], "-q1") == 0)
+			config.prepare_quorum = atoi(value);
+		else if (strcmp(argv[i], "-q2") == 0)
+			config.accept_quorum = atoi(value);
+		else if (strcmp(argv[i], "-route") == 0)
+		{
+			config.route = (strcmp(value, "leader") == 0) ? SIM_ROUTE_LEADER : SIM_ROUTE_RANDOM;
+			bad = (config.route == SIM_ROUTE_RANDOM && strcmp(value, "random") != 0);
+		}
+		else if (strcmp(argv[i], "-consistency") == 0)
+		{
+			if (strcmp(value, "quorum") == 0)
+				config.consistency = READ_QUORUM;
+			else if (strcmp(value, "linearizable") == 0)
+				config.consistency = READ_LINEARIZABLE;
+			else if (strncmp(value, "local", 5) == 0 && (value[5] == '\0' || value[5] == ':'))
+			{
+				config.consistency = READ_LOCAL;
+				config.staleness = (value[5] == ':') ? atoi(value + 6) : 0;
+				bad = (value[5] == ':' && config.staleness < 1);
+			}
+			else
+				bad = 1;
+		}
+		else if (strcmp(argv[i], "-session") == 0)
+		{
+			config.session = (strcmp(value, "on") == 0);
+			bad = (!config.session && strcmp(value, "off") != 0);
+		}
+		else if (strcmp(argv[i], "-seed") == 0)
+			config.seed = strtoull(value, NULL, 10);
+		else
+			bad = 1;
+	}
+
+	if (config.nodes < 1 || config.nodes > PEER_MAX || config.ops < 1 || config.keys < 1 ||
+			config.reads < 0 || config.reads > 100 || config.latency < 0 || config.jitter < 0 ||
+			config.loss < 0 || config.loss > 100 || config.down >= config.nodes || config.seed == 0)
+		bad = 1;
+
+	if (bad)
+	{
+		printf("Usage: tcss558 sim [-nodes n] [-ops n] [-keys n] [-reads percent] [-latency ms] [-jitter ms] [-loss percent] [-down node] [-q1 n] [-q2 n] [-route random|leader]"
+				" [-consistency quorum|linearizable|local[:ms]] [-session on|off] [-seed n]\n");
+		return(-1);
+	}
+
+	if (sim_run(&config, stdout) != 0)
+	{
+		printf("Invalid quorums -q1 %d -q2 %d for %d servers, or out of memory.\n",
+				config.prepare_quorum, config.accept_quorum, config.nodes);
+		return(-1);
+	}
+	return(0);
+}
+
+
+/*******************************************************************************
+ * RUNS THE SIMULATION AND PRINTS THE THROUGHPUT, THE LATENCY PERCENTILES, THE *
+ * STATS OF THE SERVERS AND A DIGEST OF EVERY RESULT TO THE FILE PROVIDED.     *
+ * RETURNS -1 IF THE CLUSTER CANNOT BE BUILT.                                  *
+ ******************************************************************************/
+int sim_run(sim_config * config, FILE * out)
+{
+	sim_settings     = *config;
+	sim_random_state = config->seed;
+	sim_clock        = 0;
+	sim_current      = 0;
+
+	// THE SERVERS RUN ON VIRTUAL TIME AND TALK THROUGH THE SIMULATED NETWORK
+	log_set_level("off");
+	fd_set_clock(sim_now);
+	lease_set_wait(sim_wait);
+	server_transport = sim_call;
+
+	// EVERY SERVER HAS ITS OWN TABLE, IT KEEPS ITS OWN RTT AND DETECTOR STATE PER PEER
+	int n = config->nodes;
+	sim_nodes = (server_state *) calloc(n, sizeof(server_state));
+	if (sim_nodes == NULL)
+		return(-1);
+
+	for (int i = 0; i < n; i++)
+	{
+		peer_table * table = peer_table_new(n);
+		if (table == NULL)
+			return(-1);
+		for (int j = 0; j < n; j++)
+		{
+			table->peers[j] = sim_peer_new(j, i == j);
+			if (table->peers[j] == NULL)
+				return(-1);
+		}
+		table->self = i;
+		if (peer_quorum_set(table, config->prepare_quorum, config->accept_quorum) != 0)
+			return(-1);
+
+		sim_nodes[i].kv_store = kv_new();
+		sim_nodes[i].leases   = lease_new();
+		sim_nodes[i].versions = version_new();
+		sim_nodes[i].table    = table;
+		sim_nodes[i].my_lc    = 0;
+		sim_nodes[i].hpc      = -1;
+		sim_nodes[i].leader   = RPC_NO_HINT;
+		snprintf(sim_nodes[i].myname, PEER_HOST_LENGTH, "sim%d", i);
+	}
+	server_state_load(&sim_nodes[0]);
+
+	bench * get_bench = bench_new(config->ops);
+	bench * put_bench = bench_new(config->ops);
+	version_session * session = config->session ? version_session_new() : NULL;  // -SESSION: THE CLIENT'S TOKENS
+	if (get_bench == NULL || put_bench == NULL || (config->session && session == NULL))
+		return(-1);
+
+	char * levels[READ_LEVELS] = { "quorum", "linearizable", "local" };
+	fprintf(out, "sim: nodes=%d ops=%d keys=%d reads=%d%% latency=%.2fms jitter=%.2fms loss=%.1f%% route=%s consistency=%s",
+			n, config->ops, config->keys, config->reads, config->latency, config->jitter, config->loss,
+			config->route == SIM_ROUTE_LEADER ? "leader" : "random", levels[config->consistency]);
+	if (config->consistency == READ_LOCAL && config->staleness > 0)
+		fprintf(out, ":%d", config->staleness);
+	fprintf(out, " session=%s seed=%llu\n", config->session ? "on" : "off", (unsigned long long) config->seed);
+
+	double started = bench_now_ms();
+	double next_heartbeat = 0;
+	uint64_t digest = 14695981039346656037ULL;
+	int failures = 0;
+	int leader = SIM_NO_NODE;   // the server the last reply named, with -route leader
+	for (int i = 0; i < config->ops; i++)
+	{
+		sim_heartbeats(&next_heartbeat);
+
+		// A RANDOM LIVE SERVER IS THE PROPOSER, LIKE THE CLIENT BENCHMARK
+		int node;
+		do
+			node = (int) (sim_random() % n);
+		while (node == config->down);
+
+		xdrMsg message = { 0 };
+		message.command  = ((int) (sim_random() % 100) < config->reads) ? RPC_GET : RPC_PUT;
+		message.key      = (int) (sim_random() % config->keys);
+		message.value    = (int) (sim_random() % 1000000);
+		message.deadline = RPC_CLIENT_TIMEOUT_MS;
+		if (message.command == RPC_GET)
+		{
+			message.consistency = config->consistency;
+			message.staleness   = config->staleness;
+			message.version     = version_token(session, message.key);
+		}
+
+		// -ROUTE LEADER: A PUT GOES TO THE LEADER, A NACK THAT NAMES ANOTHER ONE IS FOLLOWED ONCE
+		int leader_route = (config->route == SIM_ROUTE_LEADER && message.command == RPC_PUT);
+		if (leader_route && leader != SIM_NO_NODE)
+			node = leader;
+
+		double start = sim_clock;
+		xdrMsg response;
+		for (int redirects = 0; redirects < 2; redirects++)
+		{
+			sim_clock += sim_hop();
+			sim_switch(node);
+			response = (message.command == RPC_GET) ? *proposer_get(&message) : *proposer_propose(&message);
+			sim_clock += sim_hop();
+
+			if (config->route != SIM_ROUTE_LEADER || response.hint < 0 || response.hint >= n || response.hint == config->down)
+				break;
+			leader = response.hint;
+			if (!leader_route || response.status == OK || leader == node)
+				break;
+			node = leader;
+		}
+
+		version_observe(session, message.key, response.version);
+
+		double latency = sim_clock - start;
+		int failed = (response.status != OK || latency > RPC_CLIENT_TIMEOUT_MS);
+		failures += failed;
+		bench_record(message.command == RPC_GET ? get_bench : put_bench, latency, failed);
+
+		digest = sim_digest(digest, ((uint64_t) message.command << 32) | (uint32_t) message.key);
+		digest = sim_digest(digest, ((uint64_t) (uint32_t) response.status << 32) | (uint32_t) response.value);
+		digest = sim_digest(digest, (uint64_t) (latency * 1000000.0));
+	}
+	double wall = (bench_now_ms() - started) / 1000.0;
+
+	fprintf(out, "sim: failures=%d virtual=%.2fs throughput=%.1f ops/s wall=%.2fs simulated=%.0f ops/s\n",
+			failures, sim_clock / 1000.0, sim_clock > 0 ? config->ops / (sim_clock / 1000.0) : 0.0,
+			wall, wall > 0 ? config->ops / wall : 0.0);
+
+	bench * benches[2] = { get_bench, put_bench };
+	char * labels[2]   = { "get", "put" };
+	for (int b = 0; b < 2; b++)
+		fprintf(out, "%s: ops=%d failures=%d p50=%.2fms p90=%.2fms p99=%.2fms p99.9=%.2fms max=%.2fms\n",
+				labels[b], benches[b]->count, benches[b]->failures,
+				bench_percentile(benches[b], 50), bench_percentile(benches[b], 90),
+				bench_percentile(benches[b], 99), bench_percentile(benches[b], 99.9),
+				bench_percentile(benches[b], 100));
+
+	// THE HISTOGRAMS ARE SHARED, SO THEY HOLD THE PHASES OF EVERY SERVER TOGETHER
+	stats_reply * reply = (stats_reply *) calloc(1, sizeof(stats_reply));
+	if (reply != NULL)
+	{
+		stats_snapshot(reply);
+		stats_print(reply, out);
+		free(reply);
+	}
+	fprintf(out, "sim: digest=%016llx\n", (unsigned long long) digest);
+
+	bench_free(get_bench);
+	bench_free(put_bench);
+	version_session_free(session);
+	fd_set_clock(NULL);
+	lease_set_wait(NULL);
+	server_transport = server_rpc_call;
+	return(0);
+}
+
+
+// THE VIRTUAL CLOCK, GIVEN TO FD_NOW_MS
+double sim_now()
+{
+	return(sim_clock);
+}
+
+
+// A WRITE WAITING OUT A LEASE, GIVEN TO LEASE_WAIT
+void sim_wait(int ms)
+{
+	sim_clock += ms;
+}
+
+
+// THE TRANSPORT OF THE SIMULATED SERVERS: RUNS THE HANDLER OF THE PEER AS THAT SERVER
+int sim_call(peer * the_peer, int procedure, xdrMsg * message, xdrMsg * response, double timeout)
+{
+	int from = sim_current;
+	int to   = the_peer->id;
+	double sent = sim_clock;
+	message->deadline = (int) timeout;
+
+	xdrMsg * (*handler)(xdrMsg *) = NULL;
+	switch (procedure)
+	{
+	case RPC_PREPARE:   handler = acceptor_prepare; break;
+	case RPC_ACCEPT:    handler = acceptor_accept;  break;
+	case RPC_LEARN:     handler = learner_learn;    break;
+	case RPC_HEARTBEAT: handler = server_heartbeat; break;
+	default:            return(RPC_PROCUNAVAIL);
+	}
+
+	if (sim_lost(from, to))
+	{
+		sim_clock = sent + timeout;
+		return(RPC_TIMEDOUT);
+	}
+
+	// THE PEER HANDLES THE MESSAGE WHEN IT ARRIVES, EVEN IF THE ANSWER COMES TOO LATE
+	sim_clock += sim_hop();
+	sim_switch(to);
+	*response = *handler(message);
+	sim_switch(from);
+
+	double back = sim_hop();
+	if (sim_lost(to, from) || sim_clock + back - sent > timeout)
+	{
+		sim_clock = sent + timeout;
+		return(RPC_TIMEDOUT);
+	}
+
+	sim_clock += back;
+	return(RPC_SUCCESS);
+}
+
+
+// SAVES THE STATE OF THE CURRENT SERVER AND LOADS THE ONE OF THE SERVER PROVIDED
+void sim_switch(int node)
+{
+	if (node == sim_current)
+		return;
+
+	server_state_save(&sim_nodes[sim_current]);
+	server_state_load(&sim_nodes[node]);
+	sim_current = node;
+}
+
+
+// THE PINGS OF THE FAILURE DETECTORS, EVERY FD_HEARTBEAT_MS OF VIRTUAL TIME
+void sim_heartbeats(double * next)
+{
+	int n = sim_settings.nodes;
+	while (*next <= sim_clock)
+	{
+		for (int i = 0; i < n; i++)
+			for (int j = 0; j < n; j++)
+				if (i != j && !sim_lost(i, j) && !sim_lost(j, i))
+				{
+					fd_heartbeat(&sim_nodes[i].table->peers[j]->fd);
+					peer_lease_seen(sim_nodes[i].table->peers[j], lease_latest(sim_nodes[j].leases, sim_clock), sim_clock);
+					sim_handoff(i, j);
+
+					// THE PING OF I TELLS J WHETHER I STILL HOLDS WRITES J MISSED
+					if (handoff_pending(&sim_nodes[i].table->peers[j]->missed) == 0)
+						sim_nodes[j].table->peers[i]->clean_ms = sim_clock;
+				}
+		*next += FD_HEARTBEAT_MS;
+	}
+}
+
+
+// WHAT THE HEARTBEAT THREAD OF A SERVER DOES ONCE A PEER ANSWERS: SENDS IT THE WRITES IT MISSED, IN NO TIME
+void sim_handoff(int from, int to)
+{
+	peer * the_peer = sim_nodes[from].table->peers[to];
+	handoff_write * writes;
+	int count = handoff_take(&the_peer->missed, &writes);
+	if (count == 0)
+		return;
+
+	int current = sim_current;
+	sim_switch(to);
+	for (int w = 0; w < count; w++)
+	{
+		xdrMsg message = { 0 };
+		message.command = writes[w].command;
+		message.key     = writes[w].key;
+		message.value   = writes[w].value;
+		message.lc      = writes[w].version;
+		message.status  = OK;
+		if (learner_learn(&message)->status == FAILURE)
+			handoff_add(&the_peer->missed, writes[w].command, writes[w].key, writes[w].value, writes[w].version);
+	}
+	sim_switch(current);
+	free(writes);
+}
+
+
+// A PEER WITHOUT AN ADDRESS, ONLY THE SIMULATOR CAN REACH IT
+peer * sim_peer_new(int id, int self)
+{
+	peer * the_peer = (peer *) calloc(1, sizeof(peer));
+	if (the_peer == NULL)
+		return NULL;
+
+	the_peer->id = id;
+	snprintf(the_peer->hostname, PEER_HOST_LENGTH, "sim%d", id);
+	the_peer->program  = RPC_PROG_NUM;
+	the_peer->resolved = PEER_UNRESOLVED;
+	the_peer->is_self  = self;
+	rtt_init(&the_peer->rtt);
+	fd_reset(&the_peer->fd);
+	handoff_init(&the_peer->missed);
+	return the_peer;
+}
+
+
+// MS ONE HOP TAKES, THE LATENCY PLUS AN EXPONENTIAL JITTER
+double sim_hop()
+{
+	double u = (double) (sim_random() >> 11) / 9007199254740992.0;
+	return(sim_settings.latency - sim_settings.jitter * log(1.0 - u));
+}
+
+
+// 1 IF THE HOP BETWEEN THE SERVERS PROVIDED IS LOST
+int sim_lost(int from, int to)
+{
+	if (from == sim_settings.down || to == sim_settings.down)
+		return(1);
+	if (sim_settings.loss <= 0)
+		return(0);
+	return((double) (sim_random() >> 11) / 9007199254740992.0 * 100.0 < sim_settings.loss);
+}
+
+
+// XORSHIFT64*, ALL THE RANDOMNESS OF A RUN
+uint64_t sim_random()
+{
+	sim_random_state ^= sim_random_state >> 12;
+	sim_random_state ^= sim_random_state << 25;
+	sim_random_state ^= sim_random_state >> 27;
+	return(sim_random_state * 2685821657736338717ULL);
+}
+
+
+// FNV-1A OF THE 8 BYTES OF VALUE
+uint64_t sim_digest(uint64_t digest, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		digest ^= (value >> (i * 8)) & 0xFF;
+		digest *= 1099511628211ULL;
+	}
+	return(digest);
+}
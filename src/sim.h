@@ -0,0 +1,89 @@
+/*
+ ============================================================================
+ Name        : sim.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.25
+ Description : Runs a whole cluster in one process on virtual time.  Every
+             : simulated server is the real proposer, acceptor and learner
+             : code of server.c: the simulator swaps the state of one server
+             : in and out of server.c and replaces the rpc transport with a
+             : call to the handler of the other server.  A hop takes a fixed
+             : latency plus an exponential jitter and is lost with the
+             : probability given; a lost hop costs the caller its timeout.
+             : Nothing sleeps, so millions of operations take seconds, and
+             : all the randomness comes from the seed, so the same seed
+             : gives the same run and the same digest.
+             :
+             : One operation runs at a time, like one client.  The hops of
+             : the client itself are never lost.  With -route leader the
+             : client sends its PUTs to the leader the last reply named and
+             : follows a NACK to the leader it names once, like
+             : client_rpc_route.  With -session it keeps session tokens
+             : like client_session_enable, and its GETs carry them.
+ ============================================================================
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#define SIM_DEFAULT_NODES    5
+#define SIM_DEFAULT_OPS      100000
+#define SIM_DEFAULT_KEYS     1000
+#define SIM_DEFAULT_READS    50     // percent of the operations that are GETs
+#define SIM_DEFAULT_LATENCY  0.5    // ms of one hop
+#define SIM_DEFAULT_JITTER   0.1    // mean ms of the exponential part of a hop
+#define SIM_NO_NODE          -1
+#define SIM_ROUTE_RANDOM     0      // every operation goes to a random live server
+#define SIM_ROUTE_LEADER     1      // the PUTs go to the leader the replies name
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef SERVER_H
+#include "server.h"
+#endif
+
+#ifndef BENCH_H
+#include "bench.h"
+#endif
+
+
+// WHAT TO SIMULATE
+typedef struct sim_config {
+	int nodes;
+	int ops;
+	int keys;               // keys are drawn uniformly from 0 to keys - 1
+	int reads;              // percent of GETs, the rest are PUTs
+	double latency;         // ms of one hop
+	double jitter;          // mean ms of the exponential part of a hop
+	double loss;            // percent of the hops between servers that are lost
+	int down;               // server that never answers, SIM_NO_NODE for none
+	int prepare_quorum;     // PEER_MAJORITY or the size
+	int accept_quorum;
+	int route;              // SIM_ROUTE_RANDOM or SIM_ROUTE_LEADER
+	int consistency;        // READ_* of the GETs
+	int staleness;          // ms a READ_LOCAL GET may lag, 0 for any
+	int session;            // 1 if the GETs carry session tokens
+	uint64_t seed;
+} sim_config;
+
+
+/*******************************************************************************
+ * PARSES THE OPTIONS OF TCSS558 SIM (-NODES N -OPS N -KEYS N -READS PERCENT   *
+ * -LATENCY MS -JITTER MS -LOSS PERCENT -DOWN NODE -Q1 N -Q2 N -ROUTE          *
+ * RANDOM|LEADER -CONSISTENCY QUORUM|LINEARIZABLE|LOCAL[:MS] -SESSION ON|OFF   *
+ * -SEED N), RUNS THE SIMULATION AND PRINTS THE REPORT.  RETURNS -1 IF AN      *
+ * OPTION IS BAD.                                                              *
+ ******************************************************************************/
+int sim_main(int argc, char * argv[]);
+
+/*******************************************************************************
+ * RUNS THE SIMULATION AND PRINTS THE THROUGHPUT, THE LATENCY PERCENTILES, THE *
+ * STATS OF THE SERVERS AND A DIGEST OF EVERY RESULT TO THE FILE PROVIDED.     *
+ * RETURNS -1 IF THE CLUSTER CANNOT BE BUILT.                                  *
+ ******************************************************************************/
+int sim_run(sim_config * config, FILE * out);
+
+#endif /* SIM_H */
@@ -0,0 +1,357 @@
+/*
+ ============================================================================
+ Name        : stats.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.19
+ Description : Latency histograms and counters.  See stats.h
+ ============================================================================
+ */
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#include <math.h>
+
+#define STATS_MAX_US  0xFFFFFFFFULL  // larger latencies are counted as this
+
+stats_histogram stats_histograms[STATS_HISTOGRAMS];
+uint64_t stats_counters[STATS_COUNTERS];
+
+
+/*******************************************************************************
+ * RECORDS A LATENCY (MS) IN THE HISTOGRAM PROVIDED.  LOCK FREE.               *
+ ******************************************************************************/
+void stats_record(int histogram, double latency_ms)
+{
+	stats_add(&stats_histograms[histogram], latency_ms);
+}
+
+
+/*******************************************************************************
+ * RECORDS A LATENCY (MS) IN A HISTOGRAM THAT IS NOT ONE OF THE SERVER'S, FOR  *
+ * EXAMPLE ONE OF A CLIENT BENCHMARK.  LOCK FREE.                              *
+ ******************************************************************************/
+void stats_add(stats_histogram * h, double latency_ms)
+{
+	uint64_t value = (latency_ms > 0) ? (uint64_t) (latency_ms * 1000.0) : 0;
+	if (value > STATS_MAX_US)
+		value = STATS_MAX_US;
+
+	__atomic_fetch_add(&h->counts[stats_bucket(value)], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&h->sum_us, value, __ATOMIC_RELAXED);
+
+	// ONLY WRITE THE MAXIMUM WHEN IT GROWS
+	uint64_t max = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+	while (value > max
+	&& !__atomic_compare_exchange_n(&h->max_us, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+
+/*******************************************************************************
+ * ADDS ONE TO THE COUNTER PROVIDED.  LOCK FREE.                               *
+ ******************************************************************************/
+void stats_count(int counter)
+{
+	__atomic_fetch_add(&stats_counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+
+/*******************************************************************************
+ * FILLS IN THE REPLY WITH THE COUNTERS AND A SUMMARY OF EVERY HISTOGRAM AND   *
+ * LOCK, LOCKS OF THE SAME NAME ADDED UP.  THE HOT KEYS ARE NOT LOCKED, CALL   *
+ * IT FROM THE THREAD THAT RECORDS THEM.                                       *
+ ******************************************************************************/
+void stats_snapshot(stats_reply * reply)
+{
+	for (int c = 0; c < STATS_COUNTERS; c++)
+		reply->counters[c] = (u_int) __atomic_load_n(&stats_counters[c], __ATOMIC_RELAXED);
+
+	for (int i = 0; i < STATS_HISTOGRAMS; i++)
+	{
+		stats_histogram * h = &stats_histograms[i];
+		u_int * summary = reply->summary[i];
+
+		uint64_t total = 0;
+		for (int b = 0; b < STATS_BUCKETS; b++)
+			total += __atomic_load_n(&h->counts[b], __ATOMIC_RELAXED);
+
+		uint64_t sum = __atomic_load_n(&h->sum_us, __ATOMIC_RELAXED);
+		summary[STATS_FIELD_COUNT] = (u_int) total;
+		summary[STATS_FIELD_MEAN]  = (u_int) (total > 0 ? sum / total : 0);
+		summary[STATS_FIELD_P50]   = (u_int) stats_percentile(h, total, 50.0);
+		summary[STATS_FIELD_P90]   = (u_int) stats_percentile(h, total, 90.0);
+		summary[STATS_FIELD_P99]   = (u_int) stats_percentile(h, total, 99.0);
+		summary[STATS_FIELD_P999]  = (u_int) stats_percentile(h, total, 99.9);
+		summary[STATS_FIELD_MAX]   = (u_int) __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+	}
+
+	memset(reply->locks, 0, sizeof(reply->locks));
+	reply->lock_count    = 0;
+	reply->locks_dropped = 0;
+#ifndef LOCKSTAT_OFF
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+	{
+		// EVERY STORE OF THE SIMULATOR HAS ITS OWN "kv" LOCK, THEY SHARE ONE ENTRY
+		u_int l = 0;
+		while (l < reply->lock_count && strncmp(reply->locks[l].name, lock->name, LOCKSTAT_NAME_LENGTH) != 0)
+			l++;
+		if (l == STATS_LOCKS)
+		{
+			reply->locks_dropped++;
+			continue;
+		}
+		if (l == reply->lock_count)
+			strncpy(reply->locks[reply->lock_count++].name, lock->name, LOCKSTAT_NAME_LENGTH - 1);
+
+		stats_lock * entry = &reply->locks[l];
+		u_int max_hold_us    = (u_int) (__atomic_load_n(&lock->max_hold_ns, __ATOMIC_RELAXED) / 1000);
+		entry->acquisitions += (u_int) __atomic_load_n(&lock->acquisitions, __ATOMIC_RELAXED);
+		entry->contended    += (u_int) __atomic_load_n(&lock->contended, __ATOMIC_RELAXED);
+		entry->wait_us      += (u_int) (__atomic_load_n(&lock->wait_ns, __ATOMIC_RELAXED) / 1000);
+		if (max_hold_us > entry->max_hold_us)
+			entry->max_hold_us = max_hold_us;
+	}
+#endif
+
+	for (int kind = 0; kind < HOT_KINDS; kind++)
+		hot_snapshot(kind, &reply->hot[kind]);
+}
+
+
+/*******************************************************************************
+ * CLEARS EVERY HISTOGRAM AND COUNTER.  A VALUE RECORDED WHILE IT RUNS MAY BE  *
+ * HALF CLEARED.                                                               *
+ ******************************************************************************/
+void stats_reset()
+{
+	for (int c = 0; c < STATS_COUNTERS; c++)
+		__atomic_store_n(&stats_counters[c], 0, __ATOMIC_RELAXED);
+
+	for (int i = 0; i < STATS_HISTOGRAMS; i++)
+	{
+		stats_histogram * h = &stats_histograms[i];
+		for (int b = 0; b < STATS_BUCKETS; b++)
+			__atomic_store_n(&h->counts[b], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&h->sum_us, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&h->max_us, 0, __ATOMIC_RELAXED);
+	}
+
+	// THE LOCK COUNTS ARE WRITTEN BY THEIR HOLDERS, SO TAKE EACH LOCK TO CLEAR THEM
+#ifndef LOCKSTAT_OFF
+	for (lockstat * lock = lockstat_list(); lock != NULL; lock = lock->next)
+	{
+		pthread_mutex_lock(&lock->mutex);
+		__atomic_store_n(&lock->acquisitions, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock->contended, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock->wait_ns, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock->max_hold_ns, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&lock->mutex);
+	}
+#endif
+
+	hot_reset();
+}
+
+
+/*******************************************************************************
+ * PRINTS THE REPLY AS A TABLE TO THE FILE PROVIDED.                           *
+ ******************************************************************************/
+void stats_print(stats_reply * reply, FILE * out)
+{
+	fprintf(out, "%-18s %9s %9s %9s %9s %9s %9s %9s\n", "(microseconds)",
+			"count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (int i = 0; i < STATS_HISTOGRAMS; i++)
+	{
+		u_int * s = reply->summary[i];
+		fprintf(out, "%-18s %9u %9u %9u %9u %9u %9u %9u\n", stats_histogram_name(i),
+				s[STATS_FIELD_COUNT], s[STATS_FIELD_MEAN], s[STATS_FIELD_P50], s[STATS_FIELD_P90],
+				s[STATS_FIELD_P99], s[STATS_FIELD_P999], s[STATS_FIELD_MAX]);
+	}
+
+	for (int c = 0; c < STATS_COUNTERS; c++)
+		fprintf(out, "%s=%u%s", stats_counter_name(c), reply->counters[c], c + 1 < STATS_COUNTERS ? "  " : "\n");
+
+	if (reply->lock_count > 0)
+		fprintf(out, "%-18s %12s %12s %12s %12s\n", "(lock)", "acquisitions", "contended", "wait_us", "max_hold_us");
+	for (u_int l = 0; l < reply->lock_count && l < STATS_LOCKS; l++)
+	{
+		stats_lock * entry = &reply->locks[l];
+		fprintf(out, "%-18.*s %12u %12u %12u %12u\n", LOCKSTAT_NAME_LENGTH, entry->name,
+				entry->acquisitions, entry->contended, entry->wait_us, entry->max_hold_us);
+	}
+	if (reply->locks_dropped > 0)
+		fprintf(out, "(%u more locks not shown, the reply has room for %d names)\n", reply->locks_dropped, STATS_LOCKS);
+
+	for (int kind = 0; kind < HOT_KINDS; kind++)
+	{
+		fprintf(out, "hot %s:", kind == HOT_READS ? "reads " : "writes");
+		for (int k = 0; k < reply->hot[kind].count && k < HOT_TOP; k++)
+			fprintf(out, "  %d=%u", reply->hot[kind].keys[k].key, reply->hot[kind].keys[k].count);
+		fprintf(out, "\n");
+	}
+}
+
+
+/*******************************************************************************
+ * WRITES THE HISTOGRAM PROVIDED TO A FILE AS THE PERCENTILE DISTRIBUTION OF   *
+ * HDRHISTOGRAM (.HGRM, IN MS), SO THE HISTOGRAMS OF SEVERAL RUNS CAN BE       *
+ * PLOTTED TOGETHER.  RETURNS -1 IF THE FILE CANNOT BE WRITTEN.                *
+ ******************************************************************************/
+int stats_save(stats_histogram * histogram, char * filename)
+{
+	FILE * file = fopen(filename, "w");
+	if (file == NULL)
+		return(-1);
+
+	uint64_t total = 0;
+	for (int b = 0; b < STATS_BUCKETS; b++)
+		total += __atomic_load_n(&histogram->counts[b], __ATOMIC_RELAXED);
+
+	// ONE LINE PER BUCKET THAT HOLDS A VALUE, AT THE HIGHEST VALUE OF THE BUCKET
+	fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+	uint64_t seen = 0;
+	double mean = (total > 0) ? (double) histogram->sum_us / total : 0;
+	double squares = 0;
+	for (int b = 0; b < STATS_BUCKETS && seen < total; b++)
+	{
+		uint64_t count = __atomic_load_n(&histogram->counts[b], __ATOMIC_RELAXED);
+		if (count == 0)
+			continue;
+		seen += count;
+		double middle = (stats_bucket_low(b) + stats_bucket_high(b)) / 2.0;
+		squares += count * (middle - mean) * (middle - mean);
+
+		uint64_t value = stats_bucket_high(b);
+		if (value > histogram->max_us)
+			value = histogram->max_us;
+		double fraction = (double) seen / total;
+		if (seen < total)
+			fprintf(file, "%12.3f %1.12f %10llu %14.2f\n", value / 1000.0, fraction, (unsigned long long) seen, 1.0 / (1.0 - fraction));
+		else
+			fprintf(file, "%12.3f %1.12f %10llu\n", value / 1000.0, fraction, (unsigned long long) seen);
+	}
+
+	fprintf(file, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean / 1000.0, total > 0 ? sqrt(squares / total) / 1000.0 : 0.0);
+	fprintf(file, "#[Max     = %12.3f, Total count    = %12llu]\n", histogram->max_us / 1000.0, (unsigned long long) total);
+	fprintf(file, "#[Buckets = %12d, SubBuckets     = %12d]\n", STATS_BUCKETS, STATS_SUB_BUCKETS);
+	return(fclose(file) == 0 ? 0 : -1);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE HISTOGRAM OR THE COUNTER PROVIDED.                  *
+ ******************************************************************************/
+char * stats_histogram_name(int histogram)
+{
+	char * names[STATS_HISTOGRAMS] = { "prepare", "accept", "learn", "read", "apply", "log",
+			"proposer_propose", "proposer_get", "acceptor_prepare", "acceptor_accept", "learner_learn",
+			"proposer_mget", "proposer_mput", "proposer_get_lin", "proposer_get_local" };
+	return names[histogram];
+}
+
+char * stats_counter_name(int counter)
+{
+	char * names[STATS_COUNTERS] = { "nacks", "quorum_failures", "peer_failures", "timeouts", "skipped", "lease_waits", "stale_reads", "behind_reads", "handoffs" };
+	return names[counter];
+}
+
+
+/*******************************************************************************
+ * RETURNS THE BUCKET OF THE VALUE PROVIDED, AND THE SMALLEST AND LARGEST      *
+ * VALUES OF A BUCKET.                                                         *
+ ******************************************************************************/
+int stats_bucket(uint64_t value)
+{
+	// SMALL VALUES GET A BUCKET EACH
+	if (value < 2 * STATS_SUB_BUCKETS)
+		return((int) value);
+
+	// OTHERWISE KEEP THE TOP STATS_SUB_BITS + 1 BITS
+	int exponent = 63 - __builtin_clzll(value);
+	int shift = exponent - STATS_SUB_BITS;
+	return(2 * STATS_SUB_BUCKETS + (exponent - STATS_SUB_BITS - 1) * STATS_SUB_BUCKETS
+			+ (int) (value >> shift) - STATS_SUB_BUCKETS);
+}
+
+uint64_t stats_bucket_low(int bucket)
+{
+	if (bucket < 2 * STATS_SUB_BUCKETS)
+		return((uint64_t) bucket);
+
+	int shift = (bucket - 2 * STATS_SUB_BUCKETS) / STATS_SUB_BUCKETS + 1;
+	uint64_t sub = (bucket - 2 * STATS_SUB_BUCKETS) % STATS_SUB_BUCKETS + STATS_SUB_BUCKETS;
+	return(sub << shift);
+}
+
+uint64_t stats_bucket_high(int bucket)
+{
+	if (bucket < 2 * STATS_SUB_BUCKETS)
+		return((uint64_t) bucket);
+
+	int shift = (bucket - 2 * STATS_SUB_BUCKETS) / STATS_SUB_BUCKETS + 1;
+	return(stats_bucket_low(bucket) + (1ULL << shift) - 1);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE LATENCY (US) AT THE PERCENTILE PROVIDED (0 - 100) OF A          *
+ * HISTOGRAM THAT HOLDS TOTAL VALUES, THE HIGHEST VALUE OF ITS BUCKET.         *
+ ******************************************************************************/
+uint64_t stats_percentile(stats_histogram * histogram, uint64_t total, double percentile)
+{
+	if (total == 0)
+		return(0);
+
+	uint64_t rank = (uint64_t) ((percentile / 100.0) * total + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	// NO PERCENTILE IS LARGER THAN THE LARGEST VALUE RECORDED
+	uint64_t max = __atomic_load_n(&histogram->max_us, __ATOMIC_RELAXED);
+	uint64_t seen = 0;
+	for (int b = 0; b < STATS_BUCKETS; b++)
+	{
+		seen += __atomic_load_n(&histogram->counts[b], __ATOMIC_RELAXED);
+		if (seen >= rank)
+			return(stats_bucket_high(b) < max ? stats_bucket_high(b) : max);
+	}
+
+	return(max);
+}
+
+
+/*******************************************************************************
+ * XDR FILTER OF THE RPC_STATS REPLY                                           *
+ ******************************************************************************/
+bool_t xdr_stats(XDR * xdrs, stats_reply * reply)
+{
+	if (!xdr_vector(xdrs, (char *) reply->counters, STATS_COUNTERS, sizeof(u_int), (xdrproc_t) xdr_u_int)
+	||  !xdr_vector(xdrs, (char *) reply->summary, STATS_HISTOGRAMS * STATS_FIELDS, sizeof(u_int), (xdrproc_t) xdr_u_int)
+	||  !xdr_u_int(xdrs, &reply->lock_count)
+	||  !xdr_u_int(xdrs, &reply->locks_dropped))
+		return(FALSE);
+
+	// EVERY ENTRY IS SENT, USED OR NOT, SO THE REPLY HAS A FIXED SIZE
+	for (int l = 0; l < STATS_LOCKS; l++)
+	{
+		stats_lock * entry = &reply->locks[l];
+		if (!xdr_opaque(xdrs, entry->name, LOCKSTAT_NAME_LENGTH)
+		||  !xdr_u_int(xdrs, &entry->acquisitions)
+		||  !xdr_u_int(xdrs, &entry->contended)
+		||  !xdr_u_int(xdrs, &entry->wait_us)
+		||  !xdr_u_int(xdrs, &entry->max_hold_us))
+			return(FALSE);
+	}
+
+	for (int kind = 0; kind < HOT_KINDS; kind++)
+	{
+		hot_report * hot = &reply->hot[kind];
+		if (!xdr_int(xdrs, &hot->count))
+			return(FALSE);
+		for (int k = 0; k < HOT_TOP; k++)
+			if (!xdr_int(xdrs, &hot->keys[k].key) || !xdr_u_int(xdrs, &hot->keys[k].count))
+				return(FALSE);
+	}
+	return(TRUE);
+}
@@ -0,0 +1,178 @@
+/*
+ ============================================================================
+ Name        : stats.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.19
+ Description : Latency histograms for every phase of a request and every rpc
+             : handler, and counters for nacks, failed quaroms and failed
+             : peer calls.  A histogram has log-linear buckets like an HDR
+             : histogram: 32 buckets per power of two, so a percentile is
+             : within 3% of the real value from 1us to more than an hour.
+             : Recording is one atomic add per field, no lock is taken.
+             : RPC_STATS returns a summary of every histogram and counter.
+ ============================================================================
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#define STATS_SUB_BITS     5
+#define STATS_SUB_BUCKETS  (1 << STATS_SUB_BITS)           // buckets per power of two
+#define STATS_BUCKETS      (2 * STATS_SUB_BUCKETS + (32 - STATS_SUB_BITS - 1) * STATS_SUB_BUCKETS)
+
+// THE HISTOGRAMS
+#define STATS_PREPARE      0   // proposer: prepare fan-out until a quarom promised
+#define STATS_ACCEPT       1   // proposer: accept fan-out until a quarom accepted
+#define STATS_LEARN        2   // proposer: learn fan-out to every server
+#define STATS_READ         3   // proposer: learner get fan-out of a GET
+#define STATS_APPLY        4   // applying a learned value to the local store
+#define STATS_LOG          5   // queueing one log line
+#define STATS_H_PROPOSE    6   // the proposer_propose handler
+#define STATS_H_GET        7   // the proposer_get handler
+#define STATS_H_PREPARE    8   // the acceptor_prepare handler
+#define STATS_H_ACCEPT     9   // the acceptor_accept handler
+#define STATS_H_LEARN      10  // the learner_learn handler
+#define STATS_H_MGET       11  // the proposer_mget handler
+#define STATS_H_MPUT       12  // the proposer_mput handler
+#define STATS_H_GET_LINEAR 13  // the proposer_get handler, READ_LINEARIZABLE
+#define STATS_H_GET_LOCAL  14  // the proposer_get handler, READ_LOCAL
+#define STATS_HISTOGRAMS   15
+
+// THE COUNTERS
+#define STATS_NACKS            0   // nacks the proposer received
+#define STATS_QUORUM_FAILURES  1   // requests that didn't get a quarom
+#define STATS_PEER_FAILURES    2   // peer calls that failed (timed out or errored), the proposer moved past them
+#define STATS_TIMEOUTS         3   // peer calls that timed out
+#define STATS_SKIPPED          4   // suspected learners that were skipped
+#define STATS_LEASE_WAITS      5   // writes that waited out a read lease before they were answered
+#define STATS_STALE_READS      6   // READ_LOCAL gets that lagged more than they allowed, read by a quarom instead
+#define STATS_BEHIND_READS     7   // gets with a session token this server hadn't applied yet, read by a quarom instead
+#define STATS_HANDOFFS         8   // writes kept for a learner that missed them, to be sent again
+#define STATS_COUNTERS         9
+
+// WHAT THE SUMMARY OF ONE HISTOGRAM HOLDS (IN MICROSECONDS)
+#define STATS_FIELD_COUNT  0
+#define STATS_FIELD_MEAN   1
+#define STATS_FIELD_P50    2
+#define STATS_FIELD_P90    3
+#define STATS_FIELD_P99    4
+#define STATS_FIELD_P999   5
+#define STATS_FIELD_MAX    6
+#define STATS_FIELDS       7
+
+#define STATS_RESET        1   // key of an RPC_STATS request that clears the stats
+#define STATS_LOCKS        4   // lock names an RPC_STATS reply has room for, locks of the same name are added up
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <rpc/rpc.h>
+
+#ifndef LOCKSTAT_H
+#include "lockstat.h"
+#endif
+
+#ifndef HOTKEYS_H
+#include "hotkeys.h"
+#endif
+
+
+// ONE LATENCY HISTOGRAM
+typedef struct stats_histogram {
+	uint64_t counts[STATS_BUCKETS];
+	uint64_t sum_us;
+	uint64_t max_us;
+} stats_histogram;
+
+// THE COUNTS OF ONE LOCK IN THE REPLY
+typedef struct stats_lock {
+	char name[LOCKSTAT_NAME_LENGTH];
+	u_int acquisitions;
+	u_int contended;
+	u_int wait_us;       // total wait
+	u_int max_hold_us;
+} stats_lock;
+
+// THE REPLY OF RPC_STATS
+typedef struct stats_reply {
+	u_int counters[STATS_COUNTERS];
+	u_int summary[STATS_HISTOGRAMS][STATS_FIELDS];
+	u_int lock_count;    // entries of locks that are used
+	u_int locks_dropped; // locks left out because every entry had another name, 0 if none
+	stats_lock locks[STATS_LOCKS];
+	hot_report hot[HOT_KINDS];  // the most read and the most written keys
+} stats_reply;
+
+// READ THEM WITH __ATOMIC_LOAD_N, THEY CHANGE UNDER THE READER
+extern stats_histogram stats_histograms[STATS_HISTOGRAMS];
+extern uint64_t stats_counters[STATS_COUNTERS];
+
+
+/*******************************************************************************
+ * RECORDS A LATENCY (MS) IN THE HISTOGRAM PROVIDED.  LOCK FREE.               *
+ ******************************************************************************/
+void stats_record(int histogram, double latency_ms);
+
+/*******************************************************************************
+ * RECORDS A LATENCY (MS) IN A HISTOGRAM THAT IS NOT ONE OF THE SERVER'S, FOR  *
+ * EXAMPLE ONE OF A CLIENT BENCHMARK.  LOCK FREE.                              *
+ ******************************************************************************/
+void stats_add(stats_histogram * histogram, double latency_ms);
+
+/*******************************************************************************
+ * RETURNS THE LATENCY (US) AT THE PERCENTILE PROVIDED (0 - 100) OF A          *
+ * HISTOGRAM THAT HOLDS TOTAL VALUES, THE HIGHEST VALUE OF ITS BUCKET.         *
+ ******************************************************************************/
+uint64_t stats_percentile(stats_histogram * histogram, uint64_t total, double percentile);
+
+/*******************************************************************************
+ * ADDS ONE TO THE COUNTER PROVIDED.  LOCK FREE.                               *
+ ******************************************************************************/
+void stats_count(int counter);
+
+/*******************************************************************************
+ * FILLS IN THE REPLY WITH THE COUNTERS AND A SUMMARY OF EVERY HISTOGRAM AND   *
+ * LOCK, LOCKS OF THE SAME NAME ADDED UP.  THE HOT KEYS ARE NOT LOCKED, CALL   *
+ * IT FROM THE THREAD THAT RECORDS THEM.                                       *
+ ******************************************************************************/
+void stats_snapshot(stats_reply * reply);
+
+/*******************************************************************************
+ * CLEARS EVERY HISTOGRAM AND COUNTER.  A VALUE RECORDED WHILE IT RUNS MAY BE  *
+ * HALF CLEARED.                                                               *
+ ******************************************************************************/
+void stats_reset();
+
+/*******************************************************************************
+ * PRINTS THE REPLY AS A TABLE TO THE FILE PROVIDED.                           *
+ ******************************************************************************/
+void stats_print(stats_reply * reply, FILE * out);
+
+/*******************************************************************************
+ * WRITES THE HISTOGRAM PROVIDED TO A FILE AS THE PERCENTILE DISTRIBUTION OF   *
+ * HDRHISTOGRAM (.HGRM, IN MS), SO THE HISTOGRAMS OF SEVERAL RUNS CAN BE       *
+ * PLOTTED TOGETHER.  RETURNS -1 IF THE FILE CANNOT BE WRITTEN.                *
+ ******************************************************************************/
+int stats_save(stats_histogram * histogram, char * filename);
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE HISTOGRAM OR THE COUNTER PROVIDED.                  *
+ ******************************************************************************/
+char * stats_histogram_name(int histogram);
+char * stats_counter_name(int counter);
+
+/*******************************************************************************
+ * RETURNS THE BUCKET OF THE VALUE PROVIDED, AND THE SMALLEST AND LARGEST      *
+ * VALUES OF A BUCKET.                                                         *
+ ******************************************************************************/
+int stats_bucket(uint64_t value);
+uint64_t stats_bucket_low(int bucket);
+uint64_t stats_bucket_high(int bucket);
+
+/*******************************************************************************
+ * XDR FILTER OF THE RPC_STATS REPLY                                           *
+ ******************************************************************************/
+bool_t xdr_stats(XDR * xdrs, stats_reply * reply);
+
+#endif /* STATS_H */
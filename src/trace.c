@@ -0,0 +1,270 @@
+/*
+ ============================================================================
+ Name        : trace.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.18
+ Description : Binary event trace.  See trace.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+
+// THE EVENTS ONE THREAD HAS NOT WRITTEN YET
+typedef struct trace_buffer {
+	trace_event events[TRACE_BUFFER_EVENTS];
+	int count;
+	int thread;
+	struct trace_buffer * next;   // every buffer, so they can be flushed at exit
+} trace_buffer;
+
+int trace_fd = -1;
+int trace_node = TRACE_NO_PEER;
+uint32_t trace_next_id = 0;
+trace_buffer * trace_buffers = NULL;
+int trace_threads = 0;
+pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;  // the buffer list and the file
+__thread trace_buffer * trace_mine = NULL;
+int trace_signals[2] = { -1, -1 };  // the signal handler writes the signal, the flush thread reads it
+
+void trace_write(trace_buffer * buffer);
+int trace_catch_signals();
+void trace_on_signal(int signal_number);
+void * trace_signal_thread(void * arg);
+
+
+/*******************************************************************************
+ * TURNS THE TRACE ON, WRITING TO THE FILE PROVIDED (TRUNCATED).  THE BUFFERS  *
+ * ARE WRITTEN OUT WHEN THE PROGRAM EXITS, AND WHEN IT IS STOPPED BY SIGINT OR *
+ * SIGTERM, LIKE A SERVER.  RETURNS -1 IF THE FILE CANNOT BE CREATED.          *
+ ******************************************************************************/
+int trace_open(char * filename)
+{
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return(-1);
+
+	trace_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version    = TRACE_VERSION;
+	header.event_size = sizeof(trace_event);
+	write(fd, &header, sizeof(header));
+
+	atexit(trace_flush);
+	trace_fd = fd;
+	if (trace_catch_signals() != 0)
+		fprintf(stderr, "The trace is only written out at exit, not on SIGINT or SIGTERM\n");
+	return(0);
+}
+
+
+/*******************************************************************************
+ * COPIES AN EVENT INTO THE BUFFER OF THE CALLING THREAD, WRITING THE BUFFER   *
+ * TO THE FILE WHEN IT IS FULL.  USE TRACE_EVENT RATHER THAN CALLING IT.       *
+ ******************************************************************************/
+void trace_record(int type, uint32_t id, int peer, int key, int value, int lc, int status, double latency_ms)
+{
+	trace_buffer * buffer = trace_mine;
+
+	// FIRST EVENT OF THIS THREAD
+	if (buffer == NULL)
+	{
+		buffer = (trace_buffer *) calloc(1, sizeof(trace_buffer));
+		if (buffer == NULL)
+			return;
+
+		pthread_mutex_lock(&trace_lock);
+		buffer->thread = trace_threads++;
+		buffer->next = trace_buffers;
+		trace_buffers = buffer;
+		pthread_mutex_unlock(&trace_lock);
+		trace_mine = buffer;
+	}
+
+	trace_event * event = &buffer->events[buffer->count];
+	event->time_ns    = trace_now_ns();
+	event->latency_us = (latency_ms > 0) ? (uint32_t) (latency_ms * 1000.0) : 0;
+	event->id         = id;
+	event->key        = key;
+	event->value      = value;
+	event->lc         = lc;
+	event->type       = (int16_t) type;
+	event->peer       = (int16_t) peer;
+	event->status     = (int16_t) status;
+	event->thread     = (int16_t) buffer->thread;
+	event->node       = (int16_t) trace_node;
+	event->unused     = 0;
+
+	if (++buffer->count == TRACE_BUFFER_EVENTS)
+	{
+		pthread_mutex_lock(&trace_lock);
+		trace_write(buffer);
+		pthread_mutex_unlock(&trace_lock);
+	}
+}
+
+
+/*******************************************************************************
+ * WRITES THE BUFFERS OF EVERY THREAD TO THE FILE.                             *
+ ******************************************************************************/
+void trace_flush()
+{
+	pthread_mutex_lock(&trace_lock);
+	for (trace_buffer * buffer = trace_buffers; buffer != NULL; buffer = buffer->next)
+		trace_write(buffer);
+	pthread_mutex_unlock(&trace_lock);
+}
+
+
+// WRITES ONE BUFFER AND EMPTIES IT, THE CALLER HOLDS TRACE_LOCK
+void trace_write(trace_buffer * buffer)
+{
+	if (buffer->count > 0 && trace_fd >= 0)
+		write(trace_fd, buffer->events, sizeof(trace_event) * buffer->count);
+	buffer->count = 0;
+}
+
+
+// A SIGNAL CAN LAND IN ANY THREAD AND A HANDLER CAN'T TAKE TRACE_LOCK, SO IT ONLY WAKES A THREAD THAT FLUSHES
+int trace_catch_signals()
+{
+	if (pipe(trace_signals) != 0)
+		return(-1);
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, trace_signal_thread, NULL) != 0)
+		return(-1);
+	pthread_detach(thread);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = trace_on_signal;
+	action.sa_flags   = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGINT, &action, NULL) != 0 || sigaction(SIGTERM, &action, NULL) != 0)
+		return(-1);
+	return(0);
+}
+
+
+// THE HANDLER OF SIGINT AND SIGTERM, WRITE IS SAFE IN A HANDLER
+void trace_on_signal(int signal_number)
+{
+	unsigned char number = (unsigned char) signal_number;
+	int saved = errno;
+	write(trace_signals[1], &number, 1);
+	errno = saved;
+}
+
+
+// WAITS FOR A SIGNAL, WRITES THE BUFFERS OUT AND LETS THE SIGNAL STOP THE PROGRAM AS IT WOULD HAVE.  AN EVENT BEING RECORDED RIGHT THEN MAY BE LOST
+void * trace_signal_thread(void * arg)
+{
+	(void) arg;
+	unsigned char number;
+	while (read(trace_signals[0], &number, 1) != 1)
+		if (errno != EINTR)
+			return(NULL);
+
+	trace_flush();
+	signal(number, SIG_DFL);
+	raise(number);
+	return(NULL);
+}
+
+
+/*******************************************************************************
+ * SETS THE NODE ID WRITTEN IN EVERY EVENT, A SERVER SETS IT TO ITS OWN.       *
+ ******************************************************************************/
+void trace_set_node(int node)
+{
+	trace_node = node;
+}
+
+
+/*******************************************************************************
+ * RETURNS A NEW TRACE ID.  IDS START AT A RANDOM POINT FOR EVERY PROCESS SO   *
+ * TWO CLIENTS ARE VERY UNLIKELY TO USE THE SAME ONE.  NEVER TRACE_NO_ID.      *
+ ******************************************************************************/
+uint32_t trace_new_id()
+{
+	uint32_t id = __atomic_load_n(&trace_next_id, __ATOMIC_RELAXED);
+	if (id == TRACE_NO_ID)
+	{
+		// MIX THE CLOCK AND THE PROCESS ID INTO THE FIRST ID
+		uint32_t seed = (uint32_t) (trace_now_ns() ^ ((uint64_t) getpid() << 16)) * 2654435761U;
+		uint32_t expected = TRACE_NO_ID;
+		__atomic_compare_exchange_n(&trace_next_id, &expected, seed, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	}
+
+	do
+		id = __atomic_fetch_add(&trace_next_id, 1, __ATOMIC_RELAXED);
+	while (id == TRACE_NO_ID);
+	return(id);
+}
+
+
+/*******************************************************************************
+ * OPENS A TRACE FILE FOR READING AND CHECKS ITS HEADER.  RETURNS THE FILE     *
+ * POSITIONED AT THE FIRST EVENT, OR NULL (WITH A MESSAGE PRINTED) IF IT       *
+ * CANNOT BE OPENED OR IS NOT A TRACE OF THIS VERSION.                         *
+ ******************************************************************************/
+FILE * trace_read_open(char * filename)
+{
+	FILE * fd = fopen(filename, "rb");
+	if (fd == NULL)
+	{
+		printf("Cannot open %s\n", filename);
+		return(NULL);
+	}
+
+	trace_header header;
+	if (fread(&header, sizeof(header), 1, fd) != 1
+	||  memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+	||  header.version != TRACE_VERSION
+	||  header.event_size != sizeof(trace_event))
+	{
+		printf("%s is not a version %d trace\n", filename, TRACE_VERSION);
+		fclose(fd);
+		return(NULL);
+	}
+
+	return(fd);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN NANOSECONDS.                                    *
+ ******************************************************************************/
+uint64_t trace_now_ns()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return((uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE EVENT TYPE PROVIDED.                                *
+ ******************************************************************************/
+char * trace_type_name(int type)
+{
+	char * names[TRACE_TYPES] = { "UNKNOWN", "GET", "PUT", "DEL",
+			"SEND_PREPARE", "SEND_ACCEPT", "SEND_LEARN",
+			"RECV_PREPARE", "RECV_ACCEPT", "RECV_LEARN", "RECONFIG", "CLIENT",
+			"MGET", "MPUT" };
+
+	if (type < 0 || type >= TRACE_TYPES)
+		return names[0];
+	return names[type];
+}
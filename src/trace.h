@@ -0,0 +1,135 @@
+/*
+ ============================================================================
+ Name        : trace.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.18
+ Description : Binary event trace.  Every event is a fixed 40 byte record that
+             : is copied into a buffer of the thread that recorded it; a full
+             : buffer is written to the trace file in one write.  The trace is
+             : off unless the server is started with -trace file, and then
+             : costs a clock read and a copy per event.  tracedump converts a
+             : trace file to text or CSV.
+             :
+             : Every client operation gets a trace id that travels in the pid
+             : of each message, so the PREPARE, ACCEPT and LEARN it causes are
+             : recorded under the same id on every server.  tracecollect reads
+             : the trace files of all the servers (and of the client) and puts
+             : the events of one operation back together as a timeline.
+ ============================================================================
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAGIC          "KVTRACE1"
+#define TRACE_VERSION        2
+#define TRACE_BUFFER_EVENTS  4096   // events a thread buffers before a write
+
+// EVENT TYPES
+#define TRACE_GET            1   // a client GET was answered
+#define TRACE_PUT            2   // a client PUT was answered
+#define TRACE_DEL            3   // a client DEL was answered
+#define TRACE_SEND_PREPARE   4   // a PREPARE to a peer returned
+#define TRACE_SEND_ACCEPT    5   // an ACCEPT to a peer returned
+#define TRACE_SEND_LEARN     6   // a LEARN to a peer returned
+#define TRACE_RECV_PREPARE   7   // this acceptor answered a PREPARE
+#define TRACE_RECV_ACCEPT    8   // this acceptor answered an ACCEPT
+#define TRACE_RECV_LEARN     9   // this learner answered a LEARN
+#define TRACE_RECONFIG       10  // a membership change was answered
+#define TRACE_CLIENT         11  // the client got the answer to an operation
+#define TRACE_MGET           12  // a client MGET was answered, key is the number of keys
+#define TRACE_MPUT           13  // a client MPUT was answered, key is the number of keys
+#define TRACE_TYPES          14
+
+#define TRACE_NO_PEER        -1  // the event was not about a peer, or not on a server
+#define TRACE_NO_ID          0   // the message is not part of a traced operation
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// ONE EVENT, ALWAYS 40 BYTES ON DISK (HOST BYTE ORDER)
+typedef struct trace_event {
+	uint64_t time_ns;     // wall clock time the event ended
+	uint32_t latency_us;  // how long it took, 0 if it was instant
+	uint32_t id;          // trace id of the client operation, TRACE_NO_ID if none
+	int32_t  key;
+	int32_t  value;
+	int32_t  lc;          // lamport clock of the message
+	int16_t  type;        // TRACE_GET ...
+	int16_t  peer;        // node id of the peer, TRACE_NO_PEER if none
+	int16_t  status;      // status of the reply (OK, NACK, PROMISE, ...) or the clnt_stat
+	int16_t  thread;      // small number of the thread that recorded it
+	int16_t  node;        // node id of the server that recorded it, TRACE_NO_PEER for a client
+	int16_t  unused;
+} trace_event;
+
+// THE START OF EVERY TRACE FILE
+typedef struct trace_header {
+	char magic[8];        // TRACE_MAGIC
+	int32_t version;      // TRACE_VERSION
+	int32_t event_size;   // sizeof(trace_event)
+} trace_header;
+
+extern int trace_fd;
+extern int trace_node;
+
+
+/*******************************************************************************
+ * RECORDS AN EVENT IF THE TRACE IS ON.  WHEN IT IS OFF THE ARGUMENTS ARE NOT  *
+ * EVALUATED.                                                                  *
+ ******************************************************************************/
+#define TRACE_EVENT(type, id, peer, key, value, lc, status, latency_ms) \
+	do { if (trace_fd >= 0) trace_record(type, id, peer, key, value, lc, status, latency_ms); } while (0)
+
+
+/*******************************************************************************
+ * TURNS THE TRACE ON, WRITING TO THE FILE PROVIDED (TRUNCATED).  THE BUFFERS  *
+ * ARE WRITTEN OUT WHEN THE PROGRAM EXITS, AND WHEN IT IS STOPPED BY SIGINT OR *
+ * SIGTERM, LIKE A SERVER.  RETURNS -1 IF THE FILE CANNOT BE CREATED.          *
+ ******************************************************************************/
+int trace_open(char * filename);
+
+/*******************************************************************************
+ * COPIES AN EVENT INTO THE BUFFER OF THE CALLING THREAD, WRITING THE BUFFER   *
+ * TO THE FILE WHEN IT IS FULL.  USE TRACE_EVENT RATHER THAN CALLING IT.       *
+ ******************************************************************************/
+void trace_record(int type, uint32_t id, int peer, int key, int value, int lc, int status, double latency_ms);
+
+/*******************************************************************************
+ * SETS THE NODE ID WRITTEN IN EVERY EVENT, A SERVER SETS IT TO ITS OWN.       *
+ ******************************************************************************/
+void trace_set_node(int node);
+
+/*******************************************************************************
+ * RETURNS A NEW TRACE ID.  IDS START AT A RANDOM POINT FOR EVERY PROCESS SO   *
+ * TWO CLIENTS ARE VERY UNLIKELY TO USE THE SAME ONE.  NEVER TRACE_NO_ID.      *
+ ******************************************************************************/
+uint32_t trace_new_id();
+
+/*******************************************************************************
+ * WRITES THE BUFFERS OF EVERY THREAD TO THE FILE.                             *
+ ******************************************************************************/
+void trace_flush();
+
+/*******************************************************************************
+ * OPENS A TRACE FILE FOR READING AND CHECKS ITS HEADER.  RETURNS THE FILE     *
+ * POSITIONED AT THE FIRST EVENT, OR NULL (WITH A MESSAGE PRINTED) IF IT       *
+ * CANNOT BE OPENED OR IS NOT A TRACE OF THIS VERSION.                         *
+ ******************************************************************************/
+FILE * trace_read_open(char * filename);
+
+/*******************************************************************************
+ * RETURNS THE CURRENT TIME IN NANOSECONDS.                                    *
+ ******************************************************************************/
+uint64_t trace_now_ns();
+
+/*******************************************************************************
+ * RETURNS THE NAME OF THE EVENT TYPE PROVIDED.                                *
+ ******************************************************************************/
+char * trace_type_name(int type);
+
+#endif /* TRACE_H */
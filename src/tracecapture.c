@@ -0,0 +1,71 @@
+/*
+ ============================================================================
+ Name        : tracecapture.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.08
+ Description : Turns what a production run left behind into a workload file
+             : that tcss558 bench -replay sends again (see replay.h):
+             :
+             :     tracecapture [-o workload_file] capture_file ...
+             :
+             : A capture is the client.log of a client or the binary trace
+             : of a server (tcss558 server -trace), told apart by the trace
+             : magic.  The operations of every capture are merged in time
+             : order, so the logs of several clients or the traces of every
+             : server make one workload.  Capture either the clients or the
+             : servers of a run, not both, or its operations are in twice.
+             : The clocks of the hosts are not synchronized, so the merged
+             : timing is only as good as the clocks.  MGETs and MPUTs are
+             : skipped, neither capture has their keys.  Without -o the
+             : workload is written to stdout.
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef REPLAY_H
+#include "replay.h"
+#endif
+
+
+/*******************************************************
+ * READS EVERY CAPTURE PROVIDED AND WRITES THEIR       *
+ * OPERATIONS AS ONE WORKLOAD.  RETURNS -1 IF A FILE   *
+ * CANNOT BE READ OR THE WORKLOAD CANNOT BE WRITTEN.   *
+ ******************************************************/
+int main(int argc, char * argv[])
+{
+	char * output = NULL;
+	int files = 0;
+	replay_workload * workload = replay_new();
+	if (workload == NULL)
+		return(-1);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (replay_capture(workload, argv[i]) != 0)
+			return(-1);
+		else
+			files++;
+	}
+
+	if (files == 0)
+	{
+		printf("Usage: tracecapture [-o workload_file] capture_file ...\n");
+		return(-1);
+	}
+
+	replay_finish(workload);
+	if (replay_save(workload, output) != 0)
+	{
+		printf("Cannot write %s\n", output);
+		return(-1);
+	}
+
+	double span = (workload->count > 0) ? workload->ops[workload->count - 1].offset_ms : 0;
+	fprintf(stderr, "%d operations over %.3f s, %d skipped\n", workload->count, span / 1000.0, workload->skipped);
+	replay_free(workload);
+	return(0);
+}
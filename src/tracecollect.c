@@ -0,0 +1,286 @@
+/*
+ ============================================================================
+ Name        : tracecollect.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.21
+ Description : Puts the events of client operations back together from the
+             : trace files of every server (and of the client), using the
+             : trace id every message carries:
+             :
+             :     tracecollect [-id trace_id] [-top n] trace_file ...
+             :
+             : With -id it prints the timeline of that operation.  Otherwise
+             : it prints the timelines of the n slowest operations (10 by
+             : default) and which phase and peer was the slowest hop of each,
+             : so a tail latency can be pinned on one peer or one phase.  The
+             : servers' clocks are not synchronized, so offsets between
+             : events of different nodes are only as good as the clocks.
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+#define COLLECT_DEFAULT_TOP  10
+
+// THE EVENTS OF ONE OPERATION, A RANGE OF THE SORTED EVENTS
+typedef struct collect_operation {
+	int first;           // index of its first event
+	int count;           // number of events
+	uint32_t latency_us; // how long the operation took
+} collect_operation;
+
+int collect_load(char * filename, trace_event ** events, int * count, int * capacity);
+int collect_by_start(const void * a, const void * b);
+int collect_by_latency(const void * a, const void * b);
+uint32_t collect_latency(trace_event * events, int count);
+int collect_slowest_hop(trace_event * events, int count);
+void collect_print(trace_event * events, int count);
+uint64_t collect_start(trace_event * event);
+
+
+/*******************************************************
+ * READS EVERY TRACE FILE PROVIDED AND PRINTS THE      *
+ * TIMELINES ASKED FOR.  RETURNS -1 IF A FILE IS NOT A *
+ * TRACE OR THE TRACE ID IS NOT FOUND.                 *
+ ******************************************************/
+int main(int argc, char * argv[])
+{
+	uint32_t wanted = TRACE_NO_ID;
+	int top = COLLECT_DEFAULT_TOP;
+	trace_event * events = NULL;
+	int count = 0;
+	int capacity = 0;
+	int files = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-id") == 0 && i + 1 < argc)
+			wanted = (uint32_t) strtoul(argv[++i], NULL, 16);
+		else if (strcmp(argv[i], "-top") == 0 && i + 1 < argc)
+			top = atoi(argv[++i]);
+		else if (collect_load(argv[i], &events, &count, &capacity) != 0)
+			return(-1);
+		else
+			files++;
+	}
+
+	if (files == 0)
+	{
+		printf("Usage: tracecollect [-id trace_id] [-top n] trace_file ...\n");
+		return(-1);
+	}
+
+	// EVERY OPERATION IS A RUN OF EVENTS WITH THE SAME ID, IN THE ORDER THEY STARTED
+	qsort(events, count, sizeof(trace_event), collect_by_start);
+
+	collect_operation * operations = (collect_operation *) malloc(sizeof(collect_operation) * (count + 1));
+	int operation_count = 0;
+	for (int i = 0; i < count; )
+	{
+		int j = i;
+		while (j < count && events[j].id == events[i].id)
+			j++;
+
+		operations[operation_count].first      = i;
+		operations[operation_count].count      = j - i;
+		operations[operation_count].latency_us = collect_latency(&events[i], j - i);
+		operation_count++;
+		i = j;
+	}
+
+	fprintf(stderr, "%d events, %d operations\n", count, operation_count);
+
+	if (wanted != TRACE_NO_ID)
+	{
+		for (int i = 0; i < operation_count; i++)
+		{
+			if (events[operations[i].first].id == wanted)
+			{
+				collect_print(&events[operations[i].first], operations[i].count);
+				return(0);
+			}
+		}
+		printf("No events with the trace id %08x\n", wanted);
+		return(-1);
+	}
+
+	// THE SLOWEST OPERATIONS, EACH WITH ITS TIMELINE AND ITS SLOWEST HOP
+	qsort(operations, operation_count, sizeof(collect_operation), collect_by_latency);
+	if (top > operation_count)
+		top = operation_count;
+
+	for (int i = 0; i < top; i++)
+	{
+		collect_print(&events[operations[i].first], operations[i].count);
+		printf("\n");
+	}
+
+	printf("SLOWEST HOP OF THE %d SLOWEST OPERATIONS\n", top);
+	for (int i = 0; i < top; i++)
+	{
+		trace_event * first = &events[operations[i].first];
+		int hop = collect_slowest_hop(first, operations[i].count);
+		if (hop < 0)
+			printf("%08x %9.3fms  no peer calls\n", first->id, operations[i].latency_us / 1000.0);
+		else
+			printf("%08x %9.3fms  %-12s node %d -> peer %d  %.3fms\n", first->id,
+					operations[i].latency_us / 1000.0, trace_type_name(first[hop].type),
+					first[hop].node, first[hop].peer, first[hop].latency_us / 1000.0);
+	}
+
+	free(operations);
+	free(events);
+	return(0);
+}
+
+
+// APPENDS THE TRACED EVENTS OF THE FILE TO THE ARRAY, RETURNS -1 IF IT IS NOT A TRACE
+int collect_load(char * filename, trace_event ** events, int * count, int * capacity)
+{
+	FILE * fd = trace_read_open(filename);
+	if (fd == NULL)
+		return(-1);
+
+	trace_event event;
+	while (fread(&event, sizeof(event), 1, fd) == 1)
+	{
+		if (event.id == TRACE_NO_ID)
+			continue;
+
+		if (*count == *capacity)
+		{
+			int grown = (*capacity == 0) ? TRACE_BUFFER_EVENTS : *capacity * 2;
+			trace_event * larger = (trace_event *) realloc(*events, sizeof(trace_event) * grown);
+			if (larger == NULL)
+			{
+				printf("Out of memory after %d events\n", *count);
+				fclose(fd);
+				return(-1);
+			}
+			*events = larger;
+			*capacity = grown;
+		}
+		(*events)[(*count)++] = event;
+	}
+
+	fclose(fd);
+	return(0);
+}
+
+
+// ORDERS EVENTS BY TRACE ID, THEN BY THE TIME THEY STARTED
+int collect_by_start(const void * a, const void * b)
+{
+	trace_event * x = (trace_event *) a;
+	trace_event * y = (trace_event *) b;
+
+	if (x->id != y->id)
+		return(x->id < y->id ? -1 : 1);
+
+	uint64_t x_start = collect_start(x);
+	uint64_t y_start = collect_start(y);
+	if (x_start != y_start)
+		return(x_start < y_start ? -1 : 1);
+	return(0);
+}
+
+
+// ORDERS OPERATIONS FROM THE SLOWEST TO THE FASTEST
+int collect_by_latency(const void * a, const void * b)
+{
+	collect_operation * x = (collect_operation *) a;
+	collect_operation * y = (collect_operation *) b;
+
+	if (x->latency_us != y->latency_us)
+		return(x->latency_us > y->latency_us ? -1 : 1);
+	return(0);
+}
+
+
+// THE LATENCY THE CLIENT SAW, OR THE PROPOSER IF THE CLIENT WASN'T TRACED, OR THE SPAN OF THE EVENTS
+uint32_t collect_latency(trace_event * events, int count)
+{
+	uint32_t client = 0;
+	uint32_t proposer = 0;
+	uint64_t first = collect_start(&events[0]);
+	uint64_t last = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		switch (events[i].type)
+		{
+		case TRACE_CLIENT:
+			if (events[i].latency_us > client)
+				client = events[i].latency_us;
+			break;
+		case TRACE_GET:
+		case TRACE_PUT:
+		case TRACE_DEL:
+		case TRACE_RECONFIG:
+		case TRACE_MGET:
+		case TRACE_MPUT:
+			if (events[i].latency_us > proposer)
+				proposer = events[i].latency_us;
+			break;
+		}
+		if (events[i].time_ns > last)
+			last = events[i].time_ns;
+	}
+
+	if (client > 0)
+		return(client);
+	if (proposer > 0)
+		return(proposer);
+	return((uint32_t) ((last - first) / 1000));
+}
+
+
+// RETURNS THE INDEX OF THE SLOWEST PEER CALL OF THE OPERATION, -1 IF IT MADE NONE
+int collect_slowest_hop(trace_event * events, int count)
+{
+	int slowest = -1;
+	for (int i = 0; i < count; i++)
+	{
+		if (events[i].type != TRACE_SEND_PREPARE && events[i].type != TRACE_SEND_ACCEPT
+		&&  events[i].type != TRACE_SEND_LEARN)
+			continue;
+
+		if (slowest < 0 || events[i].latency_us > events[slowest].latency_us)
+			slowest = i;
+	}
+	return(slowest);
+}
+
+
+// PRINTS ONE OPERATION, EVERY EVENT AS ITS START AND END RELATIVE TO THE FIRST ONE
+void collect_print(trace_event * events, int count)
+{
+	uint64_t origin = collect_start(&events[0]);
+
+	printf("OPERATION %08x  K=%d  %.3fms  %d events\n", events[0].id, events[0].key,
+			collect_latency(events, count) / 1000.0, count);
+	for (int i = 0; i < count; i++)
+	{
+		char node[16];
+		if (events[i].node == TRACE_NO_PEER)
+			strcpy(node, "client");
+		else
+			sprintf(node, "N%d", events[i].node);
+
+		printf("  +%9.3fms %9.3fms  %-6s %-12s peer=%-3d status=%-3d V=%d L=%d\n",
+				(collect_start(&events[i]) - origin) / 1e6, events[i].latency_us / 1000.0,
+				node, trace_type_name(events[i].type), events[i].peer, events[i].status,
+				events[i].value, events[i].lc);
+	}
+}
+
+
+// THE TIME THE EVENT STARTED, AN EVENT IS RECORDED WHEN IT ENDS
+uint64_t collect_start(trace_event * event)
+{
+	return(event->time_ns - (uint64_t) event->latency_us * 1000ULL);
+}
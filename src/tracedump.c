@@ -0,0 +1,78 @@
+/*
+ ============================================================================
+ Name        : tracedump.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.03.18
+ Description : Converts a binary trace written by tcss558 -trace to text or
+             : CSV:   tracedump [-csv] trace.bin
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef TRACE_H
+#include "trace.h"
+#endif
+
+#include <time.h>
+
+
+/*******************************************************
+ * READS THE TRACE FILE PROVIDED AND PRINTS ONE LINE   *
+ * PER EVENT.  RETURNS -1 IF THE FILE IS NOT A TRACE.  *
+ ******************************************************/
+int main(int argc, char * argv[])
+{
+	int csv = 0;
+	char * filename = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-csv") == 0)
+			csv = 1;
+		else
+			filename = argv[i];
+	}
+
+	if (filename == NULL)
+	{
+		printf("Usage: tracedump [-csv] trace_file\n");
+		return(-1);
+	}
+
+	FILE * fd = trace_read_open(filename);
+	if (fd == NULL)
+		return(-1);
+
+	if (csv)
+		printf("time_ns,node,thread,id,type,peer,key,value,lc,status,latency_us\n");
+
+	trace_event event;
+	long count = 0;
+	while (fread(&event, sizeof(event), 1, fd) == 1)
+	{
+		if (csv)
+		{
+			printf("%llu,%d,%d,%08x,%s,%d,%d,%d,%d,%d,%u\n", (unsigned long long) event.time_ns,
+					event.node, event.thread, event.id, trace_type_name(event.type), event.peer, event.key,
+					event.value, event.lc, event.status, event.latency_us);
+		} else {
+			// SAME TIMESTAMP AS THE TEXT LOG, BUT TO THE MICROSECOND
+			time_t seconds = (time_t) (event.time_ns / 1000000000ULL);
+			struct tm local;
+			char date[26];
+			localtime_r(&seconds, &local);
+			strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+
+			printf("%s.%06d N%-2d T%-2d id=%08x %-12s peer=%-3d K=%d V=%d L=%d status=%d latency=%.3fms\n",
+					date, (int) ((event.time_ns / 1000) % 1000000), event.node, event.thread, event.id,
+					trace_type_name(event.type), event.peer, event.key, event.value,
+					event.lc, event.status, event.latency_us / 1000.0);
+		}
+		count++;
+	}
+
+	fclose(fd);
+	fprintf(stderr, "%ld events\n", count);
+	return(0);
+}
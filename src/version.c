@@ -0,0 +1,187 @@
+/*
+ ============================================================================
+ Name        : version.c
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.06
+ Description : Versions of the writes and session tokens.  See version.h
+ ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#ifndef VERSION_H
+#include "version.h"
+#endif
+
+int version_slot(version_table * table, int key);
+int version_grow(version_table * table);
+int version_hash(int key);
+
+
+/*******************************************************************************
+ * RETURNS A NEW EMPTY TABLE, OR NULL IF THERE IS NO MEMORY.                   *
+ ******************************************************************************/
+version_table * version_new()
+{
+	version_table * table = (version_table *) calloc(1, sizeof(version_table));
+	if (table == NULL)
+		return(NULL);
+
+	table->capacity = VERSION_INITIAL_SLOTS;
+	table->keys     = (int *) calloc(table->capacity, sizeof(int));
+	table->versions = (int *) calloc(table->capacity, sizeof(int));
+	if (table->keys == NULL || table->versions == NULL)
+	{
+		version_free(table);
+		return(NULL);
+	}
+	return(table);
+}
+
+
+/*******************************************************************************
+ * FREES THE TABLE.                                                            *
+ ******************************************************************************/
+void version_free(version_table * table)
+{
+	if (table == NULL)
+		return;
+	free(table->keys);
+	free(table->versions);
+	free(table);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE VERSION LAST APPLIED TO THE KEY, VERSION_NONE IF IT NEVER WAS.  *
+ ******************************************************************************/
+int version_get(version_table * table, int key)
+{
+	if (table == NULL)
+		return(VERSION_NONE);
+	return(table->versions[version_slot(table, key)]);
+}
+
+
+/*******************************************************************************
+ * RECORDS THAT THE WRITE OF THE VERSION PROVIDED WAS APPLIED TO THE KEY.  A   *
+ * LOWER VERSION THAN THE ONE RECORDED IS IGNORED.  RETURNS -1 IF THE TABLE    *
+ * COULD NOT GROW, 0 OTHERWISE.                                                *
+ ******************************************************************************/
+int version_set(version_table * table, int key, int version)
+{
+	if (table == NULL || version <= VERSION_NONE)
+		return(0);
+
+	int slot = version_slot(table, key);
+	if (table->versions[slot] == VERSION_NONE)
+	{
+		// A NEW KEY, KEEP A QUARTER OF THE SLOTS FREE SO THE PROBES STAY SHORT
+		if ((table->size + 1) * 4 > table->capacity * 3)
+		{
+			if (version_grow(table) != 0)
+				return(-1);
+			slot = version_slot(table, key);
+		}
+		table->keys[slot] = key;
+		table->size++;
+	}
+	if (version > table->versions[slot])
+		table->versions[slot] = version;
+	return(0);
+}
+
+
+/*******************************************************************************
+ * RETURNS A NEW SESSION WITHOUT ANY TOKEN, OR NULL IF THERE IS NO MEMORY.     *
+ ******************************************************************************/
+version_session * version_session_new()
+{
+	return((version_session *) calloc(1, sizeof(version_session)));
+}
+
+
+/*******************************************************************************
+ * FREES THE SESSION.                                                          *
+ ******************************************************************************/
+void version_session_free(version_session * session)
+{
+	free(session);
+}
+
+
+/*******************************************************************************
+ * RETURNS THE TOKEN A GET OF THE KEY CARRIES: THE HIGHEST VERSION THE SESSION *
+ * HAS SEEN OF THE KEY (OR OF ANOTHER KEY OF ITS BUCKET), VERSION_NONE IF IT   *
+ * HAS SEEN NONE.                                                              *
+ ******************************************************************************/
+int version_token(version_session * session, int key)
+{
+	if (session == NULL)
+		return(VERSION_NONE);
+	int bucket = (int) ((uint32_t) version_hash(key) % VERSION_SESSION_BUCKETS);
+	return(__atomic_load_n(&session->tokens[bucket], __ATOMIC_RELAXED));
+}
+
+
+/*******************************************************************************
+ * RECORDS A VERSION OF THE KEY THE SESSION HAS SEEN, IN THE REPLY TO ITS      *
+ * WRITE OR READ.  THE TOKEN ONLY EVER GOES UP.                                *
+ ******************************************************************************/
+void version_observe(version_session * session, int key, int version)
+{
+	if (session == NULL || version <= VERSION_NONE)
+		return;
+	int * token = &session->tokens[(uint32_t) version_hash(key) % VERSION_SESSION_BUCKETS];
+	int seen = __atomic_load_n(token, __ATOMIC_RELAXED);
+	while (version > seen && !__atomic_compare_exchange_n(token, &seen, version, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;  // ANOTHER THREAD MOVED IT, SEEN HAS ITS VALUE NOW
+}
+
+
+// THE SLOT OF THE KEY, OR THE FREE SLOT IT WOULD GO IN.  THERE IS ALWAYS A FREE ONE
+int version_slot(version_table * table, int key)
+{
+	int mask = table->capacity - 1;
+	int slot = version_hash(key) & mask;
+	while (table->versions[slot] != VERSION_NONE && table->keys[slot] != key)
+		slot = (slot + 1) & mask;
+	return(slot);
+}
+
+
+// DOUBLES THE SLOTS AND PUTS EVERY KEY BACK, -1 IF THERE IS NO MEMORY (THE TABLE IS LEFT AS IT WAS)
+int version_grow(version_table * table)
+{
+	version_table bigger = { 0 };
+	bigger.capacity = table->capacity * 2;
+	bigger.keys     = (int *) calloc(bigger.capacity, sizeof(int));
+	bigger.versions = (int *) calloc(bigger.capacity, sizeof(int));
+	if (bigger.keys == NULL || bigger.versions == NULL)
+	{
+		free(bigger.keys);
+		free(bigger.versions);
+		return(-1);
+	}
+
+	for (int i = 0; i < table->capacity; i++)
+		if (table->versions[i] != VERSION_NONE)
+		{
+			int slot = version_slot(&bigger, table->keys[i]);
+			bigger.keys[slot]     = table->keys[i];
+			bigger.versions[slot] = table->versions[i];
+		}
+	bigger.size = table->size;
+
+	free(table->keys);
+	free(table->versions);
+	*table = bigger;
+	return(0);
+}
+
+
+// SPREADS NEIGHBOURING KEYS OVER THE SLOTS, LIKE LEASE_BUCKET
+int version_hash(int key)
+{
+	return((int) (((uint32_t) key * 0x9E3779B1U) >> 1));
+}
@@ -0,0 +1,96 @@
+/*
+ ============================================================================
+ Name        : version.h
+ Author      : Kevin Anderson <k3a@uw.edu> & Daniel Kristiyanto <danielkr@uw.edu>
+ Version     : 2015.04.06
+ Description : Versions of the writes, for read-your-writes sessions.  The
+             : version of a PUT or DEL is the lamport clock of the proposal a
+             : quarom accepted, and the reply to the writer carries it.  Every
+             : learner keeps the version it last applied to every key (a
+             : version_table), so a GET that carries the version of the
+             : client's own last write of the key (a session token) can be
+             : answered by any server that has applied at least that much,
+             : without a read quarom.
+             :
+             : The table of a server is exact, one slot per key ever written,
+             : and grows like the store.  Only the rpc thread uses it, so
+             : nothing is locked.  The tokens of a client (a version_session)
+             : share VERSION_SESSION_BUCKETS slots: a bucket keeps the highest
+             : version of any of its keys, so a token is never too low, only
+             : sometimes higher than it has to be.  The client threads update
+             : it with atomics.
+ ============================================================================
+ */
+
+#ifndef VERSION_H
+#define VERSION_H
+
+#define VERSION_NONE             0      // no write seen, every version is higher
+#define VERSION_INITIAL_SLOTS    1024   // slots of a new table, it doubles when 3/4 full
+#define VERSION_SESSION_BUCKETS  4096   // tokens a session keeps, the keys share them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+
+// THE VERSION A LEARNER LAST APPLIED TO EVERY KEY, OPEN ADDRESSING
+typedef struct version_table {
+	int capacity;
+	int size;
+	int * keys;
+	int * versions;     // VERSION_NONE in a free slot
+} version_table;
+
+// THE SESSION TOKENS OF A CLIENT
+typedef struct version_session {
+	int tokens[VERSION_SESSION_BUCKETS];
+} version_session;
+
+
+/*******************************************************************************
+ * RETURNS A NEW EMPTY TABLE, OR NULL IF THERE IS NO MEMORY.                   *
+ ******************************************************************************/
+version_table * version_new();
+
+/*******************************************************************************
+ * FREES THE TABLE.                                                            *
+ ******************************************************************************/
+void version_free(version_table * table);
+
+/*******************************************************************************
+ * RETURNS THE VERSION LAST APPLIED TO THE KEY, VERSION_NONE IF IT NEVER WAS.  *
+ ******************************************************************************/
+int version_get(version_table * table, int key);
+
+/*******************************************************************************
+ * RECORDS THAT THE WRITE OF THE VERSION PROVIDED WAS APPLIED TO THE KEY.  A   *
+ * LOWER VERSION THAN THE ONE RECORDED IS IGNORED.  RETURNS -1 IF THE TABLE    *
+ * COULD NOT GROW, 0 OTHERWISE.                                                *
+ ******************************************************************************/
+int version_set(version_table * table, int key, int version);
+
+/*******************************************************************************
+ * RETURNS A NEW SESSION WITHOUT ANY TOKEN, OR NULL IF THERE IS NO MEMORY.     *
+ ******************************************************************************/
+version_session * version_session_new();
+
+/*******************************************************************************
+ * FREES THE SESSION.                                                          *
+ ******************************************************************************/
+void version_session_free(version_session * session);
+
+/*******************************************************************************
+ * RETURNS THE TOKEN A GET OF THE KEY CARRIES: THE HIGHEST VERSION THE SESSION *
+ * HAS SEEN OF THE KEY (OR OF ANOTHER KEY OF ITS BUCKET), VERSION_NONE IF IT   *
+ * HAS SEEN NONE.                                                              *
+ ******************************************************************************/
+int version_token(version_session * session, int key);
+
+/*******************************************************************************
+ * RECORDS A VERSION OF THE KEY THE SESSION HAS SEEN, IN THE REPLY TO ITS      *
+ * WRITE OR READ.  THE TOKEN ONLY EVER GOES UP.                                *
+ ******************************************************************************/
+void version_observe(version_session * session, int key, int version);
+
+#endif /* VERSION_H */
@@ -32,6 +32,18 @@ int xdr_rpc(XDR * xdr, xdrMsg * content)
 					  return(0);
 		if (!xdr_int(xdr, &content->pid))
 		              return (0);
+		if (!xdr_int(xdr, &content->deadline))
+		              return (0);
+		if (!xdr_int(xdr, &content->hint))
+		              return (0);
+		if (!xdr_int(xdr, &content->lease))
+		              return (0);
+		if (!xdr_int(xdr, &content->consistency))
+		              return (0);
+		if (!xdr_int(xdr, &content->staleness))
+		              return (0);
+		if (!xdr_int(xdr, &content->version))
+		              return (0);
 
 		return (1);
 }
@@ -52,3 +64,46 @@ int xdr_compare(xdrMsg * a, xdrMsg * b)
 		return(-1);
 	}
 }
+
+
+/*******************************************************
+ * XDR OF AN XDRBATCH: THE HEADER, THEN COUNT ENTRIES.  *
+ * FAILS IF COUNT IS MORE THAN RPC_BATCH_MAX.           *
+ ******************************************************/
+int xdr_batch(XDR * xdr, xdrBatch * content)
+{
+	if (!xdr_int(xdr, &content->status)
+	||  !xdr_int(xdr, &content->command)
+	||  !xdr_int(xdr, &content->lc)
+	||  !xdr_int(xdr, &content->pid)
+	||  !xdr_int(xdr, &content->deadline)
+	||  !xdr_int(xdr, &content->hint)
+	||  !xdr_int(xdr, &content->lease)
+	||  !xdr_int(xdr, &content->version)
+	||  !xdr_int(xdr, &content->count))
+		return (0);
+
+	if (content->count < 0 || content->count > RPC_BATCH_MAX)
+		return (0);
+
+	for (int i = 0; i < content->count; i++)
+		if (!xdr_int(xdr, &content->keys[i])
+		||  !xdr_int(xdr, &content->values[i])
+		||  !xdr_int(xdr, &content->results[i]))
+			return (0);
+
+	return (1);
+}
+
+
+// FNV-1A OF THE KEYS AND VALUES, SO TWO BATCHES ONLY MATCH IF THEY PUT THE SAME THINGS
+int xdr_batch_digest(xdrBatch * batch)
+{
+	uint32_t digest = 2166136261U;
+	for (int i = 0; i < batch->count; i++)
+	{
+		digest = (digest ^ (uint32_t) batch->keys[i]) * 16777619U;
+		digest = (digest ^ (uint32_t) batch->values[i]) * 16777619U;
+	}
+	return((int) digest);
+}
@@ -15,6 +15,7 @@
 // GENERAL, ALL PURPOSE
 #define RPC_PROG_NUM   0x20000001
 #define RPC_PROC_VER   1
+#define RPC_CLIENT_TIMEOUT_MS 5000  // how long a client waits for a proposer
 
 
 // TO DELETE
@@ -39,6 +40,32 @@
 // ACCEPTOR TO LEARNER
 #define RPC_LEARN      8
 
+// SERVER TO SERVER (FAILURE DETECTOR)
+#define RPC_HEARTBEAT  9
+
+// ADMIN TO PROPOSER (MEMBERSHIP CHANGES)
+#define RPC_RECONFIG   10
+
+// MEMBERSHIP COMMANDS, THE IPV4 ADDRESS OF THE SERVER IS IN VALUE, ITS NODE ID IN KEY
+#define CONFIG_ADD_NODE 11
+#define CONFIG_DEL_NODE 12
+#define CONFIG_CATCHUP  13  // PUT A KEY OF THE VERSION IN LC UNLESS THE LEARNER APPLIED A NEWER WRITE OF IT
+
+// PROCEDURE THAT RETURNS THE LATENCY HISTOGRAMS AND COUNTERS (SEE STATS.H)
+#define RPC_STATS      14
+
+// CLIENT TO PROPOSER, MANY KEYS IN ONE XDRBATCH: ONE READ ROUND, OR ONE PAXOS INSTANCE FOR ALL THE PUTS
+#define RPC_MGET       15
+#define RPC_MPUT       16
+
+// PROPOSER TO LEARNER, THE KEYS OF AN RPC_MGET OR THE PUTS OF AN RPC_MPUT (THE COMMAND OF THE BATCH)
+#define RPC_LEARN_BATCH 17
+
+// PROPOSER TO ACCEPTOR, THE ACCEPT OF AN RPC_MPUT WITH THE WHOLE BATCH IN IT
+#define RPC_ACCEPT_BATCH 18
+
+#define RPC_BATCH_MAX  128  // keys of one xdrBatch
+
 // GENERAL MESSAGE TYPES
 #define NACK          -1
 #define FAILURE       -2
@@ -49,6 +76,15 @@
 #define ACCEPT         7
 #define LEARN          8
 
+// THE HINT OF A REPLY WHEN THE SERVER DOESN'T KNOW THE LEADER
+#define RPC_NO_HINT   -1
+
+// CONSISTENCY OF A GET
+#define READ_QUORUM        0  // a read quarom of learners agrees on the value (the default)
+#define READ_LINEARIZABLE  1  // the read is ordered by a paxos round first, then read by a majority or more
+#define READ_LOCAL         2  // the server's own store, no other server is asked
+#define READ_LEVELS        3
+
 
 
 /********************************************************
@@ -61,10 +97,39 @@ typedef struct msgRpc{
 	int status;   // the 'type' of message NACK, PREPARE, ETC
 	int command;  // the command to execute
 	int lc;   // lamport clock of message
-	int pid;  // process id
+	int pid;  // trace id of the client operation (see trace.h), 0 if it has none
+	int deadline; // ms the sender will wait for the reply (0 = no deadline)
+	int hint;     // node id of the leader, where the client should send its writes (RPC_NO_HINT if unknown)
+	int lease;    // ms of read lease a GET asks for or was granted, a write must wait out, a write's deadline cut off, or the longest a heartbeat's replier granted (see lease.h)
+	int consistency; // READ_QUORUM, READ_LINEARIZABLE or READ_LOCAL of a GET
+	int staleness;   // ms a READ_LOCAL GET may lag (0 = any), in the reply how much it did
+	int version;     // commit version of a PUT or DEL reply, the least a GET's answer may be (a session token, see version.h), of the value in a GET reply
 } xdrMsg;
 
+/********************************************************
+ * MANY KEYS OF ONE RPC_MGET OR RPC_MPUT.  ONLY THE      *
+ * FIRST COUNT ENTRIES ARE TRANSMITTED.                  *
+ *******************************************************/
+typedef struct xdrBatch {
+	int status;   // OK if every key is, NACK otherwise
+	int command;  // RPC_MGET or RPC_MPUT
+	int lc;
+	int pid;
+	int deadline;
+	int hint;
+	int lease;    // ms of read lease the learners of an RPC_MPUT reported, in the reply the ms its deadline cut off
+	int version;  // commit version of every put of an RPC_MPUT, in the reply
+	int count;
+	int keys[RPC_BATCH_MAX];
+	int values[RPC_BATCH_MAX];
+	int results[RPC_BATCH_MAX];  // OK or NACK per key, in the reply
+} xdrBatch;
+
 int xdr_rpc(XDR* xdr, xdrMsg* content);
+int xdr_batch(XDR* xdr, xdrBatch* content);
 int xdr_compare(xdrMsg * a, xdrMsg * b);
 
+// A DIGEST OF THE KEYS AND VALUES OF A BATCH, THE VALUE ITS PAXOS INSTANCE AGREES ON
+int xdr_batch_digest(xdrBatch * batch);
+
 #endif